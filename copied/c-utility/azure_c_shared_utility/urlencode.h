@@ -24,6 +24,16 @@ extern "C" {
     MOCKABLE_FUNCTION(, STRING_HANDLE, URL_Encode, STRING_HANDLE, input);
     MOCKABLE_FUNCTION(, STRING_HANDLE, URL_EncodeString, const char*, textEncode);
 
+    /* NUVOTON: Exact-length encoding into caller buffer, without STRING
+    *
+    * URL_EncodedLength() returns the length of the encoding of the first @p length characters of
+    * @p text, terminator not included. URL_EncodeToBuffer() writes it with terminator, which
+    * takes URL_EncodedLength() + 1 bytes of @p buffer. It returns 0 on success, non-zero if
+    * @p bufferSize is too small.
+    */
+    MOCKABLE_FUNCTION(, size_t, URL_EncodedLength, const char*, text, size_t, length);
+    MOCKABLE_FUNCTION(, int, URL_EncodeToBuffer, const char*, text, size_t, length, char*, buffer, size_t, bufferSize);
+
     /* @brief   URL Decode (aka percent decode) a string.
     * Please note that the URL decoder only supports decoding characters that fall within the
     * 7-bit ASCII range. It does NOT support 8-bit extended ASCII, and will fail if you try.
@@ -28,6 +28,8 @@ MOCKABLE_INTERFACE(vector,
 
     /* insertion */
     FUNCTION(, int, VECTOR_push_back, VECTOR_HANDLE, handle, const void*, elements, size_t, numElements),
+    /* NUVOTON: Append numElements uninitialized elements and return the first, to construct in place without copy */
+    FUNCTION(, void*, VECTOR_emplace_back, VECTOR_HANDLE, handle, size_t, numElements),
 
     /* removal */
     FUNCTION(, void, VECTOR_erase, VECTOR_HANDLE, handle, void*, elements, size_t, numElements),
@@ -40,7 +42,11 @@ MOCKABLE_INTERFACE(vector,
     FUNCTION(, void*, VECTOR_find_if, VECTOR_HANDLE, handle, PREDICATE_FUNCTION, pred, const void*, value),
 
     /* capacity */
-    FUNCTION(, size_t, VECTOR_size, VECTOR_HANDLE, handle)
+    FUNCTION(, size_t, VECTOR_size, VECTOR_HANDLE, handle),
+    /* NUVOTON: Storage grows geometrically. Reserve/release it explicitly. */
+    FUNCTION(, size_t, VECTOR_capacity, VECTOR_HANDLE, handle),
+    FUNCTION(, int, VECTOR_reserve, VECTOR_HANDLE, handle, size_t, numElements),
+    FUNCTION(, int, VECTOR_shrink_to_fit, VECTOR_HANDLE, handle)
 )
 #ifdef __cplusplus
 }
@@ -19,6 +19,7 @@ extern "C"
     {
         void* storage;
         size_t count;
+        size_t capacity; // NUVOTON: Allocated elements, for geometric growth
         size_t elementSize;
     } VECTOR;
 
@@ -0,0 +1,383 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/urlencode.h"
+#include "azure_c_shared_utility/xlogging.h"
+#include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+
+#define NIBBLE_TO_STRING(c) (char)((c) < 10 ? (c) + '0' : (c) - 10 + 'a')
+#define NIBBLE_FROM_STRING(c) (char)(ISDIGIT(c) ? (c) - '0' : TOUPPER(c) + 10 - 'A')
+#define IS_HEXDIGIT(c) (                 \
+    ((c >= '0') && (c <= '9')) ||        \
+    ((c >= 'A') && (c <= 'F')) ||        \
+    ((c >= 'a') && (c <= 'f'))           \
+)
+#define IS_PRINTABLE(c) (                           \
+    (c == 0) ||                                     \
+    (c == '!') ||                                   \
+    (c == '(') || (c == ')') || (c == '*') ||       \
+    (c == '-') || (c == '.') ||                     \
+    ((c >= '0') && (c <= '9')) ||                   \
+    ((c >= 'A') && (c <= 'Z')) ||                   \
+    (c == '_') ||                                   \
+    ((c >= 'a') && (c <= 'z'))                      \
+)
+
+/*The below macros are to be called on the big nibble of a hex value*/
+#define IS_IN_ASCII_RANGE(c) (  \
+    (c >= '0') && (c <= '7')    \
+)
+
+#ifndef ISDIGIT
+#define ISDIGIT(c) (((c) >= '0') && ((c) <= '9'))
+#endif
+#ifndef TOUPPER
+#define TOUPPER(c) ((((c) >= 'a') && ((c) <= 'z')) ? (c) - 'a' + 'A' : (c))
+#endif
+
+// NUVOTON: Encoded length of every byte value, for the exact-length two-pass encoder:
+//          1 for printable, 3 for "%xx" of 7-bit ASCII, 6 for "%c2%xx"/"%c3%xx" of 8-bit
+//          extended ASCII taken as Latin-1. Same classes as IS_PRINTABLE().
+static const uint8_t encoded_length[256] =
+{
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,    /* 0x00 - 0x0F */
+    3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,    /* 0x10 - 0x1F */
+    3, 1, 3, 3, 3, 3, 3, 3, 1, 1, 1, 3, 3, 1, 1, 3,    /* 0x20 - 0x2F */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3, 3,    /* 0x30 - 0x3F */
+    3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x40 - 0x4F */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 1,    /* 0x50 - 0x5F */
+    3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,    /* 0x60 - 0x6F */
+    1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 3, 3, 3, 3, 3,    /* 0x70 - 0x7F */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,    /* 0x80 - 0x8F */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,    /* 0x90 - 0x9F */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,    /* 0xA0 - 0xAF */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,    /* 0xB0 - 0xBF */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,    /* 0xC0 - 0xCF */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,    /* 0xD0 - 0xDF */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,    /* 0xE0 - 0xEF */
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6     /* 0xF0 - 0xFF */
+};
+
+// NUVOTON: Sum of encoded lengths, four bytes an iteration
+static size_t URL_CountEncoded(const unsigned char* text, size_t length)
+{
+    size_t result = 0;
+    size_t pos = 0;
+
+    for (; length - pos >= 4; pos += 4)
+    {
+        result += (size_t)encoded_length[text[pos]] + encoded_length[text[pos + 1]] +
+            encoded_length[text[pos + 2]] + encoded_length[text[pos + 3]];
+    }
+    for (; pos < length; pos++)
+    {
+        result += encoded_length[text[pos]];
+    }
+
+    return result;
+}
+
+// NUVOTON: Encode into buffer sized by URL_CountEncoded(). Runs of printable bytes are copied
+//          as a whole.
+static void URL_EncodeCounted(const unsigned char* text, size_t length, char* buffer)
+{
+    size_t pos = 0;
+
+    while (pos < length)
+    {
+        size_t run = pos;
+        while (run < length && encoded_length[text[run]] == 1)
+        {
+            run++;
+        }
+        if (run != pos)
+        {
+            (void)memcpy(buffer, text + pos, run - pos);
+            buffer += run - pos;
+            pos = run;
+            if (pos == length)
+            {
+                break;
+            }
+        }
+
+        unsigned char charVal = text[pos++];
+        *buffer++ = '%';
+        if (charVal < 0x80)
+        {
+            *buffer++ = NIBBLE_TO_STRING(charVal >> 4);
+            *buffer++ = NIBBLE_TO_STRING(charVal & 0x0F);
+        }
+        else
+        {
+            /* Same as UTF-8 of U+0080 - U+00FF */
+            unsigned char continuation = (unsigned char)(0x80 | (charVal & 0x3F));
+            *buffer++ = 'c';
+            *buffer++ = (charVal < 0xC0) ? '2' : '3';
+            *buffer++ = '%';
+            *buffer++ = NIBBLE_TO_STRING(continuation >> 4);
+            *buffer++ = NIBBLE_TO_STRING(continuation & 0x0F);
+        }
+    }
+
+    *buffer = '\0';
+}
+
+size_t URL_EncodedLength(const char* text, size_t length)
+{
+    return (text == NULL) ? 0 : URL_CountEncoded((const unsigned char*)text, length);
+}
+
+int URL_EncodeToBuffer(const char* text, size_t length, char* buffer, size_t bufferSize)
+{
+    int result;
+
+    if (text == NULL || buffer == NULL)
+    {
+        LogError("URL_EncodeToBuffer:: NULL input");
+        result = MU_FAILURE;
+    }
+    else if (URL_CountEncoded((const unsigned char*)text, length) >= bufferSize)
+    {
+        LogError("URL_EncodeToBuffer:: buffer of %lu bytes too small", (unsigned long)bufferSize);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        URL_EncodeCounted((const unsigned char*)text, length, buffer);
+        result = 0;
+    }
+
+    return result;
+}
+
+static size_t calculateDecodedStringSize(const char* encodedString, size_t len)
+{
+    size_t decodedSize = 0;
+
+    if (encodedString == NULL)
+    {
+        LogError("Null encoded string");
+    }
+    else if (len == 0)
+    {
+        decodedSize = 1; //for null terminator
+    }
+    else
+    {
+        size_t remaining_len = len;
+        size_t next_step = 0;
+        size_t i = 0;
+        while (i < len)
+        {
+            //percent encoded character
+            if (encodedString[i] == '%')
+            {
+                if (remaining_len < 3 || !IS_HEXDIGIT(encodedString[i+1]) || !IS_HEXDIGIT(encodedString[i+2]))
+                {
+                    LogError("Incomplete or invalid percent encoding");
+                    break;
+                }
+                else if (!IS_IN_ASCII_RANGE(encodedString[i+1]))
+                {
+                    LogError("Out of range of characters accepted by this decoder");
+                    break;
+                }
+                else
+                {
+                    decodedSize++;
+                    next_step = 3;
+                }
+            }
+            else if (!IS_PRINTABLE(encodedString[i]))
+            {
+                LogError("Unprintable value in encoded string");
+                break;
+            }
+            //safe character
+            else
+            {
+                decodedSize++;
+                next_step = 1;
+            }
+
+            i += next_step;
+            remaining_len -= next_step;
+        }
+
+        if (encodedString[i] != '\0') //i.e. broke out of above loop due to error
+        {
+            decodedSize = 0;
+        }
+        else
+        {
+            decodedSize++; //add space for the null terminator
+        }
+    }
+    return decodedSize;
+}
+
+static unsigned char charFromNibbles(char bigNibbleStr, char littleNibbleStr)
+{
+    unsigned char bigNibbleVal = NIBBLE_FROM_STRING(bigNibbleStr);
+    unsigned char littleNibbleVal = NIBBLE_FROM_STRING(littleNibbleStr);
+
+    return bigNibbleVal << 4 | littleNibbleVal;
+}
+
+static void createDecodedString(const char* input, size_t input_size, char* output)
+{
+    /* Note that there is no danger of reckless indexing here, as calculateDecodedStringSize()
+    has already checked lengths of strings to ensure the formatting is always correct*/
+    size_t i = 0;
+    while (i <= input_size)
+    {
+        if (input[i] != '%')
+        {
+            *output++ = input[i];
+            i++;
+        }
+        else
+        {
+            *output++ = charFromNibbles(input[i+1], input[i+2]);
+            i += 3;
+        }
+    }
+}
+
+// NUVOTON: Count pass, then encode pass into exactly sized memory handed over to the STRING.
+//          This replaces the per-byte URL_PrintableChar() loop.
+static STRING_HANDLE encode_url_data(const char* text, size_t length)
+{
+    STRING_HANDLE result;
+    size_t lengthOfResult = URL_CountEncoded((const unsigned char*)text, length) + 1;
+    char* encodedURL;
+
+    /*Codes_SRS_URL_ENCODE_06_003: [If input is a zero length string then URL_Encode will return a zero length string.]*/
+    if ((encodedURL = (char*)malloc(lengthOfResult)) == NULL)
+    {
+        /*Codes_SRS_URL_ENCODE_06_002: [If an error occurs during the encoding of input then URL_Encode will return NULL.]*/
+        result = NULL;
+        LogError("URL_Encode:: MALLOC failure on encode.");
+    }
+    else
+    {
+        URL_EncodeCounted((const unsigned char*)text, length, encodedURL);
+
+        result = STRING_new_with_memory(encodedURL);
+        if (result == NULL)
+        {
+            LogError("URL_Encode:: MALLOC failure on encode.");
+            free(encodedURL);
+        }
+    }
+    return result;
+}
+
+static STRING_HANDLE decode_url_data(const char* encodedString)
+{
+    STRING_HANDLE result;
+    size_t decodedStringSize;
+    char* decodedString;
+    size_t len = strlen(encodedString);
+
+    //Calculate decoded string size
+    /*Codes_SRS_URL_ENCODE_06_006: [If an error occurs during the decoding of input, URL_Decode will return NULL.]*/
+    if ((decodedStringSize = calculateDecodedStringSize(encodedString, len)) == 0)
+    {
+        LogError("Invalid Encoded URL String");
+        result = NULL;
+    }
+    else if ((decodedString = (char*)malloc(decodedStringSize)) == NULL)
+    {
+        LogError("Failure allocating decoded URL string");
+        result = NULL;
+    }
+    else
+    {
+        createDecodedString(encodedString, len, decodedString);
+        result = STRING_new_with_memory(decodedString);
+        if (result == NULL)
+        {
+            LogError("Failure constructing new string with decoded string");
+            free(decodedString);
+        }
+    }
+    return result;
+}
+
+STRING_HANDLE URL_EncodeString(const char* textEncode)
+{
+    STRING_HANDLE result;
+    if (textEncode == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = encode_url_data(textEncode, strlen(textEncode));
+    }
+    return result;
+}
+
+STRING_HANDLE URL_Encode(STRING_HANDLE input)
+{
+    STRING_HANDLE result;
+    if (input == NULL)
+    {
+        /*Codes_SRS_URL_ENCODE_06_001: [If input is NULL then URL_Encode will return NULL.]*/
+        result = NULL;
+        LogError("URL_Encode:: NULL input");
+    }
+    else
+    {
+        // NUVOTON: Length is known already
+        result = encode_url_data(STRING_c_str(input), STRING_length(input));
+    }
+    return result;
+}
+
+STRING_HANDLE URL_DecodeString(const char* textDecode)
+{
+    STRING_HANDLE result;
+    if (textDecode == NULL)
+    {
+        result = NULL;
+    }
+    else
+    {
+        STRING_HANDLE tempString = STRING_construct(textDecode);
+        if (tempString == NULL)
+        {
+            result = NULL;
+        }
+        else
+        {
+            result = URL_Decode(tempString);
+            STRING_delete(tempString);
+        }
+    }
+    return result;
+}
+
+STRING_HANDLE URL_Decode(STRING_HANDLE input)
+{
+    STRING_HANDLE result;
+    if (input == NULL)
+    {
+        /*Codes_SRS_URL_ENCODE_06_007: [If input is NULL then URL_Decode will return NULL.]*/
+        result = NULL;
+        LogError("URL_Decode:: NULL input");
+    }
+    else
+    {
+        result = decode_url_data(STRING_c_str(input));
+    }
+    return result;
+}
@@ -0,0 +1,478 @@
+// Copyright (c) Microsoft. All rights reserved.
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/vector.h"
+#include "azure_c_shared_utility/optimize_size.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#include "azure_c_shared_utility/vector_types_internal.h"
+
+// NUVOTON: Grow storage geometrically rather than by exact size on every push, so that
+//          repeated VECTOR_push_back() costs amortized O(1) copies and fragments heap less.
+#define VECTOR_MIN_CAPACITY     4
+
+// NUVOTON: Resize storage to exactly 'capacity' elements. Count is left intact.
+static int VECTOR_set_capacity(VECTOR_HANDLE handle, size_t capacity)
+{
+    int result;
+
+    if (capacity == 0)
+    {
+        free(handle->storage);
+        handle->storage = NULL;
+        handle->capacity = 0;
+        result = 0;
+    }
+    else if (capacity > SIZE_MAX / handle->elementSize)
+    {
+        LogError("invalid argument - capacity(%lu) overflows", (unsigned long)capacity);
+        result = MU_FAILURE;
+    }
+    else
+    {
+        void* temp = realloc(handle->storage, handle->elementSize * capacity);
+        if (temp == NULL)
+        {
+            LogError("realloc failed.");
+            result = MU_FAILURE;
+        }
+        else
+        {
+            handle->storage = temp;
+            handle->capacity = capacity;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+// NUVOTON: Make room for 'numElements' more elements, growing geometrically.
+static int VECTOR_grow(VECTOR_HANDLE handle, size_t numElements)
+{
+    int result;
+
+    if (numElements > SIZE_MAX - handle->count)
+    {
+        LogError("invalid argument - numElements(%lu) overflows", (unsigned long)numElements);
+        result = MU_FAILURE;
+    }
+    else if (handle->count + numElements <= handle->capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        size_t required = handle->count + numElements;
+        size_t capacity = (handle->capacity < VECTOR_MIN_CAPACITY) ? VECTOR_MIN_CAPACITY : handle->capacity;
+        while (capacity < required)
+        {
+            capacity = (capacity > SIZE_MAX / 2) ? required : (capacity * 2);
+        }
+
+        // Doubling may overflow size in bytes while the exact size doesn't
+        if (capacity > SIZE_MAX / handle->elementSize)
+        {
+            capacity = required;
+        }
+
+        result = VECTOR_set_capacity(handle, capacity);
+    }
+
+    return result;
+}
+
+VECTOR_HANDLE VECTOR_create(size_t elementSize)
+{
+    VECTOR_HANDLE result;
+
+    /* Codes_SRS_VECTOR_10_002: [VECTOR_create shall fail and return NULL if elementsize is 0.] */
+    if (elementSize == 0)
+    {
+        LogError("invalid elementSize(%zd).", elementSize);
+        result = NULL;
+    }
+    else
+    {
+        result = (VECTOR*)malloc(sizeof(VECTOR));
+        /* Codes_SRS_VECTOR_10_002 : [VECTOR_create shall fail and return NULL if malloc fails.] */
+        if (result == NULL)
+        {
+            LogError("malloc failed.");
+        }
+        else
+        {
+            /* Codes_SRS_VECTOR_10_001: [VECTOR_create shall allocate a VECTOR_HANDLE that will contain an empty vector.The size of each element is given with the parameter elementSize.] */
+            result->storage = NULL;
+            result->count = 0;
+            result->capacity = 0;
+            result->elementSize = elementSize;
+        }
+    }
+    return result;
+}
+
+void VECTOR_destroy(VECTOR_HANDLE handle)
+{
+    /* Codes_SRS_VECTOR_10_009: [VECTOR_destroy shall return if the given handle is NULL.] */
+    if (handle == NULL)
+    {
+        LogError("invalid argument handle(NULL).");
+    }
+    else
+    {
+        /* Codes_SRS_VECTOR_10_008: [VECTOR_destroy shall free the given handle and its internal storage.] */
+        free(handle->storage);
+        free(handle);
+    }
+}
+
+VECTOR_HANDLE VECTOR_move(VECTOR_HANDLE handle)
+{
+    VECTOR_HANDLE result;
+    if (handle == NULL)
+    {
+        /* Codes_SRS_VECTOR_10_005: [VECTOR_move shall fail and return NULL if the given handle is NULL.] */
+        LogError("invalid argument - handle(NULL).");
+        result = NULL;
+    }
+    else
+    {
+        result = (VECTOR*)malloc(sizeof(VECTOR));
+        if (result == NULL)
+        {
+            /* Codes_SRS_VECTOR_10_006: [VECTOR_move shall fail and return NULL if malloc fails.] */
+            LogError("malloc failed.");
+        }
+        else
+        {
+            /* Codes_SRS_VECTOR_10_004: [VECTOR_move shall allocate a VECTOR_HANDLE and move the data to it from the given handle.] */
+            result->count = handle->count;
+            result->capacity = handle->capacity;
+            result->elementSize = handle->elementSize;
+            result->storage = handle->storage;
+
+            handle->storage = NULL;
+            handle->count = 0;
+            handle->capacity = 0;
+        }
+    }
+    return result;
+}
+
+/* insertion */
+
+int VECTOR_push_back(VECTOR_HANDLE handle, const void* elements, size_t numElements)
+{
+    int result;
+    if (handle == NULL || elements == NULL || numElements == 0)
+    {
+        /* Codes_SRS_VECTOR_10_011: [VECTOR_push_back shall fail and return non-zero if `handle` is NULL.] */
+        /* Codes_SRS_VECTOR_10_034: [VECTOR_push_back shall fail and return non-zero if `elements` is NULL.] */
+        /* Codes_SRS_VECTOR_10_035: [VECTOR_push_back shall fail and return non-zero if `numElements` is 0.] */
+        LogError("invalid argument - handle(%p), elements(%p), numElements(%zd).", handle, elements, numElements);
+        result = MU_FAILURE;
+    }
+    // NUVOTON: Grow geometrically
+    else if (VECTOR_grow(handle, numElements) != 0)
+    {
+        /* Codes_SRS_VECTOR_10_012: [VECTOR_push_back shall fail and return non-zero if memory allocation fails.] */
+        result = MU_FAILURE;
+    }
+    else
+    {
+        /* Codes_SRS_VECTOR_10_013: [VECTOR_push_back shall append the given elements and return 0 indicating success.] */
+        (void)memcpy((unsigned char*)handle->storage + (handle->elementSize * handle->count), elements, handle->elementSize * numElements);
+        handle->count += numElements;
+        result = 0;
+    }
+    return result;
+}
+
+// NUVOTON: Append without element copy
+void* VECTOR_emplace_back(VECTOR_HANDLE handle, size_t numElements)
+{
+    void* result;
+    if (handle == NULL || numElements == 0)
+    {
+        LogError("invalid argument - handle(%p), numElements(%zd).", handle, numElements);
+        result = NULL;
+    }
+    else if (VECTOR_grow(handle, numElements) != 0)
+    {
+        result = NULL;
+    }
+    else
+    {
+        result = (unsigned char*)handle->storage + (handle->elementSize * handle->count);
+        handle->count += numElements;
+    }
+    return result;
+}
+
+/* removal */
+
+void VECTOR_erase(VECTOR_HANDLE handle, void* elements, size_t numElements)
+{
+    if (handle == NULL || elements == NULL || numElements == 0)
+    {
+        /* Codes_SRS_VECTOR_10_015: [VECTOR_erase shall return if `handle` is NULL.] */
+        /* Codes_SRS_VECTOR_10_038: [VECTOR_erase shall return if `elements` is NULL.] */
+        /* Codes_SRS_VECTOR_10_039: [VECTOR_erase shall return if `numElements` is 0.] */
+        LogError("invalid argument - handle(%p), elements(%p), numElements(%zd).", handle, elements, numElements);
+    }
+    else
+    {
+        if (elements < handle->storage)
+        {
+            /* Codes_SRS_VECTOR_10_040: [VECTOR_erase shall return if `elements` is out of bound.] */
+            LogError("invalid argument elements(%p) is not a member of this object.", elements);
+        }
+        else
+        {
+            ptrdiff_t diff = ((unsigned char*)elements) - ((unsigned char*)handle->storage);
+            if ((diff % handle->elementSize) != 0)
+            {
+                /* Codes_SRS_VECTOR_10_041: [VECTOR_erase shall return if elements is misaligned.] */
+                LogError("invalid argument - elements(%p) is misaligned", elements);
+            }
+            else
+            {
+                /* Compute the arguments needed for memmove. */
+                unsigned char* src = (unsigned char*)elements + (handle->elementSize * numElements);
+                unsigned char* srcEnd = (unsigned char*)handle->storage + (handle->elementSize * handle->count);
+                if (src > srcEnd)
+                {
+                    /* Codes_SRS_VECTOR_10_040: [VECTOR_erase shall return if `elements` is out of bound.] */
+                    LogError("invalid argument - numElements(%zd) is out of bound.", numElements);
+                }
+                else
+                {
+                    /* Codes_SRS_VECTOR_10_014: [VECTOR_erase shall remove the 'numElements' starting at 'elements' and reduce its internal storage.] */
+                    handle->count -= numElements;
+                    if (handle->count == 0)
+                    {
+                        free(handle->storage);
+                        handle->storage = NULL;
+                        handle->capacity = 0;
+                    }
+                    else
+                    {
+                        // NUVOTON: Keep capacity for following pushes. VECTOR_shrink_to_fit() releases it.
+                        (void)memmove(elements, src, srcEnd - src);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void VECTOR_clear(VECTOR_HANDLE handle)
+{
+    /* Codes_SRS_VECTOR_10_017: [VECTOR_clear shall if the object is NULL or empty.] */
+    if (handle == NULL)
+    {
+        LogError("invalid argument handle(NULL).");
+    }
+    else
+    {
+        /* Codes_SRS_VECTOR_10_016: [VECTOR_clear shall remove all elements from the object and release internal storage.] */
+        free(handle->storage);
+        handle->storage = NULL;
+        handle->count = 0;
+        handle->capacity = 0;
+    }
+}
+
+/* access */
+
+void* VECTOR_element(VECTOR_HANDLE handle, size_t index)
+{
+    void* result;
+    if (handle == NULL)
+    {
+        /* Codes_SRS_VECTOR_10_019: [VECTOR_element shall fail and return NULL if handle is NULL.] */
+        LogError("invalid argument handle(NULL).");
+        result = NULL;
+    }
+    else
+    {
+        if (index >= handle->count)
+        {
+            /* Codes_SRS_VECTOR_10_020: [VECTOR_element shall fail and return NULL if the given index is out of range.] */
+            LogError("invalid argument - index(%zd); should be >= 0 and < %zd.", index, handle->count);
+            result = NULL;
+        }
+        else
+        {
+            /* Codes_SRS_VECTOR_10_018: [VECTOR_element shall return the element at the given index.] */
+            result = (unsigned char*)handle->storage + (handle->elementSize * index);
+        }
+    }
+    return result;
+}
+
+void* VECTOR_front(VECTOR_HANDLE handle)
+{
+    void* result;
+    if (handle == NULL)
+    {
+        /* Codes_SRS_VECTOR_10_022: [VECTOR_front shall fail and return NULL if handle is NULL.] */
+        LogError("invalid argument handle (NULL).");
+        result = NULL;
+    }
+    else
+    {
+        if (handle->count == 0)
+        {
+            /* Codes_SRS_VECTOR_10_028: [VECTOR_front shall return NULL if the vector is empty.] */
+            LogError("vector is empty.");
+            result = NULL;
+        }
+        else
+        {
+            /* Codes_SRS_VECTOR_10_021: [VECTOR_front shall return a pointer to the element at index 0.] */
+            result = handle->storage;
+        }
+    }
+    return result;
+}
+
+void* VECTOR_back(VECTOR_HANDLE handle)
+{
+    void* result;
+    if (handle == NULL)
+    {
+        /* Codes_SRS_VECTOR_10_024: [VECTOR_back shall fail and return NULL if handle is NULL.] */
+        LogError("invalid argument handle (NULL).");
+        result = NULL;
+    }
+    else
+    {
+        if (handle->count == 0)
+        {
+            /* Codes_SRS_VECTOR_10_029: [VECTOR_back shall return NULL if the vector is empty.] */
+            LogError("vector is empty.");
+            result = NULL;
+        }
+        else
+        {
+            /* Codes_SRS_VECTOR_10_023: [VECTOR_front shall return the last element of the vector.] */
+            result = (unsigned char*)handle->storage + (handle->elementSize * (handle->count - 1));
+        }
+    }
+    return result;
+}
+
+void* VECTOR_find_if(VECTOR_HANDLE handle, PREDICATE_FUNCTION pred, const void* value)
+{
+    void* result;
+    if (handle == NULL || pred == NULL)
+    {
+        /* Codes_SRS_VECTOR_10_030: [VECTOR_find_if shall fail and return NULL if `handle` is NULL.] */
+        /* Codes_SRS_VECTOR_10_036: [VECTOR_find_if shall fail and return NULL if `pred` is NULL.] */
+        LogError("invalid argument - handle(%p), pred(%p)", handle, pred);
+        result = NULL;
+    }
+    else
+    {
+        size_t i;
+        for (i = 0; i < handle->count; ++i)
+        {
+            if (true == pred((unsigned char*)handle->storage + (handle->elementSize * i), value))
+            {
+                /* Codes_SRS_VECTOR_10_031: [VECTOR_find_if shall return the first element in the vector that matches `pred`.] */
+                break;
+            }
+        }
+
+        if (i == handle->count)
+        {
+            /* Codes_SRS_VECTOR_10_032: [VECTOR_find_if shall return NULL if no element is found that matches `pred`.] */
+            result = NULL;
+        }
+        else
+        {
+            /* Codes_SRS_VECTOR_10_031: [VECTOR_find_if shall return the first element in the vector that matches `pred`.] */
+            result = (unsigned char*)handle->storage + (handle->elementSize * i);
+        }
+    }
+    return result;
+}
+
+/* capacity */
+
+size_t VECTOR_size(VECTOR_HANDLE handle)
+{
+    size_t result;
+    if (handle == NULL)
+    {
+        /* Codes_SRS_VECTOR_10_026: [**VECTOR_size shall return 0 if the given handle is NULL.] */
+        LogError("invalid argument handle(NULL).");
+        result = 0;
+    }
+    else
+    {
+        /* Codes_SRS_VECTOR_10_025: [VECTOR_size shall return the number of elements stored with the given handle.] */
+        result = handle->count;
+    }
+    return result;
+}
+
+// NUVOTON: Capacity management
+size_t VECTOR_capacity(VECTOR_HANDLE handle)
+{
+    size_t result;
+    if (handle == NULL)
+    {
+        LogError("invalid argument handle(NULL).");
+        result = 0;
+    }
+    else
+    {
+        result = handle->capacity;
+    }
+    return result;
+}
+
+int VECTOR_reserve(VECTOR_HANDLE handle, size_t numElements)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("invalid argument handle(NULL).");
+        result = MU_FAILURE;
+    }
+    else if (numElements <= handle->capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        result = VECTOR_set_capacity(handle, numElements);
+    }
+    return result;
+}
+
+int VECTOR_shrink_to_fit(VECTOR_HANDLE handle)
+{
+    int result;
+    if (handle == NULL)
+    {
+        LogError("invalid argument handle(NULL).");
+        result = MU_FAILURE;
+    }
+    else if (handle->count == handle->capacity)
+    {
+        result = 0;
+    }
+    else
+    {
+        result = VECTOR_set_capacity(handle, handle->count);
+    }
+    return result;
+}
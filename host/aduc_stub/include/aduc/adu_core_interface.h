@@ -0,0 +1,19 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/adu_core_interface.h: client handle of the component, defined by the test */
+
+#ifndef ADUC_ADU_CORE_INTERFACE_H
+#define ADUC_ADU_CORE_INTERFACE_H
+
+#include "aduc/c_utils.h"
+
+EXTERN_C_BEGIN
+
+typedef void* ADUC_ClientHandle;
+
+extern ADUC_ClientHandle g_iotHubClientHandleForADUComponent;
+
+EXTERN_C_END
+
+#endif /* ADUC_ADU_CORE_INTERFACE_H */
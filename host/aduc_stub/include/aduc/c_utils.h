@@ -0,0 +1,19 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/c_utils.h: only what platform layer sources use */
+
+#ifndef ADUC_C_UTILS_H
+#define ADUC_C_UTILS_H
+
+#ifdef __cplusplus
+#define EXTERN_C_BEGIN extern "C" {
+#define EXTERN_C_END }
+#else
+#define EXTERN_C_BEGIN
+#define EXTERN_C_END
+#endif
+
+#define UNREFERENCED_PARAMETER(param) (void) (param)
+
+#endif /* ADUC_C_UTILS_H */
@@ -0,0 +1,22 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/logging.h: log to stderr */
+
+#ifndef ADUC_LOGGING_H
+#define ADUC_LOGGING_H
+
+#include <stdio.h>
+
+#define ADUC_STUB_LOG(level, ...)                                               \
+    do {                                                                        \
+        fprintf(stderr, "[" level "] " __VA_ARGS__);                            \
+        fputc('\n', stderr);                                                    \
+    } while (0)
+
+#define Log_Debug(...)  ADUC_STUB_LOG("DBG", __VA_ARGS__)
+#define Log_Info(...)   ADUC_STUB_LOG("INF", __VA_ARGS__)
+#define Log_Warn(...)   ADUC_STUB_LOG("WRN", __VA_ARGS__)
+#define Log_Error(...)  ADUC_STUB_LOG("ERR", __VA_ARGS__)
+
+#endif /* ADUC_LOGGING_H */
@@ -0,0 +1,25 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/result.h: result type and general result codes */
+
+#ifndef ADUC_RESULT_H
+#define ADUC_RESULT_H
+
+#include <stdint.h>
+
+typedef int32_t ADUC_Result_t;
+
+typedef struct tagADUC_Result
+{
+    ADUC_Result_t ResultCode;
+    ADUC_Result_t ExtendedResultCode;
+} ADUC_Result;
+
+typedef enum tagADUC_GeneralResult
+{
+    ADUC_Result_Failure = 0,
+    ADUC_Result_Success = 1,
+} ADUC_GeneralResult;
+
+#endif /* ADUC_RESULT_H */
@@ -0,0 +1,46 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/types/adu_core.h: update actions, states and workflow steps */
+
+#ifndef ADUC_TYPES_ADU_CORE_H
+#define ADUC_TYPES_ADU_CORE_H
+
+typedef enum tagADUCITF_UpdateAction
+{
+    ADUCITF_UpdateAction_Undefined = -1,
+    ADUCITF_UpdateAction_Download = 0,
+    ADUCITF_UpdateAction_Install = 1,
+    ADUCITF_UpdateAction_Apply = 2,
+    ADUCITF_UpdateAction_ProcessDeployment = 3,
+    ADUCITF_UpdateAction_Cancel = 255,
+} ADUCITF_UpdateAction;
+
+typedef enum tagADUCITF_State
+{
+    ADUCITF_State_None = -1,
+    ADUCITF_State_Idle = 0,
+    ADUCITF_State_DownloadStarted = 1,
+    ADUCITF_State_DownloadSucceeded = 2,
+    ADUCITF_State_InstallStarted = 3,
+    ADUCITF_State_InstallSucceeded = 4,
+    ADUCITF_State_ApplyStarted = 5,
+    ADUCITF_State_DeploymentInProgress = 6,
+    ADUCITF_State_BackupStarted = 7,
+    ADUCITF_State_BackupSucceeded = 8,
+    ADUCITF_State_RestoreStarted = 9,
+    ADUCITF_State_Failed = 255,
+} ADUCITF_State;
+
+typedef enum tagADUCITF_WorkflowStep
+{
+    ADUCITF_WorkflowStep_Undefined = 0,
+    ADUCITF_WorkflowStep_ProcessDeployment = 1,
+    ADUCITF_WorkflowStep_Download = 2,
+    ADUCITF_WorkflowStep_Install = 3,
+    ADUCITF_WorkflowStep_Apply = 4,
+    ADUCITF_WorkflowStep_Backup = 5,
+    ADUCITF_WorkflowStep_Restore = 6,
+} ADUCITF_WorkflowStep;
+
+#endif /* ADUC_TYPES_ADU_CORE_H */
@@ -0,0 +1,28 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/types/workflow.h: opaque workflow handle, cancellation types, and
+ * workflow data members that platform sources under test use */
+
+#ifndef ADUC_TYPES_WORKFLOW_H
+#define ADUC_TYPES_WORKFLOW_H
+
+typedef void* ADUC_WorkflowHandle;
+
+typedef enum tagADUC_WorkflowCancellationType
+{
+    ADUC_WorkflowCancellationType_None = 0,
+    ADUC_WorkflowCancellationType_Normal = 1,
+    ADUC_WorkflowCancellationType_Replacement = 2,
+    ADUC_WorkflowCancellationType_Retry = 3,
+    ADUC_WorkflowCancellationType_ComponentChanged = 4,
+} ADUC_WorkflowCancellationType;
+
+typedef struct tagADUC_WorkflowData
+{
+    ADUC_WorkflowHandle WorkflowHandle;
+} ADUC_WorkflowData;
+
+typedef void* ADUC_WorkflowDataToken;
+
+#endif /* ADUC_TYPES_WORKFLOW_H */
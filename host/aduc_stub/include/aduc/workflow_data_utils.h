@@ -0,0 +1,19 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/workflow_data_utils.h: accessors, defined by the test */
+
+#ifndef ADUC_WORKFLOW_DATA_UTILS_H
+#define ADUC_WORKFLOW_DATA_UTILS_H
+
+#include "aduc/c_utils.h"
+#include "aduc/types/adu_core.h"
+#include "aduc/types/workflow.h"
+
+EXTERN_C_BEGIN
+
+ADUCITF_UpdateAction ADUC_WorkflowData_GetCurrentAction(const ADUC_WorkflowData* workflowData);
+
+EXTERN_C_END
+
+#endif /* ADUC_WORKFLOW_DATA_UTILS_H */
@@ -0,0 +1,30 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for the ADU agent's aduc/workflow_utils.h: workflow tree walk, identity and results, defined by the test */
+
+#ifndef ADUC_WORKFLOW_UTILS_H
+#define ADUC_WORKFLOW_UTILS_H
+
+#include "aduc/c_utils.h"
+#include "aduc/result.h"
+#include "aduc/types/adu_core.h"
+#include "aduc/types/workflow.h"
+
+EXTERN_C_BEGIN
+
+ADUC_WorkflowHandle workflow_get_parent(ADUC_WorkflowHandle handle);
+ADUC_WorkflowHandle workflow_get_root(ADUC_WorkflowHandle handle);
+int workflow_get_children_count(ADUC_WorkflowHandle handle);
+ADUC_WorkflowHandle workflow_get_child(ADUC_WorkflowHandle handle, int index);
+
+const char* workflow_peek_id(ADUC_WorkflowHandle handle);
+const char* workflow_peek_retryTimestamp(ADUC_WorkflowHandle handle);
+ADUCITF_WorkflowStep workflow_get_current_workflowstep(ADUC_WorkflowHandle handle);
+
+ADUC_Result workflow_get_result(ADUC_WorkflowHandle handle);
+const char* workflow_peek_result_details(ADUC_WorkflowHandle handle);
+
+EXTERN_C_END
+
+#endif /* ADUC_WORKFLOW_UTILS_H */
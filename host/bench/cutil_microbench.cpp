@@ -0,0 +1,544 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+ * Micro-benchmarks of the c-utility/umqtt primitives every IoT Hub message goes through.
+ *
+ * Each benchmark is auto-calibrated to run for at least --min-time-ms and reports ns/op,
+ * allocations/op and bytes allocated/op (heap_stats malloc interposition). Payloads follow
+ * IoT Hub shapes: device-to-cloud topic with properties, twin reported patch, SAS key/scope.
+ * No network is involved.
+ *
+ * Usage: cutil_microbench [--filter <substring>] [--min-time-ms <ms>] [--out <file.json>]
+ */
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/azure_base64.h"
+#include "azure_c_shared_utility/buffer_.h"
+#include "azure_c_shared_utility/constbuffer.h"
+#include "azure_c_shared_utility/constbuffer_array.h"
+#include "azure_c_shared_utility/hmacsha256.h"
+#include "azure_c_shared_utility/map.h"
+#include "azure_c_shared_utility/sastoken.h"
+#include "azure_c_shared_utility/sha.h"
+#include "azure_c_shared_utility/singlylinkedlist.h"
+#include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/urlencode.h"
+#include "azure_umqtt_c/mqtt_codec.h"
+
+#include "heap_stats.h"
+
+namespace {
+
+/* Realistic IoT Hub payload shapes */
+const char *const DEVICE_ID = "nuvoton-m487-ota-0001";
+const char *const HUB_SCOPE = "myhub.azure-devices.net/devices/nuvoton-m487-ota-0001";
+const char *const DEVICE_KEY = "qPnlr0rP3Gf2xeTQlJ9XGFKqpwi3xRy4FQ9YbZi+ZtM=";
+const char *const D2C_TOPIC = "devices/nuvoton-m487-ota-0001/messages/events/"
+                              "%24.ct=application%2Fjson&%24.ce=utf-8&messageType=telemetry";
+const char *const TELEMETRY = "{\"temperature\":23.37,\"humidity\":47.12,\"pressure\":1013.25,"
+                              "\"messageId\":1024,\"timestamp\":\"2022-06-14T08:21:44Z\"}";
+const char *const REPORTED_PATCH =
+    "{\"deviceUpdate\":{\"__t\":\"c\",\"agent\":{\"state\":6,\"workflow\":{\"action\":3,"
+    "\"id\":\"6a2f07a9-2d37-4d77-9a23-2f2b3e4b2f11\"},\"installedUpdateId\":"
+    "\"{\\\"provider\\\":\\\"Nuvoton\\\",\\\"name\\\":\\\"NuMaker-IoT-M487\\\",\\\"version\\\":\\\"1.2.0\\\"}\","
+    "\"lastInstallResult\":{\"resultCode\":700,\"extendedResultCode\":0,\"resultDetails\":\"\"}}}}";
+const char *const PROPERTY_KEYS[] = { "$.ct", "$.ce", "messageType", "iothub-creation-time-utc", "correlationId" };
+const char *const PROPERTY_VALUES[] = { "application/json", "utf-8", "telemetry", "2022-06-14T08:21:44Z",
+                                        "0f8fad5b-d9cb-469f-a165-70867728950e" };
+const size_t PROPERTY_COUNT = sizeof(PROPERTY_KEYS) / sizeof(PROPERTY_KEYS[0]);
+
+/* Keeps results observable so the compiler can't drop the work */
+volatile uintptr_t sink;
+
+struct BenchState {
+    uint64_t iterations;
+    std::chrono::steady_clock::time_point t0;
+    std::chrono::steady_clock::duration elapsed;
+    heap_stats_t heap0;
+    heap_stats_t heap1;
+    bool ok;
+
+    /* Work outside start()/stop(), such as fixture setup and teardown, isn't measured. */
+    void start()
+    {
+        heap_stats_get(&heap0);
+        t0 = std::chrono::steady_clock::now();
+    }
+
+    void stop()
+    {
+        elapsed = std::chrono::steady_clock::now() - t0;
+        heap_stats_get(&heap1);
+    }
+
+    void fail(const char *what)
+    {
+        fprintf(stderr, "  failed: %s\n", what);
+        ok = false;
+    }
+};
+
+struct Benchmark {
+    const char *name;
+    std::function<void(BenchState &)> run;
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+};
+
+/* STRING_* */
+
+void bm_string_construct_concat(BenchState &state)
+{
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        STRING_HANDLE s = STRING_construct("{\"telemetry\":");
+        if (s == NULL || STRING_concat(s, TELEMETRY) != 0 || STRING_concat(s, "}") != 0) {
+            state.fail("STRING_concat");
+        }
+        sink = (uintptr_t) STRING_c_str(s);
+        STRING_delete(s);
+    }
+    state.stop();
+}
+
+void bm_string_sprintf(BenchState &state)
+{
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        STRING_HANDLE s = STRING_construct_sprintf("devices/%s/messages/events/%s", DEVICE_ID, "messageType=telemetry");
+        if (s == NULL) {
+            state.fail("STRING_construct_sprintf");
+        }
+        sink = (uintptr_t) STRING_length(s);
+        STRING_delete(s);
+    }
+    state.stop();
+}
+
+void bm_string_new_json(BenchState &state)
+{
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        STRING_HANDLE s = STRING_new_JSON(REPORTED_PATCH);
+        if (s == NULL) {
+            state.fail("STRING_new_JSON");
+        }
+        sink = (uintptr_t) STRING_length(s);
+        STRING_delete(s);
+    }
+    state.stop();
+}
+
+/* BUFFER_* */
+
+void bm_buffer_create_append(BenchState &state)
+{
+    size_t len = strlen(TELEMETRY);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        BUFFER_HANDLE b = BUFFER_create((const unsigned char *) D2C_TOPIC, strlen(D2C_TOPIC));
+        if (b == NULL || BUFFER_append_build(b, (const unsigned char *) TELEMETRY, len) != 0) {
+            state.fail("BUFFER_append_build");
+        }
+        sink = (uintptr_t) BUFFER_length(b);
+        BUFFER_delete(b);
+    }
+    state.stop();
+}
+
+/* Map_* (message properties) */
+
+void bm_map_build_lookup(BenchState &state)
+{
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        MAP_HANDLE map = Map_Create(NULL);
+        for (size_t p = 0; p < PROPERTY_COUNT; p ++) {
+            if (Map_Add(map, PROPERTY_KEYS[p], PROPERTY_VALUES[p]) != MAP_OK) {
+                state.fail("Map_Add");
+            }
+        }
+        for (size_t p = 0; p < PROPERTY_COUNT; p ++) {
+            sink = (uintptr_t) Map_GetValueFromKey(map, PROPERTY_KEYS[p]);
+        }
+        Map_Destroy(map);
+    }
+    state.stop();
+}
+
+/* singlylinkedlist_* (pending message list) */
+
+bool match_item(LIST_ITEM_HANDLE list_item, const void *match_context)
+{
+    return singlylinkedlist_item_get_value(list_item) == match_context;
+}
+
+void bm_singlylinkedlist_add_find_remove(BenchState &state)
+{
+    static int items[16];
+    SINGLYLINKEDLIST_HANDLE list = singlylinkedlist_create();
+    if (list == NULL) {
+        state.fail("singlylinkedlist_create");
+        return;
+    }
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        for (size_t n = 0; n < 16; n ++) {
+            if (singlylinkedlist_add(list, &items[n]) == NULL) {
+                state.fail("singlylinkedlist_add");
+            }
+        }
+        /* Acknowledged out of order, as PUBACKs are */
+        for (size_t n = 0; n < 16; n ++) {
+            LIST_ITEM_HANDLE item = singlylinkedlist_find(list, match_item, &items[(n * 7) % 16]);
+            if (item == NULL || singlylinkedlist_remove(list, item) != 0) {
+                state.fail("singlylinkedlist_remove");
+            }
+        }
+    }
+    state.stop();
+    singlylinkedlist_destroy(list);
+}
+
+/* Azure_Base64_* */
+
+void bm_base64_encode(BenchState &state)
+{
+    unsigned char digest[32];
+    for (size_t n = 0; n < sizeof(digest); n ++) {
+        digest[n] = (unsigned char)(n * 37 + 11);
+    }
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        STRING_HANDLE s = Azure_Base64_Encode_Bytes(digest, sizeof(digest));
+        if (s == NULL) {
+            state.fail("Azure_Base64_Encode_Bytes");
+        }
+        sink = (uintptr_t) STRING_length(s);
+        STRING_delete(s);
+    }
+    state.stop();
+}
+
+void bm_base64_decode(BenchState &state)
+{
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        BUFFER_HANDLE b = Azure_Base64_Decode(DEVICE_KEY);
+        if (b == NULL) {
+            state.fail("Azure_Base64_Decode");
+        }
+        sink = (uintptr_t) BUFFER_length(b);
+        BUFFER_delete(b);
+    }
+    state.stop();
+}
+
+/* URL_Encode* (copied/c-utility two-pass encoder, as on target by default) */
+
+void bm_url_encode_scope(BenchState &state)
+{
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        STRING_HANDLE s = URL_EncodeString(HUB_SCOPE);
+        if (s == NULL) {
+            state.fail("URL_EncodeString");
+        }
+        sink = (uintptr_t) STRING_length(s);
+        STRING_delete(s);
+    }
+    state.stop();
+}
+
+void bm_url_encode_property_value(BenchState &state)
+{
+    STRING_HANDLE input = STRING_construct("application/json; charset=utf-8");
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        STRING_HANDLE s = URL_Encode(input);
+        if (s == NULL) {
+            state.fail("URL_Encode");
+        }
+        sink = (uintptr_t) STRING_length(s);
+        STRING_delete(s);
+    }
+    state.stop();
+    STRING_delete(input);
+}
+
+/* USHA* / HMACSHA256 */
+
+void bm_usha256_1k(BenchState &state)
+{
+    std::vector<uint8_t> block(1024, 0x5a);
+    uint8_t digest[USHAMaxHashSize];
+    USHAContext ctx;
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        if (USHAReset(&ctx, SHA256) != 0 ||
+            USHAInput(&ctx, block.data(), (unsigned int) block.size()) != 0 ||
+            USHAResult(&ctx, digest) != 0) {
+            state.fail("USHA");
+        }
+        sink = digest[0];
+    }
+    state.stop();
+}
+
+void bm_hmacsha256_sas_payload(BenchState &state)
+{
+    const char payload[] = "myhub.azure-devices.net%2Fdevices%2Fnuvoton-m487-ota-0001\n1655195504";
+    const unsigned char key[32] = { 0xa8, 0xf9, 0xe5, 0xaf, 0x4a, 0xcf, 0xdc, 0x67, 0xc5, 0xe4, 0xd0 };
+    BUFFER_HANDLE hash = BUFFER_new();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        if (HMACSHA256_ComputeHash(key, sizeof(key), (const unsigned char *) payload, sizeof(payload) - 1,
+                                   hash) != HMACSHA256_OK) {
+            state.fail("HMACSHA256_ComputeHash");
+        }
+        sink = (uintptr_t) BUFFER_length(hash);
+    }
+    state.stop();
+    BUFFER_delete(hash);
+}
+
+/* SASToken_Create */
+
+void bm_sastoken_create(BenchState &state)
+{
+    STRING_HANDLE key = STRING_construct(DEVICE_KEY);
+    STRING_HANDLE scope = STRING_construct(HUB_SCOPE);
+    STRING_HANDLE key_name = STRING_new();
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        STRING_HANDLE token = SASToken_Create(key, scope, key_name, 1655195504);
+        if (token == NULL) {
+            state.fail("SASToken_Create");
+        }
+        sink = (uintptr_t) STRING_length(token);
+        STRING_delete(token);
+    }
+    state.stop();
+    STRING_delete(key_name);
+    STRING_delete(scope);
+    STRING_delete(key);
+}
+
+/* mqtt_codec */
+
+void on_packet_complete(void *context, CONTROL_PACKET_TYPE packet, int flags, BUFFER_HANDLE header_data)
+{
+    (void) flags;
+    (void) header_data;
+    if (packet == PUBLISH_TYPE) {
+        (*(uint64_t *) context) ++;
+    }
+}
+
+void bm_mqtt_codec_publish_encode(BenchState &state)
+{
+    size_t len = strlen(TELEMETRY);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        BUFFER_HANDLE packet = mqtt_codec_publish(DELIVER_AT_LEAST_ONCE, false, false, (uint16_t)(i | 1), D2C_TOPIC,
+                                                  (const uint8_t *) TELEMETRY, len, NULL);
+        if (packet == NULL) {
+            state.fail("mqtt_codec_publish");
+        }
+        sink = (uintptr_t) BUFFER_length(packet);
+        BUFFER_delete(packet);
+    }
+    state.stop();
+}
+
+void bm_mqtt_codec_publish_decode(BenchState &state)
+{
+    const char twin_topic[] = "$iothub/twin/PATCH/properties/desired/?$version=2";
+    uint64_t decoded = 0;
+    MQTTCODEC_HANDLE codec = mqtt_codec_create(on_packet_complete, &decoded);
+    BUFFER_HANDLE packet = mqtt_codec_publish(DELIVER_AT_MOST_ONCE, false, false, 0, twin_topic,
+                                              (const uint8_t *) REPORTED_PATCH, strlen(REPORTED_PATCH), NULL);
+    if (codec == NULL || packet == NULL) {
+        state.fail("mqtt_codec_create");
+        BUFFER_delete(packet);
+        mqtt_codec_destroy(codec);
+        return;
+    }
+    const unsigned char *bytes = BUFFER_u_char(packet);
+    size_t size = BUFFER_length(packet);
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        /* Split as the TLS record layer hands it over */
+        size_t head = size / 3;
+        if (mqtt_codec_bytesReceived(codec, bytes, head) != 0 ||
+            mqtt_codec_bytesReceived(codec, bytes + head, size - head) != 0) {
+            state.fail("mqtt_codec_bytesReceived");
+        }
+    }
+    state.stop();
+    if (decoded != state.iterations) {
+        state.fail("decoded packet count");
+    }
+    BUFFER_delete(packet);
+    mqtt_codec_destroy(codec);
+}
+
+/* constbuffer_array */
+
+void bm_constbuffer_array_build(BenchState &state)
+{
+    const char *parts[] = { D2C_TOPIC, TELEMETRY, REPORTED_PATCH, DEVICE_ID };
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        CONSTBUFFER_ARRAY_HANDLE array = constbuffer_array_create_empty();
+        for (size_t n = 0; n < sizeof(parts) / sizeof(parts[0]); n ++) {
+            CONSTBUFFER_HANDLE part = CONSTBUFFER_Create((const unsigned char *) parts[n], strlen(parts[n]));
+            CONSTBUFFER_ARRAY_HANDLE grown = constbuffer_array_add_front(array, part);
+            CONSTBUFFER_DecRef(part);
+            if (grown == NULL) {
+                state.fail("constbuffer_array_add_front");
+                break;
+            }
+            constbuffer_array_dec_ref(array);
+            array = grown;
+        }
+        uint32_t all_size = 0;
+        if (constbuffer_array_get_all_buffers_size(array, &all_size) != 0) {
+            state.fail("constbuffer_array_get_all_buffers_size");
+        }
+        sink = all_size;
+        constbuffer_array_dec_ref(array);
+    }
+    state.stop();
+}
+
+const Benchmark BENCHMARKS[] = {
+    { "STRING/construct_concat",             bm_string_construct_concat },
+    { "STRING/construct_sprintf",            bm_string_sprintf },
+    { "STRING/new_JSON",                     bm_string_new_json },
+    { "BUFFER/create_append_build",          bm_buffer_create_append },
+    { "Map/build_lookup_5_properties",       bm_map_build_lookup },
+    { "singlylinkedlist/add_find_remove_16", bm_singlylinkedlist_add_find_remove },
+    { "Base64/encode_32",                    bm_base64_encode },
+    { "Base64/decode_device_key",            bm_base64_decode },
+    { "URL_Encode/string_scope",             bm_url_encode_scope },
+    { "URL_Encode/property_value",           bm_url_encode_property_value },
+    { "USHA/sha256_1KiB",                    bm_usha256_1k },
+    { "HMACSHA256/sas_payload",              bm_hmacsha256_sas_payload },
+    { "SASToken/create",                     bm_sastoken_create },
+    { "mqtt_codec/publish_encode",           bm_mqtt_codec_publish_encode },
+    { "mqtt_codec/publish_decode",           bm_mqtt_codec_publish_decode },
+    { "constbuffer_array/build_4",           bm_constbuffer_array_build },
+};
+
+bool run_benchmark(const Benchmark &bench, double min_time_ms, Result &result)
+{
+    BenchState state;
+    uint64_t iterations = 1;
+
+    /* Grow the iteration count until one run lasts min_time_ms, as Google Benchmark does */
+    for (;;) {
+        state.iterations = iterations;
+        state.ok = true;
+        bench.run(state);
+        if (!state.ok) {
+            return false;
+        }
+        double ms = std::chrono::duration<double, std::milli>(state.elapsed).count();
+        if (ms >= min_time_ms || iterations >= (1ull << 40)) {
+            break;
+        }
+        double scale = ms > 0 ? (min_time_ms * 1.4) / ms : 10.0;
+        if (scale > 10.0) {
+            scale = 10.0;
+        }
+        uint64_t next = (uint64_t)(iterations * scale);
+        iterations = next > iterations ? next : iterations + 1;
+    }
+
+    double n = (double) state.iterations;
+    result.name = bench.name;
+    result.iterations = state.iterations;
+    result.ns_per_op = std::chrono::duration<double, std::nano>(state.elapsed).count() / n;
+    result.allocs_per_op = (state.heap1.alloc_count - state.heap0.alloc_count) / n;
+    result.bytes_per_op = (state.heap1.alloc_bytes - state.heap0.alloc_bytes) / n;
+    return true;
+}
+
+bool write_json(const char *path, const std::vector<Result> &results, double min_time_ms)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    fprintf(fp, "{\n  \"context\": {\"min_time_ms\": %.1f},\n  \"benchmarks\": [\n", min_time_ms);
+    for (size_t i = 0; i < results.size(); i ++) {
+        const Result &r = results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, "
+                "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}%s\n",
+                r.name.c_str(), (unsigned long long) r.iterations, r.ns_per_op, r.allocs_per_op, r.bytes_per_op,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    return fclose(fp) == 0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = NULL;
+    const char *out = NULL;
+    double min_time_ms = 200;
+
+    for (int i = 1; i < argc; i ++) {
+        if (i + 1 < argc && strcmp(argv[i], "--filter") == 0) {
+            filter = argv[++ i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--min-time-ms") == 0) {
+            min_time_ms = atof(argv[++ i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--out") == 0) {
+            out = argv[++ i];
+        } else {
+            fprintf(stderr, "Usage: %s [--filter <substring>] [--min-time-ms <ms>] [--out <file.json>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    bool ok = true;
+    printf("%-40s %12s %12s %12s %12s\n", "Benchmark", "Iterations", "ns/op", "allocs/op", "bytes/op");
+    for (const Benchmark &bench : BENCHMARKS) {
+        if (filter && strstr(bench.name, filter) == NULL) {
+            continue;
+        }
+        Result result;
+        if (!run_benchmark(bench, min_time_ms, result)) {
+            fprintf(stderr, "%s failed\n", bench.name);
+            ok = false;
+            continue;
+        }
+        printf("%-40s %12llu %12.1f %12.2f %12.1f\n", result.name.c_str(), (unsigned long long) result.iterations,
+               result.ns_per_op, result.allocs_per_op, result.bytes_per_op);
+        results.push_back(result);
+    }
+
+    if (out && !write_json(out, results, min_time_ms)) {
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
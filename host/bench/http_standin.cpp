@@ -0,0 +1,177 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "standin_servers.h"
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std::chrono;
+
+int standin_listen(uint16_t *port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = 0;
+    socklen_t len = sizeof(sin);
+    if (::bind(fd, reinterpret_cast<struct sockaddr *>(&sin), sizeof(sin)) != 0 ||
+            ::listen(fd, 4) != 0 ||
+            ::getsockname(fd, reinterpret_cast<struct sockaddr *>(&sin), &len) != 0) {
+        ::close(fd);
+        return -1;
+    }
+
+    *port = ntohs(sin.sin_port);
+    return fd;
+}
+
+HttpStandIn::HttpStandIn(const std::vector<uint8_t> &image, uint32_t rate_bytes_per_sec, size_t chunk_size) :
+    _image(image),
+    _rate(rate_bytes_per_sec),
+    _chunk_size(chunk_size ? chunk_size : 1460),
+    _listen_fd(-1),
+    _port(0),
+    _stop(false),
+    _requests(0)
+{
+}
+
+HttpStandIn::~HttpStandIn()
+{
+    stop();
+}
+
+bool HttpStandIn::start()
+{
+    _listen_fd = standin_listen(&_port);
+    if (_listen_fd < 0) {
+        return false;
+    }
+    _thread = std::thread(&HttpStandIn::serve, this);
+    return true;
+}
+
+void HttpStandIn::stop()
+{
+    _stop = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    if (_listen_fd >= 0) {
+        ::close(_listen_fd);
+        _listen_fd = -1;
+    }
+}
+
+void HttpStandIn::serve()
+{
+    while (!_stop) {
+        struct pollfd pfd = { _listen_fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        int fd = ::accept(_listen_fd, NULL, NULL);
+        if (fd >= 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            serve_connection(fd);
+            ::close(fd);
+        }
+    }
+}
+
+void HttpStandIn::serve_connection(int fd)
+{
+    /* Request head only: GET has no body */
+    std::string head;
+    char buf[512];
+    while (head.find("\r\n\r\n") == std::string::npos) {
+        ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0 || head.size() > 8192) {
+            return;
+        }
+        head.append(buf, n);
+    }
+    _requests ++;
+
+    size_t start = 0;
+    bool ranged = false;
+    size_t range_pos = head.find("\r\nRange: bytes=");
+    if (range_pos == std::string::npos) {
+        range_pos = head.find("\r\nrange: bytes=");
+    }
+    if (range_pos != std::string::npos) {
+        start = strtoul(head.c_str() + range_pos + strlen("\r\nRange: bytes="), NULL, 10);
+        ranged = true;
+    }
+
+    char response[256];
+    int len;
+    if (strncmp(head.c_str(), "GET ", 4) != 0) {
+        len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 405 Method Not Allowed\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        ::send(fd, response, len, MSG_NOSIGNAL);
+        return;
+    }
+    if (start > _image.size()) {
+        len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 416 Range Not Satisfiable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        ::send(fd, response, len, MSG_NOSIGNAL);
+        return;
+    }
+
+    size_t remaining = _image.size() - start;
+    if (ranged) {
+        len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 206 Partial Content\r\nContent-Length: %zu\r\n"
+                       "Content-Range: bytes %zu-%zu/%zu\r\nConnection: close\r\n\r\n",
+                       remaining, start, _image.size() - 1, _image.size());
+    } else {
+        len = snprintf(response, sizeof(response),
+                       "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nContent-Type: application/octet-stream\r\n"
+                       "Connection: close\r\n\r\n",
+                       remaining);
+    }
+    if (::send(fd, response, len, MSG_NOSIGNAL) != len) {
+        return;
+    }
+
+    steady_clock::time_point begin = steady_clock::now();
+    size_t sent = 0;
+    while (sent < remaining && !_stop) {
+        size_t todo = remaining - sent;
+        if (todo > _chunk_size) {
+            todo = _chunk_size;
+        }
+        ssize_t n = ::send(fd, &_image[start + sent], todo, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return;
+        }
+        sent += n;
+
+        /* Pace to link rate */
+        if (_rate) {
+            steady_clock::time_point due = begin + microseconds((uint64_t) sent * 1000000 / _rate);
+            std::this_thread::sleep_until(due);
+        }
+    }
+}
@@ -0,0 +1,218 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "standin_servers.h"
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* Topic of twin desired property patches, see IoT Hub MQTT support */
+#define TWIN_DESIRED_FILTER     "$iothub/twin/PATCH/properties/desired/"
+
+static bool recv_all(int fd, void *data, size_t size)
+{
+    uint8_t *p = static_cast<uint8_t *>(data);
+    while (size) {
+        ssize_t n = ::recv(fd, p, size, 0);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool send_all(int fd, const void *data, size_t size)
+{
+    return ::send(fd, data, size, MSG_NOSIGNAL) == (ssize_t) size;
+}
+
+/* Fixed header, then body. Returns false on disconnect or malformed length. */
+static bool recv_packet(int fd, uint8_t *type_flags, std::vector<uint8_t> &body)
+{
+    if (!recv_all(fd, type_flags, 1)) {
+        return false;
+    }
+
+    uint32_t length = 0;
+    for (int shift = 0; ; shift += 7) {
+        uint8_t byte;
+        if (shift > 21 || !recv_all(fd, &byte, 1)) {
+            return false;
+        }
+        length |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+
+    body.resize(length);
+    return length == 0 || recv_all(fd, body.data(), length);
+}
+
+static void append_length(std::vector<uint8_t> &out, size_t length)
+{
+    do {
+        uint8_t byte = length & 0x7F;
+        length >>= 7;
+        out.push_back(length ? (byte | 0x80) : byte);
+    } while (length);
+}
+
+static bool send_publish(int fd, const std::string &topic, const std::string &payload)
+{
+    std::vector<uint8_t> packet;
+    packet.push_back(0x30);     // PUBLISH, QoS 0
+    append_length(packet, 2 + topic.size() + payload.size());
+    packet.push_back((uint8_t)(topic.size() >> 8));
+    packet.push_back((uint8_t) topic.size());
+    packet.insert(packet.end(), topic.begin(), topic.end());
+    packet.insert(packet.end(), payload.begin(), payload.end());
+    return send_all(fd, packet.data(), packet.size());
+}
+
+MqttStandIn::MqttStandIn(const std::string &desired_patch) :
+    _desired_patch(desired_patch),
+    _listen_fd(-1),
+    _port(0),
+    _stop(false),
+    _published(0)
+{
+}
+
+MqttStandIn::~MqttStandIn()
+{
+    stop();
+}
+
+bool MqttStandIn::start()
+{
+    _listen_fd = standin_listen(&_port);
+    if (_listen_fd < 0) {
+        return false;
+    }
+    _thread = std::thread(&MqttStandIn::serve, this);
+    return true;
+}
+
+void MqttStandIn::stop()
+{
+    _stop = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    if (_listen_fd >= 0) {
+        ::close(_listen_fd);
+        _listen_fd = -1;
+    }
+}
+
+void MqttStandIn::serve()
+{
+    while (!_stop) {
+        struct pollfd pfd = { _listen_fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        int fd = ::accept(_listen_fd, NULL, NULL);
+        if (fd >= 0) {
+            int one = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            serve_connection(fd);
+            ::close(fd);
+        }
+    }
+}
+
+bool MqttStandIn::serve_connection(int fd)
+{
+    uint8_t type_flags;
+    std::vector<uint8_t> body;
+
+    while (!_stop) {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        if (::poll(&pfd, 1, 50) <= 0) {
+            continue;
+        }
+        if (!recv_packet(fd, &type_flags, body)) {
+            return false;
+        }
+
+        switch (type_flags >> 4) {
+            case 1: {   // CONNECT
+                static const uint8_t connack[] = { 0x20, 0x02, 0x00, 0x00 };
+                if (!send_all(fd, connack, sizeof(connack))) {
+                    return false;
+                }
+                break;
+            }
+
+            case 3: {   // PUBLISH
+                if (body.size() < 2) {
+                    return false;
+                }
+                size_t topic_len = ((size_t) body[0] << 8) | body[1];
+                size_t pos = 2 + topic_len;
+                uint8_t qos = (type_flags >> 1) & 0x03;
+                size_t payload_pos = pos + (qos ? 2 : 0);
+                if (payload_pos > body.size()) {
+                    return false;
+                }
+                /* Record before acknowledging, so that it is visible once the device sees PUBACK */
+                _last_published.assign(body.begin() + payload_pos, body.end());
+                _published ++;
+                if (qos) {
+                    uint8_t puback[] = { 0x40, 0x02, body[pos], body[pos + 1] };
+                    if (!send_all(fd, puback, sizeof(puback))) {
+                        return false;
+                    }
+                }
+                break;
+            }
+
+            case 8: {   // SUBSCRIBE
+                if (body.size() < 2) {
+                    return false;
+                }
+                std::vector<uint8_t> suback = { 0x90, 0x00, body[0], body[1] };
+                bool desired = false;
+                for (size_t pos = 2; pos + 2 <= body.size(); ) {
+                    size_t len = ((size_t) body[pos] << 8) | body[pos + 1];
+                    std::string filter(body.begin() + pos + 2, body.begin() + pos + 2 + len);
+                    desired = desired || filter.compare(0, strlen(TWIN_DESIRED_FILTER), TWIN_DESIRED_FILTER) == 0;
+                    pos += 2 + len + 1;
+                    suback.push_back(0x01);
+                }
+                suback[1] = (uint8_t)(suback.size() - 2);
+                if (!send_all(fd, suback.data(), suback.size())) {
+                    return false;
+                }
+                if (desired && !send_publish(fd, TWIN_DESIRED_FILTER "?$version=2", _desired_patch)) {
+                    return false;
+                }
+                break;
+            }
+
+            case 12: {  // PINGREQ
+                static const uint8_t pingresp[] = { 0xD0, 0x00 };
+                if (!send_all(fd, pingresp, sizeof(pingresp))) {
+                    return false;
+                }
+                break;
+            }
+
+            case 14:    // DISCONNECT
+                return true;
+
+            default:
+                break;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,638 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* OTA flow benchmark on host
+ *
+ * Runs connect -> deployment -> download -> apply against local MQTT/HTTP stand-ins, through
+ * the library's HTTP client, write-back BlockDevice and link scheduler on top of the POSIX
+ * stand-in for Mbed OS, and emits per-phase timings and heap peaks as JSON.
+ *
+ * The device side of MQTT is a minimal CONNECT/SUBSCRIBE/PUBLISH exchange of the IoT Hub twin
+ * topics, so that the flow doesn't need the Azure IoT SDK submodules.
+ */
+
+#include "mbed.h"
+#include "mbed_stub.h"
+#include "blockdevice/FileBlockDevice.h"
+#include "bootutil/bootutil.h"
+#include "kvstore_global_api/kvstore_global_api.h"
+
+#include "heap_stats.h"
+#include "http_request.h"
+#include "link_scheduler.h"
+#include "standin_servers.h"
+#include "writeback_bd.h"
+
+#include <algorithm>
+#include <chrono>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+#define TWIN_DESIRED_FILTER     "$iothub/twin/PATCH/properties/desired/#"
+#define TWIN_REPORTED_TOPIC     "$iothub/twin/PATCH/properties/reported/?$rid=%u"
+
+/* ADU agent states reported along the flow */
+#define ADU_STATE_DEPLOYMENT_IN_PROGRESS    6
+#define ADU_STATE_APPLY_STARTED             5
+
+/* Referenced by tcpsocketconnection adapter, as on target */
+NetworkInterface *_defaultSystemNetwork;
+
+namespace {
+
+struct BenchConfig {
+    size_t image_size = 1024 * 1024;
+    int iterations = 5;
+    size_t write_buffer = 4096;
+    size_t recv_buffer = 2048;
+    uint32_t rate = 0;
+    size_t server_chunk = 1460;
+    size_t program_size = 8;
+    size_t erase_size = 4096;
+    const char *out_path = NULL;
+    const char *slot_path = "ota_flow_bench_slot.bin";
+    const char *kv_dir = "ota_flow_bench_kv";
+};
+
+enum Phase {
+    PHASE_CONNECT = 0,
+    PHASE_DEPLOYMENT,
+    PHASE_DOWNLOAD,
+    PHASE_APPLY,
+    PHASE_MAX
+};
+
+const char *const phase_names[PHASE_MAX] = { "connect", "deployment", "download", "apply" };
+
+struct PhaseResult {
+    double ms = 0;
+    uint64_t heap_peak = 0;     // Peak bytes in use during phase above those in use at its start, whole process
+    uint64_t allocs = 0;        // Allocations during phase
+};
+
+struct RunResult {
+    PhaseResult phases[PHASE_MAX];
+    double total_ms = 0;
+    uint32_t bus_programs = 0;
+    uint32_t bus_reads = 0;
+    uint32_t bus_erases = 0;
+    uint32_t bus_reprograms = 0;
+    uint32_t http_requests = 0;
+};
+
+/* Phase measurement: wall time, heap peak and allocation count */
+class PhaseMeter {
+public:
+    explicit PhaseMeter(PhaseResult &result) : _result(result)
+    {
+        heap_stats_t stats;
+        heap_stats_reset_peak();
+        heap_stats_get(&stats);
+        _allocs = stats.alloc_count;
+        _base_bytes = stats.current_bytes;
+        _begin = steady_clock::now();
+    }
+
+    ~PhaseMeter()
+    {
+        heap_stats_t stats;
+        heap_stats_get(&stats);
+        _result.ms = duration<double, std::milli>(steady_clock::now() - _begin).count();
+        _result.heap_peak = stats.peak_bytes - _base_bytes;
+        _result.allocs = stats.alloc_count - _allocs;
+    }
+
+private:
+    PhaseResult &_result;
+    uint64_t _allocs;
+    uint64_t _base_bytes;
+    steady_clock::time_point _begin;
+};
+
+uint64_t fnv1a64(uint64_t hash, const uint8_t *data, size_t size)
+{
+    for (size_t i = 0; i < size; i ++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+const uint64_t FNV1A64_INIT = 0xcbf29ce484222325ULL;
+
+/* Device side of MQTT over the stand-in TCPSocket, with link scheduler accounting as tcpsocketconnection does */
+class MqttLite {
+public:
+    bool connect(NetworkInterface *network, const char *host, uint16_t port, const char *client_id)
+    {
+        SocketAddress addr;
+        if (network->gethostbyname(host, &addr) != NSAPI_ERROR_OK) {
+            return false;
+        }
+        addr.set_port(port);
+        if (_socket.open(network) != NSAPI_ERROR_OK || _socket.connect(addr) != NSAPI_ERROR_OK) {
+            return false;
+        }
+        _socket.set_timeout(5000);
+
+        std::vector<uint8_t> body = { 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02, 0x00, 0x3C };
+        append_string(body, client_id);
+        if (!send_packet(0x10, body)) {
+            return false;
+        }
+
+        uint8_t type_flags;
+        return recv_packet(&type_flags, body) && (type_flags >> 4) == 2 && body.size() == 2 && body[1] == 0;
+    }
+
+    bool subscribe(const char *filter)
+    {
+        std::vector<uint8_t> body = { (uint8_t)(_packet_id >> 8), (uint8_t) _packet_id };
+        append_string(body, filter);
+        body.push_back(0x01);
+        _packet_id ++;
+        if (!send_packet(0x82, body)) {
+            return false;
+        }
+
+        uint8_t type_flags;
+        return recv_packet(&type_flags, body) && (type_flags >> 4) == 9;
+    }
+
+    /* Wait for PUBLISH, skipping other packets */
+    bool wait_publish(std::string &topic, std::string &payload)
+    {
+        uint8_t type_flags;
+        std::vector<uint8_t> body;
+        while (recv_packet(&type_flags, body)) {
+            if ((type_flags >> 4) != 3 || body.size() < 2) {
+                continue;
+            }
+            size_t topic_len = ((size_t) body[0] << 8) | body[1];
+            size_t pos = 2 + topic_len + (((type_flags >> 1) & 0x03) ? 2 : 0);
+            if (pos > body.size()) {
+                return false;
+            }
+            topic.assign(body.begin() + 2, body.begin() + 2 + topic_len);
+            payload.assign(body.begin() + pos, body.end());
+            return true;
+        }
+        return false;
+    }
+
+    /* QoS 1 publish, waiting for PUBACK */
+    bool publish(const std::string &topic, const std::string &payload)
+    {
+        std::vector<uint8_t> body;
+        append_string(body, topic.c_str());
+        uint16_t packet_id = _packet_id ++;
+        body.push_back((uint8_t)(packet_id >> 8));
+        body.push_back((uint8_t) packet_id);
+        body.insert(body.end(), payload.begin(), payload.end());
+        if (!send_packet(0x32, body)) {
+            return false;
+        }
+
+        uint8_t type_flags;
+        while (recv_packet(&type_flags, body)) {
+            if ((type_flags >> 4) == 4 && body.size() == 2 && ((body[0] << 8) | body[1]) == packet_id) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void disconnect()
+    {
+        std::vector<uint8_t> body;
+        send_packet(0xE0, body);
+        _socket.close();
+    }
+
+private:
+    static void append_string(std::vector<uint8_t> &out, const char *str)
+    {
+        size_t len = strlen(str);
+        out.push_back((uint8_t)(len >> 8));
+        out.push_back((uint8_t) len);
+        out.insert(out.end(), str, str + len);
+    }
+
+    bool send_all(const uint8_t *data, size_t size)
+    {
+        while (size) {
+            nsapi_size_or_error_t n = _socket.send(data, size);
+            if (n <= 0) {
+                return false;
+            }
+            link_scheduler_consume(LINK_SCHEDULER_CLASS_CONTROL, n);
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool recv_all(uint8_t *data, size_t size)
+    {
+        while (size) {
+            nsapi_size_or_error_t n = _socket.recv(data, size);
+            if (n <= 0) {
+                return false;
+            }
+            link_scheduler_consume(LINK_SCHEDULER_CLASS_CONTROL, n);
+            data += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool send_packet(uint8_t type_flags, const std::vector<uint8_t> &body)
+    {
+        std::vector<uint8_t> packet = { type_flags };
+        size_t length = body.size();
+        do {
+            uint8_t byte = length & 0x7F;
+            length >>= 7;
+            packet.push_back(length ? (byte | 0x80) : byte);
+        } while (length);
+        packet.insert(packet.end(), body.begin(), body.end());
+        return send_all(packet.data(), packet.size());
+    }
+
+    bool recv_packet(uint8_t *type_flags, std::vector<uint8_t> &body)
+    {
+        if (!recv_all(type_flags, 1)) {
+            return false;
+        }
+        uint32_t length = 0;
+        for (int shift = 0; ; shift += 7) {
+            uint8_t byte;
+            if (shift > 21 || !recv_all(&byte, 1)) {
+                return false;
+            }
+            length |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                break;
+            }
+        }
+        body.resize(length);
+        return length == 0 || recv_all(body.data(), length);
+    }
+
+    TCPSocket _socket;
+    uint16_t _packet_id = 1;
+};
+
+/* Value of "key": "..." or "key": 123 in flat JSON, enough for the stand-in's deployment */
+bool json_field(const std::string &json, const char *key, std::string &value)
+{
+    std::string pattern = std::string("\"") + key + "\":";
+    size_t pos = json.find(pattern);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos += pattern.size();
+    while (pos < json.size() && json[pos] == ' ') {
+        pos ++;
+    }
+    if (pos < json.size() && json[pos] == '"') {
+        size_t end = json.find('"', pos + 1);
+        if (end == std::string::npos) {
+            return false;
+        }
+        value = json.substr(pos + 1, end - pos - 1);
+    } else {
+        size_t end = json.find_first_of(",}", pos);
+        value = json.substr(pos, end - pos);
+    }
+    return true;
+}
+
+std::string reported_state(int state)
+{
+    char payload[96];
+    snprintf(payload, sizeof(payload), "{\"deviceUpdate\":{\"__t\":\"c\",\"agent\":{\"state\":%d}}}", state);
+    return payload;
+}
+
+std::string reported_topic(unsigned rid)
+{
+    char topic[96];
+    snprintf(topic, sizeof(topic), TWIN_REPORTED_TOPIC, rid);
+    return topic;
+}
+
+bool run_once(const BenchConfig &config, MqttStandIn &mqtt, HttpStandIn &http, RunResult &result)
+{
+    NetworkInterface *network = NetworkInterface::get_default_instance();
+    MqttLite client;
+    std::string url;
+    size_t image_size = 0;
+    uint64_t image_hash = 0;
+    steady_clock::time_point begin = steady_clock::now();
+
+    mbed::FileBlockDevice slot(config.slot_path, (config.image_size + config.erase_size - 1) / config.erase_size * config.erase_size,
+                               1, config.program_size, config.erase_size);
+    WriteBackBlockDevice secondary(&slot, config.write_buffer, 512);
+    uint32_t http_requests = http.request_count();
+
+    /* Stand-in flash content is held in RAM. Keep it out of heap figures of the phases. */
+    if (slot.init() != BD_ERROR_OK) {
+        fprintf(stderr, "Secondary slot init failed\n");
+        return false;
+    }
+
+    {
+        PhaseMeter meter(result.phases[PHASE_CONNECT]);
+        if (!client.connect(network, "127.0.0.1", mqtt.port(), "ota-flow-bench")) {
+            fprintf(stderr, "MQTT connect failed\n");
+            return false;
+        }
+    }
+
+    {
+        PhaseMeter meter(result.phases[PHASE_DEPLOYMENT]);
+        std::string topic, payload, value;
+        if (!client.subscribe(TWIN_DESIRED_FILTER) || !client.wait_publish(topic, payload)) {
+            fprintf(stderr, "Deployment not received\n");
+            return false;
+        }
+        if (!json_field(payload, "url", url) ||
+                !json_field(payload, "sizeInBytes", value) || (image_size = strtoul(value.c_str(), NULL, 10)) == 0 ||
+                !json_field(payload, "fnv1a64", value)) {
+            fprintf(stderr, "Deployment malformed: %s\n", payload.c_str());
+            return false;
+        }
+        image_hash = strtoull(value.c_str(), NULL, 16);
+        if (!client.publish(reported_topic(1), reported_state(ADU_STATE_DEPLOYMENT_IN_PROGRESS))) {
+            fprintf(stderr, "Report state failed\n");
+            return false;
+        }
+    }
+
+    {
+        PhaseMeter meter(result.phases[PHASE_DOWNLOAD]);
+        if (secondary.init() != BD_ERROR_OK) {
+            fprintf(stderr, "Secondary slot init failed\n");
+            return false;
+        }
+        slot.reset_counters();
+        if (secondary.erase(0, slot.size()) != BD_ERROR_OK) {
+            fprintf(stderr, "Secondary slot erase failed\n");
+            return false;
+        }
+
+        std::vector<uint8_t> recv_buffer(config.recv_buffer);
+        uint64_t hash = FNV1A64_INIT;
+        size_t offset = 0;
+        int program_error = BD_ERROR_OK;
+        auto body_cb = [&](const char *at, uint32_t length) {
+            link_scheduler_consume(LINK_SCHEDULER_CLASS_BULK, length);
+            if (program_error != BD_ERROR_OK || offset + length > image_size) {
+                program_error = BD_ERROR_DEVICE_ERROR;
+                return;
+            }
+            hash = fnv1a64(hash, reinterpret_cast<const uint8_t *>(at), length);
+            program_error = secondary.program(at, offset, length);
+            offset += length;
+        };
+
+        HttpRequest request(network, HTTP_GET, url.c_str(), body_cb);
+        request.set_receive_buffer(recv_buffer.data(), recv_buffer.size());
+        request.set_timeout(5000);
+        HttpResponse *response = request.send();
+        if (response == NULL || response->get_status_code() != 200) {
+            fprintf(stderr, "Download failed: %d\n", response ? response->get_status_code() : request.get_error());
+            return false;
+        }
+        if (program_error != BD_ERROR_OK || offset != image_size || hash != image_hash) {
+            fprintf(stderr, "Download corrupt: error %d, %zu/%zu bytes\n", program_error, offset, image_size);
+            return false;
+        }
+        if (secondary.sync() != BD_ERROR_OK) {
+            fprintf(stderr, "Secondary slot sync failed\n");
+            return false;
+        }
+    }
+
+    {
+        PhaseMeter meter(result.phases[PHASE_APPLY]);
+
+        /* Verify what landed in flash, as signature check does */
+        uint8_t buffer[4096];
+        uint64_t hash = FNV1A64_INIT;
+        for (size_t offset = 0; offset < image_size; offset += sizeof(buffer)) {
+            size_t todo = std::min(sizeof(buffer), image_size - offset);
+            if (secondary.read(buffer, offset, todo) != BD_ERROR_OK) {
+                fprintf(stderr, "Secondary slot read failed\n");
+                return false;
+            }
+            hash = fnv1a64(hash, buffer, todo);
+        }
+        if (hash != image_hash) {
+            fprintf(stderr, "Secondary slot content mismatch\n");
+            return false;
+        }
+
+        static const uint8_t install_state[] = { 1 };
+        if (kv_set("/kv/ota_bench_state", install_state, sizeof(install_state), 0) != MBED_SUCCESS ||
+                boot_set_pending(false) != 0 ||
+                !client.publish(reported_topic(2), reported_state(ADU_STATE_APPLY_STARTED))) {
+            fprintf(stderr, "Apply failed\n");
+            return false;
+        }
+        client.disconnect();
+        secondary.deinit();
+    }
+    slot.deinit();
+
+    result.total_ms = duration<double, std::milli>(steady_clock::now() - begin).count();
+    result.bus_programs = slot.get_program_count();
+    result.bus_reads = slot.get_read_count();
+    result.bus_erases = slot.get_erase_count();
+    result.bus_reprograms = slot.get_reprogram_count();
+    result.http_requests = http.request_count() - http_requests;
+    return true;
+}
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t n = values.size();
+    return (n % 2) ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+
+void write_json(FILE *out, const BenchConfig &config, const std::vector<RunResult> &runs)
+{
+    fprintf(out, "{\n");
+    fprintf(out, "  \"benchmark\": \"ota_flow\",\n");
+    fprintf(out, "  \"config\": {\"image_size\": %zu, \"iterations\": %d, \"write_buffer\": %zu, \"recv_buffer\": %zu, "
+            "\"rate\": %" PRIu32 ", \"server_chunk\": %zu, \"program_size\": %zu, \"erase_size\": %zu, "
+            "\"link_scheduler\": %s},\n",
+            config.image_size, config.iterations, config.write_buffer, config.recv_buffer,
+            config.rate, config.server_chunk, config.program_size, config.erase_size,
+            link_scheduler_is_enabled() ? "true" : "false");
+
+    fprintf(out, "  \"runs\": [\n");
+    for (size_t i = 0; i < runs.size(); i ++) {
+        const RunResult &run = runs[i];
+        fprintf(out, "    {");
+        for (int phase = 0; phase < PHASE_MAX; phase ++) {
+            fprintf(out, "\"%s\": {\"ms\": %.3f, \"heap_peak\": %" PRIu64 ", \"allocs\": %" PRIu64 "}, ",
+                    phase_names[phase], run.phases[phase].ms, run.phases[phase].heap_peak, run.phases[phase].allocs);
+        }
+        fprintf(out, "\"total_ms\": %.3f, \"bus_programs\": %" PRIu32 ", \"bus_reads\": %" PRIu32
+                ", \"bus_erases\": %" PRIu32 ", \"bus_reprograms\": %" PRIu32 ", \"http_requests\": %" PRIu32 "}%s\n",
+                run.total_ms, run.bus_programs, run.bus_reads, run.bus_erases, run.bus_reprograms, run.http_requests,
+                (i + 1 < runs.size()) ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+
+    fprintf(out, "  \"summary\": {");
+    std::vector<double> totals;
+    for (const RunResult &run : runs) {
+        totals.push_back(run.total_ms);
+    }
+    for (int phase = 0; phase < PHASE_MAX; phase ++) {
+        std::vector<double> values;
+        uint64_t heap_peak = 0;
+        for (const RunResult &run : runs) {
+            values.push_back(run.phases[phase].ms);
+            heap_peak = std::max(heap_peak, run.phases[phase].heap_peak);
+        }
+        fprintf(out, "\"%s_ms_median\": %.3f, \"%s_heap_peak_max\": %" PRIu64 ", ",
+                phase_names[phase], median(values), phase_names[phase], heap_peak);
+    }
+    std::vector<double> download_ms;
+    for (const RunResult &run : runs) {
+        download_ms.push_back(run.phases[PHASE_DOWNLOAD].ms);
+    }
+    double download_median = median(download_ms);
+    fprintf(out, "\"total_ms_median\": %.3f, \"download_kib_per_s\": %.1f}\n",
+            median(totals), download_median > 0 ? (config.image_size / 1024.0) / (download_median / 1000.0) : 0.0);
+    fprintf(out, "}\n");
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "  --size <bytes>          Image size (default 1048576)\n"
+            "  --iterations <n>        Runs of the whole flow (default 5)\n"
+            "  --write-buffer <bytes>  Write-back window of secondary slot (default 4096)\n"
+            "  --recv-buffer <bytes>   HTTP receive buffer (default 2048)\n"
+            "  --rate <bytes/s>        Pace HTTP stand-in to link rate, 0 for unlimited (default 0)\n"
+            "  --server-chunk <bytes>  HTTP stand-in send size (default 1460)\n"
+            "  --program-size <bytes>  Secondary slot program unit (default 8)\n"
+            "  --erase-size <bytes>    Secondary slot erase unit (default 4096)\n"
+            "  --out <file>            Write JSON to file instead of stdout\n",
+            prog);
+}
+
+bool parse_args(int argc, char **argv, BenchConfig &config)
+{
+    for (int i = 1; i < argc; i ++) {
+        const char *arg = argv[i];
+        if (i + 1 >= argc) {
+            return false;
+        }
+        const char *value = argv[++ i];
+        if (strcmp(arg, "--size") == 0) {
+            config.image_size = strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--iterations") == 0) {
+            config.iterations = atoi(value);
+        } else if (strcmp(arg, "--write-buffer") == 0) {
+            config.write_buffer = strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--recv-buffer") == 0) {
+            config.recv_buffer = strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--rate") == 0) {
+            config.rate = strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--server-chunk") == 0) {
+            config.server_chunk = strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--program-size") == 0) {
+            config.program_size = strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--erase-size") == 0) {
+            config.erase_size = strtoul(value, NULL, 0);
+        } else if (strcmp(arg, "--out") == 0) {
+            config.out_path = value;
+        } else {
+            return false;
+        }
+    }
+    return config.image_size > 0 && config.iterations > 0 && config.recv_buffer > 0 &&
+           config.program_size > 0 && config.erase_size % config.program_size == 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    if (!parse_args(argc, argv, config)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    _defaultSystemNetwork = NetworkInterface::get_default_instance();
+    mbed_stub_kv_set_dir(config.kv_dir);
+
+    /* Deterministic image content */
+    std::vector<uint8_t> image(config.image_size);
+    uint32_t seed = 0x12345678;
+    for (uint8_t &byte : image) {
+        seed = seed * 1103515245 + 12345;
+        byte = (uint8_t)(seed >> 16);
+    }
+
+    HttpStandIn http(image, config.rate, config.server_chunk);
+    if (!http.start()) {
+        fprintf(stderr, "HTTP stand-in start failed\n");
+        return 1;
+    }
+
+    char deployment[256];
+    snprintf(deployment, sizeof(deployment),
+             "{\"deviceUpdate\":{\"__t\":\"c\",\"service\":{\"url\":\"http://127.0.0.1:%u/firmware.bin\","
+             "\"sizeInBytes\":%zu,\"fnv1a64\":\"%016" PRIx64 "\"}}}",
+             http.port(), image.size(), fnv1a64(FNV1A64_INIT, image.data(), image.size()));
+    MqttStandIn mqtt(deployment);
+    if (!mqtt.start()) {
+        fprintf(stderr, "MQTT stand-in start failed\n");
+        return 1;
+    }
+
+    std::vector<RunResult> runs;
+    for (int i = 0; i < config.iterations; i ++) {
+        RunResult result;
+        mbed_stub_boot_reset();
+        if (!run_once(config, mqtt, http, result)) {
+            fprintf(stderr, "Run %d failed\n", i);
+            return 1;
+        }
+        if (mbed_stub_boot_pending_count() != 1) {
+            fprintf(stderr, "Run %d: swap not requested\n", i);
+            return 1;
+        }
+        runs.push_back(result);
+    }
+
+    mqtt.stop();
+    http.stop();
+
+    FILE *out = config.out_path ? fopen(config.out_path, "w") : stdout;
+    if (out == NULL) {
+        fprintf(stderr, "Cannot open %s\n", config.out_path);
+        return 1;
+    }
+    write_json(out, config, runs);
+    if (out != stdout) {
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef STANDIN_SERVERS_H
+#define STANDIN_SERVERS_H
+
+#include <atomic>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* Local stand-ins of IoT Hub (MQTT) and the update content server (HTTP), plain POSIX sockets
+ * on 127.0.0.1. Each serves one connection at a time on its own thread.
+ */
+
+/* MQTT 3.1.1 broker stand-in
+ *
+ * Accepts CONNECT, answers SUBSCRIBE, and after subscription to the twin desired properties
+ * topic, publishes the configured deployment as a desired property patch. Device PUBLISHes
+ * are acknowledged and counted.
+ */
+class MqttStandIn {
+public:
+    explicit MqttStandIn(const std::string &desired_patch);
+    ~MqttStandIn();
+
+    bool start();
+    void stop();
+    uint16_t port() const
+    {
+        return _port;
+    }
+
+    uint32_t published_count() const
+    {
+        return _published;
+    }
+
+    const std::string &last_published() const
+    {
+        return _last_published;
+    }
+
+private:
+    void serve();
+    bool serve_connection(int fd);
+
+    std::string _desired_patch;
+    int _listen_fd;
+    uint16_t _port;
+    std::thread _thread;
+    std::atomic<bool> _stop;
+    std::atomic<uint32_t> _published;
+    std::string _last_published;
+};
+
+/* HTTP/1.1 content server stand-in
+ *
+ * Serves one image for any GET path, honoring "Range: bytes=<start>-" with 206. Sends in
+ * chunks, optionally paced to a link rate to emulate a narrowband link.
+ */
+class HttpStandIn {
+public:
+    HttpStandIn(const std::vector<uint8_t> &image, uint32_t rate_bytes_per_sec, size_t chunk_size);
+    ~HttpStandIn();
+
+    bool start();
+    void stop();
+    uint16_t port() const
+    {
+        return _port;
+    }
+
+    uint32_t request_count() const
+    {
+        return _requests;
+    }
+
+private:
+    void serve();
+    void serve_connection(int fd);
+
+    const std::vector<uint8_t> &_image;
+    uint32_t _rate;
+    size_t _chunk_size;
+    int _listen_fd;
+    uint16_t _port;
+    std::thread _thread;
+    std::atomic<bool> _stop;
+    std::atomic<uint32_t> _requests;
+};
+
+/* Listening socket on 127.0.0.1 with ephemeral port. Returns -1 on failure. */
+int standin_listen(uint16_t *port);
+
+#endif /* STANDIN_SERVERS_H */
@@ -0,0 +1,423 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+ * Benchmarks of ADU workflow_utils on a multi-image deployment, the way content handlers use it.
+ *
+ * Each benchmark is auto-calibrated to run for at least --min-time-ms and reports ns/op,
+ * allocations/op and bytes allocated/op (heap_stats malloc interposition). The update action
+ * follows ADU shapes: manifest v5 with one inline step per MCUboot image, SHA-256 hashes and
+ * file URLs. Manifest signature isn't validated.
+ *
+ * Child workflows are built for 1-, 5- and 20-step deployments, and reported with peak heap as
+ * well, against the former child build transcribed with parson: deep copies of Update Action and
+ * Update Manifest pruned to the step's files.
+ *
+ * Fails if the borrowed file view (workflow_peek_update_file) allocates, or if children peak at
+ * no less heap than the former build.
+ *
+ * Usage: workflow_bench [--filter <substring>] [--min-time-ms <ms>] [--out <file.json>]
+ */
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aduc/parser_utils.h"
+#include "aduc/workflow_file_view.h"
+#include "aduc/workflow_utils.h"
+#include <parson.h>
+
+#include "heap_stats.h"
+
+namespace {
+
+/* Images of the deployment, one file and one inline step each */
+const size_t IMAGE_COUNT = 4;
+
+/* Keeps results observable so the compiler can't drop the work */
+volatile uintptr_t sink;
+
+/* Update action of a deployment with @p steps inline steps and as many files */
+std::string make_update_action(size_t steps)
+{
+    JSON_Value *manifest = json_value_init_object();
+    JSON_Object *m = json_object(manifest);
+    json_object_set_string(m, "manifestVersion", "5");
+    json_object_dotset_string(m, "updateId.provider", "Nuvoton");
+    json_object_dotset_string(m, "updateId.name", "NuMaker-IoT-M467");
+    json_object_dotset_string(m, "updateId.version", "1.1.0");
+    json_object_set_string(m, "createdDateTime", "2022-06-14T08:21:44.8516021Z");
+
+    JSON_Value *compat = json_value_init_object();
+    json_object_set_string(json_object(compat), "deviceManufacturer", "Nuvoton");
+    json_object_set_string(json_object(compat), "deviceModel", "NuMaker-IoT-M467");
+    JSON_Value *compats = json_value_init_array();
+    json_array_append_value(json_array(compats), compat);
+    json_object_set_value(m, "compatibility", compats);
+
+    JSON_Value *stepArray = json_value_init_array();
+    JSON_Value *files = json_value_init_object();
+    JSON_Value *fileUrls = json_value_init_object();
+    for (size_t i = 0; i < steps; i ++) {
+        std::string id = "f" + std::to_string(i);
+
+        JSON_Value *file = json_value_init_object();
+        json_object_set_string(json_object(file), "fileName", ("NuMaker-IoT-M467-image" + std::to_string(i) + ".bin").c_str());
+        json_object_set_number(json_object(file), "sizeInBytes", 487424);
+        json_object_dotset_string(json_object(file), "hashes.sha256", "3Ft0OJ8Q/4QF/ufEdAHyIP7jOQ0BzkmcMcwZ6OKl3d8=");
+        json_object_set_value(json_object(files), id.c_str(), file);
+
+        std::string url = "http://duinstance.b.nlu.dl.adu.microsoft.com/westus2/duinstance/"
+                          "0d1a0ae3a1e44f8c9a03c7b0f1d2e3f4/NuMaker-IoT-M467-image" + std::to_string(i) + ".bin";
+        json_object_set_string(json_object(fileUrls), id.c_str(), url.c_str());
+
+        JSON_Value *step = json_value_init_object();
+        json_object_set_string(json_object(step), "type", "inline");
+        json_object_set_string(json_object(step), "handler", "nuvoton/mcubupdate:1");
+        JSON_Value *stepFiles = json_value_init_array();
+        json_array_append_string(json_array(stepFiles), id.c_str());
+        json_object_set_value(json_object(step), "files", stepFiles);
+        json_object_dotset_string(json_object(step), "handlerProperties.installedCriteria", "1.1.0");
+        json_array_append_value(json_array(stepArray), step);
+    }
+    json_object_dotset_value(m, "instructions.steps", stepArray);
+    json_object_set_value(m, "files", files);
+
+    char *manifestString = json_serialize_to_string(manifest);
+
+    JSON_Value *action = json_value_init_object();
+    JSON_Object *a = json_object(action);
+    json_object_dotset_number(a, "workflow.action", 3);
+    json_object_dotset_string(a, "workflow.id", "6a2f07a9-2d37-4d77-9a23-2f2b3e4b2f11");
+    json_object_set_string(a, "updateManifest", manifestString);
+    json_object_set_string(a, "updateManifestSignature", std::string(1500, 'x').c_str());
+    json_object_set_value(a, "fileUrls", fileUrls);
+
+    char *actionString = json_serialize_to_string(action);
+    std::string result(actionString);
+
+    json_free_serialized_string(actionString);
+    json_free_serialized_string(manifestString);
+    json_value_free(action);
+    json_value_free(manifest);
+    return result;
+}
+
+struct BenchState {
+    uint64_t iterations;
+    std::chrono::steady_clock::time_point t0;
+    std::chrono::steady_clock::duration elapsed;
+    heap_stats_t heap0;
+    heap_stats_t heap1;
+    bool ok;
+
+    /* Work outside start()/stop(), such as fixture setup and teardown, isn't measured. */
+    void start()
+    {
+        heap_stats_reset_peak();
+        heap_stats_get(&heap0);
+        t0 = std::chrono::steady_clock::now();
+    }
+
+    void stop()
+    {
+        elapsed = std::chrono::steady_clock::now() - t0;
+        heap_stats_get(&heap1);
+    }
+
+    void fail(const char *what)
+    {
+        fprintf(stderr, "  failed: %s\n", what);
+        ok = false;
+    }
+};
+
+struct Benchmark {
+    const char *name;
+    std::function<void(BenchState &)> run;
+    bool allocation_free;       // Fails if any allocation is made per op
+    const char *baseline;       // Fails unless peak heap is below this benchmark's
+};
+
+struct Result {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+    double bytes_per_op;
+    uint64_t peak_bytes;        // Heap in use at most above start, over all ops
+};
+
+/* Root workflow of a deployment with @p steps images, parsed once */
+ADUC_WorkflowHandle root_workflow(size_t steps = IMAGE_COUNT)
+{
+    static std::map<size_t, ADUC_WorkflowHandle> handles;
+    ADUC_WorkflowHandle &handle = handles[steps];
+    if (handle == NULL) {
+        ADUC_Result result = workflow_init(make_update_action(steps).c_str(), false, &handle);
+        if (IsAducResultCodeFailure(result.ResultCode)) {
+            fprintf(stderr, "workflow_init failed: 0x%X\n", (unsigned) result.ExtendedResultCode);
+            exit(1);
+        }
+    }
+    return handle;
+}
+
+/* File description per download attempt: owning copy */
+
+void bm_get_update_file(BenchState &state)
+{
+    ADUC_WorkflowHandle handle = root_workflow();
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        ADUC_FileEntity entity;
+        memset(&entity, 0, sizeof(entity));
+        if (!workflow_get_update_file(handle, i % IMAGE_COUNT, &entity)) {
+            state.fail("workflow_get_update_file");
+            break;
+        }
+        sink = (uintptr_t) entity.Hash + entity.HashCount + entity.SizeInBytes;
+        ADUC_FileEntity_Uninit(&entity);
+    }
+    state.stop();
+}
+
+/* File description per download attempt: borrowed view */
+
+void bm_peek_update_file(BenchState &state)
+{
+    ADUC_WorkflowHandle handle = root_workflow();
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        ADUC_FileEntityView view;
+        const char *hashType = NULL;
+        const char *hashValue = NULL;
+        if (!workflow_peek_update_file(handle, i % IMAGE_COUNT, &view) ||
+            !workflow_file_view_get_hash(&view, 0, &hashType, &hashValue)) {
+            state.fail("workflow_peek_update_file");
+            break;
+        }
+        sink = (uintptr_t) view.DownloadUri + (uintptr_t) hashValue + view.SizeInBytes;
+    }
+    state.stop();
+}
+
+/* Child workflows of all steps, alive together as under steps_handler */
+
+void bm_create_children(BenchState &state, size_t steps)
+{
+    ADUC_WorkflowHandle handle = root_workflow(steps);
+    std::vector<ADUC_WorkflowHandle> children(steps);
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        for (size_t step = 0; step < steps; step ++) {
+            ADUC_Result result = workflow_create_from_inline_step(handle, (int) step, &children[step]);
+            if (IsAducResultCodeFailure(result.ResultCode)) {
+                state.fail("workflow_create_from_inline_step");
+                children[step] = NULL;
+            }
+        }
+        for (size_t step = 0; step < steps; step ++) {
+            workflow_free(children[step]);
+        }
+        if (!state.ok) {
+            break;
+        }
+    }
+    state.stop();
+}
+
+/* Former child build: deep copies of Update Action and Update Manifest, pretty printed step
+ * for debug log, then files pruned against step files. Step files are only searched, not
+ * removed from as the former build did, so that the base stays the same across iterations. */
+
+void bm_deep_copy_children(BenchState &state, size_t steps)
+{
+    JSON_Value *action = json_parse_string(make_update_action(steps).c_str());
+    JSON_Value *manifest = json_parse_string(json_object_get_string(json_object(action), "updateManifest"));
+    JSON_Array *stepArray = json_object_dotget_array(json_object(manifest), "instructions.steps");
+    std::vector<JSON_Value *> copies(2 * steps);
+
+    state.start();
+    for (uint64_t i = 0; i < state.iterations; i ++) {
+        for (size_t step = 0; step < steps; step ++) {
+            JSON_Value *stepValue = json_array_get_value(stepArray, step);
+            JSON_Object *stepObject = json_object(stepValue);
+            JSON_Value *actionCopy = json_value_deep_copy(action);
+            JSON_Value *manifestCopy = json_value_deep_copy(manifest);
+            JSON_Object *m = json_object(manifestCopy);
+
+            char *stepData = json_serialize_to_string_pretty(stepValue);
+            sink = (uintptr_t) stepData;
+            json_free_serialized_string(stepData);
+
+            json_object_set_string(m, "updateType", json_object_get_string(stepObject, "handler"));
+            json_object_set_value(m, "handlerProperties",
+                                  json_value_deep_copy(json_object_get_value(stepObject, "handlerProperties")));
+
+            JSON_Array *stepFiles = json_object_get_array(stepObject, "files");
+            JSON_Object *baseFiles = json_object_get_object(m, "files");
+            for (int b = (int) json_object_get_count(baseFiles) - 1; b >= 0; b --) {
+                const char *baseFileId = json_object_get_name(baseFiles, b);
+                bool fileRequired = false;
+                for (int f = (int) json_array_get_count(stepFiles) - 1; f >= 0; f --) {
+                    const char *stepFileId = json_array_get_string(stepFiles, f);
+                    if (baseFileId != NULL && stepFileId != NULL && strcmp(baseFileId, stepFileId) == 0) {
+                        fileRequired = true;
+                        break;
+                    }
+                }
+                if (!fileRequired) {
+                    json_object_remove(baseFiles, baseFileId);
+                }
+            }
+            json_object_set_null(m, "instructions");
+
+            copies[2 * step] = actionCopy;
+            copies[2 * step + 1] = manifestCopy;
+        }
+        for (JSON_Value *copy : copies) {
+            json_value_free(copy);
+        }
+    }
+    state.stop();
+
+    json_value_free(manifest);
+    json_value_free(action);
+}
+
+const Benchmark BENCHMARKS[] = {
+    { "workflow/get_update_file",            bm_get_update_file,     false,  NULL },
+    { "workflow/peek_update_file",           bm_peek_update_file,    true,   NULL },
+    { "workflow/deep_copy_children/1",       [](BenchState &s) { bm_deep_copy_children(s, 1); },    false,  NULL },
+    { "workflow/create_children/1",          [](BenchState &s) { bm_create_children(s, 1); },       false,  "workflow/deep_copy_children/1" },
+    { "workflow/deep_copy_children/5",       [](BenchState &s) { bm_deep_copy_children(s, 5); },    false,  NULL },
+    { "workflow/create_children/5",          [](BenchState &s) { bm_create_children(s, 5); },       false,  "workflow/deep_copy_children/5" },
+    { "workflow/deep_copy_children/20",      [](BenchState &s) { bm_deep_copy_children(s, 20); },   false,  NULL },
+    { "workflow/create_children/20",         [](BenchState &s) { bm_create_children(s, 20); },      false,  "workflow/deep_copy_children/20" },
+};
+
+bool run_benchmark(const Benchmark &bench, double min_time_ms, Result &result)
+{
+    BenchState state;
+    uint64_t iterations = 1;
+
+    /* Grow the iteration count until one run lasts min_time_ms, as Google Benchmark does */
+    for (;;) {
+        state.iterations = iterations;
+        state.ok = true;
+        bench.run(state);
+        if (!state.ok) {
+            return false;
+        }
+        double ms = std::chrono::duration<double, std::milli>(state.elapsed).count();
+        if (ms >= min_time_ms || iterations >= (1ull << 40)) {
+            break;
+        }
+        double scale = ms > 0 ? (min_time_ms * 1.4) / ms : 10.0;
+        if (scale > 10.0) {
+            scale = 10.0;
+        }
+        uint64_t next = (uint64_t)(iterations * scale);
+        iterations = next > iterations ? next : iterations + 1;
+    }
+
+    double n = (double) state.iterations;
+    result.name = bench.name;
+    result.iterations = state.iterations;
+    result.ns_per_op = std::chrono::duration<double, std::nano>(state.elapsed).count() / n;
+    result.allocs_per_op = (state.heap1.alloc_count - state.heap0.alloc_count) / n;
+    result.bytes_per_op = (state.heap1.alloc_bytes - state.heap0.alloc_bytes) / n;
+    result.peak_bytes = state.heap1.peak_bytes - state.heap0.current_bytes;
+
+    if (bench.allocation_free && state.heap1.alloc_count != state.heap0.alloc_count) {
+        fprintf(stderr, "  failed: %llu allocation(s) in %llu op(s)\n",
+                (unsigned long long)(state.heap1.alloc_count - state.heap0.alloc_count),
+                (unsigned long long) state.iterations);
+        return false;
+    }
+    return true;
+}
+
+bool write_json(const char *path, const std::vector<Result> &results, double min_time_ms)
+{
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return false;
+    }
+    fprintf(fp, "{\n  \"context\": {\"min_time_ms\": %.1f, \"images\": %zu},\n  \"benchmarks\": [\n",
+            min_time_ms, IMAGE_COUNT);
+    for (size_t i = 0; i < results.size(); i ++) {
+        const Result &r = results[i];
+        fprintf(fp, "    {\"name\": \"%s\", \"iterations\": %llu, \"ns_per_op\": %.2f, "
+                "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f, \"peak_bytes\": %llu}%s\n",
+                r.name.c_str(), (unsigned long long) r.iterations, r.ns_per_op, r.allocs_per_op, r.bytes_per_op,
+                (unsigned long long) r.peak_bytes, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(fp, "  ]\n}\n");
+    return fclose(fp) == 0;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = NULL;
+    const char *out = NULL;
+    double min_time_ms = 200;
+
+    for (int i = 1; i < argc; i ++) {
+        if (i + 1 < argc && strcmp(argv[i], "--filter") == 0) {
+            filter = argv[++ i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--min-time-ms") == 0) {
+            min_time_ms = atof(argv[++ i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--out") == 0) {
+            out = argv[++ i];
+        } else {
+            fprintf(stderr, "Usage: %s [--filter <substring>] [--min-time-ms <ms>] [--out <file.json>]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<Result> results;
+    bool ok = true;
+    printf("%-40s %12s %12s %12s %12s %12s\n", "Benchmark", "Iterations", "ns/op", "allocs/op", "bytes/op", "peak bytes");
+    for (const Benchmark &bench : BENCHMARKS) {
+        if (filter && strstr(bench.name, filter) == NULL) {
+            continue;
+        }
+        Result result;
+        if (!run_benchmark(bench, min_time_ms, result)) {
+            fprintf(stderr, "%s failed\n", bench.name);
+            ok = false;
+            continue;
+        }
+        printf("%-40s %12llu %12.1f %12.2f %12.1f %12llu\n", result.name.c_str(), (unsigned long long) result.iterations,
+               result.ns_per_op, result.allocs_per_op, result.bytes_per_op, (unsigned long long) result.peak_bytes);
+        if (bench.baseline) {
+            for (const Result &baseline : results) {
+                if (baseline.name == bench.baseline && result.peak_bytes >= baseline.peak_bytes) {
+                    fprintf(stderr, "%s peaks at %llu bytes, not below %s\n", bench.name,
+                            (unsigned long long) result.peak_bytes, bench.baseline);
+                    ok = false;
+                }
+            }
+        }
+        results.push_back(result);
+    }
+
+    if (out && !write_json(out, results, min_time_ms)) {
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,24 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/*
+ * JWS stand-ins for workflow_bench: the bench parses update actions without manifest
+ * signature validation, so that crypto_lib and its Mbed TLS dependency stay out.
+ */
+
+#include "jws_utils.h"
+
+#include <stddef.h>
+
+JWSResult VerifyJWSWithSJWK(const char* blob)
+{
+    (void) blob;
+    return JWSResult_Failed;
+}
+
+bool GetPayloadFromJWT(const char* blob, char** destBuff)
+{
+    (void) blob;
+    *destBuff = NULL;
+    return false;
+}
@@ -0,0 +1,17 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for c-utility's crt_abstractions.h: the C library is enough on Linux */
+
+#ifndef CRT_ABSTRACTIONS_H
+#define CRT_ABSTRACTIONS_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#ifndef __cplusplus
+#include <stdbool.h>
+#endif
+
+#endif /* CRT_ABSTRACTIONS_H */
@@ -0,0 +1,11 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for c-utility's gballoc.h: no custom heap, malloc() and friends as they are */
+
+#ifndef GBALLOC_H
+#define GBALLOC_H
+
+#include <stdlib.h>
+
+#endif /* GBALLOC_H */
@@ -0,0 +1,19 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for c-utility's xlogging.h: LogError() to stderr, without azure-macro-utils-c */
+
+#ifndef XLOGGING_H
+#define XLOGGING_H
+
+#include <stdio.h>
+
+#define MU_FAILURE  __LINE__
+
+#define LogError(...)                                                           \
+    do {                                                                        \
+        fprintf(stderr, "Error: " __VA_ARGS__);                                 \
+        fputc('\n', stderr);                                                    \
+    } while (0)
+
+#endif /* XLOGGING_H */
@@ -0,0 +1,16 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Force-included ahead of copied/c-utility sources. Their quoted includes look next to the source
+ * first, where the real headers are. The stand-ins included here take the same include guards,
+ * so the real ones, which need azure-macro-utils-c, expand to nothing. */
+
+#ifndef CUTIL_STUB_FORCE_INCLUDE_H
+#define CUTIL_STUB_FORCE_INCLUDE_H
+
+#include "umock_c/umock_c_prod.h"
+#include "azure_c_shared_utility/crt_abstractions.h"
+#include "azure_c_shared_utility/gballoc.h"
+#include "azure_c_shared_utility/xlogging.h"
+
+#endif /* CUTIL_STUB_FORCE_INCLUDE_H */
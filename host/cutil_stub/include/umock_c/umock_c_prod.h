@@ -0,0 +1,57 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for umock-c's umock_c_prod.h: MOCKABLE_INTERFACE/MOCKABLE_FUNCTION as plain
+ * prototypes, without azure-macro-utils-c. Up to 20 functions per interface and 4 parameters
+ * per function. */
+
+#ifndef UMOCK_C_PROD_H
+#define UMOCK_C_PROD_H
+
+#define CUTIL_STUB_CAT_(a, b)   a##b
+#define CUTIL_STUB_CAT(a, b)    CUTIL_STUB_CAT_(a, b)
+
+#define CUTIL_STUB_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, n, ...) n
+#define CUTIL_STUB_COUNT(...)   CUTIL_STUB_COUNT_(__VA_ARGS__, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+/* Parameter list from type/name pairs. No pair counts as one empty argument. */
+#define CUTIL_STUB_PARAMS_1(none)                                       void
+#define CUTIL_STUB_PARAMS_2(t1, n1)                                     t1 n1
+#define CUTIL_STUB_PARAMS_4(t1, n1, t2, n2)                             t1 n1, t2 n2
+#define CUTIL_STUB_PARAMS_6(t1, n1, t2, n2, t3, n3)                     t1 n1, t2 n2, t3 n3
+#define CUTIL_STUB_PARAMS_8(t1, n1, t2, n2, t3, n3, t4, n4)             t1 n1, t2 n2, t3 n3, t4 n4
+#define CUTIL_STUB_PARAMS(...)  CUTIL_STUB_CAT(CUTIL_STUB_PARAMS_, CUTIL_STUB_COUNT(__VA_ARGS__))(__VA_ARGS__)
+
+#define MOCKABLE_FUNCTION(modifiers, result, name, ...) \
+    result modifiers name(CUTIL_STUB_PARAMS(__VA_ARGS__));
+
+/* MOCKABLE_INTERFACE entry. Already expanded when MOCKABLE_INTERFACE gets its arguments. */
+#define FUNCTION(modifiers, result, name, ...) \
+    MOCKABLE_FUNCTION(modifiers, result, name, __VA_ARGS__)
+
+/* Drop the commas between entries */
+#define CUTIL_STUB_EACH_1(x)        x
+#define CUTIL_STUB_EACH_2(x, ...)   x CUTIL_STUB_EACH_1(__VA_ARGS__)
+#define CUTIL_STUB_EACH_3(x, ...)   x CUTIL_STUB_EACH_2(__VA_ARGS__)
+#define CUTIL_STUB_EACH_4(x, ...)   x CUTIL_STUB_EACH_3(__VA_ARGS__)
+#define CUTIL_STUB_EACH_5(x, ...)   x CUTIL_STUB_EACH_4(__VA_ARGS__)
+#define CUTIL_STUB_EACH_6(x, ...)   x CUTIL_STUB_EACH_5(__VA_ARGS__)
+#define CUTIL_STUB_EACH_7(x, ...)   x CUTIL_STUB_EACH_6(__VA_ARGS__)
+#define CUTIL_STUB_EACH_8(x, ...)   x CUTIL_STUB_EACH_7(__VA_ARGS__)
+#define CUTIL_STUB_EACH_9(x, ...)   x CUTIL_STUB_EACH_8(__VA_ARGS__)
+#define CUTIL_STUB_EACH_10(x, ...)  x CUTIL_STUB_EACH_9(__VA_ARGS__)
+#define CUTIL_STUB_EACH_11(x, ...)  x CUTIL_STUB_EACH_10(__VA_ARGS__)
+#define CUTIL_STUB_EACH_12(x, ...)  x CUTIL_STUB_EACH_11(__VA_ARGS__)
+#define CUTIL_STUB_EACH_13(x, ...)  x CUTIL_STUB_EACH_12(__VA_ARGS__)
+#define CUTIL_STUB_EACH_14(x, ...)  x CUTIL_STUB_EACH_13(__VA_ARGS__)
+#define CUTIL_STUB_EACH_15(x, ...)  x CUTIL_STUB_EACH_14(__VA_ARGS__)
+#define CUTIL_STUB_EACH_16(x, ...)  x CUTIL_STUB_EACH_15(__VA_ARGS__)
+#define CUTIL_STUB_EACH_17(x, ...)  x CUTIL_STUB_EACH_16(__VA_ARGS__)
+#define CUTIL_STUB_EACH_18(x, ...)  x CUTIL_STUB_EACH_17(__VA_ARGS__)
+#define CUTIL_STUB_EACH_19(x, ...)  x CUTIL_STUB_EACH_18(__VA_ARGS__)
+#define CUTIL_STUB_EACH_20(x, ...)  x CUTIL_STUB_EACH_19(__VA_ARGS__)
+
+#define MOCKABLE_INTERFACE(interface_name, ...) \
+    CUTIL_STUB_CAT(CUTIL_STUB_EACH_, CUTIL_STUB_COUNT(__VA_ARGS__))(__VA_ARGS__)
+
+#endif /* UMOCK_C_PROD_H */
@@ -0,0 +1,62 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Host stand-in for c-utility's STRING: only what copied/c-utility sources under test call */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "azure_c_shared_utility/strings.h"
+
+typedef struct STRING_TAG
+{
+    char* s;
+} STRING;
+
+STRING_HANDLE STRING_new_with_memory(const char* memory)
+{
+    STRING* result = NULL;
+
+    if (memory != NULL && (result = (STRING*)malloc(sizeof(STRING))) != NULL)
+    {
+        result->s = (char*)memory;
+    }
+
+    return result;
+}
+
+STRING_HANDLE STRING_construct(const char* psz)
+{
+    STRING_HANDLE result = NULL;
+    char* copy;
+
+    if (psz != NULL && (copy = (char*)malloc(strlen(psz) + 1)) != NULL)
+    {
+        (void)strcpy(copy, psz);
+        if ((result = STRING_new_with_memory(copy)) == NULL)
+        {
+            free(copy);
+        }
+    }
+
+    return result;
+}
+
+void STRING_delete(STRING_HANDLE handle)
+{
+    if (handle != NULL)
+    {
+        free(handle->s);
+        free(handle);
+    }
+}
+
+const char* STRING_c_str(STRING_HANDLE handle)
+{
+    return (handle != NULL) ? handle->s : NULL;
+}
+
+size_t STRING_length(STRING_HANDLE handle)
+{
+    return (handle != NULL) ? strlen(handle->s) : 0;
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "heap_stats.h"
+
+#include <errno.h>
+#include <stdbool.h>
+#include <malloc.h>
+#include <string.h>
+
+/* glibc entry points behind the public names */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static uint64_t s_alloc_count;
+static uint64_t s_alloc_bytes;
+static uint64_t s_current_bytes;
+static uint64_t s_peak_bytes;
+
+static void account_alloc(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    uint64_t size = malloc_usable_size(ptr);
+    __atomic_add_fetch(&s_alloc_count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&s_alloc_bytes, size, __ATOMIC_RELAXED);
+    uint64_t current = __atomic_add_fetch(&s_current_bytes, size, __ATOMIC_RELAXED);
+
+    uint64_t peak = __atomic_load_n(&s_peak_bytes, __ATOMIC_RELAXED);
+    while (current > peak &&
+            !__atomic_compare_exchange_n(&s_peak_bytes, &peak, current, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void account_free(void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    __atomic_sub_fetch(&s_current_bytes, (uint64_t) malloc_usable_size(ptr), __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    void *ptr = __libc_malloc(size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    void *ptr = __libc_calloc(nmemb, size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (ptr == NULL) {
+        return malloc(size);
+    }
+    if (size == 0) {
+        free(ptr);
+        return NULL;
+    }
+
+    size_t old_size = malloc_usable_size(ptr);
+    void *new_ptr = __libc_realloc(ptr, size);
+    if (new_ptr != NULL) {
+        __atomic_sub_fetch(&s_current_bytes, (uint64_t) old_size, __ATOMIC_RELAXED);
+        account_alloc(new_ptr);
+    }
+    return new_ptr;
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    void *ptr = __libc_memalign(alignment, size);
+    account_alloc(ptr);
+    return ptr;
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0) {
+        return EINVAL;
+    }
+    void *ptr = memalign(alignment, size);
+    if (ptr == NULL && size != 0) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void free(void *ptr)
+{
+    account_free(ptr);
+    __libc_free(ptr);
+}
+
+void heap_stats_get(heap_stats_t *stats)
+{
+    stats->alloc_count = __atomic_load_n(&s_alloc_count, __ATOMIC_RELAXED);
+    stats->alloc_bytes = __atomic_load_n(&s_alloc_bytes, __ATOMIC_RELAXED);
+    stats->current_bytes = __atomic_load_n(&s_current_bytes, __ATOMIC_RELAXED);
+    stats->peak_bytes = __atomic_load_n(&s_peak_bytes, __ATOMIC_RELAXED);
+}
+
+void heap_stats_reset_peak(void)
+{
+    __atomic_store_n(&s_peak_bytes, __atomic_load_n(&s_current_bytes, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef HEAP_STATS_H
+#define HEAP_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Heap accounting of the whole host process, by interposing malloc() and friends of glibc
+ *
+ * Byte counts are usable sizes as reported by malloc_usable_size(), so they include
+ * allocator rounding but not its headers.
+ */
+typedef struct heap_stats {
+    uint64_t alloc_count;       // Allocations since start
+    uint64_t alloc_bytes;       // Bytes allocated since start
+    uint64_t current_bytes;     // Bytes in use
+    uint64_t peak_bytes;        // Maximum of bytes in use since start or heap_stats_reset_peak()
+} heap_stats_t;
+
+void heap_stats_get(heap_stats_t *stats);
+
+/* Restart peak from bytes currently in use */
+void heap_stats_reset_peak(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HEAP_STATS_H */
@@ -0,0 +1,29 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_KVSTORE_H
+#define MBED_KVSTORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform/mbed_error.h"
+
+namespace mbed {
+
+/* Host stand-in of the KVStore interface, limited to calls used by this library */
+class KVStore {
+public:
+    virtual ~KVStore() {}
+
+    virtual int init() = 0;
+    virtual int deinit() = 0;
+    virtual int reset() = 0;
+    virtual int set(const char *key, const void *buffer, size_t size, uint32_t create_flags) = 0;
+    virtual int get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size = NULL, size_t offset = 0) = 0;
+    virtual int remove(const char *key) = 0;
+};
+
+} // namespace mbed
+
+#endif /* MBED_KVSTORE_H */
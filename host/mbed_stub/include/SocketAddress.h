@@ -0,0 +1,4 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "netsocket/SocketAddress.h"
@@ -0,0 +1,51 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_TDBSTORE_H
+#define MBED_TDBSTORE_H
+
+#include "KVStore.h"
+#include "blockdevice/BlockDevice.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mbed {
+
+/* Host stand-in: records kept in a std::map, persisted as a whole to the BlockDevice on every change.
+ *
+ * Only the KVStore calls used by this library are provided. Program/erase traffic
+ * doesn't model TDBStore's append-and-compact layout.
+ */
+class TDBStore : public KVStore {
+public:
+    explicit TDBStore(BlockDevice *bd);
+    ~TDBStore() override;
+
+    int init() override;
+    int deinit() override;
+    int reset() override;
+    int set(const char *key, const void *buffer, size_t size, uint32_t create_flags) override;
+    int get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size = NULL, size_t offset = 0) override;
+    int remove(const char *key) override;
+
+    /** Number of times records were written out to the BlockDevice */
+    uint32_t get_write_count() const
+    {
+        return _write_count;
+    }
+
+private:
+    int load();
+    int store();
+
+    BlockDevice *_bd;
+    bool _is_initialized;
+    std::map<std::string, std::vector<uint8_t>> _records;
+    uint32_t _write_count;
+};
+
+} // namespace mbed
+
+#endif /* MBED_TDBSTORE_H */
@@ -0,0 +1,89 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef FILE_BLOCK_DEVICE_H
+#define FILE_BLOCK_DEVICE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include "blockdevice/BlockDevice.h"
+
+namespace mbed {
+
+/* Host only: NOR-flash-like BlockDevice backed by a file
+ *
+ * Enforces read/program/erase alignment, and counts bus transactions. Like Mbed's block devices,
+ * init()/deinit() are reference counted. A program unit
+ * programmed again without erase in between is counted as reprogram, which NOR flash
+ * and MCUboot's swap don't tolerate.
+ */
+class FileBlockDevice : public BlockDevice {
+public:
+    /**
+     * @param path          Backing file, created or truncated to @p size on init(). NULL for RAM only.
+     * @param size          Device size, multiple of erase size
+     * @param read_size     Read unit
+     * @param program_size  Program unit
+     * @param erase_size    Erase unit
+     */
+    FileBlockDevice(const char *path, bd_size_t size,
+                    bd_size_t read_size = 1, bd_size_t program_size = 8, bd_size_t erase_size = 4096);
+    ~FileBlockDevice() override;
+
+    int init() override;
+    int deinit() override;
+    int sync() override;
+    int read(void *buffer, bd_addr_t addr, bd_size_t size) override;
+    int program(const void *buffer, bd_addr_t addr, bd_size_t size) override;
+    int erase(bd_addr_t addr, bd_size_t size) override;
+
+    bd_size_t get_read_size() const override;
+    bd_size_t get_program_size() const override;
+    bd_size_t get_erase_size() const override;
+    int get_erase_value() const override;
+    bd_size_t size() const override;
+    const char *get_type() const override;
+
+    uint32_t get_read_count() const
+    {
+        return _reads;
+    }
+
+    uint32_t get_program_count() const
+    {
+        return _programs;
+    }
+
+    uint32_t get_erase_count() const
+    {
+        return _erases;
+    }
+
+    uint32_t get_reprogram_count() const
+    {
+        return _reprograms;
+    }
+
+    void reset_counters();
+
+private:
+    const char *_path;
+    int _fd;
+    uint32_t _init_ref_count;
+    bd_size_t _size;
+    bd_size_t _read_size;
+    bd_size_t _program_size;
+    bd_size_t _erase_size;
+    std::vector<uint8_t> _ram;
+    /* Per program unit: programmed since last erase */
+    std::vector<bool> _programmed;
+    uint32_t _reads;
+    uint32_t _programs;
+    uint32_t _erases;
+    uint32_t _reprograms;
+};
+
+} // namespace mbed
+
+#endif /* FILE_BLOCK_DEVICE_H */
@@ -0,0 +1,22 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef H_BOOTUTIL_
+#define H_BOOTUTIL_
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Mock of MCUboot's swap request: recorded only, see mbed_stub.h */
+int boot_set_pending(int permanent);
+int boot_set_pending_multi(int image_index, int permanent);
+int boot_set_confirmed(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* H_BOOTUTIL_ */
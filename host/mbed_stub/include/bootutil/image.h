@@ -0,0 +1,17 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef H_IMAGE_
+#define H_IMAGE_
+
+#include <stdint.h>
+
+/* MCUboot image version, as laid out in image header */
+struct image_version {
+    uint8_t iv_major;
+    uint8_t iv_minor;
+    uint16_t iv_revision;
+    uint32_t iv_build_num;
+};
+
+#endif /* H_IMAGE_ */
@@ -0,0 +1,46 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef CMSIS_OS2_H_
+#define CMSIS_OS2_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *osThreadId_t;
+
+typedef enum {
+    osOK                    =  0,
+    osError                 = -1,
+    osErrorTimeout          = -2,
+    osErrorResource         = -3,
+    osErrorParameter        = -4,
+    osErrorNoMemory         = -5,
+    osErrorISR              = -6,
+} osStatus_t;
+
+typedef enum {
+    osPriorityIdle          =  1,
+    osPriorityLow           =  8,
+    osPriorityBelowNormal   = 16,
+    osPriorityNormal        = 24,
+    osPriorityAboveNormal   = 32,
+    osPriorityHigh          = 40,
+    osPriorityRealtime      = 48,
+} osPriority_t;
+
+#define osWaitForever       0xFFFFFFFFU
+#define osFlagsError        0x80000000U
+#define osFlagsErrorTimeout 0xFFFFFFFEU
+
+/* Unique per host thread, stable for its lifetime */
+osThreadId_t osThreadGetId(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CMSIS_OS2_H_ */
@@ -0,0 +1,32 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef US_TICKER_API_H
+#define US_TICKER_API_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Monotonic microsecond ticker, 32 bits wide like the common Mbed targets */
+typedef struct {
+    uint32_t frequency;
+    uint32_t bits;
+} ticker_info_t;
+
+typedef struct ticker_data_s ticker_data_t;
+
+uint32_t us_ticker_read(void);
+const ticker_info_t *us_ticker_get_info(void);
+
+const ticker_data_t *get_us_ticker_data(void);
+/* 64-bit microseconds since first read */
+uint64_t ticker_read_us(const ticker_data_t *const ticker);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* US_TICKER_API_H */
@@ -0,0 +1,30 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef _KVSTORE_STATIC_API
+#define _KVSTORE_STATIC_API
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform/mbed_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Host stand-in of the default KVStore: one file per key under a directory
+ *
+ * Keys are full paths like "/kv/name". The directory defaults to "./kvstore", and can be
+ * changed with mbed_stub_kv_set_dir() in mbed_stub.h.
+ */
+int kv_set(const char *full_name_key, const void *buffer, size_t size, uint32_t create_flags);
+int kv_get(const char *full_name_key, void *buffer, size_t buffer_size, size_t *actual_size);
+int kv_remove(const char *full_name_key);
+int kv_reset(const char *kvstore_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _KVSTORE_STATIC_API */
@@ -0,0 +1,37 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_H
+#define MBED_H
+
+/* POSIX stand-in for the subset of Mbed OS used by this library, for host build only */
+
+#define MBED_MAJOR_VERSION  6
+#define MBED_MINOR_VERSION  99
+#define MBED_PATCH_VERSION  99
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "platform/mbed_assert.h"
+#include "platform/mbed_atomic.h"
+#include "platform/mbed_critical.h"
+#include "platform/mbed_error.h"
+#include "hal/us_ticker_api.h"
+#include "netsocket/nsapi_types.h"
+
+#ifdef __cplusplus
+#include "platform/Callback.h"
+#include "rtos/rtos.h"
+#include "netsocket/NetworkInterface.h"
+#include "netsocket/TCPSocket.h"
+
+using namespace mbed;
+using namespace rtos;
+using namespace std;
+#endif
+
+#endif /* MBED_H */
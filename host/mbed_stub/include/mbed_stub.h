@@ -0,0 +1,47 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_STUB_H
+#define MBED_STUB_H
+
+/* Host-only controls of the POSIX stand-in for Mbed OS. Not part of Mbed OS. */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Drive rtos::Kernel::Clock from virtual time
+ *
+ * With virtual clock on, ThisThread::sleep_for() advances virtual time instead of sleeping,
+ * so that timing logic can be tested fast and deterministically. Virtual time starts at
+ * the real clock when switched on.
+ */
+void mbed_stub_clock_set_virtual(bool enable);
+void mbed_stub_clock_advance_ms(uint64_t ms);
+/* Total milliseconds slept by ThisThread::sleep_for() since start */
+uint64_t mbed_stub_clock_slept_ms(void);
+
+/* Directory of files backing kv_set()/kv_get(), created if missing */
+void mbed_stub_kv_set_dir(const char *dir);
+/* Number of kv_set() calls since start */
+uint32_t mbed_stub_kv_set_count(void);
+/* Fail the next @p count kv_set() calls with MBED_ERROR_WRITE_FAILED, leaving storage unchanged */
+void mbed_stub_kv_fail_sets(uint32_t count);
+/* Number of kv_get() calls since start */
+uint32_t mbed_stub_kv_get_count(void);
+/* Busy-wait @p get_us in each kv_get() and @p set_us in each kv_set(), as flash KVStore on target would */
+void mbed_stub_kv_set_latency_us(uint32_t get_us, uint32_t set_us);
+
+/* Recorded boot_set_pending() requests: image index of last one, -1 if none */
+int mbed_stub_boot_pending_image(void);
+int mbed_stub_boot_pending_count(void);
+void mbed_stub_boot_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBED_STUB_H */
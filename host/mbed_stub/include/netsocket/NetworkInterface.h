@@ -0,0 +1,34 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef NETWORK_INTERFACE_H
+#define NETWORK_INTERFACE_H
+
+#include <stddef.h>
+
+#include "netsocket/SocketAddress.h"
+#include "netsocket/nsapi_types.h"
+
+/* Host network: always connected, name resolution through getaddrinfo() */
+class NetworkInterface {
+public:
+    virtual ~NetworkInterface() = default;
+
+    virtual nsapi_error_t connect()
+    {
+        return NSAPI_ERROR_OK;
+    }
+
+    virtual nsapi_error_t disconnect()
+    {
+        return NSAPI_ERROR_OK;
+    }
+
+    virtual nsapi_error_t gethostbyname(const char *host, SocketAddress *address,
+                                        nsapi_version_t version = NSAPI_UNSPEC,
+                                        const char *interface_name = NULL);
+
+    static NetworkInterface *get_default_instance();
+};
+
+#endif /* NETWORK_INTERFACE_H */
@@ -0,0 +1,24 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef SOCKET_H
+#define SOCKET_H
+
+#include "netsocket/SocketAddress.h"
+#include "netsocket/nsapi_types.h"
+
+/* Socket interface, limited to calls used by this library */
+class Socket {
+public:
+    virtual ~Socket() = default;
+
+    /* Safe to call from another thread to wake up a blocked send/recv */
+    virtual nsapi_error_t close() = 0;
+    virtual nsapi_error_t connect(const SocketAddress &address) = 0;
+    virtual nsapi_size_or_error_t send(const void *data, nsapi_size_t size) = 0;
+    virtual nsapi_size_or_error_t recv(void *data, nsapi_size_t size) = 0;
+    virtual void set_blocking(bool blocking) = 0;
+    virtual void set_timeout(int timeout) = 0;
+};
+
+#endif /* SOCKET_H */
@@ -0,0 +1,38 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef SOCKET_ADDRESS_H
+#define SOCKET_ADDRESS_H
+
+#include <stdint.h>
+
+#include "netsocket/nsapi_types.h"
+
+/* IPv4 only on host */
+class SocketAddress {
+public:
+    SocketAddress();
+    SocketAddress(const char *addr, uint16_t port = 0);
+
+    bool set_ip_address(const char *addr);
+    const char *get_ip_address() const;
+    void set_port(uint16_t port);
+    uint16_t get_port() const;
+    nsapi_version_t get_ip_version() const;
+
+    explicit operator bool() const;
+
+    /* Host only: IPv4 address in network byte order */
+    uint32_t get_in_addr() const
+    {
+        return _in_addr;
+    }
+
+private:
+    bool _valid;
+    uint32_t _in_addr;
+    uint16_t _port;
+    char _ip_string[16];
+};
+
+#endif /* SOCKET_ADDRESS_H */
@@ -0,0 +1,36 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef TCPSOCKET_H
+#define TCPSOCKET_H
+
+#include <atomic>
+
+#include "netsocket/NetworkInterface.h"
+#include "netsocket/Socket.h"
+
+/* TCP socket over a POSIX socket */
+class TCPSocket : public Socket {
+public:
+    TCPSocket();
+    ~TCPSocket() override;
+
+    nsapi_error_t open(NetworkInterface *network);
+
+    nsapi_error_t close() override;
+    nsapi_error_t connect(const SocketAddress &address) override;
+    nsapi_size_or_error_t send(const void *data, nsapi_size_t size) override;
+    nsapi_size_or_error_t recv(void *data, nsapi_size_t size) override;
+    void set_blocking(bool blocking) override;
+    void set_timeout(int timeout) override;
+
+private:
+    void apply_timeout();
+
+    int _fd;
+    std::atomic<bool> _closed;
+    bool _blocking;
+    int _timeout_ms;
+};
+
+#endif /* TCPSOCKET_H */
@@ -0,0 +1,130 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_CALLBACK_H
+#define MBED_CALLBACK_H
+
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+namespace mbed {
+
+template <typename Signature>
+class Callback;
+
+/* std::function based, so unlike Mbed's it may allocate for large functors */
+template <typename R, typename... ArgTs>
+class Callback<R(ArgTs...)> {
+public:
+    Callback() = default;
+
+    Callback(std::nullptr_t)
+    {
+    }
+
+    /* Function pointer, lambda or other functor */
+    template <typename F,
+              typename = typename std::enable_if<
+                  !std::is_same<typename std::decay<F>::type, Callback>::value &&
+                  std::is_convertible<decltype(std::declval<F &>()(std::declval<ArgTs>()...)), R>::value>::type>
+    Callback(F f)
+    {
+        assign(std::move(f));
+    }
+
+    /* Member function bound to object */
+    template <typename T, typename U>
+    Callback(U *obj, R(T::*method)(ArgTs...)) :
+        _func([obj, method](ArgTs... args) -> R {
+            return (obj->*method)(std::forward<ArgTs>(args)...);
+        })
+    {
+    }
+
+    template <typename T, typename U>
+    Callback(const U *obj, R(T::*method)(ArgTs...) const) :
+        _func([obj, method](ArgTs... args) -> R {
+            return (obj->*method)(std::forward<ArgTs>(args)...);
+        })
+    {
+    }
+
+    /* Function taking bound argument first */
+    template <typename T, typename U>
+    Callback(R(*func)(T *, ArgTs...), U *arg) :
+        _func([func, arg](ArgTs... args) -> R {
+            return func(arg, std::forward<ArgTs>(args)...);
+        })
+    {
+    }
+
+    template <typename T, typename U>
+    Callback(R(*func)(const T *, ArgTs...), const U *arg) :
+        _func([func, arg](ArgTs... args) -> R {
+            return func(arg, std::forward<ArgTs>(args)...);
+        })
+    {
+    }
+
+    R call(ArgTs... args) const
+    {
+        return _func(std::forward<ArgTs>(args)...);
+    }
+
+    R operator()(ArgTs... args) const
+    {
+        return call(std::forward<ArgTs>(args)...);
+    }
+
+    explicit operator bool() const
+    {
+        return static_cast<bool>(_func);
+    }
+
+private:
+    template <typename F>
+    typename std::enable_if<std::is_pointer<F>::value>::type assign(F f)
+    {
+        if (f) {
+            _func = f;
+        }
+    }
+
+    template <typename F>
+    typename std::enable_if<!std::is_pointer<F>::value>::type assign(F f)
+    {
+        _func = std::move(f);
+    }
+
+    std::function<R(ArgTs...)> _func;
+};
+
+template <typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(R(*func)(ArgTs...))
+{
+    return Callback<R(ArgTs...)>(func);
+}
+
+template <typename T, typename U, typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(U *obj, R(T::*method)(ArgTs...))
+{
+    return Callback<R(ArgTs...)>(obj, method);
+}
+
+template <typename T, typename U, typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(R(*func)(T *, ArgTs...), U *arg)
+{
+    return Callback<R(ArgTs...)>(func, arg);
+}
+
+template <typename T, typename U, typename R, typename... ArgTs>
+Callback<R(ArgTs...)> callback(R(*func)(const T *, ArgTs...), const U *arg)
+{
+    return Callback<R(ArgTs...)>(func, arg);
+}
+
+} // namespace mbed
+
+#endif /* MBED_CALLBACK_H */
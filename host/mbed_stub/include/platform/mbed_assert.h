@@ -0,0 +1,17 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_ASSERT_H
+#define MBED_ASSERT_H
+
+#include <assert.h>
+
+#define MBED_ASSERT(expr)   assert(expr)
+
+#ifdef __cplusplus
+#define MBED_STATIC_ASSERT(expr, msg)   static_assert(expr, msg)
+#else
+#define MBED_STATIC_ASSERT(expr, msg)   _Static_assert(expr, msg)
+#endif
+
+#endif /* MBED_ASSERT_H */
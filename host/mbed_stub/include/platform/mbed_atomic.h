@@ -0,0 +1,59 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_ATOMIC_H
+#define MBED_ATOMIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* GCC/Clang builtins in place of Mbed's exclusive-access implementation */
+
+typedef struct core_util_atomic_flag {
+    uint8_t _flag;
+} core_util_atomic_flag;
+
+#define CORE_UTIL_ATOMIC_FLAG_INIT { 0 }
+
+static inline bool core_util_atomic_flag_test_and_set(volatile core_util_atomic_flag *flagPtr)
+{
+    return __atomic_test_and_set(&flagPtr->_flag, __ATOMIC_SEQ_CST);
+}
+
+static inline void core_util_atomic_flag_clear(volatile core_util_atomic_flag *flagPtr)
+{
+    __atomic_clear(&flagPtr->_flag, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t core_util_atomic_incr_u32(volatile uint32_t *valuePtr, uint32_t delta)
+{
+    return __atomic_add_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t core_util_atomic_decr_u32(volatile uint32_t *valuePtr, uint32_t delta)
+{
+    return __atomic_sub_fetch(valuePtr, delta, __ATOMIC_SEQ_CST);
+}
+
+static inline uint32_t core_util_atomic_load_u32(const volatile uint32_t *valuePtr)
+{
+    return __atomic_load_n(valuePtr, __ATOMIC_SEQ_CST);
+}
+
+static inline void core_util_atomic_store_u32(volatile uint32_t *valuePtr, uint32_t desiredValue)
+{
+    __atomic_store_n(valuePtr, desiredValue, __ATOMIC_SEQ_CST);
+}
+
+static inline bool core_util_atomic_cas_u32(volatile uint32_t *ptr, uint32_t *expectedCurrentValue, uint32_t desiredValue)
+{
+    return __atomic_compare_exchange_n(ptr, expectedCurrentValue, desiredValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+/* No interrupt context on host */
+static inline bool core_util_is_isr_active(void)
+{
+    return false;
+}
+
+#endif /* MBED_ATOMIC_H */
@@ -0,0 +1,19 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_CRITICAL_H
+#define MBED_CRITICAL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One process-wide recursive lock in place of masking interrupts */
+void core_util_critical_section_enter(void);
+void core_util_critical_section_exit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MBED_CRITICAL_H */
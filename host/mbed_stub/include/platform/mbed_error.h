@@ -0,0 +1,34 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MBED_ERROR_H
+#define MBED_ERROR_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Distinct negative codes, not Mbed's encoded values */
+#define MBED_SUCCESS                    0
+#define MBED_ERROR_INVALID_ARGUMENT     (-0x101)
+#define MBED_ERROR_INVALID_SIZE         (-0x102)
+#define MBED_ERROR_ITEM_NOT_FOUND       (-0x103)
+#define MBED_ERROR_READ_FAILED          (-0x104)
+#define MBED_ERROR_WRITE_FAILED         (-0x105)
+#define MBED_ERROR_MEDIA_FULL           (-0x106)
+#define MBED_ERROR_NOT_READY            (-0x107)
+#define MBED_ERROR_FAILED_OPERATION     (-0x108)
+#define MBED_ERROR_ALREADY_IN_USE       (-0x109)
+
+/* Fatal error: reported and the process exits with failure, where Mbed OS halts the system */
+#define MBED_MODULE_APPLICATION             0
+#define MBED_ERROR_CODE_OUT_OF_RESOURCES    0x10A
+#define MBED_MAKE_ERROR(module, error_code) (-(error_code))
+
+#define MBED_ERROR(error_status, error_msg)                                     \
+    do {                                                                        \
+        fprintf(stderr, "Fatal error %d: %s (%s:%d)\n", (int) (error_status),   \
+                error_msg, __FILE__, __LINE__);                                 \
+        _Exit(EXIT_FAILURE);                                                    \
+    } while (0)
+
+#endif /* MBED_ERROR_H */
@@ -0,0 +1,11 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef RTOS_H
+#define RTOS_H
+
+#include "rtos/rtos.h"
+
+using namespace rtos;
+
+#endif /* RTOS_H */
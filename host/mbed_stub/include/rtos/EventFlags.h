@@ -0,0 +1,46 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef EVENT_FLAG_H
+#define EVENT_FLAG_H
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+
+#include "rtos/Kernel.h"
+#include "rtos/mbed_rtos_types.h"
+
+namespace rtos {
+
+/* Timeouts run on real time, also with virtual clock on */
+class EventFlags {
+public:
+    EventFlags() = default;
+    explicit EventFlags(const char *name)
+    {
+        (void) name;
+    }
+    EventFlags(const EventFlags &) = delete;
+    EventFlags &operator=(const EventFlags &) = delete;
+
+    uint32_t set(uint32_t flags);
+    uint32_t clear(uint32_t flags = 0x7fffffff);
+    uint32_t get() const;
+
+    uint32_t wait_all(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true);
+    uint32_t wait_any(uint32_t flags = 0, uint32_t millisec = osWaitForever, bool clear = true);
+    uint32_t wait_all_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time, bool clear = true);
+    uint32_t wait_any_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time, bool clear = true);
+
+private:
+    uint32_t wait(uint32_t flags, bool all, uint32_t millisec, bool clear);
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    uint32_t _flags = 0;
+};
+
+} // namespace rtos
+
+#endif /* EVENT_FLAG_H */
@@ -0,0 +1,30 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef KERNEL_H
+#define KERNEL_H
+
+#include <chrono>
+#include <stdint.h>
+
+namespace rtos {
+namespace Kernel {
+
+/* Monotonic millisecond clock. Can be switched to virtual time, see mbed_stub.h. */
+struct Clock {
+    Clock() = delete;
+    using duration = std::chrono::milliseconds;
+    using rep = duration::rep;
+    using period = duration::period;
+    using time_point = std::chrono::time_point<Clock>;
+    using duration_u32 = std::chrono::duration<uint32_t, period>;
+    static constexpr bool is_steady = true;
+    static time_point now();
+};
+
+uint64_t get_ms_count();
+
+} // namespace Kernel
+} // namespace rtos
+
+#endif /* KERNEL_H */
@@ -0,0 +1,51 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include <mutex>
+
+#include "rtos/Kernel.h"
+#include "rtos/mbed_rtos_types.h"
+
+namespace rtos {
+
+/* Recursive like RTX mutex */
+class Mutex {
+public:
+    Mutex() = default;
+    explicit Mutex(const char *name)
+    {
+        (void) name;
+    }
+    Mutex(const Mutex &) = delete;
+    Mutex &operator=(const Mutex &) = delete;
+
+    void lock()
+    {
+        _mutex.lock();
+    }
+
+    bool trylock()
+    {
+        return _mutex.try_lock();
+    }
+
+    bool trylock_for(Kernel::Clock::duration_u32 rel_time)
+    {
+        return _mutex.try_lock_for(rel_time);
+    }
+
+    void unlock()
+    {
+        _mutex.unlock();
+    }
+
+private:
+    std::recursive_timed_mutex _mutex;
+};
+
+} // namespace rtos
+
+#endif /* MUTEX_H */
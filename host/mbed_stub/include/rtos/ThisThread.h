@@ -0,0 +1,26 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef THIS_THREAD_H
+#define THIS_THREAD_H
+
+#include <stdint.h>
+
+#include "rtos/Kernel.h"
+#include "rtos/mbed_rtos_types.h"
+
+namespace rtos {
+namespace ThisThread {
+
+/* Advance virtual time instead of sleeping when virtual clock is on, see mbed_stub.h */
+void sleep_for(uint32_t millisec);
+void sleep_for(Kernel::Clock::duration_u32 rel_time);
+void sleep_until(Kernel::Clock::time_point abs_time);
+void yield();
+osThreadId_t get_id();
+const char *get_name();
+
+} // namespace ThisThread
+} // namespace rtos
+
+#endif /* THIS_THREAD_H */
@@ -0,0 +1,56 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+
+#include "platform/Callback.h"
+#include "rtos/mbed_rtos_types.h"
+
+namespace rtos {
+
+/* std::thread underneath. Priority and stack are recorded only. */
+class Thread {
+public:
+    Thread(osPriority priority = osPriorityNormal,
+           uint32_t stack_size = OS_STACK_SIZE,
+           unsigned char *stack_mem = nullptr,
+           const char *name = nullptr);
+    Thread(const Thread &) = delete;
+    Thread &operator=(const Thread &) = delete;
+
+    /* Joins, as host threads can't be terminated */
+    virtual ~Thread();
+
+    osStatus start(mbed::Callback<void()> task);
+    osStatus join();
+    /* Only succeeds on thread already finished */
+    osStatus terminate();
+
+    osThreadId_t get_id() const;
+    const char *get_name() const;
+    osPriority get_priority() const;
+    uint32_t stack_size() const;
+
+private:
+    void run();
+
+    osPriority _priority;
+    uint32_t _stack_size;
+    const char *_name;
+    mbed::Callback<void()> _task;
+    std::thread _thread;
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    osThreadId_t _id;
+    bool _finished;
+};
+
+} // namespace rtos
+
+#endif /* THREAD_H */
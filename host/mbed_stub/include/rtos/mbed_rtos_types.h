@@ -0,0 +1,17 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef RTOS_TYPES_H_
+#define RTOS_TYPES_H_
+
+#include "cmsis_os2.h"
+
+typedef osStatus_t osStatus;
+typedef osPriority_t osPriority;
+
+/* Stack size is only recorded. Host threads get the pthread default. */
+#ifndef OS_STACK_SIZE
+#define OS_STACK_SIZE   4096
+#endif
+
+#endif /* RTOS_TYPES_H_ */
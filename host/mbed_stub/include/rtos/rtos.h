@@ -0,0 +1,14 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef RTOS_RTOS_H
+#define RTOS_RTOS_H
+
+#include "rtos/mbed_rtos_types.h"
+#include "rtos/Kernel.h"
+#include "rtos/Mutex.h"
+#include "rtos/ThisThread.h"
+#include "rtos/Thread.h"
+#include "rtos/EventFlags.h"
+
+#endif /* RTOS_RTOS_H */
@@ -0,0 +1,190 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "blockdevice/FileBlockDevice.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+namespace mbed {
+
+FileBlockDevice::FileBlockDevice(const char *path, bd_size_t size,
+                                 bd_size_t read_size, bd_size_t program_size, bd_size_t erase_size) :
+    _path(path),
+    _fd(-1),
+    _init_ref_count(0),
+    _size(size),
+    _read_size(read_size),
+    _program_size(program_size),
+    _erase_size(erase_size),
+    _reads(0),
+    _programs(0),
+    _erases(0),
+    _reprograms(0)
+{
+}
+
+FileBlockDevice::~FileBlockDevice()
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+int FileBlockDevice::init()
+{
+    if (_init_ref_count) {
+        _init_ref_count ++;
+        return BD_ERROR_OK;
+    }
+    if (_size % _erase_size || _erase_size % _program_size) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    /* Content is kept in RAM, and written through to file for inspection and reuse */
+    _ram.assign(_size, (uint8_t) get_erase_value());
+    _programmed.assign(_size / _program_size, false);
+
+    if (_path) {
+        _fd = ::open(_path, O_RDWR | O_CREAT, 0644);
+        if (_fd < 0) {
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        ssize_t n = ::pread(_fd, _ram.data(), _size, 0);
+        if (n < 0 || ::ftruncate(_fd, _size) != 0) {
+            ::close(_fd);
+            _fd = -1;
+            return BD_ERROR_DEVICE_ERROR;
+        }
+        /* Prior content counts as programmed unless erased */
+        for (bd_size_t unit = 0; unit < _programmed.size(); unit ++) {
+            const uint8_t *p = &_ram[unit * _program_size];
+            for (bd_size_t i = 0; i < _program_size; i ++) {
+                if (p[i] != (uint8_t) get_erase_value()) {
+                    _programmed[unit] = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    reset_counters();
+    _init_ref_count = 1;
+    return BD_ERROR_OK;
+}
+
+int FileBlockDevice::deinit()
+{
+    if (_init_ref_count == 0 || -- _init_ref_count) {
+        return BD_ERROR_OK;
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    return BD_ERROR_OK;
+}
+
+int FileBlockDevice::sync()
+{
+    if (_fd >= 0 && ::fsync(_fd) != 0) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+int FileBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_read(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _reads ++;
+    memcpy(buffer, &_ram[addr], size);
+    return BD_ERROR_OK;
+}
+
+int FileBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_program(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _programs ++;
+    for (bd_size_t unit = addr / _program_size; unit < (addr + size) / _program_size; unit ++) {
+        if (_programmed[unit]) {
+            _reprograms ++;
+        }
+        _programmed[unit] = true;
+    }
+
+    /* NOR flash can only clear bits */
+    const uint8_t *src = static_cast<const uint8_t *>(buffer);
+    for (bd_size_t i = 0; i < size; i ++) {
+        _ram[addr + i] &= src[i];
+    }
+
+    if (_fd >= 0 && ::pwrite(_fd, &_ram[addr], size, addr) != (ssize_t) size) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+int FileBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    if (!is_valid_erase(addr, size)) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _erases ++;
+    memset(&_ram[addr], get_erase_value(), size);
+    for (bd_size_t unit = addr / _program_size; unit < (addr + size) / _program_size; unit ++) {
+        _programmed[unit] = false;
+    }
+
+    if (_fd >= 0 && ::pwrite(_fd, &_ram[addr], size, addr) != (ssize_t) size) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+    return BD_ERROR_OK;
+}
+
+bd_size_t FileBlockDevice::get_read_size() const
+{
+    return _read_size;
+}
+
+bd_size_t FileBlockDevice::get_program_size() const
+{
+    return _program_size;
+}
+
+bd_size_t FileBlockDevice::get_erase_size() const
+{
+    return _erase_size;
+}
+
+int FileBlockDevice::get_erase_value() const
+{
+    return 0xFF;
+}
+
+bd_size_t FileBlockDevice::size() const
+{
+    return _size;
+}
+
+const char *FileBlockDevice::get_type() const
+{
+    return "FILE";
+}
+
+void FileBlockDevice::reset_counters()
+{
+    _reads = 0;
+    _programs = 0;
+    _erases = 0;
+    _reprograms = 0;
+}
+
+} // namespace mbed
@@ -0,0 +1,197 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "TDBStore.h"
+
+#include <string.h>
+
+namespace mbed {
+
+/* Layout: magic, record count, then per record: key length, key, data size, data. Little endian. */
+static const uint32_t TDBSTORE_STUB_MAGIC = 0x54444253;
+
+static void put_u32(std::vector<uint8_t> &out, uint32_t value)
+{
+    for (int i = 0; i < 4; i ++) {
+        out.push_back((uint8_t)(value >> (i * 8)));
+    }
+}
+
+static bool get_u32(const std::vector<uint8_t> &in, size_t &pos, uint32_t &value)
+{
+    if (pos + 4 > in.size()) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; i ++) {
+        value |= (uint32_t) in[pos + i] << (i * 8);
+    }
+    pos += 4;
+    return true;
+}
+
+TDBStore::TDBStore(BlockDevice *bd) :
+    _bd(bd),
+    _is_initialized(false),
+    _write_count(0)
+{
+}
+
+TDBStore::~TDBStore()
+{
+    deinit();
+}
+
+int TDBStore::init()
+{
+    if (_is_initialized) {
+        return MBED_SUCCESS;
+    }
+    if (_bd->init() != BD_ERROR_OK) {
+        return MBED_ERROR_READ_FAILED;
+    }
+
+    int ret = load();
+    if (ret != MBED_SUCCESS) {
+        _bd->deinit();
+        return ret;
+    }
+    _is_initialized = true;
+    return MBED_SUCCESS;
+}
+
+int TDBStore::deinit()
+{
+    if (!_is_initialized) {
+        return MBED_SUCCESS;
+    }
+    _records.clear();
+    _is_initialized = false;
+    return _bd->deinit() == BD_ERROR_OK ? MBED_SUCCESS : MBED_ERROR_FAILED_OPERATION;
+}
+
+int TDBStore::reset()
+{
+    if (!_is_initialized) {
+        return MBED_ERROR_NOT_READY;
+    }
+    _records.clear();
+    return store();
+}
+
+int TDBStore::set(const char *key, const void *buffer, size_t size, uint32_t create_flags)
+{
+    (void) create_flags;
+    if (!_is_initialized) {
+        return MBED_ERROR_NOT_READY;
+    }
+    if (key == NULL || (buffer == NULL && size != 0)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    const uint8_t *data = static_cast<const uint8_t *>(buffer);
+    _records[key] = std::vector<uint8_t>(data, data + size);
+    return store();
+}
+
+int TDBStore::get(const char *key, void *buffer, size_t buffer_size, size_t *actual_size, size_t offset)
+{
+    if (!_is_initialized) {
+        return MBED_ERROR_NOT_READY;
+    }
+    if (key == NULL || (buffer == NULL && buffer_size != 0)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    auto it = _records.find(key);
+    if (it == _records.end()) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    if (offset > it->second.size()) {
+        return MBED_ERROR_INVALID_SIZE;
+    }
+
+    size_t copy_size = it->second.size() - offset;
+    if (copy_size > buffer_size) {
+        copy_size = buffer_size;
+    }
+    if (copy_size) {
+        memcpy(buffer, it->second.data() + offset, copy_size);
+    }
+    if (actual_size) {
+        *actual_size = copy_size;
+    }
+    return MBED_SUCCESS;
+}
+
+int TDBStore::remove(const char *key)
+{
+    if (!_is_initialized) {
+        return MBED_ERROR_NOT_READY;
+    }
+    if (key == NULL) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+    if (_records.erase(key) == 0) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    return store();
+}
+
+int TDBStore::load()
+{
+    std::vector<uint8_t> image(_bd->size());
+    if (_bd->read(image.data(), 0, image.size()) != BD_ERROR_OK) {
+        return MBED_ERROR_READ_FAILED;
+    }
+
+    size_t pos = 0;
+    uint32_t magic, count;
+    if (!get_u32(image, pos, magic) || magic != TDBSTORE_STUB_MAGIC || !get_u32(image, pos, count)) {
+        /* Blank or foreign content: start empty */
+        return MBED_SUCCESS;
+    }
+
+    for (uint32_t i = 0; i < count; i ++) {
+        uint32_t key_len, data_len;
+        if (!get_u32(image, pos, key_len) || pos + key_len > image.size()) {
+            return MBED_ERROR_READ_FAILED;
+        }
+        std::string key(reinterpret_cast<const char *>(&image[pos]), key_len);
+        pos += key_len;
+        if (!get_u32(image, pos, data_len) || pos + data_len > image.size()) {
+            return MBED_ERROR_READ_FAILED;
+        }
+        _records[key] = std::vector<uint8_t>(image.begin() + pos, image.begin() + pos + data_len);
+        pos += data_len;
+    }
+    return MBED_SUCCESS;
+}
+
+int TDBStore::store()
+{
+    std::vector<uint8_t> image;
+    put_u32(image, TDBSTORE_STUB_MAGIC);
+    put_u32(image, (uint32_t) _records.size());
+    for (const auto &record : _records) {
+        put_u32(image, (uint32_t) record.first.size());
+        image.insert(image.end(), record.first.begin(), record.first.end());
+        put_u32(image, (uint32_t) record.second.size());
+        image.insert(image.end(), record.second.begin(), record.second.end());
+    }
+
+    bd_size_t program_size = _bd->get_program_size();
+    image.resize(((image.size() + program_size - 1) / program_size) * program_size, (uint8_t) _bd->get_erase_value());
+    if (image.size() > _bd->size()) {
+        return MBED_ERROR_MEDIA_FULL;
+    }
+
+    _write_count ++;
+    if (_bd->erase(0, _bd->size()) != BD_ERROR_OK ||
+            _bd->program(image.data(), 0, image.size()) != BD_ERROR_OK) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    return MBED_SUCCESS;
+}
+
+} // namespace mbed
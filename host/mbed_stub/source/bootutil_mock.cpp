@@ -0,0 +1,44 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "bootutil/bootutil.h"
+#include "mbed_stub.h"
+
+#include <atomic>
+
+static std::atomic<int> s_pending_image(-1);
+static std::atomic<int> s_pending_count(0);
+
+int boot_set_pending_multi(int image_index, int permanent)
+{
+    (void) permanent;
+    s_pending_image = image_index;
+    s_pending_count ++;
+    return 0;
+}
+
+int boot_set_pending(int permanent)
+{
+    return boot_set_pending_multi(0, permanent);
+}
+
+int boot_set_confirmed(void)
+{
+    return 0;
+}
+
+int mbed_stub_boot_pending_image(void)
+{
+    return s_pending_image;
+}
+
+int mbed_stub_boot_pending_count(void)
+{
+    return s_pending_count;
+}
+
+void mbed_stub_boot_reset(void)
+{
+    s_pending_image = -1;
+    s_pending_count = 0;
+}
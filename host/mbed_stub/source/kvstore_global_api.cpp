@@ -0,0 +1,170 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "kvstore_global_api/kvstore_global_api.h"
+#include "mbed_stub.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static std::mutex s_kv_mutex;
+static std::string s_kv_dir = "kvstore";
+static std::atomic<uint32_t> s_kv_set_count(0);
+static uint32_t s_kv_fail_sets = 0;
+static std::atomic<uint32_t> s_kv_get_count(0);
+static std::atomic<uint32_t> s_kv_get_latency_us(0);
+static std::atomic<uint32_t> s_kv_set_latency_us(0);
+
+void mbed_stub_kv_set_dir(const char *dir)
+{
+    std::lock_guard<std::mutex> lock(s_kv_mutex);
+    s_kv_dir = dir;
+}
+
+uint32_t mbed_stub_kv_set_count(void)
+{
+    return s_kv_set_count;
+}
+
+void mbed_stub_kv_fail_sets(uint32_t count)
+{
+    std::lock_guard<std::mutex> lock(s_kv_mutex);
+    s_kv_fail_sets = count;
+}
+
+uint32_t mbed_stub_kv_get_count(void)
+{
+    return s_kv_get_count;
+}
+
+void mbed_stub_kv_set_latency_us(uint32_t get_us, uint32_t set_us)
+{
+    s_kv_get_latency_us = get_us;
+    s_kv_set_latency_us = set_us;
+}
+
+/* Busy-wait rather than sleep: the scheduler's wake-up latency would swamp flash-like latency */
+static void kv_latency(uint32_t us)
+{
+    if (us == 0) {
+        return;
+    }
+    auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+}
+
+/* "/kv/name" to "<dir>/kv_name". Must be in lock. */
+static bool kv_file_path(const char *full_name_key, std::string &path)
+{
+    if (full_name_key == NULL || full_name_key[0] != '/') {
+        return false;
+    }
+
+    std::string key(full_name_key + 1);
+    if (key.empty()) {
+        return false;
+    }
+    for (char &c : key) {
+        if (c == '/') {
+            c = '_';
+        }
+    }
+
+    ::mkdir(s_kv_dir.c_str(), 0755);
+    path = s_kv_dir + "/" + key;
+    return true;
+}
+
+int kv_set(const char *full_name_key, const void *buffer, size_t size, uint32_t create_flags)
+{
+    (void) create_flags;
+    if (buffer == NULL && size != 0) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    std::lock_guard<std::mutex> lock(s_kv_mutex);
+    std::string path;
+    if (!kv_file_path(full_name_key, path)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    s_kv_set_count ++;
+    kv_latency(s_kv_set_latency_us);
+    if (s_kv_fail_sets) {
+        s_kv_fail_sets --;
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == NULL) {
+        return MBED_ERROR_WRITE_FAILED;
+    }
+    bool ok = (size == 0 || fwrite(buffer, 1, size, file) == size);
+    ok = (fclose(file) == 0) && ok;
+    return ok ? MBED_SUCCESS : MBED_ERROR_WRITE_FAILED;
+}
+
+int kv_get(const char *full_name_key, void *buffer, size_t buffer_size, size_t *actual_size)
+{
+    if (buffer == NULL && buffer_size != 0) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    std::lock_guard<std::mutex> lock(s_kv_mutex);
+    std::string path;
+    if (!kv_file_path(full_name_key, path)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    s_kv_get_count ++;
+    kv_latency(s_kv_get_latency_us);
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == NULL) {
+        return MBED_ERROR_ITEM_NOT_FOUND;
+    }
+    size_t n = buffer_size ? fread(buffer, 1, buffer_size, file) : 0;
+    bool ok = !ferror(file);
+    fclose(file);
+    if (!ok) {
+        return MBED_ERROR_READ_FAILED;
+    }
+    if (actual_size) {
+        *actual_size = n;
+    }
+    return MBED_SUCCESS;
+}
+
+int kv_remove(const char *full_name_key)
+{
+    std::lock_guard<std::mutex> lock(s_kv_mutex);
+    std::string path;
+    if (!kv_file_path(full_name_key, path)) {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+    return (::unlink(path.c_str()) == 0) ? MBED_SUCCESS : MBED_ERROR_ITEM_NOT_FOUND;
+}
+
+int kv_reset(const char *kvstore_path)
+{
+    (void) kvstore_path;
+    std::lock_guard<std::mutex> lock(s_kv_mutex);
+    DIR *dir = opendir(s_kv_dir.c_str());
+    if (dir == NULL) {
+        return MBED_SUCCESS;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] != '.') {
+            ::unlink((s_kv_dir + "/" + entry->d_name).c_str());
+        }
+    }
+    closedir(dir);
+    return MBED_SUCCESS;
+}
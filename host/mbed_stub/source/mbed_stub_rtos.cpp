@@ -0,0 +1,279 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "mbed.h"
+#include "mbed_stub.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using namespace std::chrono;
+
+/* Virtual clock, see mbed_stub.h */
+static std::atomic<bool> s_clock_virtual(false);
+static std::atomic<uint64_t> s_clock_virtual_ms(0);
+static std::atomic<uint64_t> s_clock_slept_ms(0);
+
+static uint64_t real_ms(void)
+{
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+void mbed_stub_clock_set_virtual(bool enable)
+{
+    if (enable && !s_clock_virtual) {
+        s_clock_virtual_ms = real_ms();
+    }
+    s_clock_virtual = enable;
+}
+
+void mbed_stub_clock_advance_ms(uint64_t ms)
+{
+    s_clock_virtual_ms += ms;
+}
+
+uint64_t mbed_stub_clock_slept_ms(void)
+{
+    return s_clock_slept_ms;
+}
+
+/* Thread identity: address of a per-thread object, so that it stays unique for thread lifetime */
+static thread_local char s_thread_tag;
+static thread_local const char *s_thread_name = "main";
+
+osThreadId_t osThreadGetId(void)
+{
+    return &s_thread_tag;
+}
+
+static std::recursive_mutex s_critical_mutex;
+
+void core_util_critical_section_enter(void)
+{
+    s_critical_mutex.lock();
+}
+
+void core_util_critical_section_exit(void)
+{
+    s_critical_mutex.unlock();
+}
+
+namespace rtos {
+
+namespace Kernel {
+
+Clock::time_point Clock::now()
+{
+    return time_point(duration(s_clock_virtual ? s_clock_virtual_ms.load() : real_ms()));
+}
+
+uint64_t get_ms_count()
+{
+    return Clock::now().time_since_epoch().count();
+}
+
+} // namespace Kernel
+
+namespace ThisThread {
+
+void sleep_for(uint32_t millisec)
+{
+    sleep_for(Kernel::Clock::duration_u32(millisec));
+}
+
+void sleep_for(Kernel::Clock::duration_u32 rel_time)
+{
+    s_clock_slept_ms += rel_time.count();
+    if (s_clock_virtual) {
+        s_clock_virtual_ms += rel_time.count();
+        std::this_thread::yield();
+    } else {
+        std::this_thread::sleep_for(rel_time);
+    }
+}
+
+void sleep_until(Kernel::Clock::time_point abs_time)
+{
+    Kernel::Clock::time_point now = Kernel::Clock::now();
+    if (abs_time > now) {
+        sleep_for(Kernel::Clock::duration_u32((abs_time - now).count()));
+    }
+}
+
+void yield()
+{
+    std::this_thread::yield();
+}
+
+osThreadId_t get_id()
+{
+    return osThreadGetId();
+}
+
+const char *get_name()
+{
+    return s_thread_name;
+}
+
+} // namespace ThisThread
+
+Thread::Thread(osPriority priority, uint32_t stack_size, unsigned char *stack_mem, const char *name) :
+    _priority(priority),
+    _stack_size(stack_size),
+    _name(name),
+    _id(nullptr),
+    _finished(false)
+{
+    (void) stack_mem;
+}
+
+Thread::~Thread()
+{
+    join();
+}
+
+osStatus Thread::start(mbed::Callback<void()> task)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    if (_thread.joinable() || _finished) {
+        return osErrorParameter;
+    }
+
+    _task = task;
+    _thread = std::thread(&Thread::run, this);
+    /* Like RTX, thread ID is valid on return */
+    _cond.wait(lock, [this] {
+        return _id != nullptr;
+    });
+    return osOK;
+}
+
+void Thread::run()
+{
+    s_thread_name = _name ? _name : "thread";
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _id = osThreadGetId();
+    }
+    _cond.notify_all();
+
+    if (_task) {
+        _task();
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    _finished = true;
+}
+
+osStatus Thread::join()
+{
+    if (_thread.joinable()) {
+        if (_thread.get_id() == std::this_thread::get_id()) {
+            return osErrorResource;
+        }
+        _thread.join();
+    }
+    return osOK;
+}
+
+osStatus Thread::terminate()
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_finished) {
+            return osErrorResource;
+        }
+    }
+    return join();
+}
+
+osThreadId_t Thread::get_id() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _finished ? nullptr : _id;
+}
+
+const char *Thread::get_name() const
+{
+    return _name;
+}
+
+osPriority Thread::get_priority() const
+{
+    return _priority;
+}
+
+uint32_t Thread::stack_size() const
+{
+    return _stack_size;
+}
+
+uint32_t EventFlags::set(uint32_t flags)
+{
+    uint32_t result;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _flags |= flags;
+        result = _flags;
+    }
+    _cond.notify_all();
+    return result;
+}
+
+uint32_t EventFlags::clear(uint32_t flags)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t result = _flags;
+    _flags &= ~flags;
+    return result;
+}
+
+uint32_t EventFlags::get() const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _flags;
+}
+
+uint32_t EventFlags::wait_all(uint32_t flags, uint32_t millisec, bool clear)
+{
+    return wait(flags, true, millisec, clear);
+}
+
+uint32_t EventFlags::wait_any(uint32_t flags, uint32_t millisec, bool clear)
+{
+    return wait(flags, false, millisec, clear);
+}
+
+uint32_t EventFlags::wait_all_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time, bool clear)
+{
+    return wait(flags, true, rel_time.count(), clear);
+}
+
+uint32_t EventFlags::wait_any_for(uint32_t flags, Kernel::Clock::duration_u32 rel_time, bool clear)
+{
+    return wait(flags, false, rel_time.count(), clear);
+}
+
+uint32_t EventFlags::wait(uint32_t flags, bool all, uint32_t millisec, bool clear)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    auto satisfied = [this, flags, all] {
+        return all ? ((_flags & flags) == flags) : ((_flags & flags) != 0);
+    };
+
+    if (millisec == osWaitForever) {
+        _cond.wait(lock, satisfied);
+    } else if (!_cond.wait_for(lock, milliseconds(millisec), satisfied)) {
+        return osFlagsErrorTimeout;
+    }
+
+    uint32_t result = _flags;
+    if (clear) {
+        _flags &= ~flags;
+    }
+    return result;
+}
+
+} // namespace rtos
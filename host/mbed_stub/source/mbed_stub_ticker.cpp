@@ -0,0 +1,35 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "hal/us_ticker_api.h"
+
+#include <chrono>
+
+using namespace std::chrono;
+
+struct ticker_data_s {
+    steady_clock::time_point start;
+};
+
+static const ticker_info_t s_us_ticker_info = { 1000000, 32 };
+static const ticker_data_t s_us_ticker_data = { steady_clock::now() };
+
+const ticker_data_t *get_us_ticker_data(void)
+{
+    return &s_us_ticker_data;
+}
+
+uint64_t ticker_read_us(const ticker_data_t *const ticker)
+{
+    return duration_cast<microseconds>(steady_clock::now() - ticker->start).count();
+}
+
+uint32_t us_ticker_read(void)
+{
+    return (uint32_t) ticker_read_us(&s_us_ticker_data);
+}
+
+const ticker_info_t *us_ticker_get_info(void)
+{
+    return &s_us_ticker_info;
+}
@@ -0,0 +1,255 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "netsocket/NetworkInterface.h"
+#include "netsocket/SocketAddress.h"
+#include "netsocket/TCPSocket.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+SocketAddress::SocketAddress() :
+    _valid(false),
+    _in_addr(0),
+    _port(0)
+{
+    _ip_string[0] = '\0';
+}
+
+SocketAddress::SocketAddress(const char *addr, uint16_t port) :
+    SocketAddress()
+{
+    set_ip_address(addr);
+    set_port(port);
+}
+
+bool SocketAddress::set_ip_address(const char *addr)
+{
+    struct in_addr in;
+    _valid = (addr != NULL && inet_pton(AF_INET, addr, &in) == 1);
+    _in_addr = _valid ? in.s_addr : 0;
+    if (_valid) {
+        inet_ntop(AF_INET, &in, _ip_string, sizeof(_ip_string));
+    } else {
+        _ip_string[0] = '\0';
+    }
+    return _valid;
+}
+
+const char *SocketAddress::get_ip_address() const
+{
+    return _valid ? _ip_string : NULL;
+}
+
+void SocketAddress::set_port(uint16_t port)
+{
+    _port = port;
+}
+
+uint16_t SocketAddress::get_port() const
+{
+    return _port;
+}
+
+nsapi_version_t SocketAddress::get_ip_version() const
+{
+    return _valid ? NSAPI_IPv4 : NSAPI_UNSPEC;
+}
+
+SocketAddress::operator bool() const
+{
+    return _valid;
+}
+
+nsapi_error_t NetworkInterface::gethostbyname(const char *host, SocketAddress *address,
+                                              nsapi_version_t version, const char *interface_name)
+{
+    (void) interface_name;
+    if (host == NULL || address == NULL || version == NSAPI_IPv6) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo *result = NULL;
+    if (getaddrinfo(host, NULL, &hints, &result) != 0 || result == NULL) {
+        return NSAPI_ERROR_DNS_FAILURE;
+    }
+
+    char ip[INET_ADDRSTRLEN];
+    const struct sockaddr_in *sin = reinterpret_cast<const struct sockaddr_in *>(result->ai_addr);
+    inet_ntop(AF_INET, &sin->sin_addr, ip, sizeof(ip));
+    freeaddrinfo(result);
+
+    return address->set_ip_address(ip) ? NSAPI_ERROR_OK : NSAPI_ERROR_DNS_FAILURE;
+}
+
+NetworkInterface *NetworkInterface::get_default_instance()
+{
+    static NetworkInterface s_host_network;
+    return &s_host_network;
+}
+
+static nsapi_error_t errno_to_nsapi(int err)
+{
+    switch (err) {
+        case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+        case EWOULDBLOCK:
+#endif
+            return NSAPI_ERROR_WOULD_BLOCK;
+        case EINPROGRESS:
+            return NSAPI_ERROR_IN_PROGRESS;
+        case ECONNREFUSED:
+        case ENETUNREACH:
+        case EHOSTUNREACH:
+            return NSAPI_ERROR_NO_CONNECTION;
+        case ECONNRESET:
+        case EPIPE:
+            return NSAPI_ERROR_CONNECTION_LOST;
+        case ETIMEDOUT:
+            return NSAPI_ERROR_CONNECTION_TIMEOUT;
+        case EBADF:
+        case ENOTSOCK:
+            return NSAPI_ERROR_NO_SOCKET;
+        default:
+            return NSAPI_ERROR_DEVICE_ERROR;
+    }
+}
+
+TCPSocket::TCPSocket() :
+    _fd(-1),
+    _closed(true),
+    _blocking(true),
+    _timeout_ms(-1)
+{
+}
+
+TCPSocket::~TCPSocket()
+{
+    close();
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+nsapi_error_t TCPSocket::open(NetworkInterface *network)
+{
+    (void) network;
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+
+    _fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd < 0) {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    int one = 1;
+    ::setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    _closed = false;
+    apply_timeout();
+    return NSAPI_ERROR_OK;
+}
+
+/* Shut down only, and release the descriptor on destruction, so that a send/recv blocked in
+ * another thread wakes up without the descriptor number getting reused under it. */
+nsapi_error_t TCPSocket::close()
+{
+    if (_fd < 0 || _closed.exchange(true)) {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    ::shutdown(_fd, SHUT_RDWR);
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_error_t TCPSocket::connect(const SocketAddress &address)
+{
+    if (_fd < 0 || _closed) {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    if (!address) {
+        return NSAPI_ERROR_PARAMETER;
+    }
+
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(address.get_port());
+    sin.sin_addr.s_addr = address.get_in_addr();
+
+    if (::connect(_fd, reinterpret_cast<struct sockaddr *>(&sin), sizeof(sin)) != 0) {
+        return errno_to_nsapi(errno);
+    }
+    return NSAPI_ERROR_OK;
+}
+
+nsapi_size_or_error_t TCPSocket::send(const void *data, nsapi_size_t size)
+{
+    if (_fd < 0 || _closed) {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+
+    ssize_t n = ::send(_fd, data, size, MSG_NOSIGNAL);
+    if (n < 0) {
+        return _closed ? NSAPI_ERROR_NO_SOCKET : errno_to_nsapi(errno);
+    }
+    return (nsapi_size_or_error_t) n;
+}
+
+nsapi_size_or_error_t TCPSocket::recv(void *data, nsapi_size_t size)
+{
+    if (_fd < 0 || _closed) {
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+
+    ssize_t n = ::recv(_fd, data, size, 0);
+    if (n < 0) {
+        return _closed ? NSAPI_ERROR_NO_SOCKET : errno_to_nsapi(errno);
+    }
+    if (n == 0 && _closed) {
+        /* Woken up by close() from another thread, not by peer */
+        return NSAPI_ERROR_NO_SOCKET;
+    }
+    return (nsapi_size_or_error_t) n;
+}
+
+void TCPSocket::set_blocking(bool blocking)
+{
+    _blocking = blocking;
+    _timeout_ms = blocking ? -1 : 0;
+    apply_timeout();
+}
+
+void TCPSocket::set_timeout(int timeout)
+{
+    _blocking = (timeout != 0);
+    _timeout_ms = timeout;
+    apply_timeout();
+}
+
+void TCPSocket::apply_timeout()
+{
+    if (_fd < 0) {
+        return;
+    }
+
+    int flags = ::fcntl(_fd, F_GETFL, 0);
+    ::fcntl(_fd, F_SETFL, _blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+
+    struct timeval tv;
+    tv.tv_sec = (_timeout_ms > 0) ? (_timeout_ms / 1000) : 0;
+    tv.tv_usec = (_timeout_ms > 0) ? ((_timeout_ms % 1000) * 1000) : 0;
+    ::setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    ::setsockopt(_fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Minimal assertions for host unit tests: each test is a plain executable run by ctest, failing by exit code */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int host_test_failures;
+
+#define HOST_CHECK(cond)                                                        \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            host_test_failures ++;                                              \
+        }                                                                       \
+    } while (0)
+
+#define HOST_CHECK_EQ(actual, expected)                                         \
+    do {                                                                        \
+        long long host_test_a = (long long) (actual);                           \
+        long long host_test_e = (long long) (expected);                         \
+        if (host_test_a != host_test_e) {                                       \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, \
+                    #actual, host_test_a, host_test_e);                         \
+            host_test_failures ++;                                              \
+        }                                                                       \
+    } while (0)
+
+#define HOST_TEST_RESULT()                                                      \
+    (host_test_failures ? (fprintf(stderr, "%d check(s) failed\n", host_test_failures), 1) : 0)
+
+#endif  /* HOST_TEST_H */
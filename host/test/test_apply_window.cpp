@@ -0,0 +1,77 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Deferred apply window: seconds until the daily window opens, including a window wrapping past
+ * midnight and RTC not set, and Wait() returning on trigger and on cancel
+ *
+ * Built with its own configuration, see host/CMakeLists.txt:
+ * apply-window-start 22:00 UTC, apply-window-length 4 h
+ */
+
+#include "mbed_apply_window.h"
+#include "mbed_workflow_cancellation.h"
+
+#include "host_test.h"
+
+/* Midnight UTC, 2023-11-15 */
+static const time_t MIDNIGHT = 1700006400;
+static const time_t HOUR = 60 * 60;
+
+/* Workflow cancellation stand-in: one flag for every handle, no subscriber ever called */
+static bool s_cancel_requested;
+
+bool ADUC_WorkflowCancellation_IsRequested(ADUC_WorkflowHandle handle)
+{
+    (void) handle;
+    return s_cancel_requested;
+}
+
+bool ADUC_WorkflowCancellation_Subscribe(ADUC_WorkflowHandle handle, ADUC_WorkflowCancellationCallback callback, void* context)
+{
+    (void) handle;
+    (void) callback;
+    (void) context;
+    return true;
+}
+
+void ADUC_WorkflowCancellation_Unsubscribe(ADUC_WorkflowCancellationCallback callback, void* context)
+{
+    (void) callback;
+    (void) context;
+}
+
+int main()
+{
+    /* RTC not set: window ignored */
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(0), 0);
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(12 * HOUR), 0);
+
+    /* Inside window, before and after midnight */
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT - 2 * HOUR), 0);
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT - 1), 0);
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT), 0);
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT + 2 * HOUR - 1), 0);
+
+    /* Outside window: until 22:00 */
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT + 2 * HOUR), 20 * HOUR);
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT + 12 * HOUR), 10 * HOUR);
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT + 22 * HOUR - 1), 1);
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT + 22 * HOUR), 0);
+
+    /* Same on any later day */
+    HOST_CHECK_EQ(ADUC_ApplyWindow_SecondsUntilOpen(MIDNIGHT + 100 * 24 * HOUR + 12 * HOUR), 10 * HOUR);
+
+    int workflow = 0;
+    ADUC_WorkflowHandle handle = &workflow;
+
+    /* Trigger latched before the wait opens the window right away */
+    ADUC_ApplyWindow_Trigger();
+    HOST_CHECK(ADUC_ApplyWindow_Wait(handle));
+
+    /* Cancel wins over trigger */
+    ADUC_ApplyWindow_Trigger();
+    s_cancel_requested = true;
+    HOST_CHECK(!ADUC_ApplyWindow_Wait(handle));
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* DownloadStallMonitor on virtual clock: adaptive socket timeout from first-byte latency and
+ * smoothed chunk interval, clamped to bounds */
+
+#include "download_stall_monitor.h"
+#include "mbed_stub.h"
+
+#include "host_test.h"
+
+static const uint32_t TIMEOUT_MIN_MS = 5000;
+static const uint32_t TIMEOUT_MAX_MS = 60000;
+static const uint32_t TIMEOUT_FACTOR = 4;
+
+/* Receive one chunk @p interval_ms after the previous one */
+static void chunk_after(DownloadStallMonitor &monitor, uint64_t interval_ms, uint32_t length)
+{
+    mbed_stub_clock_advance_ms(interval_ms);
+    monitor.on_chunk(length);
+}
+
+int main()
+{
+    mbed_stub_clock_set_virtual(true);
+
+    /* Nothing measured yet: upper bound */
+    {
+        DownloadStallMonitor monitor(TIMEOUT_MIN_MS, TIMEOUT_MAX_MS, TIMEOUT_FACTOR);
+        HOST_CHECK_EQ(monitor.timeout_ms(), TIMEOUT_MAX_MS);
+        HOST_CHECK_EQ(monitor.rate(), 0);
+    }
+
+    /* Fast link: 4 x 200 ms first-byte latency is below lower bound */
+    {
+        DownloadStallMonitor monitor(TIMEOUT_MIN_MS, TIMEOUT_MAX_MS, TIMEOUT_FACTOR);
+        monitor.on_attempt_start();
+        chunk_after(monitor, 200, 1000);
+        HOST_CHECK_EQ(monitor.timeout_ms(), TIMEOUT_MIN_MS);
+    }
+
+    /* Slow link: first-byte latency, then smoothed chunk interval once it gets worse */
+    {
+        DownloadStallMonitor monitor(TIMEOUT_MIN_MS, TIMEOUT_MAX_MS, TIMEOUT_FACTOR);
+        monitor.on_attempt_start();
+        chunk_after(monitor, 3000, 4000);
+        HOST_CHECK_EQ(monitor.timeout_ms(), 4 * 3000);
+
+        /* Chunk interval (0 * 3 + 8000) / 4 = 2000 is still below first-byte latency */
+        chunk_after(monitor, 8000, 4000);
+        HOST_CHECK_EQ(monitor.timeout_ms(), 4 * 3000);
+        HOST_CHECK_EQ(monitor.rate(), 500);
+
+        /* Chunk interval (2000 * 3 + 8000) / 4 = 3500 takes over */
+        chunk_after(monitor, 8000, 4000);
+        HOST_CHECK_EQ(monitor.timeout_ms(), 4 * 3500);
+        HOST_CHECK_EQ(monitor.rate(), 500);
+
+        /* Long gap clamps to upper bound */
+        chunk_after(monitor, 100000, 4000);
+        HOST_CHECK_EQ(monitor.timeout_ms(), TIMEOUT_MAX_MS);
+
+        /* Reconnect measures first-byte latency afresh but keeps smoothed chunk interval */
+        monitor.on_attempt_start();
+        chunk_after(monitor, 100, 4000);
+        HOST_CHECK_EQ(monitor.timeout_ms(), TIMEOUT_MAX_MS);
+    }
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,122 @@
+# Copyright (c) 2022 Nuvoton Technology Corporation
+# SPDX-License-Identifier: Apache-2.0
+
+# Feature toggles of tools/cmake/azure_client_features.cmake: sources each profile selects,
+# and lookup of the size tool for the size report. Run in script mode:
+#
+#   cmake -DAZURE_CLIENT_ROOT=<repository root> -P test_feature_profiles.cmake
+
+cmake_minimum_required(VERSION 3.19)
+
+include(${AZURE_CLIENT_ROOT}/tools/cmake/azure_client_features.cmake)
+
+set(s_failures 0)
+
+macro(check_has SOURCES FILE)
+    set(_all ${${SOURCES}})
+    list(FILTER _all INCLUDE REGEX "/${FILE}$")
+    if(NOT _all)
+        message(SEND_ERROR "${SOURCES}: ${FILE} missing")
+        math(EXPR s_failures "${s_failures} + 1")
+    endif()
+endmacro()
+
+macro(check_lacks SOURCES FILE)
+    set(_all ${${SOURCES}})
+    list(FILTER _all INCLUDE REGEX "/${FILE}$")
+    if(_all)
+        message(SEND_ERROR "${SOURCES}: ${FILE} not left out")
+        math(EXPR s_failures "${s_failures} + 1")
+    endif()
+endmacro()
+
+macro(check_equal ACTUAL EXPECTED)
+    if(NOT "${ACTUAL}" STREQUAL "${EXPECTED}")
+        message(SEND_ERROR "'${ACTUAL}' is not '${EXPECTED}'")
+        math(EXPR s_failures "${s_failures} + 1")
+    endif()
+endmacro()
+
+# Default: everything but test mocks, fast codecs
+set(MBED_CONFIG_DEFINITIONS MBED_CONF_AZURE_CLIENT_FEATURE_TEST_MOCKS=0)
+azure_client_feature_sources(default ${AZURE_CLIENT_ROOT})
+check_has(default copied/c-utility/urlencode.c)
+check_has(default copied/c-utility/utf8_checker.c)
+check_has(default wsio.c)
+check_has(default http_proxy_io.c)
+check_has(default prov_device_ll_client.c)
+check_has(default prov_transport_mqtt_ws_client.c)
+check_has(default iothub_client_core.c)
+check_has(default iothub_module_client.c)
+check_lacks(default umock_c.c)
+check_lacks(default dependencies/c-utility/src/urlencode.c)
+
+# Unset configuration: nothing left out
+set(MBED_CONFIG_DEFINITIONS "")
+azure_client_feature_sources(all ${AZURE_CLIENT_ROOT})
+check_has(all umock_c.c)
+
+# MQTT only: DPS stays, without its WebSockets transport
+set(MBED_CONFIG_DEFINITIONS
+    MBED_CONF_AZURE_CLIENT_FEATURE_WEBSOCKETS=0
+    MBED_CONF_AZURE_CLIENT_FEATURE_HTTP_PROXY=0
+    MBED_CONF_AZURE_CLIENT_FEATURE_TEST_MOCKS=0
+)
+azure_client_feature_sources(mqtt_only ${AZURE_CLIENT_ROOT})
+check_lacks(mqtt_only wsio.c)
+check_lacks(mqtt_only uws_client.c)
+check_lacks(mqtt_only utf8_checker.c)
+check_lacks(mqtt_only http_proxy_io.c)
+check_lacks(mqtt_only prov_transport_mqtt_ws_client.c)
+check_has(mqtt_only prov_transport_mqtt_client.c)
+check_has(mqtt_only copied/c-utility/urlencode.c)
+
+# LL only, without DPS and module client, unmodified codecs
+set(MBED_CONFIG_DEFINITIONS
+    MBED_CONF_AZURE_CLIENT_FEATURE_CONVENIENCE_LAYER=0
+    MBED_CONF_AZURE_CLIENT_FEATURE_DPS=0
+    MBED_CONF_AZURE_CLIENT_FEATURE_MODULE_CLIENT=0
+    MBED_CONF_AZURE_CLIENT_FEATURE_TEST_MOCKS=0
+    MBED_CONF_AZURE_CLIENT_FEATURE_FAST_CODECS=0
+)
+azure_client_feature_sources(ll_only ${AZURE_CLIENT_ROOT})
+check_lacks(ll_only iothub_client.c)
+check_lacks(ll_only iothubtransport.c)
+check_lacks(ll_only iothub_module_client_ll.c)
+check_lacks(ll_only prov_device_client.c)
+check_has(ll_only dependencies/c-utility/src/urlencode.c)
+check_has(ll_only dependencies/c-utility/src/utf8_checker.c)
+check_lacks(ll_only copied/c-utility/urlencode.c)
+
+# Size tool: next to a prefixed compiler, CMAKE_SIZE over that, else a host tool
+set(toolchain_dir ${CMAKE_CURRENT_BINARY_DIR}/test_feature_profiles_toolchain)
+file(REMOVE_RECURSE ${toolchain_dir})
+foreach(tool arm-none-eabi-gcc arm-none-eabi-size my-size)
+    file(WRITE ${toolchain_dir}/${tool} "#!/bin/sh\n")
+    file(CHMOD ${toolchain_dir}/${tool} PERMISSIONS OWNER_READ OWNER_WRITE OWNER_EXECUTE)
+endforeach()
+
+set(CMAKE_C_COMPILER ${toolchain_dir}/arm-none-eabi-gcc)
+azure_client_find_size_tool(size_from_prefix)
+check_equal("${size_from_prefix}" "${toolchain_dir}/arm-none-eabi-size")
+
+set(CMAKE_SIZE ${toolchain_dir}/my-size)
+azure_client_find_size_tool(size_from_toolchain)
+check_equal("${size_from_toolchain}" "${toolchain_dir}/my-size")
+unset(CMAKE_SIZE)
+
+set(CMAKE_C_COMPILER /usr/bin/cc)
+azure_client_find_size_tool(size_fallback)
+if(size_fallback)
+    get_filename_component(size_fallback_name "${size_fallback}" NAME)
+    if(NOT size_fallback_name MATCHES "^(llvm-)?size$")
+        message(SEND_ERROR "Fallback size tool '${size_fallback}'")
+        math(EXPR s_failures "${s_failures} + 1")
+    endif()
+endif()
+
+file(REMOVE_RECURSE ${toolchain_dir})
+
+if(s_failures GREATER 0)
+    message(FATAL_ERROR "${s_failures} check(s) failed")
+endif()
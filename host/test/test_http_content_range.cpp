@@ -0,0 +1,55 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Content-Range parsing of 206 Partial Content, which a resumed download checks against its offset */
+
+#include "http_content_range.h"
+
+#include "host_test.h"
+
+static bool parses(const char *value, uint64_t first_exp, uint64_t last_exp)
+{
+    uint64_t first = 0;
+    uint64_t last = 0;
+    return http_content_range_parse(value, &first, &last) && first == first_exp && last == last_exp;
+}
+
+static bool rejects(const char *value)
+{
+    uint64_t first = 0;
+    uint64_t last = 0;
+    return !http_content_range_parse(value, &first, &last);
+}
+
+int main()
+{
+    /* Well-formed */
+    HOST_CHECK(parses("bytes 4096-1048575/1048576", 4096, 1048575));
+    HOST_CHECK(parses("bytes 0-0/1", 0, 0));
+    HOST_CHECK(parses("bytes 100-199/*", 100, 199));
+    HOST_CHECK(parses("  BYTES 100-199/200  ", 100, 199));
+    HOST_CHECK(parses("bytes 4294967296-4294967299/4294967300", 4294967296ULL, 4294967299ULL));
+
+    /* Unsatisfied or other unit */
+    HOST_CHECK(rejects("bytes */1048576"));
+    HOST_CHECK(rejects("items 0-9/10"));
+    HOST_CHECK(rejects("bytes=0-9/10"));
+
+    /* Malformed */
+    HOST_CHECK(rejects(""));
+    HOST_CHECK(rejects("bytes"));
+    HOST_CHECK(rejects("bytes 100"));
+    HOST_CHECK(rejects("bytes 100-"));
+    HOST_CHECK(rejects("bytes 100-199"));
+    HOST_CHECK(rejects("bytes -199/200"));
+    HOST_CHECK(rejects("bytes 100-199/"));
+    HOST_CHECK(rejects("bytes 100-199/200x"));
+    HOST_CHECK(rejects("bytes 0x10-199/200"));
+    HOST_CHECK(rejects("bytes 99999999999999999999-1/2"));
+
+    /* Inconsistent */
+    HOST_CHECK(rejects("bytes 200-100/300"));
+    HOST_CHECK(rejects("bytes 100-200/200"));
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Token-bucket link scheduler on virtual clock: control never waits, bulk waits for reserve and cap,
+ * refill is capped at bucket depth
+ *
+ * Built with its own configuration, see host/CMakeLists.txt:
+ * link-rate 10000 B/s, bulk-rate 5000 B/s, burst 4096 B, control-reserve 1024 B
+ */
+
+#include "link_scheduler.h"
+#include "mbed_stub.h"
+
+#include "host_test.h"
+
+/* Milliseconds slept by one call to link_scheduler_consume() */
+static uint64_t consume_slept_ms(LINK_SCHEDULER_CLASS cls, size_t bytes)
+{
+    uint64_t slept_ms = mbed_stub_clock_slept_ms();
+    link_scheduler_consume(cls, bytes);
+    return mbed_stub_clock_slept_ms() - slept_ms;
+}
+
+int main()
+{
+    mbed_stub_clock_set_virtual(true);
+
+    HOST_CHECK(link_scheduler_is_enabled());
+
+    /* Control class goes into debt of link tokens without waiting: 4096 - 10000 = -5904 */
+    HOST_CHECK_EQ(consume_slept_ms(LINK_SCHEDULER_CLASS_CONTROL, 10000), 0);
+
+    /* Bulk class waits until link tokens recover above control reserve:
+     * (1024 - (-5905)) bytes at 10000 B/s = 693 ms, slept in steps of at most 100 ms */
+    uint64_t slept_ms = consume_slept_ms(LINK_SCHEDULER_CLASS_BULK, 1);
+    HOST_CHECK(slept_ms >= 693 && slept_ms <= 700);
+
+    /* Bulk class beyond its bucket waits for its own cap: 5000 bytes over burst at 5000 B/s = 1000 ms.
+     * Link tokens recover in ~910 ms, so bulk cap dominates. */
+    slept_ms = consume_slept_ms(LINK_SCHEDULER_CLASS_BULK, 4096 + 5000);
+    HOST_CHECK(slept_ms >= 1000 && slept_ms <= 1010);
+
+    /* Idle time refills up to bucket depth only: one burst drains it below control reserve again,
+     * (1024 - 0) bytes at 10000 B/s = 102 ms */
+    mbed_stub_clock_advance_ms(60 * 1000);
+    slept_ms = consume_slept_ms(LINK_SCHEDULER_CLASS_BULK, 4096);
+    HOST_CHECK(slept_ms >= 102 && slept_ms <= 110);
+
+    /* Zero bytes never waits */
+    HOST_CHECK_EQ(consume_slept_ms(LINK_SCHEDULER_CLASS_BULK, 0), 0);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,308 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* mbed-http heap use: allocations per request, streamed body not allocating per chunk, caller
+ * placed URL and receive buffers; and the buffered HttpResponse body: one allocation for known
+ * length, geometric growth for unknown length, HTTP_RESPONSE_MAX_BODY_SIZE at and past the cap
+ * on every path that can reach it
+ *
+ * Responses come from a socket that plays back a script on the calling thread, so that
+ * allocations counted process-wide are those of mbed-http alone.
+ */
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "mbed.h"
+#include "heap_stats.h"
+#include "http_request.h"
+
+#include "host_test.h"
+
+/* TCPSocket playing back @p response, @p chunk_size bytes per recv() at most */
+class ScriptedSocket : public TCPSocket {
+public:
+    ScriptedSocket(const std::string &response, size_t chunk_size) :
+        _response(response), _chunk_size(chunk_size), _offset(0)
+    {
+    }
+
+    nsapi_error_t connect(const SocketAddress &address) override
+    {
+        (void) address;
+        return NSAPI_ERROR_OK;
+    }
+
+    nsapi_size_or_error_t send(const void *data, nsapi_size_t size) override
+    {
+        (void) data;
+        return size;
+    }
+
+    nsapi_size_or_error_t recv(void *data, nsapi_size_t size) override
+    {
+        size_t todo = _response.size() - _offset;
+        if (todo > size) {
+            todo = size;
+        }
+        if (todo > _chunk_size) {
+            todo = _chunk_size;
+        }
+        memcpy(data, _response.data() + _offset, todo);
+        _offset += todo;
+        return todo;
+    }
+
+    nsapi_error_t close() override
+    {
+        return NSAPI_ERROR_OK;
+    }
+
+private:
+    std::string _response;
+    size_t _chunk_size;
+    size_t _offset;
+};
+
+static uint64_t alloc_count(void)
+{
+    heap_stats_t stats;
+    heap_stats_get(&stats);
+    return stats.alloc_count;
+}
+
+static std::string content_length_response(size_t body_size)
+{
+    return "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(body_size) +
+           "\r\nContent-Type: application/octet-stream\r\n\r\n" + std::string(body_size, 'b');
+}
+
+static std::string chunked_response(size_t body_size, size_t chunk_size)
+{
+    std::string response = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+    char header[16];
+    for (size_t offset = 0; offset < body_size; offset += chunk_size) {
+        size_t length = (body_size - offset < chunk_size) ? body_size - offset : chunk_size;
+        snprintf(header, sizeof(header), "%zx\r\n", length);
+        response += header + std::string(length, 'b') + "\r\n";
+    }
+    return response + "0\r\n\r\n";
+}
+
+static std::string until_close_response(size_t body_size)
+{
+    return "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n" + std::string(body_size, 'b');
+}
+
+static const char *s_url = "http://contoso.blob.core.windows.net/updates/image.bin?sv=2020&sig=abc";
+
+/* Allocations made by one GET of @p response, body streamed to a callback */
+static uint64_t streamed_request_allocations(const std::string &response, uint8_t *recv_buffer, size_t recv_buffer_size,
+                                             size_t *received)
+{
+    ScriptedSocket socket(response, 1460);
+    *received = 0;
+
+    uint64_t count = alloc_count();
+    {
+        HttpRequest request(&socket, HTTP_GET, s_url, [received](const char *at, uint32_t length) {
+            (void) at;
+            *received += length;
+        });
+        if (recv_buffer != NULL) {
+            request.set_receive_buffer(recv_buffer, recv_buffer_size);
+        }
+        HttpResponse *res = request.send();
+        HOST_CHECK(res != NULL && res->get_status_code() == 200);
+    }
+    return alloc_count() - count;
+}
+
+static void test_request_allocations(void)
+{
+    /* URL fields in caller storage: nothing on heap, else one buffer for all of them */
+    std::vector<char> storage(ParsedUrl::storage_size(strlen(s_url)));
+    uint64_t count = alloc_count();
+    {
+        ParsedUrl url(s_url, storage.data(), storage.size());
+        HOST_CHECK(url.valid());
+        HOST_CHECK(strcmp(url.host(), "contoso.blob.core.windows.net") == 0);
+        HOST_CHECK(strcmp(url.query(), "sv=2020&sig=abc") == 0);
+    }
+    HOST_CHECK_EQ(alloc_count() - count, 0);
+
+    count = alloc_count();
+    {
+        ParsedUrl url(s_url);
+        HOST_CHECK(url.valid());
+    }
+    HOST_CHECK_EQ(alloc_count() - count, 1);
+
+    /* Parser and its settings table: nothing on heap */
+    HttpResponse response;
+    count = alloc_count();
+    {
+        HttpParser parser(&response, HTTP_RESPONSE);
+    }
+    HOST_CHECK_EQ(alloc_count() - count, 0);
+
+    /* Whole request: same count whatever the body size, one less with caller receive buffer */
+    size_t received = 0;
+    uint64_t small = streamed_request_allocations(content_length_response(1024), NULL, 0, &received);
+    HOST_CHECK_EQ(received, 1024);
+    uint64_t large = streamed_request_allocations(content_length_response(512 * 1024), NULL, 0, &received);
+    HOST_CHECK_EQ(received, 512 * 1024);
+    HOST_CHECK_EQ(large, small);
+
+    uint8_t recv_buffer[HTTP_RECEIVE_BUFFER_SIZE];
+    uint64_t placed = streamed_request_allocations(content_length_response(512 * 1024), recv_buffer,
+                                                   sizeof(recv_buffer), &received);
+    HOST_CHECK_EQ(received, 512 * 1024);
+    HOST_CHECK_EQ(placed, small - 1);
+
+    printf("Allocations per request: %llu, with caller receive buffer: %llu\n",
+           (unsigned long long) small, (unsigned long long) placed);
+}
+
+/* Allocations made for the buffered body of @p response, fed @p feed_size bytes at a time.
+ * Returns whether all of it was parsed.
+ */
+static bool buffer_body(const std::string &response, size_t feed_size, HttpResponse *res, uint64_t *body_allocations)
+{
+    HttpParser parser(res, HTTP_RESPONSE);
+    size_t header_size = response.find("\r\n\r\n") + 4;
+
+    /* Headers apart, so that only body allocations are counted */
+    if (parser.execute(response.data(), header_size) != header_size) {
+        *body_allocations = 0;
+        return false;
+    }
+
+    uint64_t count = alloc_count();
+    bool parsed = true;
+    for (size_t offset = header_size; offset < response.size() && parsed; offset += feed_size) {
+        size_t length = (response.size() - offset < feed_size) ? response.size() - offset : feed_size;
+        parsed = parser.execute(response.data() + offset, length) == length && !parser.failed();
+    }
+    if (parsed) {
+        parser.finish();
+    }
+    *body_allocations = alloc_count() - count;
+    return parsed;
+}
+
+/* Reallocations geometric growth makes for @p body_size bytes */
+static uint64_t growth_steps(size_t body_size)
+{
+    uint64_t steps = 0;
+    for (size_t capacity = 0; capacity < body_size; steps ++) {
+        capacity = capacity ? capacity * 2 : HTTP_RESPONSE_INITIAL_BODY_SIZE;
+        if (capacity > HTTP_RESPONSE_MAX_BODY_SIZE) {
+            capacity = HTTP_RESPONSE_MAX_BODY_SIZE;
+        }
+    }
+    return steps;
+}
+
+/* Pieces smaller than the first allocation grow by doubling alone. Larger pieces can take
+ * more than doubling at a time, so fewer steps.
+ */
+static void check_growth(uint64_t allocations, size_t body_size, size_t piece)
+{
+    if (piece < HTTP_RESPONSE_INITIAL_BODY_SIZE) {
+        HOST_CHECK_EQ(allocations, growth_steps(body_size));
+    } else {
+        HOST_CHECK(allocations >= 1 && allocations <= growth_steps(body_size));
+    }
+}
+
+static void check_body(HttpResponse &response, size_t body_size)
+{
+    HOST_CHECK(response.is_message_complete());
+    HOST_CHECK(!response.is_body_too_large());
+    HOST_CHECK_EQ(response.get_body_length(), body_size);
+    HOST_CHECK(response.get_body_as_string() == std::string(body_size, 'b'));
+}
+
+static void test_body_growth(void)
+{
+    const size_t cap = HTTP_RESPONSE_MAX_BODY_SIZE;
+    uint64_t allocations = 0;
+
+    /* Known length: allocated once, up to and at the cap */
+    for (size_t body_size : { (size_t) 1, (size_t) 10000, cap }) {
+        HttpResponse res;
+        HOST_CHECK(buffer_body(content_length_response(body_size), 536, &res, &allocations));
+        HOST_CHECK_EQ(allocations, 1);
+        check_body(res, body_size);
+    }
+
+    /* Unknown length, chunked or until close: doubling, in small and large pieces, up to and at the cap */
+    for (size_t body_size : { (size_t) 100, (size_t) 1024, (size_t) 1025, (size_t) 40000, cap }) {
+        for (size_t piece : { (size_t) 100, (size_t) 4096 }) {
+            HttpResponse chunked;
+            HOST_CHECK(buffer_body(chunked_response(body_size, piece), piece, &chunked, &allocations));
+            check_growth(allocations, body_size, piece);
+            check_body(chunked, body_size);
+
+            HttpResponse until_close;
+            HOST_CHECK(buffer_body(until_close_response(body_size), piece, &until_close, &allocations));
+            check_growth(allocations, body_size, piece);
+            HOST_CHECK_EQ(until_close.get_body_length(), body_size);
+        }
+    }
+}
+
+static void test_body_overflow(void)
+{
+    const size_t cap = HTTP_RESPONSE_MAX_BODY_SIZE;
+    uint64_t allocations = 0;
+
+    /* Declared length past the cap: refused at headers, nothing allocated */
+    HttpResponse declared;
+    HOST_CHECK(!buffer_body(content_length_response(cap + 1), 536, &declared, &allocations));
+    HOST_CHECK(declared.is_body_too_large());
+    HOST_CHECK_EQ(allocations, 0);
+    HOST_CHECK_EQ(declared.get_body_length(), 0);
+
+    /* Growing past the cap: stops at the byte that doesn't fit, body kept up to it */
+    HttpResponse chunked;
+    HOST_CHECK(!buffer_body(chunked_response(cap + 1, 4096), 4096, &chunked, &allocations));
+    HOST_CHECK(chunked.is_body_too_large());
+    HOST_CHECK(!chunked.is_message_complete());
+    HOST_CHECK_EQ(chunked.get_body_length(), cap - cap % 4096);
+
+    HttpResponse until_close;
+    HOST_CHECK(!buffer_body(until_close_response(cap + 1), 1, &until_close, &allocations));
+    HOST_CHECK(until_close.is_body_too_large());
+    HOST_CHECK_EQ(until_close.get_body_length(), cap);
+
+    /* Through send(): -2102 for too large, still -2101 for malformed */
+    struct {
+        std::string response;
+        nsapi_error_t error;
+    } cases[] = {
+        { content_length_response(cap), 0 },
+        { content_length_response(cap + 1), -2102 },
+        { chunked_response(cap + 1, 1000), -2102 },
+        { until_close_response(cap + 1), -2102 },
+        { "HTTP/1.1 200 OK\r\nContent-Length: x\r\n\r\n", -2101 },
+    };
+    for (auto &c : cases) {
+        ScriptedSocket socket(c.response, 1460);
+        HttpRequest request(&socket, HTTP_GET, s_url);
+        HttpResponse *res = request.send();
+        HOST_CHECK_EQ(request.get_error(), c.error);
+        HOST_CHECK((res != NULL) == (c.error == 0));
+    }
+}
+
+int main()
+{
+    test_request_allocations();
+    test_body_growth();
+    test_body_overflow();
+
+    return HOST_TEST_RESULT();
+}
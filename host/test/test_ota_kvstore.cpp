@@ -0,0 +1,241 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* OTA metadata store over default KVStore: write suppression, batch held until commit and
+ * committed in one write, one batch at a time owned by one thread, records of earlier versions.
+ * And cost of a deployment's metadata writes against one write per record. */
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+
+#include "mbed_ota_kvstore.h"
+#include "mbed.h"
+#include "mbed_stub.h"
+#include "kvstore_global_api/kvstore_global_api.h"
+
+#include "host_test.h"
+
+/* kv_set() calls made by @p fn */
+template <typename F>
+static uint32_t kv_writes(F fn)
+{
+    uint32_t count = mbed_stub_kv_set_count();
+    fn();
+    return mbed_stub_kv_set_count() - count;
+}
+
+/* Content of @p key as string, "" if not found */
+static const char *kv_content(const char *key)
+{
+    static char buffer[ADUC_OTA_KV_RECORD_MAXSIZE + 1];
+    size_t actual_size = 0;
+    if (ADUC_OtaKV_Get(key, buffer, ADUC_OTA_KV_RECORD_MAXSIZE, &actual_size) != MBED_SUCCESS) {
+        actual_size = 0;
+    }
+    buffer[actual_size] = '\0';
+    return buffer;
+}
+
+/* Assumed latency of TDBStore on internal flash: get reads the record, set programs it */
+#define KV_GET_LATENCY_US       200
+#define KV_SET_LATENCY_US       5000
+
+/* Run @p fn on another thread and wait for it */
+template <typename F>
+static void on_other_thread(F fn)
+{
+    std::thread thread(fn);
+    thread.join();
+}
+
+/* Metadata writes of one deployment: workflow state at phase boundaries, install batch of
+ * upgrade state, settle after reboot, and workflow state removal */
+struct Deployment {
+    uint32_t writes;
+    uint32_t worst_writes;      // Most writes made by one call
+    double worst_ms;
+    double total_ms;
+};
+
+static const size_t s_workflowSize = 200;
+static const size_t s_upgradeSize = 160;
+
+template <typename Set, typename Batch, typename Remove>
+static Deployment run_deployment(Set set, Batch batch, Remove remove)
+{
+    uint8_t workflow[s_workflowSize];
+    uint8_t upgrade[s_upgradeSize];
+    memset(upgrade, 0x00, sizeof(upgrade));
+
+    Deployment result = { 0, 0, 0, 0 };
+    auto step = [&](auto fn) {
+        uint32_t sets = mbed_stub_kv_set_count();
+        uint32_t writes = result.writes;
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        /* Also counts writes fn() adds to result.writes itself */
+        result.writes += mbed_stub_kv_set_count() - sets;
+        writes = result.writes - writes;
+        result.worst_writes = writes > result.worst_writes ? writes : result.worst_writes;
+        result.total_ms += ms;
+        result.worst_ms = ms > result.worst_ms ? ms : result.worst_ms;
+    };
+
+    for (int phase = 1; phase <= 3; phase ++) {
+        memset(workflow, phase, sizeof(workflow));
+        step([&] { set("ota_workflow", workflow, sizeof(workflow)); });
+    }
+    step([&] {
+        upgrade[0] = 1;
+        upgrade[1] = 1;
+        batch(upgrade, sizeof(upgrade));
+    });
+    memset(workflow, 4, sizeof(workflow));
+    step([&] { set("ota_workflow", workflow, sizeof(workflow)); });
+    step([&] {
+        memset(upgrade, 0x00, 2);
+        set("ota_upgrade", upgrade, sizeof(upgrade));
+    });
+    /* TDBStore removes by appending a delete record: a write too */
+    step([&] { result.writes += remove("ota_workflow"); });
+
+    return result;
+}
+
+/* Former store, one write per record: transcribed write suppression over individual keys */
+static void per_key_set(const char *key, const void *buffer, size_t size)
+{
+    std::string path = std::string("/kv/") + key;
+    uint8_t stored[ADUC_OTA_KV_RECORD_MAXSIZE];
+    size_t actual_size = 0;
+    if (kv_get(path.c_str(), stored, sizeof(stored), &actual_size) == MBED_SUCCESS &&
+        actual_size == size && memcmp(stored, buffer, size) == 0) {
+        return;
+    }
+    kv_set(path.c_str(), buffer, size, 0);
+}
+
+static void bench_deployment(void)
+{
+    kv_reset("/kv/");
+    mbed_stub_kv_set_latency_us(KV_GET_LATENCY_US, KV_SET_LATENCY_US);
+
+    Deployment per_key = run_deployment(
+        per_key_set,
+        [](const void *buffer, size_t size) { per_key_set("ota_upgrade", buffer, size); },
+        [](const char *key) -> uint32_t { return kv_remove((std::string("/kv/") + key).c_str()) == MBED_SUCCESS; });
+
+    kv_reset("/kv/");
+    Deployment packed = run_deployment(
+        [](const char *key, const void *buffer, size_t size) { ADUC_OtaKV_Set(key, buffer, size); },
+        [](const void *buffer, size_t size) {
+            ADUC_OtaKV_BeginBatch();
+            ADUC_OtaKV_Set("ota_upgrade", buffer, size);
+            ADUC_OtaKV_Commit();
+        },
+        [](const char *key) -> uint32_t {
+            ADUC_OtaKV_Remove(key);
+            return 0;
+        });
+
+    mbed_stub_kv_set_latency_us(0, 0);
+
+    printf("Deployment metadata, KVStore get %d us, set %d us: per-key -> packed\n",
+           KV_GET_LATENCY_US, KV_SET_LATENCY_US);
+    printf("  writes %u -> %u, worst call %.2f -> %.2f ms, total %.2f -> %.2f ms, %.0f -> %.0f writes/s\n",
+           (unsigned) per_key.writes, (unsigned) packed.writes, per_key.worst_ms, packed.worst_ms,
+           per_key.total_ms, packed.total_ms,
+           per_key.writes * 1000.0 / per_key.total_ms, packed.writes * 1000.0 / packed.total_ms);
+
+    /* No more writes than per-key, and no call costs more than one write. Times above are
+     * wall clock, only printed. */
+    HOST_CHECK(packed.writes <= per_key.writes);
+    HOST_CHECK_EQ(packed.worst_writes, 1);
+}
+
+int main()
+{
+    mbed_stub_kv_set_dir("test_ota_kvstore.kv");
+    kv_reset("/kv/");
+
+    /* Outside batch: write through, unless content is unchanged */
+    HOST_CHECK_EQ(kv_writes([] { HOST_CHECK_EQ(ADUC_OtaKV_Set("a", "1", 1), MBED_SUCCESS); }), 1);
+    HOST_CHECK_EQ(kv_writes([] { HOST_CHECK_EQ(ADUC_OtaKV_Set("a", "1", 1), MBED_SUCCESS); }), 0);
+    HOST_CHECK(strcmp(kv_content("a"), "1") == 0);
+
+    /* In batch: held in RAM and readable, one write per record on commit */
+    HOST_CHECK_EQ(ADUC_OtaKV_BeginBatch(), MBED_SUCCESS);
+    HOST_CHECK_EQ(kv_writes([] {
+        ADUC_OtaKV_Set("a", "2", 1);
+        ADUC_OtaKV_Set("b", "x", 1);
+        ADUC_OtaKV_Set("a", "3", 1);
+    }), 0);
+    HOST_CHECK(strcmp(kv_content("a"), "3") == 0);
+
+    /* Batch full: third record written through */
+    HOST_CHECK_EQ(kv_writes([] { ADUC_OtaKV_Set("c", "y", 1); }), 1);
+
+    /* Not nestable */
+    HOST_CHECK_EQ(ADUC_OtaKV_BeginBatch(), MBED_ERROR_ALREADY_IN_USE);
+
+    /* Another thread can neither start its own batch nor commit ours. Its writes to held records
+     * update the held content, others write through. */
+    on_other_thread([] {
+        HOST_CHECK_EQ(ADUC_OtaKV_BeginBatch(), MBED_ERROR_ALREADY_IN_USE);
+        HOST_CHECK_EQ(ADUC_OtaKV_Commit(), MBED_ERROR_ALREADY_IN_USE);
+        HOST_CHECK_EQ(kv_writes([] { ADUC_OtaKV_Set("b", "z", 1); }), 0);
+        HOST_CHECK_EQ(kv_writes([] { ADUC_OtaKV_Set("c", "w", 1); }), 1);
+    });
+
+    /* All held records in one write */
+    HOST_CHECK_EQ(kv_writes([] { HOST_CHECK_EQ(ADUC_OtaKV_Commit(), MBED_SUCCESS); }), 1);
+    HOST_CHECK(strcmp(kv_content("a"), "3") == 0);
+    HOST_CHECK(strcmp(kv_content("b"), "z") == 0);
+    HOST_CHECK(strcmp(kv_content("c"), "w") == 0);
+
+    /* Batch ended: other threads can take the next one, commit without batch writes nothing */
+    on_other_thread([] {
+        HOST_CHECK_EQ(ADUC_OtaKV_BeginBatch(), MBED_SUCCESS);
+        HOST_CHECK_EQ(ADUC_OtaKV_Commit(), MBED_SUCCESS);
+    });
+    HOST_CHECK_EQ(kv_writes([] { HOST_CHECK_EQ(ADUC_OtaKV_Commit(), MBED_SUCCESS); }), 0);
+
+    /* Remove drops held content too */
+    HOST_CHECK_EQ(ADUC_OtaKV_BeginBatch(), MBED_SUCCESS);
+    ADUC_OtaKV_Set("a", "4", 1);
+    HOST_CHECK_EQ(ADUC_OtaKV_Remove("a"), MBED_SUCCESS);
+    HOST_CHECK_EQ(kv_writes([] { HOST_CHECK_EQ(ADUC_OtaKV_Commit(), MBED_SUCCESS); }), 0);
+    HOST_CHECK(strcmp(kv_content("a"), "") == 0);
+    HOST_CHECK_EQ(ADUC_OtaKV_Remove("a"), MBED_ERROR_ITEM_NOT_FOUND);
+
+    /* Failed commit: none of the held records persist */
+    HOST_CHECK_EQ(ADUC_OtaKV_BeginBatch(), MBED_SUCCESS);
+    ADUC_OtaKV_Set("a", "5", 1);
+    ADUC_OtaKV_Set("b", "6", 1);
+    mbed_stub_kv_fail_sets(1);
+    HOST_CHECK_EQ(ADUC_OtaKV_Commit(), MBED_ERROR_WRITE_FAILED);
+    HOST_CHECK(strcmp(kv_content("a"), "") == 0);
+    HOST_CHECK(strcmp(kv_content("b"), "z") == 0);
+
+    /* Record written on its own by earlier versions: read, and moved on next set */
+    HOST_CHECK_EQ(kv_set("/kv/d", "old", 3, 0), MBED_SUCCESS);
+    HOST_CHECK(strcmp(kv_content("d"), "old") == 0);
+    HOST_CHECK_EQ(kv_writes([] { HOST_CHECK_EQ(ADUC_OtaKV_Set("d", "new", 3), MBED_SUCCESS); }), 1);
+    HOST_CHECK(strcmp(kv_content("d"), "new") == 0);
+    char buffer[8];
+    size_t actual_size = 0;
+    HOST_CHECK_EQ(kv_get("/kv/d", buffer, sizeof(buffer), &actual_size), MBED_ERROR_ITEM_NOT_FOUND);
+
+    /* Records full */
+    HOST_CHECK_EQ(ADUC_OtaKV_Set("e", "1", 1), MBED_SUCCESS);
+    HOST_CHECK_EQ(ADUC_OtaKV_Set("f", "1", 1), MBED_ERROR_MEDIA_FULL);
+    HOST_CHECK(strcmp(kv_content("e"), "1") == 0);
+
+    bench_deployment();
+
+    return HOST_TEST_RESULT();
+}
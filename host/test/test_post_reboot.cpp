@@ -0,0 +1,347 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Settle of MCUboot firmware upgrade state after reboot, which MCUboot OTA PAL runs before main()
+ *
+ * Against the former global constructor, transcribed from mcubupdate_handler.cpp: same stored
+ * state, image confirm and revert for each boot, and its cost in KVStore accesses and time before
+ * main() on a KVStore with flash-like latency. Also from state stored by the former constructor,
+ * on its own rather than packed with other OTA records. MCUboot image state is faked: which
+ * version runs, and whether it is confirmed.
+ */
+
+#include "image_upgrade_state.h"
+#include "mbed_ota_kvstore.h"
+
+#include "mbed.h"
+#include "mbed_stub.h"
+#include "kvstore_global_api/kvstore_global_api.h"
+
+#include "host_test.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+
+#define STATE_PATH              "/kv/" OTA_IMAGE_UPDATE_STATE_KEY
+
+/* Assumed latency of TDBStore on internal flash: get reads the record, set programs it */
+#define KV_GET_LATENCY_US       200
+#define KV_SET_LATENCY_US       5000
+
+/* Faked MCUboot image state */
+static struct image_version s_running_version;
+static bool s_image_ok;
+static int s_confirm_rc;
+static int s_confirm_count;
+
+bool imgUpgSt_installed(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState, bool *confirmed)
+{
+    if (!imageUpgradeState->installRebooted_valid ||
+        !imageUpgradeState->installRebooted) {
+        return false;
+    }
+
+    if (!imageUpgradeState->stageVersion_valid) {
+        return false;
+    }
+
+    if (0 != memcmp(&(imageUpgradeState->stageVersion),
+                    &s_running_version,
+                    sizeof(struct image_version))) {
+        return false;
+    }
+
+    *confirmed = s_image_ok;
+    return true;
+}
+
+int fwu_confirm_image_set(void)
+{
+    s_confirm_count ++;
+    if (s_confirm_rc == 0) {
+        s_image_ok = true;
+    }
+    return s_confirm_rc;
+}
+
+/* Former global constructor Update_NVImgUpgSt_PostReboot, on the raw state record as it accessed it */
+
+static bool legacy_getAll(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
+{
+    size_t actual_size = 0;
+    return kv_get(STATE_PATH, imageUpgradeState, sizeof(*imageUpgradeState), &actual_size) == MBED_SUCCESS &&
+           actual_size == sizeof(*imageUpgradeState);
+}
+
+static bool legacy_setAll(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
+{
+    return kv_set(STATE_PATH, imageUpgradeState, sizeof(*imageUpgradeState), 0) == MBED_SUCCESS;
+}
+
+static bool legacy_installRebooted(bool *installRebooted)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!legacy_getAll(&imageUpgradeState) || !imageUpgradeState.installRebooted_valid) {
+        return false;
+    }
+    *installRebooted = imageUpgradeState.installRebooted;
+    return true;
+}
+
+static bool legacy_setInstallRebooted(bool installRebooted)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!legacy_getAll(&imageUpgradeState)) {
+        return false;
+    }
+    imageUpgradeState.installRebooted = installRebooted;
+    imageUpgradeState.installRebooted_valid = true;
+    return legacy_setAll(&imageUpgradeState);
+}
+
+static bool legacy_installed(bool *confirmed)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    return legacy_getAll(&imageUpgradeState) && imgUpgSt_installed(&imageUpgradeState, confirmed);
+}
+
+static bool legacy_settleInstalledCriteria(void)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!legacy_getAll(&imageUpgradeState) || !imageUpgradeState.stageInstalledCriteria_valid) {
+        return false;
+    }
+    size_t len = strlen(imageUpgradeState.stageInstalledCriteria);
+    if (len > INSTALLEDCRITERIA_MAXCHAR) {
+        return false;
+    }
+    memcpy(imageUpgradeState.persistentInstalledCriteria, imageUpgradeState.stageInstalledCriteria, len + 1);
+    imageUpgradeState.persistentInstalledCriteria_valid = true;
+    imageUpgradeState.stageInstalledCriteria_valid = false;
+    memset(imageUpgradeState.stageInstalledCriteria, 0x00, INSTALLEDCRITERIA_MAXCHAR + 1);
+    return legacy_setAll(&imageUpgradeState);
+}
+
+static bool legacy_reset(void)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!legacy_getAll(&imageUpgradeState)) {
+        memset(&imageUpgradeState, 0x00, sizeof(imageUpgradeState));
+    } else {
+        memset(&imageUpgradeState, 0x00, offsetof(OTA_NonVolatileImageUpgradeState_t, reserved));
+    }
+    return legacy_setAll(&imageUpgradeState);
+}
+
+/* @return false for revert, as imgUpgSt_postReboot() */
+static bool legacy_postReboot(void)
+{
+    bool installRebooted = false;
+    if (legacy_installRebooted(&installRebooted) && !installRebooted) {
+        legacy_setInstallRebooted(true);
+    }
+
+    bool confirmed = false;
+    if (legacy_installed(&confirmed) && !confirmed) {
+        fwu_confirm_image_set();
+    }
+
+    if (legacy_installed(&confirmed)) {
+        if (confirmed) {
+            legacy_settleInstalledCriteria();
+            legacy_reset();
+        } else {
+            legacy_reset();
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Boot cases */
+
+enum Boot {
+    Boot_First,             // No state stored yet
+    Boot_Normal,            // Nothing staged
+    Boot_Installed,         // First boot after install reboot into stage image
+    Boot_ConfirmFails,      // As above, but image confirm fails
+    Boot_Reverted,          // Bootloader reverted: stage image doesn't run
+    Boot_Confirmed,         // Reset after image confirm, before state commit
+};
+
+static const char *const s_bootNames[] = {
+    "first", "normal", "after install", "confirm fails", "reverted", "reset after confirm",
+};
+
+static const struct image_version s_oldVersion = { 1, 0, 0, 1 };
+static const struct image_version s_stageVersion = { 1, 1, 0, 2 };
+
+/* Store state and set MCUboot image state as found on @p boot. Stored on its own as the former
+ * constructor did if @p legacyStored, else in OTA KVStore. */
+static void setup_boot(Boot boot, bool legacyStored)
+{
+    kv_reset("/kv/");
+    s_running_version = s_stageVersion;
+    s_image_ok = false;
+    s_confirm_rc = 0;
+    s_confirm_count = 0;
+
+    if (boot == Boot_First) {
+        s_running_version = s_oldVersion;
+        s_image_ok = true;
+        return;
+    }
+
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    memset(&imageUpgradeState, 0x00, sizeof(imageUpgradeState));
+    imageUpgradeState.persistentInstalledCriteria_valid = true;
+    strcpy(imageUpgradeState.persistentInstalledCriteria, "1.0.0.1");
+
+    if (boot == Boot_Normal) {
+        s_running_version = s_oldVersion;
+        s_image_ok = true;
+    } else {
+        /* As install leaves it */
+        imageUpgradeState.stageVersion_valid = true;
+        imageUpgradeState.stageVersion = s_stageVersion;
+        imageUpgradeState.stageInstalledCriteria_valid = true;
+        strcpy(imageUpgradeState.stageInstalledCriteria, "1.1.0.2");
+        imageUpgradeState.installRebooted_valid = true;
+        imageUpgradeState.installRebooted = (boot == Boot_Confirmed);
+
+        if (boot == Boot_ConfirmFails) {
+            s_confirm_rc = -1;
+        } else if (boot == Boot_Reverted) {
+            s_running_version = s_oldVersion;
+            s_image_ok = true;
+        } else if (boot == Boot_Confirmed) {
+            s_image_ok = true;
+        }
+    }
+
+    if (legacyStored) {
+        HOST_CHECK(legacy_setAll(&imageUpgradeState));
+    } else {
+        HOST_CHECK_EQ(ADUC_OtaKV_Set(OTA_IMAGE_UPDATE_STATE_KEY, &imageUpgradeState, sizeof(imageUpgradeState)), MBED_SUCCESS);
+    }
+}
+
+struct BootResult {
+    bool stored;
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    bool noRevert;
+    bool imageOk;
+    int confirmCount;
+    uint32_t gets;
+    uint32_t sets;
+    double ms;
+};
+
+static BootResult run_boot(Boot boot, bool (*postReboot)(void), bool legacyStored)
+{
+    setup_boot(boot, legacyStored);
+
+    BootResult result;
+    uint32_t gets = mbed_stub_kv_get_count();
+    uint32_t sets = mbed_stub_kv_set_count();
+    auto start = std::chrono::steady_clock::now();
+    result.noRevert = postReboot();
+    auto end = std::chrono::steady_clock::now();
+    result.ms = std::chrono::duration<double, std::milli>(end - start).count();
+    result.gets = mbed_stub_kv_get_count() - gets;
+    result.sets = mbed_stub_kv_set_count() - sets;
+
+    memset(&result.imageUpgradeState, 0x00, sizeof(result.imageUpgradeState));
+    /* Where either stored it: OTA KVStore reads state stored on its own too */
+    size_t actual_size = 0;
+    result.stored = ADUC_OtaKV_Get(OTA_IMAGE_UPDATE_STATE_KEY, &result.imageUpgradeState,
+                                   sizeof(result.imageUpgradeState), &actual_size) == MBED_SUCCESS &&
+                    actual_size == sizeof(result.imageUpgradeState);
+    result.imageOk = s_image_ok;
+    result.confirmCount = s_confirm_count;
+    return result;
+}
+
+static void test_same_as_legacy(void)
+{
+    for (int boot = Boot_First; boot <= Boot_Confirmed; boot ++) {
+        BootResult legacy = run_boot((Boot) boot, legacy_postReboot, true);
+
+        /* First boot after firmware upgrade from former constructor, and later ones */
+        for (int legacyStored = 1; legacyStored >= 0; legacyStored --) {
+            BootResult settle = run_boot((Boot) boot, imgUpgSt_postReboot, legacyStored);
+
+            if (settle.stored != legacy.stored ||
+                memcmp(&settle.imageUpgradeState, &legacy.imageUpgradeState, sizeof(settle.imageUpgradeState)) != 0) {
+                fprintf(stderr, "Boot '%s'%s: stored state differs from former constructor\n", s_bootNames[boot],
+                        legacyStored ? " from former state" : "");
+            }
+            HOST_CHECK_EQ(settle.stored, legacy.stored);
+            HOST_CHECK(memcmp(&settle.imageUpgradeState, &legacy.imageUpgradeState, sizeof(settle.imageUpgradeState)) == 0);
+            HOST_CHECK_EQ(settle.noRevert, legacy.noRevert);
+            HOST_CHECK_EQ(settle.imageOk, legacy.imageOk);
+            HOST_CHECK_EQ(settle.confirmCount, legacy.confirmCount);
+        }
+    }
+}
+
+static void test_settled_state(void)
+{
+    BootResult result = run_boot(Boot_Installed, imgUpgSt_postReboot, false);
+    HOST_CHECK(result.noRevert);
+    HOST_CHECK(result.imageOk);
+    HOST_CHECK(!result.imageUpgradeState.stageVersion_valid);
+    HOST_CHECK(!result.imageUpgradeState.stageInstalledCriteria_valid);
+    HOST_CHECK(!result.imageUpgradeState.installRebooted_valid);
+    HOST_CHECK(result.imageUpgradeState.persistentInstalledCriteria_valid);
+    HOST_CHECK(strcmp(result.imageUpgradeState.persistentInstalledCriteria, "1.1.0.2") == 0);
+
+    result = run_boot(Boot_ConfirmFails, imgUpgSt_postReboot, false);
+    HOST_CHECK(!result.noRevert);
+    HOST_CHECK(strcmp(result.imageUpgradeState.persistentInstalledCriteria, "1.0.0.1") == 0);
+}
+
+/* KVStore accesses, and time on KVStore with latency, of settle before main() against the former constructor */
+static void bench_boot(void)
+{
+    mbed_stub_kv_set_latency_us(KV_GET_LATENCY_US, KV_SET_LATENCY_US);
+
+    printf("Before main(), KVStore get %d us, set %d us: former constructor -> settle\n",
+           KV_GET_LATENCY_US, KV_SET_LATENCY_US);
+    for (int boot = Boot_First; boot <= Boot_Confirmed; boot ++) {
+        BootResult legacy = run_boot((Boot) boot, legacy_postReboot, true);
+        BootResult settle = run_boot((Boot) boot, imgUpgSt_postReboot, false);
+        printf("  %-20s %u get %u set %6.2f ms -> %u get %u set %6.2f ms\n", s_bootNames[boot],
+               (unsigned) legacy.gets, (unsigned) legacy.sets, legacy.ms,
+               (unsigned) settle.gets, (unsigned) settle.sets, settle.ms);
+
+        /* One read when nothing is pending. Otherwise, one write, after the read of write suppression.
+         * With nothing stored at all, OTA KVStore also looks for state stored on its own. */
+        if (boot == Boot_First) {
+            HOST_CHECK_EQ(settle.gets, 2);
+            HOST_CHECK_EQ(settle.sets, 0);
+        } else if (boot == Boot_Normal) {
+            HOST_CHECK_EQ(settle.gets, 1);
+            HOST_CHECK_EQ(settle.sets, 0);
+        } else {
+            HOST_CHECK_EQ(settle.gets, 2);
+            HOST_CHECK_EQ(settle.sets, 1);
+        }
+        HOST_CHECK(settle.gets < legacy.gets);
+        HOST_CHECK(settle.sets <= legacy.sets);
+    }
+
+    mbed_stub_kv_set_latency_us(0, 0);
+}
+
+int main()
+{
+    mbed_stub_kv_set_dir("test_post_reboot.kv");
+
+    test_same_as_legacy();
+    test_settled_state();
+    bench_boot();
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,393 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Fixed-schema writer of the deviceUpdate 'agent' reported property against upstream
+ * GetReportingJsonValue(), serialized the way parson does: same members in same order, same
+ * escaping, stepResults of child workflows, truncation, and hand-over to D2C messaging
+ *
+ * Parson escapes '/' as "\/", the writer doesn't. Both are valid JSON for the same string, so
+ * the reference output is compared with "\/" taken back to "/".
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "aduc/adu_core_interface.h"
+#include "aduc/d2c_messaging.h"
+#include "aduc/reported_state_writer.h"
+#include "aduc/workflow_data_utils.h"
+#include "aduc/workflow_utils.h"
+
+#include "host_test.h"
+
+/* Workflow stand-in: root with optional children */
+struct TestWorkflow {
+    const char *id;
+    const char *retry;
+    ADUC_Result result;
+    const char *details;
+    std::vector<TestWorkflow *> children;
+};
+
+static ADUCITF_UpdateAction s_action = ADUCITF_UpdateAction_ProcessDeployment;
+
+const char *workflow_peek_id(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->id;
+}
+
+const char *workflow_peek_retryTimestamp(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->retry;
+}
+
+ADUC_Result workflow_get_result(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->result;
+}
+
+const char *workflow_peek_result_details(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->details;
+}
+
+int workflow_get_children_count(ADUC_WorkflowHandle handle)
+{
+    return (int) static_cast<TestWorkflow *>(handle)->children.size();
+}
+
+ADUC_WorkflowHandle workflow_get_child(ADUC_WorkflowHandle handle, int index)
+{
+    return static_cast<TestWorkflow *>(handle)->children[index];
+}
+
+ADUCITF_UpdateAction ADUC_WorkflowData_GetCurrentAction(const ADUC_WorkflowData *workflowData)
+{
+    (void) workflowData;
+    return s_action;
+}
+
+/* D2C messaging stand-in: keeps what was handed over */
+static int s_client;
+ADUC_ClientHandle g_iotHubClientHandleForADUComponent;
+
+static std::string s_sent;
+static int s_sent_count;
+
+bool ADUC_D2C_Message_SendAsync_TakeOwnership(ADUC_D2C_Message_Type type, void *cloudServiceHandle, char *message,
+                                              ADUC_D2C_MESSAGE_HTTP_RESPONSE_CALLBACK responseCallback,
+                                              ADUC_D2C_MESSAGE_COMPLETED_CALLBACK completedCallback,
+                                              ADUC_D2C_MESSAGE_STATUS_CHANGED_CALLBACK statusChangedCallback,
+                                              void *userData)
+{
+    (void) responseCallback;
+    (void) statusChangedCallback;
+    (void) userData;
+
+    HOST_CHECK_EQ(type, ADUC_D2C_Message_Type_Device_Update_Result);
+    HOST_CHECK(cloudServiceHandle == &g_iotHubClientHandleForADUComponent);
+    s_sent = message;
+    s_sent_count ++;
+    free(message);
+    if (completedCallback != NULL) {
+        completedCallback(NULL, ADUC_D2C_Message_Status_Success);
+    }
+    return true;
+}
+
+/* JSON value the way parson keeps it: object members in insertion order */
+struct JsonValue {
+    enum { Number, String, Object } type;
+    double number;
+    std::string string;
+    std::vector<std::pair<std::string, JsonValue>> members;
+
+    static JsonValue object(void)
+    {
+        return JsonValue { Object, 0, "", {} };
+    }
+
+    void set_number(const char *name, double value)
+    {
+        members.emplace_back(name, JsonValue { Number, value, "", {} });
+    }
+
+    void set_string(const char *name, const char *value)
+    {
+        members.emplace_back(name, JsonValue { String, 0, value, {} });
+    }
+
+    void set_value(const char *name, const JsonValue &value)
+    {
+        members.emplace_back(name, value);
+    }
+};
+
+/* parson json_serialize_string() */
+static void parson_serialize_string(const std::string &text, std::string &out)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (unsigned char c : text) {
+        switch (c) {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '/':  out += "\\/"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    out += "\\u00";
+                    out += hex[c >> 4];
+                    out += hex[c & 0x0F];
+                } else {
+                    out += (char) c;
+                }
+                break;
+        }
+    }
+    out += '"';
+}
+
+/* parson json_serialize_to_buffer_r(), not pretty */
+static void parson_serialize(const JsonValue &value, std::string &out)
+{
+    char number[32];
+
+    switch (value.type) {
+        case JsonValue::Number:
+            snprintf(number, sizeof(number), "%1.17g", value.number);
+            out += number;
+            break;
+        case JsonValue::String:
+            parson_serialize_string(value.string, out);
+            break;
+        case JsonValue::Object:
+            out += '{';
+            for (size_t i = 0; i < value.members.size(); i ++) {
+                if (i > 0) {
+                    out += ',';
+                }
+                parson_serialize_string(value.members[i].first, out);
+                out += ':';
+                parson_serialize(value.members[i].second, out);
+            }
+            out += '}';
+            break;
+    }
+}
+
+/* Upstream adu_core_interface.c GetReportingJsonValue() */
+static JsonValue reference_reporting_json(const ADUC_WorkflowData *workflowData, ADUCITF_State updateState,
+                                          const ADUC_Result *result, const char *installedUpdateId)
+{
+    ADUC_WorkflowHandle handle = (workflowData != NULL) ? workflowData->WorkflowHandle : NULL;
+    JsonValue agent = JsonValue::object();
+
+    agent.set_number("state", updateState);
+
+    if (handle != NULL) {
+        JsonValue workflow = JsonValue::object();
+        workflow.set_number("action", ADUC_WorkflowData_GetCurrentAction(workflowData));
+        workflow.set_string("id", workflow_peek_id(handle));
+        const char *retryTimestamp = workflow_peek_retryTimestamp(handle);
+        if (retryTimestamp != NULL && *retryTimestamp != '\0') {
+            workflow.set_string("retryTimestamp", retryTimestamp);
+        }
+        agent.set_value("workflow", workflow);
+    }
+
+    if (installedUpdateId != NULL) {
+        agent.set_string("installedUpdateId", installedUpdateId);
+    }
+
+    ADUC_Result rootResult = { ADUC_Result_Failure, 0 };
+    if (result != NULL) {
+        rootResult = *result;
+    } else if (handle != NULL) {
+        rootResult = workflow_get_result(handle);
+    }
+
+    JsonValue lastInstallResult = JsonValue::object();
+    lastInstallResult.set_number("resultCode", rootResult.ResultCode);
+    lastInstallResult.set_number("extendedResultCode", rootResult.ExtendedResultCode);
+    if (handle != NULL && workflow_peek_result_details(handle) != NULL) {
+        lastInstallResult.set_string("resultDetails", workflow_peek_result_details(handle));
+    }
+
+    int childCount = (handle != NULL) ? workflow_get_children_count(handle) : 0;
+    if (childCount > 0) {
+        JsonValue stepResults = JsonValue::object();
+        for (int i = 0; i < childCount; i ++) {
+            ADUC_WorkflowHandle child = workflow_get_child(handle, i);
+            ADUC_Result childResult = workflow_get_result(child);
+            JsonValue step = JsonValue::object();
+            step.set_number("resultCode", childResult.ResultCode);
+            step.set_number("extendedResultCode", childResult.ExtendedResultCode);
+            if (workflow_peek_result_details(child) != NULL) {
+                step.set_string("resultDetails", workflow_peek_result_details(child));
+            }
+            std::string key = "step_" + std::to_string(i);
+            stepResults.set_value(key.c_str(), step);
+        }
+        lastInstallResult.set_value("stepResults", stepResults);
+    }
+    agent.set_value("lastInstallResult", lastInstallResult);
+
+    JsonValue deviceUpdate = JsonValue::object();
+    deviceUpdate.set_string("__t", "c");
+    deviceUpdate.set_value("agent", agent);
+
+    JsonValue root = JsonValue::object();
+    root.set_value("deviceUpdate", deviceUpdate);
+    return root;
+}
+
+static std::string reference_string(const ADUC_WorkflowData *workflowData, ADUCITF_State updateState,
+                                    const ADUC_Result *result, const char *installedUpdateId)
+{
+    std::string json;
+    parson_serialize(reference_reporting_json(workflowData, updateState, result, installedUpdateId), json);
+
+    /* "\/" and "/" are the same string */
+    std::string unescaped;
+    for (size_t i = 0; i < json.size(); i ++) {
+        if (json[i] == '\\' && i + 1 < json.size()) {
+            if (json[i + 1] != '/') {
+                unescaped += json[i];
+            }
+            unescaped += json[i + 1];
+            i ++;
+        } else {
+            unescaped += json[i];
+        }
+    }
+    return unescaped;
+}
+
+static void check_same(const ADUC_WorkflowData *workflowData, ADUCITF_State updateState,
+                       const ADUC_Result *result, const char *installedUpdateId)
+{
+    std::string expected = reference_string(workflowData, updateState, result, installedUpdateId);
+
+    char *json = ADUC_ReportedState_SerializeToString(workflowData, updateState, result, installedUpdateId);
+    HOST_CHECK(json != NULL);
+    if (json == NULL) {
+        return;
+    }
+    if (expected != json) {
+        fprintf(stderr, "expected: %s\nwritten:  %s\n", expected.c_str(), json);
+    }
+    HOST_CHECK(expected == json);
+
+    /* Measured length is exact */
+    HOST_CHECK_EQ(ADUC_ReportedState_Serialize(NULL, 0, workflowData, updateState, result, installedUpdateId),
+                  expected.size());
+    free(json);
+}
+
+static TestWorkflow s_root = { "wf-1", NULL, { ADUC_Result_Success, 0 }, NULL, {} };
+static TestWorkflow s_step0 = { "step-0", NULL, { ADUC_Result_Success, 0 }, "downloaded", {} };
+static TestWorkflow s_step1 = { "step-1", NULL, { ADUC_Result_Failure, (int32_t) 0x80000001 }, "install \"failed\"\n", {} };
+
+static void test_same_as_upstream(void)
+{
+    ADUC_WorkflowData workflowData = { &s_root };
+    ADUC_WorkflowData noWorkflow = { NULL };
+    ADUC_Result result = { ADUC_Result_Success, 0 };
+    ADUC_Result negative = { -1, (int32_t) 0x80000000 };
+
+    /* No workflow, NULL data, no result */
+    check_same(NULL, ADUCITF_State_Idle, NULL, NULL);
+    check_same(&noWorkflow, ADUCITF_State_Idle, &result, "contoso/toaster/1.0");
+
+    /* Workflow, without and with retry token */
+    check_same(&workflowData, ADUCITF_State_DeploymentInProgress, &result, NULL);
+    s_root.retry = "";
+    check_same(&workflowData, ADUCITF_State_DeploymentInProgress, &result, NULL);
+    s_root.retry = "2022-01-26T11:33:29.9680598Z";
+    check_same(&workflowData, ADUCITF_State_DownloadStarted, &result, NULL);
+
+    /* Result taken from workflow, with details */
+    s_root.result = { ADUC_Result_Failure, 0x30000001 };
+    s_root.details = "Download failed: http://contoso.com/a b";
+    check_same(&workflowData, ADUCITF_State_Failed, NULL, NULL);
+
+    /* Negative and large codes */
+    s_action = ADUCITF_UpdateAction_Cancel;
+    check_same(&workflowData, ADUCITF_State_Failed, &negative, NULL);
+    s_action = ADUCITF_UpdateAction_ProcessDeployment;
+
+    /* Every kind of escape, in every string member */
+    const char *escapes = "\"q\" \\b\\ / \b\f\n\r\t \x01\x1f caf\xc3\xa9 \x7f";
+    s_root.id = escapes;
+    s_root.retry = escapes;
+    s_root.details = escapes;
+    check_same(&workflowData, ADUCITF_State_Idle, &result, escapes);
+    s_root.id = "wf-1";
+    s_root.retry = NULL;
+    s_root.details = NULL;
+
+    /* stepResults of child workflows */
+    s_root.children = { &s_step0, &s_step1 };
+    check_same(&workflowData, ADUCITF_State_Failed, NULL, NULL);
+    check_same(&workflowData, ADUCITF_State_Idle, &result, "contoso/toaster/1.0");
+
+    std::vector<TestWorkflow> many(12, TestWorkflow { "step", NULL, { ADUC_Result_Success, 0 }, NULL, {} });
+    s_root.children.clear();
+    for (TestWorkflow &step : many) {
+        s_root.children.push_back(&step);
+    }
+    check_same(&workflowData, ADUCITF_State_InstallSucceeded, NULL, NULL);
+    s_root.children.clear();
+}
+
+static void test_truncation(void)
+{
+    ADUC_WorkflowData workflowData = { &s_root };
+    ADUC_Result result = { ADUC_Result_Success, 0 };
+    std::string expected = reference_string(&workflowData, ADUCITF_State_Idle, &result, "contoso/toaster/1.0");
+
+    /* Cut at every length: prefix of full output, terminated, full length returned */
+    for (size_t size = 1; size <= expected.size() + 1; size ++) {
+        std::vector<char> buffer(size + 1, 'X');
+        size_t length = ADUC_ReportedState_Serialize(buffer.data(), size, &workflowData, ADUCITF_State_Idle, &result,
+                                                     "contoso/toaster/1.0");
+        HOST_CHECK_EQ(length, expected.size());
+        HOST_CHECK(expected.compare(0, size - 1, buffer.data()) == 0);
+        HOST_CHECK_EQ(buffer[size], 'X');
+    }
+}
+
+static void test_report(void)
+{
+    ADUC_WorkflowData workflowData = { &s_root };
+    ADUC_Result result = { ADUC_Result_Success, 0 };
+
+    /* Not before the component is registered */
+    g_iotHubClientHandleForADUComponent = NULL;
+    HOST_CHECK(!ADUC_ReportedState_ReportAsync(&workflowData, ADUCITF_State_Idle, &result, NULL));
+    HOST_CHECK_EQ(s_sent_count, 0);
+
+    g_iotHubClientHandleForADUComponent = &s_client;
+    HOST_CHECK(ADUC_ReportedState_ReportAsync(&workflowData, ADUCITF_State_Idle, &result, "contoso/toaster/1.0"));
+    HOST_CHECK_EQ(s_sent_count, 1);
+    HOST_CHECK(s_sent == reference_string(&workflowData, ADUCITF_State_Idle, &result, "contoso/toaster/1.0"));
+}
+
+int main()
+{
+    test_same_as_upstream();
+    test_truncation();
+    test_report();
+
+    return HOST_TEST_RESULT();
+}
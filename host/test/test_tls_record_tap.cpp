@@ -0,0 +1,193 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* TLS record tap: milestones of a TLS 1.2 connection carrying MQTT, at the byte that reaches
+ * them, once each, whatever the splits of the stream into sends and receives. Stream not
+ * framed as TLS records gives none.
+ */
+
+#include <stdlib.h>
+#include <vector>
+
+#include "tls_record_tap.h"
+
+#include "host_test.h"
+
+typedef std::vector<unsigned char> Bytes;
+
+static void append_record(Bytes *stream, unsigned char type, size_t length)
+{
+    stream->push_back(type);
+    stream->push_back(3);
+    stream->push_back(3);
+    stream->push_back((unsigned char) (length >> 8));
+    stream->push_back((unsigned char) length);
+    for (size_t index = 0; index < length; index ++) {
+        stream->push_back((unsigned char) (index * 7));
+    }
+}
+
+/* Bytes of one direction in a row, as one flight of the handshake */
+struct Flight {
+    TLS_RECORD_TAP_DIRECTION direction;
+    Bytes bytes;
+};
+
+/* Where an event is reached: direction and offset of the byte in that direction */
+struct Milestone {
+    unsigned event;
+    TLS_RECORD_TAP_DIRECTION direction;
+    size_t offset;
+};
+
+/* TLS 1.2 full handshake, MQTT CONNECT/CONNACK, then more MQTT traffic both ways */
+static std::vector<Flight> tls_mqtt_transcript(std::vector<Milestone> *milestones)
+{
+    std::vector<Flight> flights;
+    size_t sent = 0;
+    size_t received = 0;
+
+    Flight client_hello = { TLS_RECORD_TAP_SENT, Bytes() };
+    append_record(&client_hello.bytes, 22, 200);
+    milestones->push_back({ TLS_RECORD_TAP_HANDSHAKE_BEGIN, TLS_RECORD_TAP_SENT, 4 });
+    flights.push_back(client_hello);
+    sent += client_hello.bytes.size();
+
+    /* ServerHello, Certificate, ServerKeyExchange, ServerHelloDone: handshake records before ChangeCipherSpec */
+    Flight server_hello = { TLS_RECORD_TAP_RECEIVED, Bytes() };
+    append_record(&server_hello.bytes, 22, 90);
+    append_record(&server_hello.bytes, 22, 3000);
+    append_record(&server_hello.bytes, 22, 300);
+    append_record(&server_hello.bytes, 22, 4);
+    flights.push_back(server_hello);
+    received += server_hello.bytes.size();
+
+    /* ClientKeyExchange, ChangeCipherSpec, Finished */
+    Flight client_finished = { TLS_RECORD_TAP_SENT, Bytes() };
+    append_record(&client_finished.bytes, 22, 70);
+    append_record(&client_finished.bytes, 20, 1);
+    append_record(&client_finished.bytes, 22, 40);
+    flights.push_back(client_finished);
+    sent += client_finished.bytes.size();
+
+    /* NewSessionTicket, ChangeCipherSpec, Finished: handshake done at last byte of Finished */
+    Flight server_finished = { TLS_RECORD_TAP_RECEIVED, Bytes() };
+    append_record(&server_finished.bytes, 22, 180);
+    append_record(&server_finished.bytes, 20, 1);
+    append_record(&server_finished.bytes, 22, 40);
+    milestones->push_back({ TLS_RECORD_TAP_HANDSHAKE_END, TLS_RECORD_TAP_RECEIVED, received + server_finished.bytes.size() - 1 });
+    flights.push_back(server_finished);
+    received += server_finished.bytes.size();
+
+    Flight connect = { TLS_RECORD_TAP_SENT, Bytes() };
+    append_record(&connect.bytes, 23, 350);
+    milestones->push_back({ TLS_RECORD_TAP_FIRST_DATA_SENT, TLS_RECORD_TAP_SENT, sent + 4 });
+    flights.push_back(connect);
+    sent += connect.bytes.size();
+
+    Flight connack = { TLS_RECORD_TAP_RECEIVED, Bytes() };
+    append_record(&connack.bytes, 23, 29);
+    milestones->push_back({ TLS_RECORD_TAP_FIRST_DATA_RECEIVED, TLS_RECORD_TAP_RECEIVED, received + connack.bytes.size() - 1 });
+    flights.push_back(connack);
+    received += connack.bytes.size();
+
+    /* Twin, telemetry, alert on close: no more milestones */
+    Flight subscribe = { TLS_RECORD_TAP_SENT, Bytes() };
+    append_record(&subscribe.bytes, 23, 120);
+    append_record(&subscribe.bytes, 23, 0);
+    flights.push_back(subscribe);
+
+    Flight twin = { TLS_RECORD_TAP_RECEIVED, Bytes() };
+    append_record(&twin.bytes, 23, 1500);
+    append_record(&twin.bytes, 22, 40);
+    append_record(&twin.bytes, 21, 26);
+    flights.push_back(twin);
+
+    return flights;
+}
+
+/* Feed @p flights in pieces of 1 to @p max_piece bytes, checking each milestone comes in the piece holding its byte */
+static void feed_in_pieces(const std::vector<Flight> &flights, const std::vector<Milestone> &milestones, size_t max_piece)
+{
+    TLS_RECORD_TAP tap;
+    tls_record_tap_reset(&tap);
+
+    size_t offsets[TLS_RECORD_TAP_DIRECTION_MAX] = { 0, 0 };
+    unsigned reached = 0;
+
+    for (const Flight &flight : flights) {
+        size_t done = 0;
+        while (done < flight.bytes.size()) {
+            size_t piece = 1 + (size_t) rand() % max_piece;
+            if (piece > flight.bytes.size() - done) {
+                piece = flight.bytes.size() - done;
+            }
+
+            size_t begin = offsets[flight.direction];
+            size_t end = begin + piece;
+            unsigned events = tls_record_tap_feed(&tap, flight.direction, &flight.bytes[done], piece);
+
+            unsigned expected = 0;
+            for (const Milestone &milestone : milestones) {
+                if (milestone.direction == flight.direction && milestone.offset >= begin && milestone.offset < end) {
+                    expected |= milestone.event;
+                }
+            }
+            HOST_CHECK_EQ(events, expected);
+            HOST_CHECK_EQ(events & reached, 0);
+            reached |= events;
+
+            offsets[flight.direction] = end;
+            done += piece;
+        }
+    }
+
+    HOST_CHECK_EQ(reached, TLS_RECORD_TAP_HANDSHAKE_BEGIN | TLS_RECORD_TAP_HANDSHAKE_END |
+                  TLS_RECORD_TAP_FIRST_DATA_SENT | TLS_RECORD_TAP_FIRST_DATA_RECEIVED);
+}
+
+static void test_milestones(void)
+{
+    std::vector<Milestone> milestones;
+    std::vector<Flight> flights = tls_mqtt_transcript(&milestones);
+
+    srand(1);
+    for (size_t max_piece : { (size_t) 1, (size_t) 3, (size_t) 5, (size_t) 6, (size_t) 128, (size_t) 1460, (size_t) 20000 }) {
+        for (int round = 0; round < 50; round ++) {
+            feed_in_pieces(flights, milestones, max_piece);
+        }
+    }
+}
+
+static void test_not_tls(void)
+{
+    TLS_RECORD_TAP tap;
+    tls_record_tap_reset(&tap);
+
+    /* Plain MQTT CONNECT: stopped at first header, records after it not followed */
+    const unsigned char connect[] = { 0x10, 0x1A, 0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0x02 };
+    HOST_CHECK_EQ(tls_record_tap_feed(&tap, TLS_RECORD_TAP_SENT, connect, sizeof(connect)), 0);
+
+    Bytes records;
+    append_record(&records, 22, 10);
+    append_record(&records, 23, 10);
+    HOST_CHECK_EQ(tls_record_tap_feed(&tap, TLS_RECORD_TAP_SENT, records.data(), records.size()), 0);
+
+    /* Length past largest TLS record */
+    tls_record_tap_reset(&tap);
+    const unsigned char too_long[] = { 22, 3, 3, 0x48, 0x01 };
+    HOST_CHECK_EQ(tls_record_tap_feed(&tap, TLS_RECORD_TAP_SENT, too_long, sizeof(too_long)), 0);
+
+    /* Reset for new connection follows again */
+    tls_record_tap_reset(&tap);
+    HOST_CHECK_EQ(tls_record_tap_feed(&tap, TLS_RECORD_TAP_SENT, records.data(), records.size()),
+                  TLS_RECORD_TAP_HANDSHAKE_BEGIN | TLS_RECORD_TAP_FIRST_DATA_SENT);
+}
+
+int main()
+{
+    test_milestones();
+    test_not_tls();
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,256 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* URL encoder and UTF-8 checker of copied/c-utility against the upstream per-byte algorithms,
+ * on fixed cases and on random input: identical output, exact encoded length, caller buffer
+ * bounds, and decode of encoded 7-bit ASCII giving the input back
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "azure_c_shared_utility/strings.h"
+#include "azure_c_shared_utility/urlencode.h"
+#include "azure_c_shared_utility/utf8_checker.h"
+
+#include "host_test.h"
+
+/* Upstream c-utility URL_PrintableChar(), one byte at a time */
+static std::string reference_url_encode(const std::string &text)
+{
+    static const char hex[] = "0123456789abcdef";
+    std::string result;
+
+    for (unsigned char c : text) {
+        if (c == '!' || c == '(' || c == ')' || c == '*' || c == '-' || c == '.' || c == '_' ||
+                (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+            result += (char) c;
+            continue;
+        }
+
+        unsigned char bigNibble = c >> 4;
+        unsigned char littleNibble = c & 0x0F;
+        if (bigNibble >= 0x0C) {
+            bigNibble -= 0x04;
+        }
+        result += '%';
+        if (c < 0x80) {
+            result += hex[bigNibble];
+            result += hex[littleNibble];
+        } else {
+            result += 'c';
+            result += (c < 0xC0) ? '2' : '3';
+            result += '%';
+            result += hex[bigNibble];
+            result += hex[littleNibble];
+        }
+    }
+
+    return result;
+}
+
+/* Upstream c-utility utf8_checker_is_valid_utf8(), one code point at a time */
+static bool reference_is_valid_utf8(const unsigned char *s, size_t length)
+{
+    size_t pos = 0;
+
+    if (s == NULL) {
+        return false;
+    }
+
+    while (pos < length) {
+        unsigned char lead = s[pos];
+        size_t extra;
+        uint32_t code_point;
+        uint32_t min;
+
+        if ((lead >> 3) == 0x1E) {
+            extra = 3;
+            code_point = lead & 0x07;
+            min = 0x10000;
+        } else if ((lead >> 4) == 0x0E) {
+            extra = 2;
+            code_point = lead & 0x0F;
+            min = 0x800;
+        } else if ((lead >> 5) == 0x06) {
+            extra = 1;
+            code_point = lead & 0x1F;
+            min = 0x80;
+        } else if ((lead >> 7) == 0x00) {
+            pos++;
+            continue;
+        } else {
+            return false;
+        }
+
+        pos++;
+        for (size_t i = 0; i < extra; i++, pos++) {
+            if (pos >= length || (s[pos] >> 6) != 0x02) {
+                return false;
+            }
+            code_point = (code_point << 6) + (s[pos] & 0x3F);
+        }
+        if (code_point < min) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/* xorshift32: reproducible input across runs */
+static uint32_t s_random = 2463534242UL;
+
+static uint32_t next_random(void)
+{
+    s_random ^= s_random << 13;
+    s_random ^= s_random >> 17;
+    s_random ^= s_random << 5;
+    return s_random;
+}
+
+/* Property bag and SAS scope shaped: mostly unreserved with some reserved and non-ASCII */
+static std::string random_text(void)
+{
+    static const char unreserved[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-._";
+    static const char reserved[] = " $&+,/:;=?@#%\"<>[]\\^`{|}~'";
+    std::string text;
+    size_t length = next_random() % 200;
+
+    for (size_t i = 0; i < length; i++) {
+        uint32_t pick = next_random() % 16;
+        if (pick < 11) {
+            text += unreserved[next_random() % (sizeof(unreserved) - 1)];
+        } else if (pick < 14) {
+            text += reserved[next_random() % (sizeof(reserved) - 1)];
+        } else {
+            text += (char) (1 + next_random() % 255);
+        }
+    }
+
+    return text;
+}
+
+/* Mostly ASCII runs, valid multi-byte sequences, and the odd random byte */
+static std::vector<unsigned char> random_utf8(void)
+{
+    std::vector<unsigned char> text;
+    size_t parts = next_random() % 16;
+
+    for (size_t part = 0; part < parts; part++) {
+        uint32_t pick = next_random() % 8;
+        if (pick < 4) {
+            size_t run = next_random() % 24;
+            for (size_t i = 0; i < run; i++) {
+                text.push_back((unsigned char) (0x20 + next_random() % 0x5F));
+            }
+        } else if (pick == 4) {
+            text.push_back((unsigned char) (0xC2 + next_random() % 0x1E));
+            text.push_back((unsigned char) (0x80 + next_random() % 0x40));
+        } else if (pick == 5) {
+            text.push_back((unsigned char) (0xE0 + next_random() % 0x10));
+            text.push_back((unsigned char) (0x80 + next_random() % 0x40));
+            text.push_back((unsigned char) (0x80 + next_random() % 0x40));
+        } else if (pick == 6) {
+            text.push_back((unsigned char) (0xF0 + next_random() % 0x08));
+            text.push_back((unsigned char) (0x80 + next_random() % 0x40));
+            text.push_back((unsigned char) (0x80 + next_random() % 0x40));
+            text.push_back((unsigned char) (0x80 + next_random() % 0x40));
+        } else {
+            text.push_back((unsigned char) next_random());
+        }
+    }
+
+    return text;
+}
+
+static void check_encode(const std::string &text)
+{
+    std::string expected = reference_url_encode(text);
+
+    STRING_HANDLE encoded = URL_EncodeString(text.c_str());
+    HOST_CHECK(encoded != NULL && expected == STRING_c_str(encoded));
+    STRING_delete(encoded);
+
+    STRING_HANDLE input = STRING_construct(text.c_str());
+    encoded = URL_Encode(input);
+    HOST_CHECK(encoded != NULL && expected == STRING_c_str(encoded));
+    STRING_delete(encoded);
+    STRING_delete(input);
+
+    /* Exact length: fits with terminator, one byte less doesn't */
+    size_t length = URL_EncodedLength(text.c_str(), text.size());
+    HOST_CHECK_EQ(length, expected.size());
+    std::vector<char> buffer(length + 1, 'X');
+    HOST_CHECK_EQ(URL_EncodeToBuffer(text.c_str(), text.size(), buffer.data(), buffer.size()), 0);
+    HOST_CHECK(expected == buffer.data());
+    HOST_CHECK(URL_EncodeToBuffer(text.c_str(), text.size(), buffer.data(), length) != 0);
+
+    /* Decoder takes back 7-bit ASCII only */
+    bool ascii = true;
+    for (unsigned char c : text) {
+        ascii = ascii && c < 0x80;
+    }
+    if (ascii) {
+        STRING_HANDLE decoded = URL_DecodeString(expected.c_str());
+        HOST_CHECK(decoded != NULL && text == STRING_c_str(decoded));
+        STRING_delete(decoded);
+    }
+}
+
+static void check_utf8(const unsigned char *text, size_t length)
+{
+    HOST_CHECK_EQ(utf8_checker_is_valid_utf8(text, length), reference_is_valid_utf8(text, length));
+}
+
+int main()
+{
+    /* Fixed cases */
+    check_encode("");
+    check_encode("temperature");
+    check_encode("$.ct=application%2Fjson&$.ce=utf-8");
+    check_encode("contoso.azure-devices.net/devices/device-01");
+    check_encode("a b+c/d?e=f&g#h");
+    check_encode("!()*-._~'");
+    check_encode("\x01\x7f\x80\xbf\xc0\xff");
+    check_encode("caf\xe9 \xa9 2022");
+
+    HOST_CHECK(URL_EncodeString(NULL) == NULL);
+    HOST_CHECK(URL_Encode(NULL) == NULL);
+    HOST_CHECK(URL_EncodeToBuffer(NULL, 0, NULL, 0) != 0);
+
+    static const char *utf8_cases[] = {
+        "",
+        "plain ASCII, longer than one word",
+        "caf\xc3\xa9",
+        "\xe2\x82\xac 100",
+        "\xf0\x9f\x98\x80 emoji",
+        "\xc0\xaf overlong",
+        "\xe0\x80\xaf overlong",
+        "\xf0\x80\x80\xaf overlong",
+        "truncated \xe2\x82",
+        "lone continuation \x80",
+        "\xff invalid lead",
+    };
+    for (const char *text : utf8_cases) {
+        check_utf8((const unsigned char *) text, strlen(text));
+    }
+    HOST_CHECK(!utf8_checker_is_valid_utf8(NULL, 0));
+
+    /* Random input */
+    for (int i = 0; i < 20000; i++) {
+        check_encode(random_text());
+
+        std::vector<unsigned char> text = random_utf8();
+        check_utf8(text.data(), text.size());
+        /* Misaligned start and every cut, for the word-at-a-time skip */
+        if (!text.empty()) {
+            check_utf8(text.data() + 1, text.size() - 1);
+            check_utf8(text.data(), next_random() % text.size());
+        }
+    }
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* VECTOR (copied/c-utility/vector.c): geometric growth, reserve/emplace/shrink, content kept across growth */
+
+#include <stdint.h>
+
+#include "azure_c_shared_utility/vector.h"
+
+#include "host_test.h"
+
+int main()
+{
+    VECTOR_HANDLE vector = VECTOR_create(sizeof(uint32_t));
+    HOST_CHECK(vector != NULL);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 0);
+
+    /* First push allocates minimum capacity, then capacity doubles */
+    uint32_t capacity_changes = 0;
+    size_t last_capacity = 0;
+    for (uint32_t i = 0; i < 1000; i ++) {
+        HOST_CHECK_EQ(VECTOR_push_back(vector, &i, 1), 0);
+        size_t capacity = VECTOR_capacity(vector);
+        if (capacity != last_capacity) {
+            HOST_CHECK(last_capacity == 0 ? capacity == 4 : capacity == last_capacity * 2);
+            last_capacity = capacity;
+            capacity_changes ++;
+        }
+    }
+    HOST_CHECK_EQ(VECTOR_size(vector), 1000);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 1024);
+    /* 4, 8, ..., 1024 */
+    HOST_CHECK_EQ(capacity_changes, 9);
+    for (uint32_t i = 0; i < 1000; i ++) {
+        HOST_CHECK_EQ(*(uint32_t *) VECTOR_element(vector, i), i);
+    }
+
+    /* Push of many elements at once grows to fit them in one go */
+    uint32_t many[2000] = { 0 };
+    HOST_CHECK_EQ(VECTOR_push_back(vector, many, 2000), 0);
+    HOST_CHECK_EQ(VECTOR_size(vector), 3000);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 4096);
+
+    /* Erase keeps capacity for following pushes, shrink_to_fit releases it */
+    VECTOR_erase(vector, VECTOR_element(vector, 1000), 2000);
+    HOST_CHECK_EQ(VECTOR_size(vector), 1000);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 4096);
+    HOST_CHECK_EQ(*(uint32_t *) VECTOR_back(vector), 999);
+    HOST_CHECK_EQ(VECTOR_shrink_to_fit(vector), 0);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 1000);
+    HOST_CHECK_EQ(*(uint32_t *) VECTOR_element(vector, 500), 500);
+
+    /* Erasing everything frees storage */
+    VECTOR_erase(vector, VECTOR_front(vector), VECTOR_size(vector));
+    HOST_CHECK_EQ(VECTOR_size(vector), 0);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 0);
+
+    /* Reserve allocates exactly, pushes within it don't grow */
+    HOST_CHECK_EQ(VECTOR_reserve(vector, 10), 0);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 10);
+    HOST_CHECK_EQ(VECTOR_reserve(vector, 5), 0);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 10);
+
+    /* Emplace appends uninitialized elements in place */
+    uint32_t *emplaced = (uint32_t *) VECTOR_emplace_back(vector, 10);
+    HOST_CHECK(emplaced != NULL);
+    for (uint32_t i = 0; i < 10; i ++) {
+        emplaced[i] = 100 + i;
+    }
+    HOST_CHECK_EQ(VECTOR_size(vector), 10);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 10);
+    HOST_CHECK_EQ(*(uint32_t *) VECTOR_element(vector, 9), 109);
+    HOST_CHECK(VECTOR_emplace_back(vector, 0) == NULL);
+
+    /* Move takes storage and capacity along */
+    VECTOR_HANDLE moved = VECTOR_move(vector);
+    HOST_CHECK(moved != NULL);
+    HOST_CHECK_EQ(VECTOR_size(moved), 10);
+    HOST_CHECK_EQ(VECTOR_capacity(moved), 10);
+    HOST_CHECK_EQ(VECTOR_size(vector), 0);
+    HOST_CHECK_EQ(VECTOR_capacity(vector), 0);
+
+    VECTOR_destroy(moved);
+    VECTOR_destroy(vector);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,191 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Workflow cancellation token: scope over the workflow tree, subscribers, tables sized by
+ * configuration, and latency from cancel request to abort of an HTTP download in flight
+ *
+ * Built with its own configuration, see host/CMakeLists.txt:
+ * workflow-cancellation-tokens 3, workflow-cancellation-subscribers 2
+ *
+ * With --overflow-tokens or --overflow-subscribers, fills that table past its size, which must
+ * be fatal. ctest expects these runs to fail.
+ */
+
+#include "mbed.h"
+#include "aduc/workflow_utils.h"
+#include "http_request.h"
+#include "mbed_workflow_cancellation.h"
+#include "standin_servers.h"
+
+#include "host_test.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+NetworkInterface *_defaultSystemNetwork;
+
+/* Workflow tree stand-in: root with two children, one of them with a grandchild */
+struct TestWorkflow {
+    TestWorkflow *parent;
+};
+
+static TestWorkflow s_root = { NULL };
+static TestWorkflow s_child0 = { &s_root };
+static TestWorkflow s_child1 = { &s_root };
+static TestWorkflow s_grandchild = { &s_child0 };
+
+ADUC_WorkflowHandle workflow_get_parent(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->parent;
+}
+
+static void CountCallback(void *context)
+{
+    (*static_cast<int *>(context)) ++;
+}
+
+static void AbortOnCancel(void *context)
+{
+    static_cast<HttpRequestBase *>(context)->abort();
+}
+
+static void test_scope_and_subscribers(void)
+{
+    int calls0 = 0;
+    int calls1 = 0;
+
+    HOST_CHECK(ADUC_WorkflowCancellation_Subscribe(&s_grandchild, CountCallback, &calls0));
+    HOST_CHECK(ADUC_WorkflowCancellation_Subscribe(&s_child1, CountCallback, &calls1));
+
+    /* Cancel applies to the workflow and its descendants, not to its parent or siblings */
+    HOST_CHECK(ADUC_WorkflowCancellation_Request(&s_child0));
+    HOST_CHECK(ADUC_WorkflowCancellation_IsRequested(&s_child0));
+    HOST_CHECK(ADUC_WorkflowCancellation_IsRequested(&s_grandchild));
+    HOST_CHECK(!ADUC_WorkflowCancellation_IsRequested(&s_root));
+    HOST_CHECK(!ADUC_WorkflowCancellation_IsRequested(&s_child1));
+    HOST_CHECK_EQ(calls0, 1);
+    HOST_CHECK_EQ(calls1, 0);
+
+    /* Repeated request doesn't notify again */
+    HOST_CHECK(ADUC_WorkflowCancellation_Request(&s_child0));
+    HOST_CHECK_EQ(calls0, 1);
+
+    ADUC_WorkflowCancellation_Unsubscribe(CountCallback, &calls0);
+    ADUC_WorkflowCancellation_Unsubscribe(CountCallback, &calls1);
+
+    /* Subscribing after the request is notified right away */
+    HOST_CHECK(ADUC_WorkflowCancellation_Subscribe(&s_grandchild, CountCallback, &calls0));
+    HOST_CHECK_EQ(calls0, 2);
+    ADUC_WorkflowCancellation_Unsubscribe(CountCallback, &calls0);
+
+    /* Cancel of root covers the whole tree */
+    HOST_CHECK(ADUC_WorkflowCancellation_Request(&s_root));
+    HOST_CHECK(ADUC_WorkflowCancellation_IsRequested(&s_child1));
+
+    ADUC_WorkflowCancellation_Reset(&s_root);
+    ADUC_WorkflowCancellation_Reset(&s_child0);
+    HOST_CHECK(!ADUC_WorkflowCancellation_IsRequested(&s_grandchild));
+    HOST_CHECK(!ADUC_WorkflowCancellation_IsRequested(&s_child1));
+}
+
+/* Milliseconds from cancel request to HttpRequest::send() returning, or -1 on failure */
+static long long measure_cancel_to_abort_ms(void)
+{
+    /* One chunk a second: abort must not wait for the next chunk, nor for the socket timeout */
+    std::vector<uint8_t> image(64 * 1024, 0x5A);
+    HttpStandIn server(image, 4096, 4096);
+    if (!server.start()) {
+        return -1;
+    }
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%u/image.bin", server.port());
+
+    std::atomic<size_t> received(0);
+    steady_clock::time_point returned;
+    HttpResponse *response = NULL;
+
+    HttpRequest request(_defaultSystemNetwork, HTTP_GET, url, [&](const char *at, uint32_t length) {
+        (void) at;
+        received += length;
+    });
+    request.set_timeout(5000);
+
+    HOST_CHECK(ADUC_WorkflowCancellation_Subscribe(&s_child1, AbortOnCancel, &request));
+    std::thread worker([&]() {
+        response = request.send();
+        returned = steady_clock::now();
+    });
+
+    /* Cancel while the transfer is blocked between chunks */
+    while (received == 0) {
+        std::this_thread::sleep_for(milliseconds(1));
+    }
+    std::this_thread::sleep_for(milliseconds(100));
+
+    steady_clock::time_point requested = steady_clock::now();
+    HOST_CHECK(ADUC_WorkflowCancellation_Request(&s_root));
+
+    worker.join();
+    ADUC_WorkflowCancellation_Unsubscribe(AbortOnCancel, &request);
+    ADUC_WorkflowCancellation_Reset(&s_root);
+    server.stop();
+
+    /* Aborted, not completed */
+    HOST_CHECK(response == NULL || !response->is_message_complete());
+    HOST_CHECK(received < image.size());
+
+    return duration_cast<milliseconds>(returned - requested).count();
+}
+
+static void fill_tokens(void)
+{
+    std::vector<TestWorkflow> workflows(MBED_CONF_AZURE_CLIENT_OTA_WORKFLOW_CANCELLATION_TOKENS + 1, TestWorkflow { NULL });
+    for (TestWorkflow &workflow : workflows) {
+        ADUC_WorkflowCancellation_Request(&workflow);
+    }
+}
+
+static void fill_subscribers(void)
+{
+    int calls[MBED_CONF_AZURE_CLIENT_OTA_WORKFLOW_CANCELLATION_SUBSCRIBERS + 1];
+    for (int &context : calls) {
+        ADUC_WorkflowCancellation_Subscribe(&s_root, CountCallback, &context);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--overflow-tokens") == 0) {
+        fill_tokens();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--overflow-subscribers") == 0) {
+        fill_subscribers();
+        return 0;
+    }
+
+    _defaultSystemNetwork = NetworkInterface::get_default_instance();
+
+    test_scope_and_subscribers();
+
+    /* Up to the configured sizes */
+    TestWorkflow workflows[MBED_CONF_AZURE_CLIENT_OTA_WORKFLOW_CANCELLATION_TOKENS] = {};
+    for (TestWorkflow &workflow : workflows) {
+        HOST_CHECK(ADUC_WorkflowCancellation_Request(&workflow));
+    }
+    for (TestWorkflow &workflow : workflows) {
+        ADUC_WorkflowCancellation_Reset(&workflow);
+    }
+
+    long long latency_ms = measure_cancel_to_abort_ms();
+    printf("Cancel to abort latency: %lld ms\n", latency_ms);
+    HOST_CHECK(latency_ms >= 0);
+    HOST_CHECK(latency_ms < 200);
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,254 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Workflow persistence across reset: the agent is killed after each step of a deployment, and
+ * a new process must resume from what the killed one got into storage. Also, writes only at
+ * phase boundaries, and RAM copy kept in step with storage when a write fails.
+ *
+ * Each run of the agent is a forked process, so that nothing survives in RAM between runs.
+ */
+
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "mbed.h"
+#include "mbed_stub.h"
+#include "aduc/workflow_utils.h"
+#include "kvstore_global_api/kvstore_global_api.h"
+#include "mbed_workflow_persistence.h"
+
+#include "host_test.h"
+
+/* Root workflow stand-in */
+struct TestWorkflow {
+    const char *id;
+    const char *retry;
+    ADUCITF_WorkflowStep step;
+};
+
+ADUC_WorkflowHandle workflow_get_root(ADUC_WorkflowHandle handle)
+{
+    return handle;
+}
+
+const char *workflow_peek_id(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->id;
+}
+
+const char *workflow_peek_retryTimestamp(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->retry;
+}
+
+ADUCITF_WorkflowStep workflow_get_current_workflowstep(ADUC_WorkflowHandle handle)
+{
+    return static_cast<TestWorkflow *>(handle)->step;
+}
+
+static TestWorkflow s_workflow = { "wf-1", "retry-1", ADUCITF_WorkflowStep_Undefined };
+
+/* Image of 1000 bytes, settled part digest */
+static const uint8_t s_digest[ADUC_PERSISTED_PREFIX_DIGEST_SIZE] = { 0xA5, 0x5A };
+
+/* What a new process must resume from, after the agent is killed past a step */
+struct Expected {
+    bool phase;
+    ADUCITF_WorkflowStep step;
+    ADUCITF_State state;
+    uint32_t downloadOffset;
+};
+
+/* Deployment steps the agent records, in order. Not-boundary states are among them. */
+static void agent_step(int index)
+{
+    switch (index) {
+        case 0:
+            s_workflow.step = ADUCITF_WorkflowStep_ProcessDeployment;
+            HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_DeploymentInProgress));
+            break;
+        case 1:
+            s_workflow.step = ADUCITF_WorkflowStep_Download;
+            HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_DownloadStarted));
+            break;
+        case 2:
+            HOST_CHECK(ADUC_WorkflowPersistence_SaveDownloadCheckpoint(&s_workflow, 0, 1000, 400, s_digest));
+            break;
+        case 3:
+            HOST_CHECK(ADUC_WorkflowPersistence_SaveDownloadOffset(&s_workflow, 1000, NULL));
+            break;
+        case 4:
+            HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_DownloadSucceeded));
+            break;
+        case 5:
+            s_workflow.step = ADUCITF_WorkflowStep_Backup;
+            HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_BackupStarted));
+            HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_BackupSucceeded));
+            break;
+        case 6:
+            s_workflow.step = ADUCITF_WorkflowStep_Install;
+            HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_InstallStarted));
+            HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_InstallSucceeded));
+            break;
+    }
+}
+
+#define AGENT_STEP_COUNT    7
+
+static const Expected s_expected[AGENT_STEP_COUNT] = {
+    { true, ADUCITF_WorkflowStep_ProcessDeployment, ADUCITF_State_DeploymentInProgress, 0 },
+    { true, ADUCITF_WorkflowStep_ProcessDeployment, ADUCITF_State_DeploymentInProgress, 0 },
+    { true, ADUCITF_WorkflowStep_ProcessDeployment, ADUCITF_State_DeploymentInProgress, 400 },
+    { true, ADUCITF_WorkflowStep_ProcessDeployment, ADUCITF_State_DeploymentInProgress, 1000 },
+    { true, ADUCITF_WorkflowStep_Download, ADUCITF_State_DownloadSucceeded, 1000 },
+    { true, ADUCITF_WorkflowStep_Backup, ADUCITF_State_BackupSucceeded, 1000 },
+    { true, ADUCITF_WorkflowStep_Install, ADUCITF_State_InstallSucceeded, 1000 },
+};
+
+/* Run @p fn in a new process, as after reset. Its exit code: HOST_TEST_RESULT() */
+template <typename F>
+static int in_new_process(F fn)
+{
+    fflush(NULL);
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        _exit(HOST_TEST_RESULT());
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (WIFSIGNALED(status)) {
+        return WTERMSIG(status) == SIGKILL ? 0 : 1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+/* Agent startup, then killed right after step @p last, as on watchdog reset */
+static int run_agent_killed_after(int last)
+{
+    return in_new_process([last] {
+        ADUC_WorkflowPersistence_Load();
+        for (int index = 0; index <= last; index ++) {
+            agent_step(index);
+        }
+        if (HOST_TEST_RESULT() == 0) {
+            kill(getpid(), SIGKILL);
+        }
+    });
+}
+
+/* Agent startup after reset: what it resumes from */
+static int check_resume(const Expected &expected)
+{
+    return in_new_process([&expected] {
+        HOST_CHECK(ADUC_WorkflowPersistence_Load());
+        HOST_CHECK(ADUC_WorkflowPersistence_IsSameDeployment(&s_workflow));
+
+        ADUCITF_WorkflowStep step = ADUCITF_WorkflowStep_Undefined;
+        ADUCITF_State state = ADUCITF_State_Idle;
+        HOST_CHECK_EQ(ADUC_WorkflowPersistence_TakeStartupPhase(&s_workflow, &step, &state), expected.phase);
+        HOST_CHECK_EQ(step, expected.step);
+        HOST_CHECK_EQ(state, expected.state);
+
+        /* Given out once */
+        HOST_CHECK(!ADUC_WorkflowPersistence_TakeStartupPhase(&s_workflow, &step, &state));
+
+        uint32_t downloadOffset = 0;
+        uint8_t digest[ADUC_PERSISTED_PREFIX_DIGEST_SIZE];
+        HOST_CHECK(ADUC_WorkflowPersistence_GetDownloadOffset(&s_workflow, &downloadOffset, digest));
+        HOST_CHECK_EQ(downloadOffset, expected.downloadOffset);
+        if (expected.downloadOffset == 400) {
+            HOST_CHECK(memcmp(digest, s_digest, sizeof(digest)) == 0);
+        }
+
+        /* Another deployment, or retry of it, doesn't resume */
+        TestWorkflow retry = { "wf-1", "retry-2", ADUCITF_WorkflowStep_ProcessDeployment };
+        HOST_CHECK(!ADUC_WorkflowPersistence_IsSameDeployment(&retry));
+        HOST_CHECK(!ADUC_WorkflowPersistence_GetDownloadOffset(&retry, &downloadOffset, NULL));
+    });
+}
+
+static void test_kill_and_resume(void)
+{
+    for (int last = 0; last < AGENT_STEP_COUNT; last ++) {
+        kv_reset("/kv/");
+        HOST_CHECK_EQ(run_agent_killed_after(last), 0);
+        HOST_CHECK_EQ(check_resume(s_expected[last]), 0);
+    }
+}
+
+/* kv_set() calls made by @p fn */
+template <typename F>
+static uint32_t kv_writes(F fn)
+{
+    uint32_t count = mbed_stub_kv_set_count();
+    fn();
+    return mbed_stub_kv_set_count() - count;
+}
+
+static void test_writes(void)
+{
+    kv_reset("/kv/");
+    HOST_CHECK_EQ(in_new_process([] {
+        ADUC_WorkflowPersistence_Load();
+        s_workflow.step = ADUCITF_WorkflowStep_Download;
+
+        /* Phase boundary once, states inside a step never */
+        HOST_CHECK_EQ(kv_writes([] { ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_DownloadStarted); }), 0);
+        HOST_CHECK_EQ(kv_writes([] { ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_DownloadSucceeded); }), 1);
+        HOST_CHECK_EQ(kv_writes([] { ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_DownloadSucceeded); }), 0);
+        HOST_CHECK_EQ(kv_writes([] { ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_ApplyStarted); }), 0);
+
+        /* Failed deployment is redone from start, not resumed */
+        HOST_CHECK_EQ(kv_writes([] { ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_Failed); }), 1);
+    }), 0);
+}
+
+static void test_failed_write(void)
+{
+    kv_reset("/kv/");
+    HOST_CHECK_EQ(in_new_process([] {
+        ADUC_WorkflowPersistence_Load();
+        s_workflow.step = ADUCITF_WorkflowStep_Download;
+        HOST_CHECK(ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_DownloadSucceeded));
+        HOST_CHECK(ADUC_WorkflowPersistence_SaveDownloadOffset(&s_workflow, 1000, NULL));
+
+        /* Failed writes leave RAM copy as in storage */
+        mbed_stub_kv_fail_sets(2);
+        s_workflow.step = ADUCITF_WorkflowStep_Install;
+        HOST_CHECK(!ADUC_WorkflowPersistence_SavePhase(&s_workflow, ADUCITF_State_InstallSucceeded));
+        HOST_CHECK(!ADUC_WorkflowPersistence_SaveDownloadOffset(&s_workflow, 0, NULL));
+
+        uint32_t downloadOffset = 0;
+        HOST_CHECK(ADUC_WorkflowPersistence_GetDownloadOffset(&s_workflow, &downloadOffset, NULL));
+        HOST_CHECK_EQ(downloadOffset, 1000);
+
+        /* Retried write goes through, not suppressed as unchanged */
+        HOST_CHECK_EQ(kv_writes([] {
+            HOST_CHECK(ADUC_WorkflowPersistence_SaveDownloadOffset(&s_workflow, 0, NULL));
+        }), 1);
+        HOST_CHECK_EQ(kv_writes([] {
+            HOST_CHECK(ADUC_WorkflowPersistence_SaveDownloadOffset(&s_workflow, 1000, NULL));
+        }), 1);
+        if (HOST_TEST_RESULT() == 0) {
+            kill(getpid(), SIGKILL);
+        }
+    }), 0);
+
+    Expected expected = { true, ADUCITF_WorkflowStep_Download, ADUCITF_State_DownloadSucceeded, 1000 };
+    HOST_CHECK_EQ(check_resume(expected), 0);
+}
+
+int main()
+{
+    mbed_stub_kv_set_dir("test_workflow_persistence.kv");
+
+    test_kill_and_resume();
+    test_writes();
+    test_failed_write();
+
+    return HOST_TEST_RESULT();
+}
@@ -0,0 +1,388 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* Table-driven workflow transitions against the upstream if/else chains they replace: same decision
+ * for every combination of hot fields, and same reported states on replay of recorded deployments.
+ * Replay also measures CPU time per transition of both.
+ *
+ * agent_workflow.cpp needs the ADU agent sources, so replay drives a stand-in of its dispatch:
+ * update actions as ADUC_Workflow_HandlePropertyUpdate and ADUC_Workflow_HandleUpdateAction take them,
+ * step completions as ADUC_Workflow_WorkCompletionCallback and ADUC_Workflow_AutoTransitionWorkflow do.
+ * Upstream decisions are transcribed from iot-hub-device-update agent_workflow.c.
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+
+#include "mbed_workflow_transition.h"
+
+#include "host_test.h"
+
+/* Upstream workflowHandlerMap, transitions only */
+struct UpstreamMapEntry {
+    ADUCITF_WorkflowStep WorkflowStep;
+    ADUCITF_State NextStateOnSuccess;
+    ADUCITF_WorkflowStep AutoTransitionWorkflowStepOnSuccess;
+    ADUCITF_State NextStateOnFailure;
+    ADUCITF_WorkflowStep AutoTransitionWorkflowStepOnFailure;
+};
+
+static const UpstreamMapEntry s_upstreamMap[] = {
+    { ADUCITF_WorkflowStep_ProcessDeployment, ADUCITF_State_DeploymentInProgress, ADUCITF_WorkflowStep_Download, ADUCITF_State_Failed, ADUCITF_WorkflowStep_Undefined },
+    { ADUCITF_WorkflowStep_Download, ADUCITF_State_DownloadSucceeded, ADUCITF_WorkflowStep_Backup, ADUCITF_State_Failed, ADUCITF_WorkflowStep_Undefined },
+    { ADUCITF_WorkflowStep_Backup, ADUCITF_State_BackupSucceeded, ADUCITF_WorkflowStep_Install, ADUCITF_State_Failed, ADUCITF_WorkflowStep_Undefined },
+    { ADUCITF_WorkflowStep_Install, ADUCITF_State_InstallSucceeded, ADUCITF_WorkflowStep_Apply, ADUCITF_State_Failed, ADUCITF_WorkflowStep_Restore },
+    { ADUCITF_WorkflowStep_Apply, ADUCITF_State_Idle, ADUCITF_WorkflowStep_Undefined, ADUCITF_State_Failed, ADUCITF_WorkflowStep_Restore },
+    { ADUCITF_WorkflowStep_Restore, ADUCITF_State_Idle, ADUCITF_WorkflowStep_Undefined, ADUCITF_State_Failed, ADUCITF_WorkflowStep_Undefined },
+};
+
+static const UpstreamMapEntry *upstream_entry(ADUCITF_WorkflowStep workflowStep)
+{
+    for (const UpstreamMapEntry &entry : s_upstreamMap) {
+        if (entry.WorkflowStep == workflowStep) {
+            return &entry;
+        }
+    }
+    return NULL;
+}
+
+/* ADUC_Workflow_HandleUpdateAction */
+static ADUC_WorkflowUpdateDecision upstream_on_update_action(const ADUC_WorkflowTransitionFields *fields)
+{
+    bool isReplaceOrRetry = (fields->CancellationType == ADUC_WorkflowCancellationType_Replacement)
+        || (fields->CancellationType == ADUC_WorkflowCancellationType_Retry);
+
+    if (fields->Action == ADUCITF_UpdateAction_Cancel || fields->CancellationType == ADUC_WorkflowCancellationType_Normal
+        || ((fields->Action == ADUCITF_UpdateAction_ProcessDeployment) && isReplaceOrRetry)) {
+        if (fields->OperationInProgress) {
+            return ADUC_WorkflowUpdateDecision_CancelOperation;
+        } else if (fields->Action == ADUCITF_UpdateAction_Cancel || fields->CancellationType == ADUC_WorkflowCancellationType_Normal) {
+            return ADUC_WorkflowUpdateDecision_ReturnToIdle;
+        } else {
+            return ADUC_WorkflowUpdateDecision_ClearAndProcess;
+        }
+    }
+    return ADUC_WorkflowUpdateDecision_Process;
+}
+
+/* ADUC_Workflow_AutoTransitionWorkflow */
+static ADUC_WorkflowCompletion upstream_get_next(ADUCITF_WorkflowStep workflowStep, bool succeeded)
+{
+    const UpstreamMapEntry *entry = upstream_entry(workflowStep);
+    if (entry == NULL) {
+        return { ADUC_WorkflowCompletion_Invalid, ADUCITF_State_None, ADUCITF_WorkflowStep_Undefined };
+    }
+    if (succeeded) {
+        return { ADUC_WorkflowCompletion_NextStep, entry->NextStateOnSuccess, entry->AutoTransitionWorkflowStepOnSuccess };
+    }
+    return { ADUC_WorkflowCompletion_NextStep, entry->NextStateOnFailure, entry->AutoTransitionWorkflowStepOnFailure };
+}
+
+/* ADUC_Workflow_WorkCompletionCallback */
+static ADUC_WorkflowCompletion upstream_on_complete(const ADUC_WorkflowTransitionFields *fields, bool succeeded)
+{
+    if (upstream_entry(fields->WorkflowStep) == NULL || succeeded || !fields->OperationCancelRequested) {
+        return upstream_get_next(fields->WorkflowStep, succeeded);
+    }
+
+    if (fields->CancellationType == ADUC_WorkflowCancellationType_Replacement
+        || fields->CancellationType == ADUC_WorkflowCancellationType_Retry
+        || fields->CancellationType == ADUC_WorkflowCancellationType_ComponentChanged) {
+        return { ADUC_WorkflowCompletion_Restart, ADUCITF_State_None, ADUCITF_WorkflowStep_Undefined };
+    }
+    if (fields->CancellationType != ADUC_WorkflowCancellationType_Normal) {
+        return { ADUC_WorkflowCompletion_Invalid, ADUCITF_State_None, ADUCITF_WorkflowStep_Undefined };
+    }
+    return { ADUC_WorkflowCompletion_Cancelled, ADUCITF_State_Idle, ADUCITF_WorkflowStep_Undefined };
+}
+
+static const ADUCITF_UpdateAction s_actions[] = {
+    ADUCITF_UpdateAction_Undefined, ADUCITF_UpdateAction_Download, ADUCITF_UpdateAction_Install,
+    ADUCITF_UpdateAction_Apply, ADUCITF_UpdateAction_ProcessDeployment, ADUCITF_UpdateAction_Cancel,
+};
+
+static const ADUC_WorkflowCancellationType s_cancellationTypes[] = {
+    ADUC_WorkflowCancellationType_None, ADUC_WorkflowCancellationType_Normal, ADUC_WorkflowCancellationType_Replacement,
+    ADUC_WorkflowCancellationType_Retry, ADUC_WorkflowCancellationType_ComponentChanged,
+};
+
+static const ADUCITF_WorkflowStep s_steps[] = {
+    ADUCITF_WorkflowStep_Undefined, ADUCITF_WorkflowStep_ProcessDeployment, ADUCITF_WorkflowStep_Download,
+    ADUCITF_WorkflowStep_Install, ADUCITF_WorkflowStep_Apply, ADUCITF_WorkflowStep_Backup, ADUCITF_WorkflowStep_Restore,
+};
+
+static void test_all_fields(void)
+{
+    for (ADUCITF_UpdateAction action : s_actions) {
+        for (ADUC_WorkflowCancellationType cancellationType : s_cancellationTypes) {
+            for (ADUCITF_WorkflowStep step : s_steps) {
+                for (int flags = 0; flags < 4; flags ++) {
+                    ADUC_WorkflowTransitionFields fields = { action, step, cancellationType, (flags & 1) != 0, (flags & 2) != 0 };
+                    HOST_CHECK_EQ(ADUC_WorkflowTransition_OnUpdateAction(&fields), upstream_on_update_action(&fields));
+
+                    for (bool succeeded : { false, true }) {
+                        ADUC_WorkflowCompletion table = ADUC_WorkflowTransition_OnComplete(&fields, succeeded);
+                        ADUC_WorkflowCompletion upstream = upstream_on_complete(&fields, succeeded);
+                        HOST_CHECK_EQ(table.Kind, upstream.Kind);
+                        if (table.Kind == ADUC_WorkflowCompletion_NextStep || table.Kind == ADUC_WorkflowCompletion_Cancelled) {
+                            HOST_CHECK_EQ(table.NextState, upstream.NextState);
+                            HOST_CHECK_EQ(table.NextStep, upstream.NextStep);
+                        }
+
+                        ADUC_WorkflowCompletion tableNext = ADUC_WorkflowTransition_GetNext(step, succeeded);
+                        ADUC_WorkflowCompletion upstreamNext = upstream_get_next(step, succeeded);
+                        HOST_CHECK_EQ(tableNext.Kind, upstreamNext.Kind);
+                        HOST_CHECK_EQ(tableNext.NextState, upstreamNext.NextState);
+                        HOST_CHECK_EQ(tableNext.NextStep, upstreamNext.NextStep);
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* Decisions the stand-in dispatch is driven by */
+struct Decisions {
+    ADUC_WorkflowUpdateDecision (*OnUpdateAction)(const ADUC_WorkflowTransitionFields *fields);
+    ADUC_WorkflowCompletion (*GetNext)(ADUCITF_WorkflowStep workflowStep, bool succeeded);
+    ADUC_WorkflowCompletion (*OnComplete)(const ADUC_WorkflowTransitionFields *fields, bool succeeded);
+};
+
+static const Decisions s_table = {
+    ADUC_WorkflowTransition_OnUpdateAction, ADUC_WorkflowTransition_GetNext, ADUC_WorkflowTransition_OnComplete
+};
+
+static const Decisions s_upstream = { upstream_on_update_action, upstream_get_next, upstream_on_complete };
+
+/* Recorded deployment: twin update actions from the service, and results of async step operations */
+enum Event {
+    Deploy,     // New deployment
+    Retry,      // Retry of current deployment
+    Replace,    // Replacement of current deployment
+    Cancel,
+    Succeed,    // Operation in progress succeeds
+    Fail,       // Operation in progress fails, or ends on cancel
+};
+
+/* Stand-in of agent_workflow.cpp dispatch, on hot fields alone */
+class Agent {
+public:
+    explicit Agent(const Decisions &decisions) : _decisions(decisions), _active(false), _decisionCount(0)
+    {
+        _fields = { ADUCITF_UpdateAction_Undefined, ADUCITF_WorkflowStep_Undefined, ADUC_WorkflowCancellationType_None, false, false };
+    }
+
+    void replay(const std::vector<Event> &events)
+    {
+        for (Event event : events) {
+            switch (event) {
+                case Deploy:
+                    _active = true;
+                    _fields = { ADUCITF_UpdateAction_ProcessDeployment, ADUCITF_WorkflowStep_Undefined, ADUC_WorkflowCancellationType_None, false, false };
+                    handle_update_action();
+                    break;
+                case Retry:
+                    _fields.CancellationType = ADUC_WorkflowCancellationType_Retry;
+                    handle_update_action();
+                    break;
+                case Replace:
+                    _fields.CancellationType = ADUC_WorkflowCancellationType_Replacement;
+                    handle_update_action();
+                    break;
+                case Cancel:
+                    if (!_active) {
+                        break;
+                    }
+                    // Duplicate cancel ignored
+                    if (_fields.CancellationType == ADUC_WorkflowCancellationType_None) {
+                        _fields.CancellationType = ADUC_WorkflowCancellationType_Normal;
+                        handle_update_action();
+                    }
+                    break;
+                case Succeed:
+                case Fail:
+                    HOST_CHECK(_fields.OperationInProgress);
+                    work_completion(event == Succeed);
+                    break;
+            }
+        }
+    }
+
+    const std::vector<ADUCITF_State> &reports() const
+    {
+        return _reports;
+    }
+
+    unsigned decisionCount() const
+    {
+        return _decisionCount;
+    }
+
+private:
+    void handle_update_action()
+    {
+        _decisionCount ++;
+        switch (_decisions.OnUpdateAction(&_fields)) {
+            case ADUC_WorkflowUpdateDecision_CancelOperation:
+                _fields.OperationCancelRequested = true;
+                return;
+            case ADUC_WorkflowUpdateDecision_ReturnToIdle:
+                _fields.OperationCancelRequested = false;
+                _fields.CancellationType = ADUC_WorkflowCancellationType_None;
+                _active = false;
+                return;
+            case ADUC_WorkflowUpdateDecision_ClearAndProcess:
+                _fields.OperationCancelRequested = false;
+                _fields.CancellationType = ADUC_WorkflowCancellationType_None;
+                break;
+            case ADUC_WorkflowUpdateDecision_Process:
+                break;
+        }
+        _fields.WorkflowStep = ADUCITF_WorkflowStep_ProcessDeployment;
+        transition();
+    }
+
+    /* ProcessDeployment completes synchronously, other steps on a later event */
+    void transition()
+    {
+        _fields.OperationInProgress = true;
+        if (_fields.WorkflowStep == ADUCITF_WorkflowStep_ProcessDeployment) {
+            work_completion(true);
+        }
+    }
+
+    void work_completion(bool succeeded)
+    {
+        _decisionCount ++;
+        ADUC_WorkflowCompletion completion = _decisions.OnComplete(&_fields, succeeded);
+        switch (completion.Kind) {
+            case ADUC_WorkflowCompletion_NextStep:
+                _reports.push_back(completion.NextState);
+                _fields.OperationInProgress = false;
+                if (succeeded) {
+                    _fields.OperationCancelRequested = false;
+                    if (completion.NextState == ADUCITF_State_Idle) {
+                        _active = false;
+                        return;
+                    }
+                }
+                auto_transition(succeeded);
+                break;
+            case ADUC_WorkflowCompletion_Restart:
+                _fields.CancellationType = ADUC_WorkflowCancellationType_None;
+                _fields.OperationCancelRequested = false;
+                _fields.WorkflowStep = ADUCITF_WorkflowStep_ProcessDeployment;
+                transition();
+                break;
+            case ADUC_WorkflowCompletion_Cancelled:
+                _reports.push_back(completion.NextState);
+                _active = false;
+                _fields.OperationInProgress = false;
+                break;
+            case ADUC_WorkflowCompletion_Invalid:
+                HOST_CHECK(false);
+                break;
+        }
+    }
+
+    void auto_transition(bool succeeded)
+    {
+        _decisionCount ++;
+        ADUC_WorkflowCompletion next = _decisions.GetNext(_fields.WorkflowStep, succeeded);
+        if (next.Kind != ADUC_WorkflowCompletion_NextStep || next.NextStep == ADUCITF_WorkflowStep_Undefined) {
+            return;
+        }
+        _fields.WorkflowStep = next.NextStep;
+        transition();
+    }
+
+    const Decisions &_decisions;
+    ADUC_WorkflowTransitionFields _fields;
+    bool _active;
+    std::vector<ADUCITF_State> _reports;
+    unsigned _decisionCount;
+};
+
+struct Recording {
+    const char *name;
+    std::vector<Event> events;
+    std::vector<ADUCITF_State> reports;
+};
+
+static const std::vector<Recording> s_recordings = {
+    { "deployment", { Deploy, Succeed, Succeed, Succeed, Succeed },
+      { ADUCITF_State_DeploymentInProgress, ADUCITF_State_DownloadSucceeded, ADUCITF_State_BackupSucceeded,
+        ADUCITF_State_InstallSucceeded, ADUCITF_State_Idle } },
+    { "download failure, then cancel to idle", { Deploy, Fail, Cancel },
+      { ADUCITF_State_DeploymentInProgress, ADUCITF_State_Failed } },
+    { "install failure, restore", { Deploy, Succeed, Succeed, Fail, Succeed },
+      { ADUCITF_State_DeploymentInProgress, ADUCITF_State_DownloadSucceeded, ADUCITF_State_BackupSucceeded,
+        ADUCITF_State_Failed, ADUCITF_State_Idle } },
+    { "cancel during download, duplicate cancel ignored", { Deploy, Cancel, Cancel, Fail },
+      { ADUCITF_State_DeploymentInProgress, ADUCITF_State_Idle } },
+    { "retry during download", { Deploy, Retry, Fail, Succeed, Succeed, Succeed, Succeed },
+      { ADUCITF_State_DeploymentInProgress, ADUCITF_State_DeploymentInProgress, ADUCITF_State_DownloadSucceeded,
+        ADUCITF_State_BackupSucceeded, ADUCITF_State_InstallSucceeded, ADUCITF_State_Idle } },
+    { "replacement during install", { Deploy, Succeed, Succeed, Replace, Fail, Succeed, Succeed, Succeed, Succeed },
+      { ADUCITF_State_DeploymentInProgress, ADUCITF_State_DownloadSucceeded, ADUCITF_State_BackupSucceeded,
+        ADUCITF_State_DeploymentInProgress, ADUCITF_State_DownloadSucceeded, ADUCITF_State_BackupSucceeded,
+        ADUCITF_State_InstallSucceeded, ADUCITF_State_Idle } },
+    { "retry after failure", { Deploy, Fail, Retry, Succeed, Succeed, Succeed, Fail, Fail },
+      { ADUCITF_State_DeploymentInProgress, ADUCITF_State_Failed, ADUCITF_State_DeploymentInProgress,
+        ADUCITF_State_DownloadSucceeded, ADUCITF_State_BackupSucceeded, ADUCITF_State_InstallSucceeded,
+        ADUCITF_State_Failed, ADUCITF_State_Failed } },
+};
+
+static void test_replay(void)
+{
+    for (const Recording &recording : s_recordings) {
+        Agent table(s_table);
+        table.replay(recording.events);
+        Agent upstream(s_upstream);
+        upstream.replay(recording.events);
+
+        if (table.reports() != recording.reports || upstream.reports() != recording.reports) {
+            printf("Replay of '%s' reported other states\n", recording.name);
+        }
+        HOST_CHECK(table.reports() == recording.reports);
+        HOST_CHECK(upstream.reports() == recording.reports);
+    }
+}
+
+/* CPU time per decision on replay of all recordings, in ns */
+static double replay_ns_per_decision(const Decisions &decisions, int rounds)
+{
+    unsigned decisionCount = 0;
+    timespec start, end;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+    for (int round = 0; round < rounds; round ++) {
+        for (const Recording &recording : s_recordings) {
+            Agent agent(decisions);
+            agent.replay(recording.events);
+            decisionCount += agent.decisionCount();
+        }
+    }
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+
+    double ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+    return ns / decisionCount;
+}
+
+static void bench_replay(void)
+{
+    const int rounds = 20000;
+    double table = replay_ns_per_decision(s_table, rounds);
+    double upstream = replay_ns_per_decision(s_upstream, rounds);
+    printf("Replay CPU time per transition (incl. stand-in dispatch): table %.1f ns, upstream if/else %.1f ns\n",
+           table, upstream);
+}
+
+int main()
+{
+    test_all_fields();
+    test_replay();
+    bench_replay();
+
+    return HOST_TEST_RESULT();
+}
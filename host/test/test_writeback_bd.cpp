@@ -0,0 +1,79 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+/* WriteBackBlockDevice over NOR-like FileBlockDevice: content and program unit reprogram counts */
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "blockdevice/FileBlockDevice.h"
+#include "writeback_bd.h"
+
+#include "host_test.h"
+
+using mbed::FileBlockDevice;
+
+static const mbed::bd_size_t SLOT_SIZE = 64 * 1024;
+static const mbed::bd_size_t PROGRAM_SIZE = 8;
+static const mbed::bd_size_t ERASE_SIZE = 4096;
+
+static std::vector<uint8_t> make_image(size_t size)
+{
+    std::vector<uint8_t> image(size);
+    uint32_t x = 0x12345678;
+    for (size_t i = 0; i < size; i ++) {
+        x = x * 1103515245 + 12345;
+        image[i] = (uint8_t)(x >> 16);
+    }
+    return image;
+}
+
+/* Program image in odd sized chunks as download delivers it, optionally sync()ing after each chunk */
+static void program_image(const std::vector<uint8_t> &image, size_t chunk, bool sync_each, uint32_t *syncs)
+{
+    FileBlockDevice slot("test_writeback_bd.bin", SLOT_SIZE, 1, PROGRAM_SIZE, ERASE_SIZE);
+    WriteBackBlockDevice bd(&slot, 512, 256);
+
+    HOST_CHECK_EQ(bd.init(), BD_ERROR_OK);
+    HOST_CHECK_EQ(bd.erase(0, SLOT_SIZE), BD_ERROR_OK);
+    slot.reset_counters();
+
+    *syncs = 0;
+    for (size_t offset = 0; offset < image.size(); offset += chunk) {
+        size_t todo = (image.size() - offset < chunk) ? image.size() - offset : chunk;
+        HOST_CHECK_EQ(bd.program(&image[offset], offset, todo), BD_ERROR_OK);
+        if (sync_each) {
+            HOST_CHECK_EQ(bd.sync(), BD_ERROR_OK);
+            (*syncs) ++;
+        }
+    }
+    HOST_CHECK_EQ(bd.sync(), BD_ERROR_OK);
+    (*syncs) ++;
+
+    if (sync_each) {
+        /* Only the last partial program unit of a sync may be programmed again */
+        HOST_CHECK(slot.get_reprogram_count() <= *syncs);
+    } else {
+        HOST_CHECK_EQ(slot.get_reprogram_count(), 0);
+    }
+
+    std::vector<uint8_t> readback(image.size());
+    HOST_CHECK_EQ(bd.read(readback.data(), 0, readback.size()), BD_ERROR_OK);
+    HOST_CHECK(memcmp(readback.data(), image.data(), image.size()) == 0);
+
+    HOST_CHECK_EQ(bd.deinit(), BD_ERROR_OK);
+}
+
+int main()
+{
+    std::vector<uint8_t> image = make_image(20000 + 3);
+    uint32_t syncs;
+
+    program_image(image, 1000, false, &syncs);
+    program_image(image, 1000, true, &syncs);
+    program_image(image, 333, true, &syncs);
+    program_image(image, 4096, true, &syncs);
+
+    return HOST_TEST_RESULT();
+}
@@ -42,17 +42,48 @@ protected:
     // Callback for receiving mbed-http response body
     // For small memory device, download and install by chunk
     ADUC_Result CombinedDownloadInstall(const tagADUC_WorkflowData* workflowData,
+                                        int imageIndex,
                                         const char *dl_data,
                                         uint32_t dl_length);
 
+    // Download and install one MCUboot image into its secondary slot
+    // On resume, continue from progress prepared by ResumePartialDownload()
+    ADUC_Result DownloadImage(const tagADUC_WorkflowData* workflowData,
+                              int imageIndex,
+                              size_t settledOffset,
+                              bool resume,
+                              const void* fileEntity_opaque);
+
     // Verify signature
     bool VerifySignature(const tagADUC_WorkflowData* workflowData,
-                         void* fileEntity_opaque);
+                         int imageIndex,
+                         const void* fileEntity_opaque);
+
+    // Pick up payload which has settled in secondary bd before unexpected reset
+    bool ResumeSettledDownload(const tagADUC_WorkflowData* workflowData,
+                               int imageIndex,
+                               size_t settledOffset,
+                               const void* fileEntity_opaque);
+
+    // Pick up part of image which has settled in secondary bd before unexpected reset, verified
+    // against persisted digest
+    bool ResumePartialDownload(const tagADUC_WorkflowData* workflowData,
+                               int imageIndex,
+                               size_t settledOffset,
+                               const void* fileEntity_opaque,
+                               uint8_t* prefixDigest);
+
+    // Persist download progress within image with digest of its downloaded part
+    void CheckpointDownload(const tagADUC_WorkflowData* workflowData, int imageIndex);
+
+    // Internal OTA operation context per image, so that images can download concurrently
+    bool OTACtx_Reinit(int imageIndex, bool eraseSecondary);
+    void OTACtx_Deinit(int imageIndex);
+    void **otaCtx_opaque;
 
-    // Internal OTA operation context
-    bool OTACtx_Reinit(void);
-    void OTACtx_Deinit(void);
-    void *otaCtx_opaque;
+    // Concurrent download of images: transfers in flight, for aborting the rest on first failure,
+    // and worker thread control blocks
+    void *dlGroup_opaque;
 };
 
 #endif // ADUC_MCUBUPDATE_HANDLER_HPP
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2022, Nuvoton Technology Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DOWNLOAD_STALL_MONITOR_H
+#define DOWNLOAD_STALL_MONITOR_H
+
+#include <stdint.h>
+#include <chrono>
+
+#include "rtos/Kernel.h"
+
+/**
+ * @brief Stall detection of HTTP download
+ *
+ * Socket timeout follows the link rather than a fixed worst case: a multiple of the worse of
+ * first-byte latency (round trip plus server turnaround) and smoothed chunk interval, clamped
+ * to configured bounds. Before anything is measured, the upper bound applies.
+ */
+class DownloadStallMonitor
+{
+public:
+    /**
+     * @param min_ms  Lower bound of socket timeout in ms
+     * @param max_ms  Upper bound of socket timeout in ms, also used before link is measured
+     * @param factor  Multiple of observed latency/chunk interval before download is considered stalled
+     */
+    DownloadStallMonitor(uint32_t min_ms, uint32_t max_ms, uint32_t factor) :
+        timeout_min_ms(min_ms),
+        timeout_max_ms(max_ms),
+        timeout_factor(factor),
+        last_chunk_ms(0),
+        first_chunk(true),
+        first_byte_ms(0),
+        chunk_interval_ms(0),
+        rate_bps(0),
+        measured(false)
+    {
+    }
+
+    /* Start of one connection attempt */
+    void on_attempt_start(void)
+    {
+        last_chunk_ms = now_ms();
+        first_chunk = true;
+    }
+
+    /* Body chunk received */
+    void on_chunk(uint32_t length)
+    {
+        uint64_t now = now_ms();
+        uint32_t interval_ms = (uint32_t) (now - last_chunk_ms);
+        last_chunk_ms = now;
+
+        if (first_chunk) {
+            first_chunk = false;
+            first_byte_ms = interval_ms;
+            measured = true;
+            return;
+        }
+
+        /* Exponentially weighted moving average, weight 1/4 to new sample */
+        chunk_interval_ms = (chunk_interval_ms * 3 + interval_ms) / 4;
+        if (interval_ms) {
+            uint32_t bps = (uint32_t) ((uint64_t) length * 1000 / interval_ms);
+            rate_bps = rate_bps ? ((rate_bps * 3 + bps) / 4) : bps;
+        }
+    }
+
+    /* Socket timeout to apply */
+    int timeout_ms(void) const
+    {
+        if (!measured) {
+            return (int) timeout_max_ms;
+        }
+
+        uint64_t base_ms = (first_byte_ms > chunk_interval_ms) ? first_byte_ms : chunk_interval_ms;
+        uint64_t timeout_ms = base_ms * timeout_factor;
+        if (timeout_ms < timeout_min_ms) {
+            timeout_ms = timeout_min_ms;
+        } else if (timeout_ms > timeout_max_ms) {
+            timeout_ms = timeout_max_ms;
+        }
+        return (int) timeout_ms;
+    }
+
+    /* Smoothed throughput in bytes/s */
+    uint32_t rate(void) const
+    {
+        return rate_bps;
+    }
+
+private:
+    static uint64_t now_ms(void)
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(rtos::Kernel::Clock::now().time_since_epoch()).count();
+    }
+
+    const uint32_t  timeout_min_ms;
+    const uint32_t  timeout_max_ms;
+    const uint32_t  timeout_factor;
+    uint64_t    last_chunk_ms;
+    bool        first_chunk;
+    uint32_t    first_byte_ms;
+    uint32_t    chunk_interval_ms;
+    uint32_t    rate_bps;
+    bool        measured;
+};
+
+#endif /* DOWNLOAD_STALL_MONITOR_H */
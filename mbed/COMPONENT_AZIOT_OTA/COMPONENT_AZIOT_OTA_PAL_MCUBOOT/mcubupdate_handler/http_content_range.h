@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2022, Nuvoton Technology Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HTTP_CONTENT_RANGE_H
+#define HTTP_CONTENT_RANGE_H
+
+#include <stdint.h>
+#include <ctype.h>
+#include <strings.h>
+
+/* Parse decimal digits at @p *p into @p *value, advancing @p *p. No digits or overflow fails. */
+static inline bool http_content_range_number(const char **p, uint64_t *value)
+{
+    const char *s = *p;
+    uint64_t v = 0;
+
+    if (!isdigit((unsigned char) *s)) {
+        return false;
+    }
+    for (; isdigit((unsigned char) *s); s ++) {
+        if (v > (UINT64_MAX - 9) / 10) {
+            return false;
+        }
+        v = v * 10 + (*s - '0');
+    }
+
+    *p = s;
+    *value = v;
+    return true;
+}
+
+/**
+ * @brief Parse byte range of 206 Partial Content
+ *
+ * Accepts "bytes <first>-<last>/<complete-length>" or "bytes <first>-<last>/*" (RFC 7233 4.2).
+ * Unsatisfied range ("bytes *" with complete length only) and anything malformed fail.
+ *
+ * @param value     Content-Range header value
+ * @param first     First byte position on success
+ * @param last      Last byte position on success
+ * @return true on success
+ */
+static inline bool http_content_range_parse(const char *value, uint64_t *first, uint64_t *last)
+{
+    const char *p = value;
+    uint64_t f, l, complete;
+
+    while (*p == ' ' || *p == '\t') {
+        p ++;
+    }
+    if (strncasecmp(p, "bytes", 5) != 0) {
+        return false;
+    }
+    p += 5;
+    if (*p != ' ') {
+        return false;
+    }
+    while (*p == ' ') {
+        p ++;
+    }
+
+    if (!http_content_range_number(&p, &f) || *p ++ != '-' ||
+        !http_content_range_number(&p, &l) || *p ++ != '/' || l < f) {
+        return false;
+    }
+    if (*p == '*') {
+        p ++;
+    } else if (!http_content_range_number(&p, &complete) || l >= complete) {
+        return false;
+    }
+
+    while (*p == ' ' || *p == '\t') {
+        p ++;
+    }
+    if (*p != '\0') {
+        return false;
+    }
+
+    *first = f;
+    *last = l;
+    return true;
+}
+
+#endif /* HTTP_CONTENT_RANGE_H */
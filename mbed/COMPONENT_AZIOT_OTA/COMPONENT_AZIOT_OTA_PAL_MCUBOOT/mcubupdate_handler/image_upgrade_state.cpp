@@ -0,0 +1,235 @@
+/**
+ * @file image_upgrade_state.cpp
+ * @brief Implements non-volatile firmware upgrade state of MCUboot OTA PAL.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#include "image_upgrade_state.h"
+#include "aduc/logging.h"
+
+#include "mbed.h"               // for Mbed OS
+#include "mbed_ota_kvstore.h"   // for OTA metadata
+
+#include <stddef.h>             // for offsetof
+#include <string.h>
+
+static_assert(sizeof(OTA_NonVolatileImageUpgradeState_t) <= ADUC_OTA_KV_RECORD_MAXSIZE,
+              "OTA_NonVolatileImageUpgradeState_t too large for OTA KVStore batch");
+
+static bool nvImgUpgSt_setAll(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState);
+static bool nvImgUpgSt_getAll(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState);
+
+/* Routines to operate in-RAM copy of OTA_NonVolatileImageUpgradeState_t struct */
+static void imgUpgSt_clearStage(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState);
+static bool imgUpgSt_settleInstalledCriteria(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState);
+
+bool imgUpgSt_postReboot(void)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
+        return true;
+    }
+
+    /* Fast path: nothing staged */
+    if (!imageUpgradeState.installRebooted_valid &&
+        !imageUpgradeState.stageVersion_valid) {
+        return true;
+    }
+
+    bool dirty = false;
+
+    /* Indicate install rebooted */
+    if (imageUpgradeState.installRebooted_valid &&
+        !imageUpgradeState.installRebooted) {
+        imageUpgradeState.installRebooted = true;
+        dirty = true;
+    }
+
+    bool confirmed = false;
+    bool revert = false;
+    if (imgUpgSt_installed(&imageUpgradeState, &confirmed)) {
+        /* Try to confirm MCUboot firmware upgrade anyway for "test"
+         * swap type because ADU doesn't define self-test flow. */
+        if (!confirmed) {
+            confirmed = (fwu_confirm_image_set() == 0);
+        }
+
+        /* Settle ADU installed criteria only after MCUboot firmware upgrade has confirmed. */
+        if (confirmed) {
+            /* MCUboot firmware upgrade has confirmed.
+             * Make ADU stage installed criteria become persistent. */
+            imgUpgSt_settleInstalledCriteria(&imageUpgradeState);
+        } else {
+            /* MCUboot firmware upgrade hasn't confirmed for some error.
+             * Re-restart for image revert. */
+            revert = true;
+        }
+        imgUpgSt_clearStage(&imageUpgradeState);
+        dirty = true;
+    }
+
+    /* Image confirm above goes first. If reset before this commit, next boot finds the
+     * image confirmed and redoes the settle. */
+    if (dirty && !nvImgUpgSt_setAll(&imageUpgradeState)) {
+        Log_Error("nvImgUpgSt_setAll() failed");
+    }
+
+    return !revert;
+}
+
+/*-----------------------------------------------------------*/
+
+bool nvImgUpgSt_reset(bool includeReserved)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (includeReserved || !nvImgUpgSt_getAll(&imageUpgradeState)) {
+        memset(&imageUpgradeState, 0x00, sizeof(OTA_NonVolatileImageUpgradeState_t));
+    } else {
+        imgUpgSt_clearStage(&imageUpgradeState);
+    }
+
+    return nvImgUpgSt_setAll(&imageUpgradeState);
+}
+
+bool nvImgUpgSt_setStageVersion(struct image_version *stageVersion)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
+        return false;
+    }
+
+    memcpy(&(imageUpgradeState.stageVersion),
+           stageVersion,
+           sizeof(struct image_version));
+    imageUpgradeState.stageVersion_valid = true;
+
+    return nvImgUpgSt_setAll(&imageUpgradeState);
+}
+
+bool nvImgUpgSt_setInstallRebooted(bool installRebooted)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
+        return false;
+    }
+
+    imageUpgradeState.installRebooted = installRebooted;
+    imageUpgradeState.installRebooted_valid = true;
+
+    return nvImgUpgSt_setAll(&imageUpgradeState);
+}
+
+bool nvImgUpgSt_setStageInstalledCriteria(const char *installedCriteria)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
+        return false;
+    }
+
+    size_t len = strlen(installedCriteria);
+    if (len > INSTALLEDCRITERIA_MAXCHAR) {
+        return false;
+    }
+
+    memcpy(imageUpgradeState.stageInstalledCriteria,
+           installedCriteria,
+           len + 1);
+    imageUpgradeState.stageInstalledCriteria_valid = true;
+
+    return nvImgUpgSt_setAll(&imageUpgradeState);
+}
+
+/**
+ * @brief Make stage installed criteria become persistent
+ *
+ * @note Stage installed criteria will be cleared on success.
+ */
+static bool imgUpgSt_settleInstalledCriteria(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
+{
+    if (!imageUpgradeState->stageInstalledCriteria_valid) {
+        return false;
+    }
+
+    size_t len = strnlen(imageUpgradeState->stageInstalledCriteria, INSTALLEDCRITERIA_MAXCHAR + 1);
+    if (len > INSTALLEDCRITERIA_MAXCHAR) {
+        return false;
+    }
+
+    /* Copy stage installed criteria to persistent one */
+    memcpy(imageUpgradeState->persistentInstalledCriteria,
+           imageUpgradeState->stageInstalledCriteria,
+           len + 1);
+    imageUpgradeState->persistentInstalledCriteria_valid = true;
+
+    /* Clear stage installed criteria */
+    imageUpgradeState->stageInstalledCriteria_valid = false;
+    memset(imageUpgradeState->stageInstalledCriteria, 
+           0x00,
+           INSTALLEDCRITERIA_MAXCHAR + 1);
+
+    return true;
+}
+
+/**
+ * @brief Clear stage states, leaving reserved area intact
+ */
+static void imgUpgSt_clearStage(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
+{
+    static_assert(offsetof(OTA_NonVolatileImageUpgradeState_t, reserved) < sizeof(OTA_NonVolatileImageUpgradeState_t),
+                  "Invalid reserved region offset in OTA_NonVolatileImageUpgradeState_t");
+    memset(imageUpgradeState, 0x00, offsetof(OTA_NonVolatileImageUpgradeState_t, reserved));
+}
+
+bool nvImgUpgSt_persistentInstalledCriteria(char *installedCriteria, size_t installedCriteria_maxlen)
+{
+    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
+    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
+        return false;
+    }
+
+    if (!imageUpgradeState.persistentInstalledCriteria_valid) {
+        return false;
+    }
+
+    size_t len = strlen(imageUpgradeState.persistentInstalledCriteria);
+    if ((len + 1) > installedCriteria_maxlen) {
+        return false;
+    }
+
+    memcpy(installedCriteria,
+           imageUpgradeState.persistentInstalledCriteria,
+           len + 1);
+
+    return true;
+}
+
+static bool nvImgUpgSt_setAll(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
+{
+    int kv_status = ADUC_OtaKV_Set(OTA_IMAGE_UPDATE_STATE_KEY,
+                                   imageUpgradeState,
+                                   sizeof(OTA_NonVolatileImageUpgradeState_t));
+    if (kv_status != MBED_SUCCESS) {
+        return false;
+    }
+
+    return true;
+}
+
+static bool nvImgUpgSt_getAll(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
+{
+    size_t actual_size = 0;
+
+    int kv_status = ADUC_OtaKV_Get(OTA_IMAGE_UPDATE_STATE_KEY,
+                                   imageUpgradeState,
+                                   sizeof(OTA_NonVolatileImageUpgradeState_t),
+                                   &actual_size);
+    if (kv_status != MBED_SUCCESS) {
+        return false;
+    }
+    if (actual_size != sizeof(OTA_NonVolatileImageUpgradeState_t)) {
+        return false;
+    }
+
+    return true;
+}
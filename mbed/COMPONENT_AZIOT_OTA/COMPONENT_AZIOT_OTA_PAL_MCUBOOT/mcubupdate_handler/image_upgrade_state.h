@@ -0,0 +1,82 @@
+/**
+ * @file image_upgrade_state.h
+ * @brief Non-volatile firmware upgrade state of MCUboot OTA PAL, and its settle after install reboot.
+ *
+ * Kept apart from mcubupdate_handler.cpp, which provides the MCUboot side of the settle: whether
+ * the staged image runs, and its confirm. So the settle builds and is measured on the host.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef IMAGE_UPGRADE_STATE_H
+#define IMAGE_UPGRADE_STATE_H
+
+#include "bootutil/image.h"     // for struct image_version
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* OTA KVStore key to in-storage struct OTA_NonVolatileImageUpgradeState_t */
+#define OTA_IMAGE_UPDATE_STATE_KEY              "ota_image_update_state"
+
+/* Maximum characters of installed criteria, excluding tailing null character */
+#define INSTALLEDCRITERIA_MAXCHAR               64
+
+/*-----------------------------------------------------------*/
+
+/* In-storage struct for holding OTA PAL/MCUboot FWU states which need to be non-volatile to cross reset cycle */
+typedef struct {
+    /* MCUboot version of stage, non-secure image */
+    bool                stageVersion_valid;
+    struct image_version    stageVersion;
+
+    /* Flag for install rebooted */
+    bool                installRebooted_valid;
+    bool                installRebooted;
+
+    /* ADU stage installed criteria */
+    bool                stageInstalledCriteria_valid;
+    char                stageInstalledCriteria[INSTALLEDCRITERIA_MAXCHAR + 1];
+
+    /* Mark the following area is reserved for not being cleared */
+    uint32_t            reserved;
+
+    /* ADU persistent installed criteria */
+    bool                persistentInstalledCriteria_valid;
+    char                persistentInstalledCriteria[INSTALLEDCRITERIA_MAXCHAR + 1];
+} OTA_NonVolatileImageUpgradeState_t;
+
+/* Routines to operate in-storage OTA_NonVolatileImageUpgradeState_t struct */
+bool nvImgUpgSt_reset(bool includeReserved);
+bool nvImgUpgSt_setStageVersion(struct image_version *stageVersion);
+bool nvImgUpgSt_setInstallRebooted(bool installRebooted);
+bool nvImgUpgSt_setStageInstalledCriteria(const char *installedCriteria);
+bool nvImgUpgSt_persistentInstalledCriteria(char *installedCriteria, size_t installedCriteria_maxlen);
+
+/**
+ * @brief Update OTA_NonVolatileImageUpgradeState_t after reboot and confirm MCUboot firmware upgrade
+ *
+ * With no upgrade pending, this costs one KVStore read. Otherwise, state changes are committed
+ * with one KVStore write, after the image confirm.
+ *
+ * @return false if MCUboot firmware upgrade failed to confirm, and system has to reset for image revert
+ */
+bool imgUpgSt_postReboot(void);
+
+/* MCUboot side of imgUpgSt_postReboot(), in mcubupdate_handler.cpp */
+
+/**
+ * @brief Whether the stage image of @p imageUpgradeState runs now after install reboot
+ *
+ * @param confirmed Set to whether it is confirmed, on true return
+ */
+bool imgUpgSt_installed(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState, bool *confirmed);
+
+/**
+ * @brief Mark the running image set as confirmed
+ *
+ * @return 0 on success
+ */
+int fwu_confirm_image_set(void);
+
+#endif /* IMAGE_UPGRADE_STATE_H */
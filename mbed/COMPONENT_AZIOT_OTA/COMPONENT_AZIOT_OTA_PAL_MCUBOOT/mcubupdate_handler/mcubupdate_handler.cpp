@@ -10,154 +10,410 @@
 #include "aduc/logging.h"
 #include "aduc/parser_utils.h"
 #include "aduc/string_c_utils.h"
-#include "aduc/types/update_content.h"  // ADUC_FileEntity
 #include "aduc/workflow_data_utils.h"
+#include "aduc/workflow_file_view.h"   // ADUC_FileEntityView
 #include "aduc/workflow_utils.h"
 #include <azure_c_shared_utility/azure_base64.h>
 #include <azure_c_shared_utility/sha.h>
 #include <string>
 
 #include "mbed.h"               // for Mbed OS
-#include "kvstore_global_api/kvstore_global_api.h"
 
 #include "bootutil/bootutil.h"  // for MCUboot
+#include "FlashIAP/FlashIAPBlockDevice.h"
 #include "bootutil/image.h"
 #include "flash_map_backend/secondary_bd.h"
 #include "sysflash/sysflash.h"
-
+#include "writeback_bd.h"
+#include "download_stall_monitor.h"
+#include "http_content_range.h"
+
+#include "mbed_workflow_persistence.h"  // for resuming across unexpected reset
+#include "mbed_post_reboot.h"           // for confirming upgrade before main()
+#include "image_upgrade_state.h"         // for OTA PAL/MCUboot FWU states
+#include "mbed_workflow_cancellation.h" // for aborting transfer on cancel
+#include "mbed_apply_window.h"          // for deferring apply of staged images
+#include "mbed_ota_kvstore.h"           // for OTA metadata
+
+#include "link_scheduler.h"     // for sharing link with MQTT
+#include "trace_ring.h"         // for profiling
 #include "http_request.h"       // for mbed-http
 #include "https_request.h"
 #include "NetworkInterface.h"
 
-#include <stddef.h>             // for offsetof
 #include <memory>               // for unique_ptr
 #include <functional>           // for function
+#include <new>                  // for placement new
 
 /* Default read block size for calculating image digest from secondary bd */
 #define FWU_READ_BLOCK_DEFSIZE                      1024
 
-/* KVStore key to in-storage struct OTA_NonVolatileImageUpgradeState_t */
-#define OTA_IMAGE_UPDATE_STATE_KEY              "ota_image_update_state"
+/* Default write-back window size for programming secondary bd */
+#if defined(MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_SECONDARY_BLOCKDEVICE_WRITE_BUFFER_SIZE)
+#define FWU_WRITE_BLOCK_DEFSIZE                     MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_SECONDARY_BLOCKDEVICE_WRITE_BUFFER_SIZE
+#else
+#define FWU_WRITE_BLOCK_DEFSIZE                     2048
+#endif
+
+/* Bounds of adaptive socket timeout for detecting stalled download, in ms */
+#define FWU_STALL_TIMEOUT_MIN                       MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_DOWNLOAD_STALL_TIMEOUT_MIN
+#define FWU_STALL_TIMEOUT_MAX                       MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_DOWNLOAD_STALL_TIMEOUT_MAX
+
+/* Multiple of observed latency/chunk interval before download is considered stalled */
+#define FWU_STALL_TIMEOUT_FACTOR                    4
+
+/* Consecutive reconnects without progress before download fails */
+#define FWU_DOWNLOAD_RECONNECT_MAX                  MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_DOWNLOAD_RECONNECT_MAX
+
+/* Bytes of image between persisted download checkpoints, 0 to disable */
+#define FWU_DOWNLOAD_CHECKPOINT_INTERVAL            MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_DOWNLOAD_CHECKPOINT_INTERVAL
+
+/* Images downloaded at a time for multi-image update */
+#define FWU_DOWNLOAD_CONCURRENCY                    MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_DOWNLOAD_CONCURRENCY
+
+/* Memory budget in bytes of concurrent image downloads, 0 for no limit other than concurrency */
+#define FWU_DOWNLOAD_MEMORY_BUDGET                  MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_DOWNLOAD_MEMORY_BUDGET
+
+/* Estimated heap of one transfer: TLS context and record buffers, receive buffer, and
+ * write-back/read cache plus read block of the stage slot */
+#define FWU_DOWNLOAD_TRANSFER_FOOTPRINT             (MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_DOWNLOAD_TLS_FOOTPRINT + \
+                                                     (HTTP_RECEIVE_BUFFER_SIZE) + \
+                                                     FWU_WRITE_BLOCK_DEFSIZE + \
+                                                     FWU_READ_BLOCK_DEFSIZE * 2)
+
+/* Apply in place: MCUboot direct-XIP/RAM-load boots the slot of higher version, instead of swapping slots.
+ * Stage goes to the inactive slot, either primary or secondary. */
+#if defined(MCUBOOT_DIRECT_XIP) || defined(MCUBOOT_RAM_LOAD)
+#define FWU_APPLY_IN_PLACE                          1
+#else
+#define FWU_APPLY_IN_PLACE                          0
+#endif
+
+/* Apply in place with revert: new slot is tried once and must be confirmed */
+#if defined(MCUBOOT_DIRECT_XIP_REVERT) || defined(MCUBOOT_RAM_LOAD_REVERT)
+#define FWU_APPLY_IN_PLACE_REVERT                   1
+#else
+#define FWU_APPLY_IN_PLACE_REVERT                   0
+#endif
+
+/* Number of MCUboot images updatable in one deployment, one file each. Apply in place supports image 0 only. */
+#if defined(MCUBOOT_IMAGE_NUMBER) && !FWU_APPLY_IN_PLACE
+#define FWU_IMAGE_NUMBER                            MCUBOOT_IMAGE_NUMBER
+#else
+#define FWU_IMAGE_NUMBER                            1
+#endif
+
+/* Routines to operate MCUboot slots of image 0: 0 for primary, 1 for secondary */
+static int fwu_active_slot(void);
+static int fwu_slot_flash_area_id(int slot);
+static bool fwu_read_slot_header(int slot, struct image_header *header);
+static BlockDevice *fwu_stage_bd(int image_index);
+static int fwu_set_confirmed(void);
+
+/**
+ * @brief Mark the running image set as confirmed
+ */
+int fwu_confirm_image_set(void)
+{
+#if FWU_IMAGE_NUMBER > 1
+    /* Image 0 stands for the set. Confirm the others first, so that the whole
+     * set reverts on failure. No-op for images not swapped. */
+    for (int image_index = 1; image_index < FWU_IMAGE_NUMBER; image_index ++) {
+        int rc = boot_set_confirmed_multi(image_index);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+#endif
+
+    /* Mark the image with index 0 in the primary slot as confirmed. 
+     * The system will continue booting into the image in the primary
+     * slot until told to boot from a different slot. */
+    return fwu_set_confirmed();
+}
 
-/* Stringize */
-#define STR_EXPAND(tok) #tok
-#define STR(tok) STR_EXPAND(tok)
+/**
+ * @brief Update OTA_NonVolatileImageUpgradeState_t after reboot and confirm MCUboot firmware upgrade
+ *
+ * See mbed_post_reboot.h. Runs once, from mbed_main() below unless disabled, else at agent startup.
+ */
+void ADUC_PostReboot_Settle(void)
+{
+    static core_util_atomic_flag settled = CORE_UTIL_ATOMIC_FLAG_INIT;
+    if (core_util_atomic_flag_test_and_set(&settled)) {
+        return;
+    }
 
-/* Convert to KVStore default fully-qualified key path */
-#define KV_DEF_FQ_KEY(KEY)                      \
-    "/" STR(MBED_CONF_STORAGE_DEFAULT_KV) "/" KEY
+    if (!imgUpgSt_postReboot()) {
+        NVIC_SystemReset();
+    }
+}
 
-/* Maximum characters of installed criteria, excluding tailing null character */
-#define INSTALLEDCRITERIA_MAXCHAR               64
+#if MBED_CONF_AZURE_CLIENT_OTA_MCUBOOT_CONFIRM_BEFORE_MAIN
+/* Confirm firmware upgrade before main(), as early as the former C++ global object constructor did.
+ * Mbed OS pre-main hook runs after global object constructors, so OTA KVStore is ready. */
+extern "C" void mbed_main(void)
+{
+    ADUC_PostReboot_Settle();
+}
+#endif
 
 /*-----------------------------------------------------------*/
 
-/* In-storage struct for holding OTA PAL/MCUboot FWU states which need to be non-volatile to cross reset cycle */
-typedef struct {
-    /* MCUboot version of stage, non-secure image */
-    bool                stageVersion_valid;
-    struct image_version    stageVersion;
-
-    /* Flag for install rebooted */
-    bool                installRebooted_valid;
-    bool                installRebooted;
-
-    /* ADU stage installed criteria */
-    bool                stageInstalledCriteria_valid;
-    char                stageInstalledCriteria[INSTALLEDCRITERIA_MAXCHAR + 1];
-
-    /* Mark the following area is reserved for not being cleared */
-    uint32_t            reserved;
-
-    /* ADU persistent installed criteria */
-    bool                persistentInstalledCriteria_valid;
-    char                persistentInstalledCriteria[INSTALLEDCRITERIA_MAXCHAR + 1];
-} OTA_NonVolatileImageUpgradeState_t;
-
-/* Routines to operate in-storage OTA_NonVolatileImageUpgradeState_t struct */
-static bool nvImgUpgSt_reset(bool includeReserved);
-static bool nvImgUpgSt_setStageVersion(struct image_version *stageVersion);
-static bool nvImgUpgSt_setInstallRebooted(bool installRebooted);
-static bool nvImgUpgSt_setStageInstalledCriteria(const char *installedCriteria);
-static bool nvImgUpgSt_settleInstalledCriteria(void);
-static bool nvImgUpgSt_installed(bool *confirmed);
-static bool nvImgUpgSt_installRebooted(bool *installRebooted);
-static bool nvImgUpgSt_persistentInstalledCriteria(char *installedCriteria, size_t installedCriteria_maxlen);
-static bool nvImgUpgSt_setAll(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState);
-static bool nvImgUpgSt_getAll(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState);
-
-/* Helper class for updating OTA_NonVolatileImageUpgradeState_t immediately after reboot */
-class Update_NVImgUpgSt_PostReboot
+/**
+ * @brief Network interface for mbed-http. Can override by user application
+ */
+__attribute__((weak))
+NetworkInterface *mbed_http_network = NetworkInterface::get_default_instance();
+
+/**
+ * @brief Secondary slot BlockDevice of MCUboot image @p image_index. Can override by user application
+ *
+ * Mbed MCUboot flash map backend provides get_secondary_bd() for image 0 only. For multi-image
+ * (MCUBOOT_IMAGE_NUMBER > 1), override this to return secondary slot of the other images too,
+ * consistent with the bootloader's flash map.
+ */
+__attribute__((weak))
+BlockDevice *get_secondary_bd_multi(int image_index)
+{
+    return (image_index == 0) ? get_secondary_bd() : nullptr;
+}
+
+/**
+ * @brief Mark secondary image of @p image_index pending, non-permanent to enable image revert
+ */
+static int fwu_set_pending(int image_index)
+{
+#if FWU_APPLY_IN_PLACE
+    /* Bootloader picks the stage slot by its higher version. With revert, it also needs
+     * swap magic there to try the image once. */
+    MBED_ASSERT(image_index == 0);
+#if FWU_APPLY_IN_PLACE_REVERT
+    const struct flash_area *fap = nullptr;
+    int rc = flash_area_open(fwu_slot_flash_area_id(1 - fwu_active_slot()), &fap);
+    if (rc == 0) {
+        rc = boot_write_magic(fap);
+        flash_area_close(fap);
+    }
+    return rc;
+#else
+    return 0;
+#endif
+#elif FWU_IMAGE_NUMBER > 1
+    return boot_set_pending_multi(image_index, 0);
+#else
+    MBED_ASSERT(image_index == 0);
+    return boot_set_pending(false);
+#endif
+}
+
+/**
+ * @brief Withdraw pending mark of secondary image of @p image_index
+ *
+ * bootutil has no API for this. Erase the last erase unit of the secondary slot, where image
+ * trailer resides, so that the bootloader won't find swap magic. Payload has to be re-downloaded.
+ */
+static int fwu_unset_pending(int image_index)
+{
+    BlockDevice *bd = fwu_stage_bd(image_index);
+    if (bd == nullptr) {
+        return -1;
+    }
+
+    int rc = bd->init();
+    if (rc != 0) {
+        return rc;
+    }
+    bd_size_t size = bd->size();
+    bd_size_t erase_size = bd->get_erase_size(size - 1);
+    rc = bd->erase(size - erase_size, erase_size);
+    bd->deinit();
+
+    return rc;
+}
+
+#if FWU_APPLY_IN_PLACE
+/**
+ * @brief Primary slot BlockDevice of image 0. Can override by user application
+ *
+ * Staged into on apply in place when running from secondary slot.
+ */
+__attribute__((weak))
+BlockDevice *get_primary_bd(void)
+{
+    static FlashIAPBlockDevice fbd(MCUBOOT_PRIMARY_SLOT_START_ADDR, MCUBOOT_SLOT_SIZE);
+    return &fbd;
+}
+
+static int fwu_version_cmp(const struct image_version *a, const struct image_version *b)
+{
+    if (a->iv_major != b->iv_major) {
+        return (a->iv_major > b->iv_major) ? 1 : -1;
+    }
+    if (a->iv_minor != b->iv_minor) {
+        return (a->iv_minor > b->iv_minor) ? 1 : -1;
+    }
+    if (a->iv_revision != b->iv_revision) {
+        return (a->iv_revision > b->iv_revision) ? 1 : -1;
+    }
+    if (a->iv_build_num != b->iv_build_num) {
+        return (a->iv_build_num > b->iv_build_num) ? 1 : -1;
+    }
+    return 0;
+}
+#endif
+
+static int fwu_slot_flash_area_id(int slot)
+{
+    return (slot == 0) ? FLASH_AREA_IMAGE_PRIMARY(0) : FLASH_AREA_IMAGE_SECONDARY(0);
+}
+
+static bool fwu_read_slot_header(int slot, struct image_header *header)
 {
-public:
-    Update_NVImgUpgSt_PostReboot();
-};
+    /* Through flash map rather than memory-mapped primary slot, which needn't be on internal flash */
+    const struct flash_area *fap = nullptr;
+    if (flash_area_open(fwu_slot_flash_area_id(slot), &fap) != 0) {
+        return false;
+    }
+    int rc = flash_area_read(fap, 0, header, sizeof(struct image_header));
+    flash_area_close(fap);
+    if (rc != 0) {
+        return false;
+    }
+
+    return header->ih_magic == IMAGE_MAGIC;
+}
 
-Update_NVImgUpgSt_PostReboot::Update_NVImgUpgSt_PostReboot()
+/**
+ * @brief Slot of image 0 running now
+ *
+ * Always primary for swap. For direct-XIP, the slot we execute in. For RAM-load, the slot
+ * of higher version, as the bootloader decided. Determined on first call, which is at agent
+ * startup before anything is staged, and kept until reboot.
+ */
+static int fwu_active_slot(void)
 {
-    /* Indicate install rebooted */
-    bool installRebooted = false;
-    if (nvImgUpgSt_installRebooted(&installRebooted) &&
-        !installRebooted) {
-        nvImgUpgSt_setInstallRebooted(true);
-    }
-
-    /* Try to confirm MCUboot firmware upgrade anyway for "test"
-     * swap type because ADU doesn't define self-test flow. */
-    bool confirmed = false;
-    if (nvImgUpgSt_installed(&confirmed) && !confirmed) {
-        /* Mark the image with index 0 in the primary slot as confirmed. 
-         * The system will continue booting into the image in the primary
-         * slot until told to boot from a different slot. */
-        boot_set_confirmed();
-    }
-
-    /* Settle ADU installed criteria only after MCUboot firmware upgrade has confirmed. */
-    if (nvImgUpgSt_installed(&confirmed)) {
-        if (confirmed) {
-            /* MCUboot firmware upgrade has confirmed.
-             * Make ADU stage installed criteria become persistent. */
-            nvImgUpgSt_settleInstalledCriteria();
-            nvImgUpgSt_reset(false);
+#if defined(MCUBOOT_DIRECT_XIP)
+    uint32_t pc = (uint32_t) (uintptr_t) &fwu_active_slot;
+    return (pc >= MCUBOOT_PRIMARY_SLOT_START_ADDR &&
+            pc < (MCUBOOT_PRIMARY_SLOT_START_ADDR + MCUBOOT_SLOT_SIZE)) ? 0 : 1;
+#elif defined(MCUBOOT_RAM_LOAD)
+    static int active_slot = -1;
+    if (active_slot < 0) {
+        struct image_header primary_header;
+        struct image_header secondary_header;
+        if (!fwu_read_slot_header(1, &secondary_header)) {
+            active_slot = 0;
+        } else if (!fwu_read_slot_header(0, &primary_header)) {
+            active_slot = 1;
         } else {
-            /* MCUboot firmware upgrade hasn't confirmed for some error.
-             * Re-restart for image revert. */
-            nvImgUpgSt_reset(false);
-            NVIC_SystemReset();
+            active_slot = (fwu_version_cmp(&secondary_header.ih_ver, &primary_header.ih_ver) > 0) ? 1 : 0;
         }
     }
+    return active_slot;
+#else
+    return 0;
+#endif
 }
 
-/* Confirm firmware upgrade when MCUboot upgrade strategy is SWAP through C++ global object constructor */
-Update_NVImgUpgSt_PostReboot update_nvImgUpgSt_postReboot;
+/**
+ * @brief BlockDevice to stage image of @p image_index into
+ */
+static BlockDevice *fwu_stage_bd(int image_index)
+{
+#if FWU_APPLY_IN_PLACE
+    /* Inactive slot */
+    if (image_index == 0 && fwu_active_slot() == 1) {
+        return get_primary_bd();
+    }
+#endif
 
-/*-----------------------------------------------------------*/
+    return get_secondary_bd_multi(image_index);
+}
+
+/**
+ * @brief Mark the running image 0 as confirmed
+ */
+static int fwu_set_confirmed(void)
+{
+#if FWU_APPLY_IN_PLACE
+    const struct flash_area *fap = nullptr;
+    int rc = flash_area_open(fwu_slot_flash_area_id(fwu_active_slot()), &fap);
+    if (rc == 0) {
+        rc = boot_write_image_ok(fap);
+        flash_area_close(fap);
+    }
+    return rc;
+#else
+    return boot_set_confirmed();
+#endif
+}
 
-/** Read program unit of mbed::BlockDevice
+/**
+ * @brief Transfers to run at a time for downloading @p image_count images
  *
- * @param bd                Target mbed::BlockDevice
- * @param progunit          Destination buffer to place read program unit
- * @param progunit_size     Program unit size
- * @param readblock         Helper buffer to place read block
- * @param readblock_size    Read block size
- * @param offset            Offset in bytes to indicate which program unit to read
- * 
- * @return mbed::BlockDevice API return code
+ * Bounded by configured concurrency and, if set, memory budget. The first transfer runs in
+ * the calling download worker. Each extra one costs a worker stack too.
  */
-static int bd_read_program_unit(mbed::BlockDevice *bd,
-                                void *progunit,
-                                size_t progunit_size,
-                                void *readblock,
-                                size_t readblock_size,
-                                size_t offset);
+static int fwu_download_worker_count(int image_count)
+{
+    int count = FWU_DOWNLOAD_CONCURRENCY;
 
-/*-----------------------------------------------------------*/
+    if (FWU_DOWNLOAD_MEMORY_BUDGET) {
+        size_t budget = FWU_DOWNLOAD_MEMORY_BUDGET;
+        int fit = 1;
+        if (budget > FWU_DOWNLOAD_TRANSFER_FOOTPRINT) {
+            fit += (int) ((budget - FWU_DOWNLOAD_TRANSFER_FOOTPRINT) / (FWU_DOWNLOAD_TRANSFER_FOOTPRINT + OS_STACK_SIZE));
+        }
+        if (count > fit) {
+            count = fit;
+        }
+    }
+
+    if (count > image_count) {
+        count = image_count;
+    }
+    return (count < 1) ? 1 : count;
+}
 
 /**
- * @brief Network interface for mbed-http. Can override by user application
+ * @brief Offset of the download checkpoint following @p offset, or 0 if none before @p total
  */
-__attribute__((weak))
-NetworkInterface *mbed_http_network = NetworkInterface::get_default_instance();
+static size_t fwu_next_checkpoint(size_t offset, size_t total)
+{
+#if FWU_DOWNLOAD_CHECKPOINT_INTERVAL
+    size_t next = (offset / FWU_DOWNLOAD_CHECKPOINT_INTERVAL + 1) * FWU_DOWNLOAD_CHECKPOINT_INTERVAL;
+    return (next < total) ? next : 0;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Get byte range of 206 Partial Content from its Content-Range header.
+ */
+static bool fwu_get_content_range(HttpResponse *response, uint64_t *first, uint64_t *last)
+{
+    std::vector<std::string *> fields = response->get_headers_fields();
+    std::vector<std::string *> values = response->get_headers_values();
+
+    for (size_t ix = 0; ix < fields.size() && ix < values.size(); ix ++) {
+        if (strcasecmp(fields[ix]->c_str(), "content-range") == 0) {
+            return http_content_range_parse(values[ix]->c_str(), first, last);
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Abort in-flight mbed-http transfer on cancel request. Runs in the cancelling thread.
+ */
+static void AbortDownloadOnCancel(void *context)
+{
+    Log_Info("Cancel requested. Abort HTTP download.");
+    static_cast<HttpRequestBase *>(context)->abort();
+}
 
 /*-----------------------------------------------------------*/
 
@@ -171,31 +427,104 @@ typedef struct
 
     /* MCUboot firmware update context: Stage */
     struct fwu_stage_s {
+        int                     image_index;                // MCUboot image index
         struct image_header     image_header;               // Cached image header on the fly
-        BlockDevice *           secondary_bd;               // Secondary BlockDevice
+        WriteBackBlockDevice *  secondary_bd;               // Secondary BlockDevice, fronted by write-back/read cache
         bool                    secondary_bd_inited;
-        void *                  secondary_bd_progunit;      // Program unit buffer to cover unaligned last data block
-        size_t                  secondary_bd_progunit_size;
-        void *                  secondary_bd_readblock;     // Read block buffer which must align on read unit boundary
+        void *                  secondary_bd_readblock;     // Read block buffer for calculating image digest
         size_t                  secondary_bd_readblock_size;
     } fwu_stage;
 
     /* Download progress */
     struct dl_prog_s {
+        size_t                  base;                       // Payload bytes of images before this one
         size_t                  offset;                     // Downloaded bytes
         size_t                  total_exp;                  // Expected total bytes to download
         size_t                  total_act;                  // Actual total bytes downloaded
+        size_t                  next_checkpoint;            // Offset of next persisted checkpoint, 0 if none
+        USHAContext             prefix_sha;                 // SHA-256 over [0, offset) for checkpoints
     } dl_prog;
 
 } OTA_OperationContext_t;
 
+/* Concurrent download of images of one update */
+typedef struct
+{
+    rtos::Mutex             mutex;                          // Guards aborted and requests
+    bool                    aborted;                        // Set on first failure, no transfer starts after
+    HttpRequestBase *       requests[FWU_IMAGE_NUMBER];     // In-flight transfer per image, nullptr if none
+
+    /* Thread control block memory of extra workers, kept across runs, so that ARM C library libspace
+     * bound to worker thread is reused. See NU_WORKAROUND_THREAD_LIBSPACE_UNBIND in mbed_adu_core_impl.hpp. */
+    uint64_t                workerBlocks[FWU_IMAGE_NUMBER][(sizeof(rtos::Thread) + 7) / 8];
+} OTA_DownloadGroup_t;
+
+/**
+ * @brief Start a new download run of the group
+ */
+static void DownloadGroup_Reset(OTA_DownloadGroup_t *group)
+{
+    group->mutex.lock();
+    group->aborted = false;
+    group->mutex.unlock();
+}
+
+/**
+ * @brief Register in-flight transfer of @p imageIndex, for abort by other workers
+ *
+ * @return false if the group has been aborted, in which case the transfer mustn't start.
+ */
+static bool DownloadGroup_Attach(OTA_DownloadGroup_t *group, int imageIndex, HttpRequestBase *request)
+{
+    group->mutex.lock();
+    bool aborted = group->aborted;
+    if (!aborted) {
+        group->requests[imageIndex] = request;
+    }
+    group->mutex.unlock();
+    return !aborted;
+}
+
+static void DownloadGroup_Detach(OTA_DownloadGroup_t *group, int imageIndex)
+{
+    group->mutex.lock();
+    group->requests[imageIndex] = nullptr;
+    group->mutex.unlock();
+}
+
+static bool DownloadGroup_IsAborted(OTA_DownloadGroup_t *group)
+{
+    group->mutex.lock();
+    bool aborted = group->aborted;
+    group->mutex.unlock();
+    return aborted;
+}
+
+/**
+ * @brief Abort transfers in flight, as cancel does, and keep new ones from starting
+ */
+static void DownloadGroup_Abort(OTA_DownloadGroup_t *group)
+{
+    group->mutex.lock();
+    if (!group->aborted) {
+        group->aborted = true;
+        for (HttpRequestBase *request : group->requests) {
+            if (request) {
+                request->abort();
+            }
+        }
+    }
+    group->mutex.unlock();
+}
+
 /*-----------------------------------------------------------*/
 
 /**
  * @brief Constructor for the MCUbUpdate Handler Impl class.
  */
 MCUbUpdateHandlerImpl::MCUbUpdateHandlerImpl()
-    : otaCtx_opaque(nullptr)
+    : otaCtx_opaque(new void *[FWU_IMAGE_NUMBER]()),
+      dlGroup_opaque(new OTA_DownloadGroup_t())
 {
 }
     
@@ -204,7 +533,11 @@ MCUbUpdateHandlerImpl::MCUbUpdateHandlerImpl()
  */
 MCUbUpdateHandlerImpl::~MCUbUpdateHandlerImpl() // override
 {
-    OTACtx_Deinit();
+    for (int imageIndex = 0; imageIndex < FWU_IMAGE_NUMBER; imageIndex ++) {
+        OTACtx_Deinit(imageIndex);
+    }
+    delete [] otaCtx_opaque;
+    delete static_cast<OTA_DownloadGroup_t *>(dlGroup_opaque);
 
     /* About ADUC_Logging API
      *
@@ -236,8 +569,12 @@ ADUC_Result MCUbUpdateHandlerImpl::Download(const tagADUC_WorkflowData* workflow
     ADUC_Result result = { .ResultCode = ADUC_Result_Download_Success };
     ADUC_WorkflowHandle handle = workflowData->WorkflowHandle;
     int fileCount = 0;
-    ADUC_FileEntity fileEntity;
-    memset(&fileEntity, 0, sizeof(fileEntity));
+    int resumedCount = 0;
+    size_t resumedPartial = 0;
+    uint8_t prefixDigest[ADUC_PERSISTED_PREFIX_DIGEST_SIZE];
+    int workerCount = 0;
+    ADUC_FileEntityView fileEntities[FWU_IMAGE_NUMBER];
+    size_t settledOffsets[FWU_IMAGE_NUMBER + 1];
 
     /* Abort on cancel requested */
     if (workflow_is_cancel_requested(handle))
@@ -246,49 +583,184 @@ ADUC_Result MCUbUpdateHandlerImpl::Download(const tagADUC_WorkflowData* workflow
         goto done;
     }
 
-    /* For 'nuvoton/mcubupdate:1', we're expecting 1 payload file. */
+    /* For 'nuvoton/mcubupdate:1', we're expecting one payload file per MCUboot image,
+     * file index being image index. */
     fileCount = workflow_get_update_files_count(handle);
-    if (fileCount != 1)
+    if (fileCount < 1 || fileCount > FWU_IMAGE_NUMBER)
     {
-        Log_Error("MCUbUpdate expecting one file. (%d)", fileCount);
+        Log_Error("MCUbUpdate expecting 1~%d files. (%d)", FWU_IMAGE_NUMBER, fileCount);
         result = { .ResultCode = ADUC_Result_Failure };
         goto done;
     }
 
-    /* Get upgrade firmware information */
-    if (!workflow_get_update_file(handle, 0, &fileEntity))
-    {
-        Log_Error("Get upgrade firmware information failed");
-        result = { .ResultCode = ADUC_Result_Failure };
+    /* Persisted download progress counts bytes of images settled in their
+     * secondary slots, in image order. */
+    settledOffsets[0] = 0;
+    for (int imageIndex = 0; imageIndex < fileCount; imageIndex ++) {
+        /* Get upgrade firmware information, borrowed from workflow */
+        if (!workflow_peek_update_file(handle, imageIndex, &fileEntities[imageIndex]))
+        {
+            Log_Error("Get upgrade firmware information failed");
+            result = { .ResultCode = ADUC_Result_Failure };
+            goto done;
+        }
+
+        /* Show upgrade firmware information */
+        Log_Info("Upgrade firmware: Image %d", imageIndex);
+        Log_Info("Upgrade firmware: FileId %s", fileEntities[imageIndex].FileId);
+        Log_Info("Upgrade firmware: DownloadUri %s", fileEntities[imageIndex].DownloadUri);
+        Log_Info("Upgrade firmware: TargetFilename %s", fileEntities[imageIndex].TargetFilename);
+        Log_Info("Upgrade firmware: SizeInBytes %d", (int) fileEntities[imageIndex].SizeInBytes);
+
+        settledOffsets[imageIndex + 1] = settledOffsets[imageIndex] + fileEntities[imageIndex].SizeInBytes;
+    }
+
+    /* Skip download of leading images whose payload has settled in secondary bd before unexpected reset */
+    while (resumedCount < fileCount &&
+           ResumeSettledDownload(workflowData, resumedCount, settledOffsets[resumedCount], &fileEntities[resumedCount])) {
+        Log_Info("Upgrade firmware: Image %d already downloaded and verified. Skip download.", resumedCount);
+        OTACtx_Deinit(resumedCount);
+        resumedCount ++;
+    }
+    if (resumedCount == fileCount) {
         goto done;
     }
 
-    /* Show upgrade firmware information */
-    Log_Info("Upgrade firmware: FileId %s", fileEntity.FileId);
-    Log_Info("Upgrade firmware: DownloadUri %s", fileEntity.DownloadUri);
-    Log_Info("Upgrade firmware: TargetFilename %s", fileEntity.TargetFilename);
-    Log_Info("Upgrade firmware: SizeInBytes %d", fileEntity.SizeInBytes);
+    /* Continue the next image from its persisted checkpoint, if its part in secondary bd still matches */
+    if (ResumePartialDownload(workflowData, resumedCount, settledOffsets[resumedCount], &fileEntities[resumedCount], prefixDigest)) {
+        resumedPartial = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[resumedCount])->dl_prog.offset;
+        Log_Info("Upgrade firmware: Image %d resumes download at %d/%d bytes",
+                 resumedCount, resumedPartial, (int) fileEntities[resumedCount].SizeInBytes);
+    }
+
+    /* Secondary bd of the rest is to erase. Invalidate persisted download progress from first of them. */
+    ADUC_WorkflowPersistence_SaveDownloadOffset(handle,
+                                                settledOffsets[resumedCount] + resumedPartial,
+                                                resumedPartial ? prefixDigest : nullptr);
 
-    /* OTA operation context */
-    if (!OTACtx_Reinit()) {
+    /* Stage the rest with bounded concurrency, each image into its own slot */
+    workerCount = fwu_download_worker_count(fileCount - resumedCount);
+    Log_Info("Upgrade firmware: Download %d image(s) with %d transfer(s) at a time",
+             fileCount - resumedCount, workerCount);
+    {
+        OTA_DownloadGroup_t *dlGroup = static_cast<OTA_DownloadGroup_t *>(dlGroup_opaque);
+        rtos::Mutex stage_mutex;
+        int next_image = resumedCount;          // Next image to start
+        int settled_count = resumedCount;       // Images settled in order, as persisted
+        bool settled[FWU_IMAGE_NUMBER] = { false };
+        bool stop = false;
+
+        /* Run by calling thread and extra workers. Take images in order until none left or one fails. */
+        auto StageImagesTask = [&]() {
+            while (true) {
+                stage_mutex.lock();
+                int imageIndex = (stop || workflow_is_cancel_requested(handle)) ? fileCount : next_image ++;
+                stage_mutex.unlock();
+                if (imageIndex >= fileCount) {
+                    break;
+                }
+
+                /* Context is released right away to bound memory to transfers in flight */
+                bool resume = (imageIndex == resumedCount && resumedPartial != 0);
+                ADUC_Result imageResult = DownloadImage(workflowData, imageIndex, settledOffsets[imageIndex], resume,
+                                                        &fileEntities[imageIndex]);
+                OTACtx_Deinit(imageIndex);
+
+                stage_mutex.lock();
+                if (IsAducResultCodeFailure(imageResult.ResultCode) ||
+                    imageResult.ResultCode == ADUC_Result_Cancel_Success) {
+                    /* First failure wins. Abort images in flight, no new ones start. */
+                    if (!stop) {
+                        stop = true;
+                        result = imageResult;
+                        DownloadGroup_Abort(dlGroup);
+                    }
+                } else {
+                    /* Payload has settled in secondary bd. Persist for resuming across unexpected reset,
+                     * over images settled in order only, as resume expects. */
+                    settled[imageIndex] = true;
+                    int settled_count_old = settled_count;
+                    while (settled_count < fileCount && settled[settled_count]) {
+                        settled_count ++;
+                    }
+                    if (settled_count != settled_count_old) {
+                        ADUC_WorkflowPersistence_SaveDownloadOffset(handle, settledOffsets[settled_count], nullptr);
+                    }
+                }
+                stage_mutex.unlock();
+            }
+        };
+
+        /* See CombinedDownloadInstallTask_simple in DownloadImage() for mbed Callback size limit */
+        auto StageImagesTask_simple = [&]() {
+            StageImagesTask();
+        };
+
+        DownloadGroup_Reset(dlGroup);
+        rtos::Thread *workers[FWU_IMAGE_NUMBER] = { nullptr };
+        for (int workerIndex = 1; workerIndex < workerCount; workerIndex ++) {
+            rtos::Thread *worker = new (dlGroup->workerBlocks[workerIndex]) rtos::Thread(osPriorityNormal,  // priority
+                                                                                          OS_STACK_SIZE,     // stack_size
+                                                                                          nullptr,           // stack_mem
+                                                                                          "Image download worker");
+            osStatus os_rc = worker->start(StageImagesTask_simple);
+            if (os_rc != osOK) {
+                /* Fewer transfers at a time, not fatal */
+                Log_Warn("Image download worker: Thread.start(): -0x%08x", -os_rc);
+                worker->~Thread();
+                break;
+            }
+            workers[workerIndex] = worker;
+        }
+
+        StageImagesTask();
+
+        for (rtos::Thread *worker : workers) {
+            if (worker) {
+                worker->join();
+                worker->~Thread();
+            }
+        }
+
+        /* Resumed image may not have started on cancel */
+        OTACtx_Deinit(resumedCount);
+    }
+
+done:
+    return result;
+}
+
+ADUC_Result MCUbUpdateHandlerImpl::DownloadImage(const tagADUC_WorkflowData* workflowData,
+                                                 int imageIndex,
+                                                 size_t settledOffset,
+                                                 bool resume,
+                                                 const void* fileEntity_opaque)
+{
+    ADUC_Result result = { .ResultCode = ADUC_Result_Download_Success };
+    ADUC_WorkflowHandle handle = workflowData->WorkflowHandle;
+    OTA_DownloadGroup_t *dlGroup = static_cast<OTA_DownloadGroup_t *>(dlGroup_opaque);
+
+    MBED_ASSERT(fileEntity_opaque != nullptr);
+    const ADUC_FileEntityView &fileEntity = *static_cast<const ADUC_FileEntityView*>(fileEntity_opaque);
+
+    /* OTA operation context. On resume, ResumePartialDownload() has prepared it with secondary bd
+     * content and download progress kept. */
+    if (!resume && !OTACtx_Reinit(imageIndex, true)) {
         Log_Error("OTACtx_Reinit() failed");
         result = { .ResultCode = ADUC_Result_Failure };
         goto done;
     }
-    MBED_ASSERT(otaCtx_opaque != nullptr);
-    OTA_OperationContext_t *otaCtx_inst; otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque);
+    MBED_ASSERT(otaCtx_opaque[imageIndex] != nullptr);
+    OTA_OperationContext_t *otaCtx_inst; otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[imageIndex]);
 
-    /* Get active image's version */
-    {
-        const struct image_header *header = (const struct image_header *) MCUBOOT_PRIMARY_SLOT_START_ADDR;
-        if (header->ih_magic != IMAGE_MAGIC) {
+    /* Get active image's version. Slot address is known for image 0 only. */
+    if (imageIndex == 0) {
+        struct image_header *header = &(otaCtx_inst->fwu_active.image_header);
+        if (!fwu_read_slot_header(fwu_active_slot(), header)) {
             Log_Error("Active image header error: Magic: EXP 0x%08x ACT 0x%08" PRIx32, IMAGE_MAGIC, header->ih_magic);
             result = { .ResultCode = ADUC_Result_Failure };
             goto done;
         }
-        memcpy(&(otaCtx_inst->fwu_active.image_header),
-               header,
-               sizeof(struct image_header));
 
         struct image_version *active_image_version = &(otaCtx_inst->fwu_active.image_header.ih_ver);
         Log_Info("Active image version: %d.%d.%d+%" PRIu32,
@@ -299,41 +771,132 @@ ADUC_Result MCUbUpdateHandlerImpl::Download(const tagADUC_WorkflowData* workflow
     }
 
     /* Initialize download progress */
-    {
+    if (!resume) {
+        otaCtx_inst->dl_prog.base = settledOffset;
         otaCtx_inst->dl_prog.offset = 0;
         otaCtx_inst->dl_prog.total_exp = fileEntity.SizeInBytes;
         otaCtx_inst->dl_prog.total_act = 0;
+        otaCtx_inst->dl_prog.next_checkpoint = fwu_next_checkpoint(0, fileEntity.SizeInBytes);
+        if (otaCtx_inst->dl_prog.next_checkpoint &&
+            USHAReset(&otaCtx_inst->dl_prog.prefix_sha, SHA256) != 0) {
+            Log_Error("Error in SHA Reset, SHAversion: %d", SHA256);
+            result = { .ResultCode = ADUC_Result_Failure };
+            goto done;
+        }
     }
 
     /* Combine mbed-http download and install by chunk
      *
      * Manage dynamic objects with RAII
+     *
+     * On stalled or dropped connection, reconnect and continue from current offset with HTTP
+     * Range request, so that a flaky link doesn't restart the whole download.
      */
     {
-        bool isHttps = (fileEntity.DownloadUri[4] == 's') || 
-            (fileEntity.DownloadUri[4] == 'S');
+        /* Parse and validate URL once, shared by reconnect attempts */
+        ParsedUrl parsed_download_url(fileEntity.DownloadUri);
+        if (!parsed_download_url.valid()) {
+            Log_Error("Invalid download URL: %s", fileEntity.DownloadUri);
+            result = { .ResultCode = ADUC_Result_Failure };
+            goto done;
+        }
+        bool isHttps = parsed_download_url.is_secure();
 
-        std::unique_ptr<HttpsRequest> scoped_https_download_request;
-        std::unique_ptr<HttpRequest> scoped_http_download_request;
+        std::unique_ptr<HttpRequestBase> scoped_download_request;
+        DownloadStallMonitor stall_monitor(FWU_STALL_TIMEOUT_MIN, FWU_STALL_TIMEOUT_MAX, FWU_STALL_TIMEOUT_FACTOR);
+
+        /* Receive buffer shared by reconnect attempts, rather than allocated per request */
+        std::unique_ptr<uint8_t[]> scoped_recv_buffer(new uint8_t[HTTP_RECEIVE_BUFFER_SIZE]);
+
+        /* Per connection attempt */
+        size_t attempt_offset = 0;          // Offset where this attempt starts
+        size_t attempt_skip = 0;            // Bytes to discard when server ignores Range
+        bool attempt_first_chunk = true;
+        int applied_timeout_ms = 0;
 
         /* Note 'result' is captured by reference, so we can get callback returned result. */
         auto CombinedDownloadInstallTask = [&](const char *dl_data, uint32_t dl_length) {
-            /* Cancel HTTPS/HTTP transfer on previous failure or cancel requested */
+            /* Cancel HTTPS/HTTP transfer on previous failure, cancel requested, or failure of another image */
             if (IsAducResultCodeFailure(result.ResultCode) ||
-                workflow_is_cancel_requested(handle)) {
-                if (isHttps) {
-                    if (scoped_https_download_request) {    // Check managed object for safe
-                        scoped_https_download_request->cancel();
+                workflow_is_cancel_requested(handle) ||
+                DownloadGroup_IsAborted(dlGroup)) {
+                if (scoped_download_request) {      // Check managed object for safe
+                    scoped_download_request->cancel();
+                }
+                return;
+            }
+
+            /* Adapt stall timeout to observed link */
+            stall_monitor.on_chunk(dl_length);
+            int timeout_ms = stall_monitor.timeout_ms();
+            if (timeout_ms != applied_timeout_ms) {
+                scoped_download_request->set_timeout(timeout_ms);
+                applied_timeout_ms = timeout_ms;
+            }
+
+            /* Check status code on first chunk of the attempt */
+            if (attempt_first_chunk) {
+                attempt_first_chunk = false;
+
+                HttpResponse *response = scoped_download_request->get_response_in_progress();
+                int status_code = response->get_status_code();
+                if (status_code == 200) {
+                    /* Full content: Range not requested or ignored by server */
+                    attempt_skip = attempt_offset;
+                } else if (status_code == 206 && attempt_offset != 0) {
+                    /* Partial content, which must start at requested offset. Otherwise, data
+                     * would land at wrong offset in secondary bd. */
+                    uint64_t range_first = 0;
+                    uint64_t range_last = 0;
+                    if (!fwu_get_content_range(response, &range_first, &range_last) ||
+                        range_first != attempt_offset) {
+                        Log_Error("HTTP download: Partial content not at offset %d", attempt_offset);
+                        result = { .ResultCode = ADUC_Result_Failure };
+                        scoped_download_request->cancel();
+                        return;
                     }
+                    attempt_skip = 0;
                 } else {
-                    if (scoped_http_download_request) {     // Check managed object for safe
-                        scoped_http_download_request->cancel();
-                    }
+                    Log_Error("HTTP download: Unexpected status code %d at offset %d", status_code, attempt_offset);
+                    result = { .ResultCode = ADUC_Result_Failure };
+                    scoped_download_request->cancel();
+                    return;
+                }
+            }
+
+            /* Discard already-installed part */
+            if (attempt_skip) {
+                uint32_t skip = (dl_length < attempt_skip) ? dl_length : attempt_skip;
+                attempt_skip -= skip;
+                dl_data += skip;
+                dl_length -= skip;
+                if (dl_length == 0) {
+                    return;
                 }
-                return;
             }
 
-            result = this->CombinedDownloadInstall(workflowData, dl_data, dl_length);
+            /* Share link with MQTT: hold off draining the socket while over budget */
+            link_scheduler_consume(LINK_SCHEDULER_CLASS_BULK, dl_length);
+
+            /* Split at checkpoint so that it lands on program unit boundary */
+            TRACE_RING_BEGIN("download_chunk");
+            while (dl_length && !IsAducResultCodeFailure(result.ResultCode)) {
+                size_t next_checkpoint = otaCtx_inst->dl_prog.next_checkpoint;
+                uint32_t todo = dl_length;
+                if (next_checkpoint && todo > next_checkpoint - otaCtx_inst->dl_prog.offset) {
+                    todo = next_checkpoint - otaCtx_inst->dl_prog.offset;
+                }
+
+                result = this->CombinedDownloadInstall(workflowData, imageIndex, dl_data, todo);
+                dl_data += todo;
+                dl_length -= todo;
+
+                if (next_checkpoint && otaCtx_inst->dl_prog.offset == next_checkpoint &&
+                    !IsAducResultCodeFailure(result.ResultCode)) {
+                    CheckpointDownload(workflowData, imageIndex);
+                }
+            }
+            TRACE_RING_END("download_chunk");
         };
 
         /* Notes on passing body callback to mbed-http HttpsRequest/HttpRequest
@@ -354,47 +917,111 @@ ADUC_Result MCUbUpdateHandlerImpl::Download(const tagADUC_WorkflowData* workflow
             CombinedDownloadInstallTask(dl_data, dl_length);
         };
 
-        /* Distinguish HTTPS/HTTP */
-        if (isHttps) {
-            scoped_https_download_request.reset(new HttpsRequest(mbed_http_network,
-                                                                 nullptr,   // TODO: CA certificate
-                                                                 HTTP_GET,
-                                                                 fileEntity.DownloadUri,
-                                                                 CombinedDownloadInstallTask_simple));
-
-            /* Start HTTP download (blocking call) */
-            HttpResponse* http_response = scoped_https_download_request->send();
-            if (!http_response && !workflow_is_cancel_requested(handle)) {
-                Log_Error("mbed-http failed: Error code %d", scoped_https_download_request->get_error());
+        int reconnects = 0;
+        while (true) {
+            /* Distinguish HTTPS/HTTP */
+            if (isHttps) {
+                scoped_download_request.reset(new HttpsRequest(mbed_http_network,
+                                                               nullptr,     // TODO: CA certificate
+                                                               HTTP_GET,
+                                                               &parsed_download_url,
+                                                               CombinedDownloadInstallTask_simple));
+            } else {
+                scoped_download_request.reset(new HttpRequest(mbed_http_network,
+                                                              HTTP_GET,
+                                                              &parsed_download_url,
+                                                              CombinedDownloadInstallTask_simple));
+            }
+
+            scoped_download_request->set_receive_buffer(scoped_recv_buffer.get(), HTTP_RECEIVE_BUFFER_SIZE);
+
+            attempt_offset = otaCtx_inst->dl_prog.offset;
+            attempt_skip = 0;
+            attempt_first_chunk = true;
+            if (attempt_offset != 0) {
+                char range[32];
+                snprintf(range, sizeof(range), "bytes=%u-", (unsigned) attempt_offset);
+                scoped_download_request->set_header("Range", range);
+            }
+
+            /* Timeout also bounds connect and TLS handshake */
+            applied_timeout_ms = stall_monitor.timeout_ms();
+            scoped_download_request->set_timeout(applied_timeout_ms);
+            stall_monitor.on_attempt_start();
+
+            /* Start HTTP download (blocking call), abortable on cancel request and on failure of another image */
+            if (!DownloadGroup_Attach(dlGroup, imageIndex, scoped_download_request.get())) {
+                Log_Info("HTTP download: Image %d aborted on failure of another image", imageIndex);
                 result = { .ResultCode = ADUC_Result_Failure };
                 goto done;
             }
-        } else {
-            scoped_http_download_request.reset(new HttpRequest(mbed_http_network,
-                                                               HTTP_GET,
-                                                               fileEntity.DownloadUri,
-                                                               CombinedDownloadInstallTask_simple));
+            if (!ADUC_WorkflowCancellation_Subscribe(handle, AbortDownloadOnCancel, scoped_download_request.get())) {
+                Log_Warn("Cancel request will take effect on next received chunk only");
+            }
+            HttpResponse* http_response = scoped_download_request->send();
+            ADUC_WorkflowCancellation_Unsubscribe(AbortDownloadOnCancel, scoped_download_request.get());
+            DownloadGroup_Detach(dlGroup, imageIndex);
+
+            /* Not to retry on cancel, install failure, failure of another image, or completed message/content */
+            if (workflow_is_cancel_requested(handle) ||
+                IsAducResultCodeFailure(result.ResultCode) ||
+                DownloadGroup_IsAborted(dlGroup) ||
+                (http_response && http_response->is_message_complete()) ||
+                otaCtx_inst->dl_prog.offset >= otaCtx_inst->dl_prog.total_exp) {
+                break;
+            }
 
-            /* Start HTTP download (blocking call) */
-            HttpResponse* http_response = scoped_http_download_request->send();
-            if (!http_response && !workflow_is_cancel_requested(handle)) {
-                Log_Error("mbed-http failed: Error code %d", scoped_http_download_request->get_error());
+            /* Stalled or dropped. Reconnect unless no progress for too many times. */
+            if (otaCtx_inst->dl_prog.offset != attempt_offset) {
+                reconnects = 0;
+            }
+            if (reconnects >= FWU_DOWNLOAD_RECONNECT_MAX) {
+                Log_Error("mbed-http failed: Error code %d", scoped_download_request->get_error());
                 result = { .ResultCode = ADUC_Result_Failure };
                 goto done;
             }
+            reconnects ++;
+            Log_Warn("HTTP download: Stalled at %d/%d bytes (error %d, timeout %d ms, %" PRIu32 " bytes/s). Reconnect %d/%d",
+                     otaCtx_inst->dl_prog.offset,
+                     otaCtx_inst->dl_prog.total_exp,
+                     scoped_download_request->get_error(),
+                     applied_timeout_ms,
+                     stall_monitor.rate(),
+                     reconnects,
+                     FWU_DOWNLOAD_RECONNECT_MAX);
+
+            /* Release socket before reconnect. Back off linearly. */
+            scoped_download_request.reset();
+            rtos::ThisThread::sleep_for(std::chrono::seconds(reconnects));
         }
 
+        /* Flush write-back cache of secondary bd on completion or cancel */
+        int rc_sync = otaCtx_inst->fwu_stage.secondary_bd->sync();
+
         /* Abort on cancel requested */
         if (workflow_is_cancel_requested(handle)) {
             result = this->Cancel(workflowData);
             goto done;
         }
 
+        if (rc_sync != 0) {
+            Log_Error("Secondary BlockDevice sync() failed: %d", rc_sync);
+            result = { .ResultCode = ADUC_Result_Failure };
+            goto done;
+        }
+
         /* Check callback returned result */
         if (IsAducResultCodeFailure(result.ResultCode)) {
             goto done;
         }
 
+        /* Partly downloaded on failure of another image */
+        if (DownloadGroup_IsAborted(dlGroup)) {
+            Log_Info("HTTP download: Image %d aborted on failure of another image", imageIndex);
+            result = { .ResultCode = ADUC_Result_Failure };
+            goto done;
+        }
+
         /* Check download length */
         otaCtx_inst->dl_prog.total_act = otaCtx_inst->dl_prog.offset;
         if (otaCtx_inst->dl_prog.total_act != otaCtx_inst->dl_prog.total_exp) {
@@ -408,14 +1035,20 @@ ADUC_Result MCUbUpdateHandlerImpl::Download(const tagADUC_WorkflowData* workflow
     }
 
     /* Verify signature */
-    if (!VerifySignature(workflowData, &fileEntity)) {
+    TRACE_RING_BEGIN("verify_signature");
+    bool verified; verified = VerifySignature(workflowData, imageIndex, &fileEntity);
+    TRACE_RING_END("verify_signature");
+    if (!verified) {
         Log_Error("VerifySignature() failed");
         result = { .ResultCode = ADUC_Result_Failure };
         goto done;
     }
 
+    Log_Info("Secondary BlockDevice bus transactions: %" PRIu32 " reads, %" PRIu32 " programs",
+             otaCtx_inst->fwu_stage.secondary_bd->get_bus_read_count(),
+             otaCtx_inst->fwu_stage.secondary_bd->get_bus_program_count());
+
 done:
-    ADUC_FileEntity_Uninit(&fileEntity);
     return result;
 }
 
@@ -456,6 +1089,10 @@ ADUC_Result MCUbUpdateHandlerImpl::Apply(const tagADUC_WorkflowData* workflowDat
 {
     ADUC_Result result = { .ResultCode = ADUC_Result_Apply_Success };
     ADUC_WorkflowHandle handle = workflowData->WorkflowHandle;
+    int imageCount = 0;
+    int imageIndex = 0;
+    bool staged = true;
+    int kv_status = MBED_SUCCESS;
 
     /* Stage installedCriteria */
     char* installedCriteria = workflow_get_installed_criteria(handle);
@@ -473,23 +1110,59 @@ ADUC_Result MCUbUpdateHandlerImpl::Apply(const tagADUC_WorkflowData* workflowDat
         goto done;
     }
 
-    /* Keep stage installedCriteria across reboot */
-    if (!nvImgUpgSt_setStageInstalledCriteria(installedCriteria)) {
-        Log_Info("nvImgUpgSt_setStageInstalledCriteria() failed");
-        result = { .ResultCode = ADUC_Result_Failure };
+    /* Images are staged and verified. Defer marking them pending until apply window opens,
+     * so that reboot into them doesn't happen at arbitrary time. */
+    if (!ADUC_ApplyWindow_Wait(handle))
+    {
+        result = this->Cancel(workflowData);
         goto done;
     }
 
-    /* Mark secondary image pending, non-permanent to enable image revert */
-    if (boot_set_pending(false) != 0) {
-        Log_Info("boot_set_pending() failed: Mark secondary image pending");
+    /* Keep stage installedCriteria across reboot, and indicate not reboot yet for install.
+     * Batch both into one write, committed before marking pending. */
+    kv_status = ADUC_OtaKV_BeginBatch();
+    if (kv_status != MBED_SUCCESS) {
+        Log_Error("ADUC_OtaKV_BeginBatch() failed: %d", kv_status);
         result = { .ResultCode = ADUC_Result_Failure };
         goto done;
     }
-
-    /* Indicate not reboot yet for install */
-    if (!nvImgUpgSt_setInstallRebooted(false)) {
+    if (!nvImgUpgSt_setStageInstalledCriteria(installedCriteria)) {
+        Log_Info("nvImgUpgSt_setStageInstalledCriteria() failed");
+        staged = false;
+    } else if (!nvImgUpgSt_setInstallRebooted(false)) {
         Log_Error("nvImgUpgSt_setInstallRebooted(false) failed");
+        staged = false;
+    }
+    /* Commit also on failure above, to end the batch */
+    kv_status = ADUC_OtaKV_Commit();
+    if (kv_status != MBED_SUCCESS) {
+        Log_Error("ADUC_OtaKV_Commit() failed: %d", kv_status);
+        staged = false;
+    }
+    if (!staged) {
+        result = { .ResultCode = ADUC_Result_Failure };
+        goto done;
+    }
+
+    /* Mark secondary images pending, non-permanent to enable image revert
+     *
+     * All or none, so that one reboot applies the whole set: on failure, withdraw marks
+     * already made. */
+    imageCount = (int) workflow_get_update_files_count(handle);
+    for (imageIndex = 0; imageIndex < imageCount; imageIndex ++) {
+        if (fwu_set_pending(imageIndex) != 0) {
+            Log_Info("boot_set_pending() failed: Mark secondary image %d pending", imageIndex);
+            break;
+        }
+    }
+    if (imageIndex != imageCount) {
+        while (imageIndex-- > 0) {
+            if (fwu_unset_pending(imageIndex) != 0) {
+                Log_Error("Withdraw pending mark of secondary image %d failed", imageIndex);
+            }
+        }
+        /* Secondary slot content is gone together with pending mark */
+        ADUC_WorkflowPersistence_SaveDownloadOffset(handle, 0, nullptr);
         result = { .ResultCode = ADUC_Result_Failure };
         goto done;
     }
@@ -597,6 +1270,7 @@ done:
 /*-----------------------------------------------------------*/
 
 ADUC_Result MCUbUpdateHandlerImpl::CombinedDownloadInstall(const tagADUC_WorkflowData* workflowData,
+                                                           int imageIndex,
                                                            const char *dl_data,
                                                            uint32_t dl_length)
 {
@@ -604,8 +1278,8 @@ ADUC_Result MCUbUpdateHandlerImpl::CombinedDownloadInstall(const tagADUC_Workflo
     ADUC_WorkflowHandle handle = workflowData->WorkflowHandle;
 
     /* OTA operation context */
-    MBED_ASSERT(otaCtx_opaque != nullptr);
-    OTA_OperationContext_t *otaCtx_inst; otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque);
+    MBED_ASSERT(otaCtx_opaque[imageIndex] != nullptr);
+    OTA_OperationContext_t *otaCtx_inst; otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[imageIndex]);
 
     Log_Info("HTTP download: %d/%d", otaCtx_inst->dl_prog.offset, otaCtx_inst->dl_prog.total_exp);
 
@@ -644,8 +1318,18 @@ ADUC_Result MCUbUpdateHandlerImpl::CombinedDownloadInstall(const tagADUC_Workflo
                      stage_image_version->iv_revision,
                      stage_image_version->iv_build_num);
 
-            /* Save stage version in NV to check installed or not on reboot */
-            if (!nvImgUpgSt_setStageVersion(&otaCtx_inst->fwu_stage.image_header.ih_ver)) {
+#if FWU_APPLY_IN_PLACE
+            /* Bootloader won't pick stage slot unless its version is higher */
+            if (fwu_version_cmp(stage_image_version, &(otaCtx_inst->fwu_active.image_header.ih_ver)) <= 0) {
+                Log_Error("Stage image version must be higher than active one to apply in place");
+                result = { .ResultCode = ADUC_Result_Failure };
+                goto done;
+            }
+#endif
+
+            /* Save stage version in NV to check installed or not on reboot. Image 0 stands for the set. */
+            if (otaCtx_inst->fwu_stage.image_index == 0 &&
+                !nvImgUpgSt_setStageVersion(&otaCtx_inst->fwu_stage.image_header.ih_ver)) {
                 Log_Error("nvImgUpgSt_setStageVersion() failed");
                 result = { .ResultCode = ADUC_Result_Failure };
                 goto done;
@@ -661,122 +1345,29 @@ ADUC_Result MCUbUpdateHandlerImpl::CombinedDownloadInstall(const tagADUC_Workflo
         goto done;
     }
 
-    /* Write through BlockDevice program() */
-
-    MBED_ASSERT(otaCtx_inst->fwu_stage.secondary_bd_progunit);
-    MBED_ASSERT(otaCtx_inst->fwu_stage.secondary_bd_progunit_size);
-
-    const uint8_t *fwu_data; fwu_data = (const uint8_t *) dl_data;
-    /* NOTE: fwu_offset can start from other than 0 */
-    size_t fwu_offset; fwu_offset = 0 + otaCtx_inst->dl_prog.offset;
-    size_t fwu_rmn; fwu_rmn = dl_length;
-    size_t fwu_todo;
-    size_t fwu_offset_alignup;
-    int rc; rc = 0;
-
-    /* Program first data which doesn't align on program unit boundary */
-    fwu_offset_alignup = ((fwu_offset + otaCtx_inst->fwu_stage.secondary_bd_progunit_size - 1) / otaCtx_inst->fwu_stage.secondary_bd_progunit_size) * otaCtx_inst->fwu_stage.secondary_bd_progunit_size;
-    fwu_todo = fwu_offset_alignup - fwu_offset;
-    if (fwu_todo > fwu_rmn) {
-        fwu_todo = fwu_rmn;
-    }
-    MBED_ASSERT(otaCtx_inst->fwu_stage.secondary_bd_progunit_size > fwu_todo);
-
-    if (fwu_todo) {
-        /* Read first program unit */
-        rc = bd_read_program_unit(otaCtx_inst->fwu_stage.secondary_bd,
-                                  otaCtx_inst->fwu_stage.secondary_bd_progunit,
-                                  otaCtx_inst->fwu_stage.secondary_bd_progunit_size,
-                                  otaCtx_inst->fwu_stage.secondary_bd_readblock,
-                                  otaCtx_inst->fwu_stage.secondary_bd_readblock_size,
-                                  fwu_offset);
-        if (rc != 0) {
-            Log_Error("bd_read_program_unit(offset=%d) failed: rc=%d",
-                      fwu_offset, rc);
-            result = { .ResultCode = ADUC_Result_Failure };
-            goto done;
-        }
-
-        /* Move unaligned data to first program unit */
-        uint8_t *fwu_data_first = (uint8_t *) otaCtx_inst->fwu_stage.secondary_bd_progunit;
-        size_t fwu_offset_first = (fwu_offset / otaCtx_inst->fwu_stage.secondary_bd_progunit_size) * otaCtx_inst->fwu_stage.secondary_bd_progunit_size;
-        size_t fwu_todo_first = otaCtx_inst->fwu_stage.secondary_bd_progunit_size;
-        memcpy(fwu_data_first + (fwu_offset - fwu_offset_first), fwu_data, fwu_todo);
-        fwu_data += fwu_todo;
-        fwu_offset += fwu_todo;
-        fwu_rmn -= fwu_todo;
-
-        /* Program first program unit */
-        rc = otaCtx_inst->fwu_stage.secondary_bd->program(fwu_data_first,
-                                                          fwu_offset_first,
-                                                          fwu_todo_first);
-        if (rc != 0) {
-            Log_Error("Secondary BlockDevice program(addr=%d, size=%d) failed: %d",
-                      fwu_offset_first, fwu_todo_first, rc);
-            result = { .ResultCode = ADUC_Result_Failure };
-            goto done;
-        }
-    }
-
-    /* Program data which aligns on program unit boundary */
-    fwu_todo = (fwu_rmn / otaCtx_inst->fwu_stage.secondary_bd_progunit_size) * otaCtx_inst->fwu_stage.secondary_bd_progunit_size;
-    if (fwu_todo) {
-        rc = otaCtx_inst->fwu_stage.secondary_bd->program(fwu_data,
-                                                          fwu_offset,
-                                                          fwu_todo);
-        if (rc != 0) {
-            Log_Error("Secondary BlockDevice program(addr=%d, size=%d) failed: %d",
-                      fwu_offset, fwu_todo, rc);
-            result = { .ResultCode = ADUC_Result_Failure };
-            goto done;
-        }
-        fwu_data += fwu_todo;
-        fwu_offset += fwu_todo;
-        fwu_rmn -= fwu_todo;
+    /* Write through BlockDevice program()
+     *
+     * Secondary bd is fronted by write-back cache, which coalesces sequential
+     * chunks into aligned program units, so no read-modify-program here. */
+    int rc; rc = otaCtx_inst->fwu_stage.secondary_bd->program(dl_data,
+                                                              otaCtx_inst->dl_prog.offset,
+                                                              dl_length);
+    if (rc != 0) {
+        Log_Error("Secondary BlockDevice program(addr=%d, size=%d) failed: %d",
+                  otaCtx_inst->dl_prog.offset, dl_length, rc);
+        result = { .ResultCode = ADUC_Result_Failure };
+        goto done;
     }
 
-    /* Program last data which doesn't align on program unit boundary */
-    fwu_todo = fwu_rmn;
-    if (fwu_todo) {
-        MBED_ASSERT(otaCtx_inst->fwu_stage.secondary_bd_progunit_size > fwu_todo);
-
-        /* Read last program unit */
-        rc = bd_read_program_unit(otaCtx_inst->fwu_stage.secondary_bd,
-                                  otaCtx_inst->fwu_stage.secondary_bd_progunit,
-                                  otaCtx_inst->fwu_stage.secondary_bd_progunit_size,
-                                  otaCtx_inst->fwu_stage.secondary_bd_readblock,
-                                  otaCtx_inst->fwu_stage.secondary_bd_readblock_size,
-                                  fwu_offset);
-        if (rc != 0) {
-            Log_Error("bd_read_program_unit(offset=%d) failed: rc=%d",
-                      fwu_offset, rc);
-            result = { .ResultCode = ADUC_Result_Failure };
-            goto done;
-        }
-
-        /* Move unaligned data to last program unit */
-        uint8_t *fwu_data_last = (uint8_t *) otaCtx_inst->fwu_stage.secondary_bd_progunit;
-        size_t fwu_offset_last = fwu_offset;
-        size_t fwu_todo_last = otaCtx_inst->fwu_stage.secondary_bd_progunit_size;
-        memcpy(fwu_data_last, fwu_data, fwu_todo);
-        fwu_data += fwu_todo;
-        fwu_offset += fwu_todo;
-        fwu_rmn -= fwu_todo;
-
-        /* Program last program unit */
-        rc = otaCtx_inst->fwu_stage.secondary_bd->program(fwu_data_last,
-                                                          fwu_offset_last,
-                                                          fwu_todo_last);
-        if (rc != 0) {
-            Log_Error("Secondary BlockDevice program(addr=%d, size=%d) failed: %d",
-                      fwu_offset_last, fwu_todo_last, rc);
-            result = { .ResultCode = ADUC_Result_Failure };
-            goto done;
-        }
+    /* Running digest of downloaded part while checkpoints are ahead */
+    if (otaCtx_inst->dl_prog.next_checkpoint &&
+        USHAInput(&otaCtx_inst->dl_prog.prefix_sha, (const uint8_t *) dl_data, dl_length) != 0) {
+        Log_Error("Error in SHA Input, SHA version: %d", SHA256);
+        result = { .ResultCode = ADUC_Result_Failure };
+        goto done;
     }
 
     /* Advance download offset */
-    MBED_ASSERT(fwu_rmn == 0);
     otaCtx_inst->dl_prog.offset += dl_length;
 
 done:
@@ -784,13 +1375,14 @@ done:
 }
 
 bool MCUbUpdateHandlerImpl::VerifySignature(const tagADUC_WorkflowData* workflowData,
-                                            void* fileEntity_opaque)
+                                            int imageIndex,
+                                            const void* fileEntity_opaque)
 {
     MBED_ASSERT(fileEntity_opaque != nullptr);
-    ADUC_FileEntity &fileEntity = *static_cast<ADUC_FileEntity*>(fileEntity_opaque);
+    const ADUC_FileEntityView &fileEntity = *static_cast<const ADUC_FileEntityView*>(fileEntity_opaque);
 
-    MBED_ASSERT(otaCtx_opaque != nullptr);
-    OTA_OperationContext_t *otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque);
+    MBED_ASSERT(otaCtx_opaque[imageIndex] != nullptr);
+    OTA_OperationContext_t *otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[imageIndex]);
 
     USHAContext shaCtx;
     uint8_t *shaDigest = nullptr;
@@ -800,12 +1392,11 @@ bool MCUbUpdateHandlerImpl::VerifySignature(const tagADUC_WorkflowData* workflow
     if (fileEntity.HashCount) {
         SHAversion shaVersion;
         int shaDigestSize;
-        char *hashType;
-        char *hashValueBase64;
+        const char *hashType = nullptr;
+        const char *hashValueBase64 = nullptr;
 
-        hashType = ADUC_HashUtils_GetHashType(fileEntity.Hash, fileEntity.HashCount, 0);
-        if (hashType == nullptr) {
-            Log_Error("ADUC_HashUtils_GetHashType(index=0) failed");
+        if (!workflow_file_view_get_hash(&fileEntity, 0, &hashType, &hashValueBase64)) {
+            Log_Error("workflow_file_view_get_hash(index=0) failed");
             rc_ret = false;
             goto cleanup;
         }
@@ -841,7 +1432,6 @@ bool MCUbUpdateHandlerImpl::VerifySignature(const tagADUC_WorkflowData* workflow
         fwu_offset = 0;
         fwu_rmn = fileEntity.SizeInBytes;
 
-        /* First or middle chunks which align on read block boundary */
         while (fwu_rmn) {
             fwu_todo = fwu_rmn;
 
@@ -850,12 +1440,7 @@ bool MCUbUpdateHandlerImpl::VerifySignature(const tagADUC_WorkflowData* workflow
                 fwu_todo = otaCtx_inst->fwu_stage.secondary_bd_readblock_size;
             }
 
-            /* Unaligned last chunk */
-            if (fwu_todo < otaCtx_inst->fwu_stage.secondary_bd_readblock_size) {
-                break;
-            }
-
-            /* Note buffer size is both aligned and actual */
+            /* Read cache takes care of unaligned last chunk */
             int rc_bd = otaCtx_inst->fwu_stage.secondary_bd->read(fwu_data,
                                                                   fwu_offset,
                                                                   fwu_todo);
@@ -879,35 +1464,6 @@ bool MCUbUpdateHandlerImpl::VerifySignature(const tagADUC_WorkflowData* workflow
             fwu_rmn -= fwu_todo;
         }
 
-        /* Last chunk which doesn't align on read block boundary */
-        if (fwu_rmn) {
-            fwu_todo = fwu_rmn;
-            MBED_ASSERT(fwu_todo < otaCtx_inst->fwu_stage.secondary_bd_readblock_size);
-
-            /* Note buffer size is aligned instead of actual */
-            int rc_bd = otaCtx_inst->fwu_stage.secondary_bd->read(fwu_data,
-                                                                  fwu_offset,
-                                                                  otaCtx_inst->fwu_stage.secondary_bd_readblock_size);
-            if (rc_bd != 0) {
-                LogError("Secondary BlockDevice read(addr=%d, size=%d) failed: %d",
-                         fwu_offset,
-                         otaCtx_inst->fwu_stage.secondary_bd_readblock_size,
-                         rc_bd);
-                rc_ret = false;
-                goto cleanup;
-            }
-
-            if (USHAInput(&shaCtx, fwu_data, fwu_todo) != 0) {
-                Log_Error("Error in SHA Input, SHA version: %d", shaVersion);
-                rc_ret = false;
-                goto cleanup;
-            };
-
-            /* Next data */
-            fwu_offset += fwu_todo;
-            fwu_rmn -= fwu_todo;
-        }
-
         /* SHA digest buffer */
         shaDigestSize = USHAHashSize(shaVersion);
         shaDigest = (uint8_t *) malloc(shaDigestSize);
@@ -927,14 +1483,6 @@ bool MCUbUpdateHandlerImpl::VerifySignature(const tagADUC_WorkflowData* workflow
             goto cleanup;
         }
 
-        /* Base64-encoded SHA digest: Expected */
-        hashValueBase64 = ADUC_HashUtils_GetHashValue(fileEntity.Hash, fileEntity.HashCount, 0);
-        if (hashValueBase64 == nullptr) {
-            Log_Error("ADUC_HashUtils_GetHashValue(index=0) failed");
-            rc_ret = false;
-            goto cleanup;
-        }
-
         /* Compare Base64-encoded SHA digest */
         if (strcmp(hashValueBase64, STRING_c_str(h_shaDigestBase64)) != 0) {
             Log_Error("Invalid Hash: SHAversion: %d: EXP %s, ACT %s",
@@ -953,10 +1501,213 @@ cleanup:
     return rc_ret;
 }
 
-bool MCUbUpdateHandlerImpl::OTACtx_Reinit(void)
+bool MCUbUpdateHandlerImpl::ResumeSettledDownload(const tagADUC_WorkflowData* workflowData,
+                                                  int imageIndex,
+                                                  size_t settledOffset,
+                                                  const void* fileEntity_opaque)
+{
+    MBED_ASSERT(fileEntity_opaque != nullptr);
+    const ADUC_FileEntityView &fileEntity = *static_cast<const ADUC_FileEntityView*>(fileEntity_opaque);
+    ADUC_WorkflowHandle handle = workflowData->WorkflowHandle;
+
+    /* Payload completely in secondary bd for the same deployment? Persisted progress
+     * counts images before this one too. */
+    uint32_t downloadOffset = 0;
+    if (!ADUC_WorkflowPersistence_GetDownloadOffset(handle, &downloadOffset, nullptr) ||
+        fileEntity.SizeInBytes == 0 ||
+        downloadOffset < settledOffset + fileEntity.SizeInBytes) {
+        return false;
+    }
+
+    Log_Info("Persisted download progress: %" PRIu32 " bytes, image %d at %d~%d",
+             downloadOffset, imageIndex, settledOffset, settledOffset + fileEntity.SizeInBytes);
+
+    /* OTA operation context, keeping secondary bd content */
+    if (!OTACtx_Reinit(imageIndex, false)) {
+        Log_Error("OTACtx_Reinit() failed");
+        return false;
+    }
+    MBED_ASSERT(otaCtx_opaque[imageIndex] != nullptr);
+    OTA_OperationContext_t *otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[imageIndex]);
+
+    /* Re-catch MCUBOOT header from secondary bd */
+    int rc_bd = otaCtx_inst->fwu_stage.secondary_bd->read(&(otaCtx_inst->fwu_stage.image_header),
+                                                          0,
+                                                          sizeof(struct image_header));
+    if (rc_bd != 0 ||
+        otaCtx_inst->fwu_stage.image_header.ih_magic != IMAGE_MAGIC) {
+        Log_Warn("Invalid MCUBOOT header in secondary BlockDevice. Re-download.");
+        return false;
+    }
+
+    /* Stage version was cleared by OTACtx_Reinit(). Save it again. */
+    if (imageIndex == 0 &&
+        !nvImgUpgSt_setStageVersion(&otaCtx_inst->fwu_stage.image_header.ih_ver)) {
+        Log_Error("nvImgUpgSt_setStageVersion() failed");
+        return false;
+    }
+
+    otaCtx_inst->dl_prog.offset = fileEntity.SizeInBytes;
+    otaCtx_inst->dl_prog.total_exp = fileEntity.SizeInBytes;
+    otaCtx_inst->dl_prog.total_act = fileEntity.SizeInBytes;
+
+    /* Don't trust storage blindly */
+    if (!VerifySignature(workflowData, imageIndex, &fileEntity)) {
+        Log_Warn("Persisted payload failed to verify. Re-download.");
+        return false;
+    }
+
+    return true;
+}
+
+bool MCUbUpdateHandlerImpl::ResumePartialDownload(const tagADUC_WorkflowData* workflowData,
+                                                  int imageIndex,
+                                                  size_t settledOffset,
+                                                  const void* fileEntity_opaque,
+                                                  uint8_t* prefixDigest)
+{
+    MBED_ASSERT(fileEntity_opaque != nullptr);
+    const ADUC_FileEntityView &fileEntity = *static_cast<const ADUC_FileEntityView*>(fileEntity_opaque);
+    ADUC_WorkflowHandle handle = workflowData->WorkflowHandle;
+
+    static_assert(SHA256HashSize == ADUC_PERSISTED_PREFIX_DIGEST_SIZE, "Persisted prefix digest must fit SHA-256");
+
+    /* Checkpoint of the same deployment within this image? Image header must be there to pick up. */
+    uint32_t downloadOffset = 0;
+    if (FWU_DOWNLOAD_CHECKPOINT_INTERVAL == 0 ||
+        imageIndex >= FWU_IMAGE_NUMBER ||
+        !ADUC_WorkflowPersistence_GetDownloadOffset(handle, &downloadOffset, prefixDigest) ||
+        downloadOffset < settledOffset + sizeof(struct image_header) ||
+        downloadOffset >= settledOffset + fileEntity.SizeInBytes) {
+        return false;
+    }
+    size_t partialOffset = downloadOffset - settledOffset;
+
+    Log_Info("Persisted download progress: %" PRIu32 " bytes, image %d at %d/%d",
+             downloadOffset, imageIndex, partialOffset, (int) fileEntity.SizeInBytes);
+
+    /* OTA operation context, keeping secondary bd content */
+    if (!OTACtx_Reinit(imageIndex, false)) {
+        Log_Error("OTACtx_Reinit() failed");
+        return false;
+    }
+    MBED_ASSERT(otaCtx_opaque[imageIndex] != nullptr);
+    OTA_OperationContext_t *otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[imageIndex]);
+
+    bool resumed = false;
+    uint8_t *fwu_data = (uint8_t *) otaCtx_inst->fwu_stage.secondary_bd_readblock;
+    size_t fwu_offset = 0;
+    USHAContext shaCtx;
+    uint8_t shaDigest[SHA256HashSize];
+
+    /* Re-catch MCUBOOT header from secondary bd */
+    int rc_bd = otaCtx_inst->fwu_stage.secondary_bd->read(&(otaCtx_inst->fwu_stage.image_header),
+                                                          0,
+                                                          sizeof(struct image_header));
+    if (rc_bd != 0 ||
+        otaCtx_inst->fwu_stage.image_header.ih_magic != IMAGE_MAGIC) {
+        Log_Warn("Invalid MCUBOOT header in secondary BlockDevice. Re-download.");
+        goto cleanup;
+    }
+
+    /* Stage version was cleared by OTACtx_Reinit(). Save it again. */
+    if (imageIndex == 0 &&
+        !nvImgUpgSt_setStageVersion(&otaCtx_inst->fwu_stage.image_header.ih_ver)) {
+        Log_Error("nvImgUpgSt_setStageVersion() failed");
+        goto cleanup;
+    }
+
+    /* Hash the part in secondary bd, which also restores running digest for later checkpoints */
+    if (USHAReset(&otaCtx_inst->dl_prog.prefix_sha, SHA256) != 0) {
+        Log_Error("Error in SHA Reset, SHAversion: %d", SHA256);
+        goto cleanup;
+    }
+    while (fwu_offset < partialOffset) {
+        size_t fwu_todo = partialOffset - fwu_offset;
+        if (fwu_todo > otaCtx_inst->fwu_stage.secondary_bd_readblock_size) {
+            fwu_todo = otaCtx_inst->fwu_stage.secondary_bd_readblock_size;
+        }
+
+        rc_bd = otaCtx_inst->fwu_stage.secondary_bd->read(fwu_data, fwu_offset, fwu_todo);
+        if (rc_bd != 0) {
+            Log_Error("Secondary BlockDevice read(addr=%d, size=%d) failed: %d", fwu_offset, fwu_todo, rc_bd);
+            goto cleanup;
+        }
+        if (USHAInput(&otaCtx_inst->dl_prog.prefix_sha, fwu_data, fwu_todo) != 0) {
+            Log_Error("Error in SHA Input, SHA version: %d", SHA256);
+            goto cleanup;
+        }
+        fwu_offset += fwu_todo;
+    }
+
+    /* Finalize a copy, keeping running digest open */
+    shaCtx = otaCtx_inst->dl_prog.prefix_sha;
+    if (USHAResult(&shaCtx, shaDigest) != 0) {
+        Log_Error("USHAResult() failed");
+        goto cleanup;
+    }
+
+    /* Don't trust storage blindly */
+    if (memcmp(shaDigest, prefixDigest, sizeof(shaDigest)) != 0) {
+        Log_Warn("Persisted part of image %d failed to verify. Re-download.", imageIndex);
+        goto cleanup;
+    }
+
+    otaCtx_inst->dl_prog.base = settledOffset;
+    otaCtx_inst->dl_prog.offset = partialOffset;
+    otaCtx_inst->dl_prog.total_exp = fileEntity.SizeInBytes;
+    otaCtx_inst->dl_prog.total_act = 0;
+    otaCtx_inst->dl_prog.next_checkpoint = fwu_next_checkpoint(partialOffset, fileEntity.SizeInBytes);
+    resumed = true;
+
+cleanup:
+    if (!resumed) {
+        OTACtx_Deinit(imageIndex);
+    }
+
+    return resumed;
+}
+
+void MCUbUpdateHandlerImpl::CheckpointDownload(const tagADUC_WorkflowData* workflowData, int imageIndex)
 {
-    OTACtx_Deinit();
-    MBED_ASSERT(otaCtx_opaque == nullptr);
+    ADUC_WorkflowHandle handle = workflowData->WorkflowHandle;
+
+    MBED_ASSERT(otaCtx_opaque[imageIndex] != nullptr);
+    OTA_OperationContext_t *otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[imageIndex]);
+    auto &dl_prog = otaCtx_inst->dl_prog;
+
+    USHAContext shaCtx = dl_prog.prefix_sha;
+    uint8_t shaDigest[SHA256HashSize];
+
+    /* Next one, unless past the end, where the settled image is persisted instead */
+    dl_prog.next_checkpoint = fwu_next_checkpoint(dl_prog.offset, dl_prog.total_exp);
+
+    /* Checkpoint must not count data still in write-back cache */
+    int rc_sync = otaCtx_inst->fwu_stage.secondary_bd->sync();
+    if (rc_sync != 0) {
+        Log_Warn("Download checkpoint: Secondary BlockDevice sync() failed: %d", rc_sync);
+        return;
+    }
+
+    if (USHAResult(&shaCtx, shaDigest) != 0) {
+        Log_Warn("Download checkpoint: USHAResult() failed");
+        return;
+    }
+
+    /* Only in image order. Skipped if images before this one haven't settled. */
+    if (ADUC_WorkflowPersistence_SaveDownloadCheckpoint(handle,
+                                                        dl_prog.base,
+                                                        dl_prog.total_exp,
+                                                        dl_prog.offset,
+                                                        shaDigest)) {
+        Log_Info("Download checkpoint: Image %d at %d/%d bytes", imageIndex, dl_prog.offset, dl_prog.total_exp);
+    }
+}
+
+bool MCUbUpdateHandlerImpl::OTACtx_Reinit(int imageIndex, bool eraseSecondary)
+{
+    OTACtx_Deinit(imageIndex);
+    MBED_ASSERT(otaCtx_opaque[imageIndex] == nullptr);
 
     bool rc_ret = true;
 
@@ -965,9 +1716,10 @@ bool MCUbUpdateHandlerImpl::OTACtx_Reinit(void)
 
     /* Clean, zero-initialized struct */
     memset(otaCtx_inst, 0x00, sizeof(OTA_OperationContext_t));
+    otaCtx_inst->fwu_stage.image_index = imageIndex;
 
-    /* Reset non-volatile image state */
-    if (!nvImgUpgSt_reset(false)) {
+    /* Reset non-volatile image state on starting over the image set */
+    if (imageIndex == 0 && !nvImgUpgSt_reset(false)) {
         Log_Error("nvImgUpgSt_reset() failed");
         rc_ret = false;
         goto cleanup;
@@ -976,13 +1728,18 @@ bool MCUbUpdateHandlerImpl::OTACtx_Reinit(void)
     /* Prepare secondary bd */
     {
         /* Get secondary bd */
-        otaCtx_inst->fwu_stage.secondary_bd = get_secondary_bd();
-        if (otaCtx_inst->fwu_stage.secondary_bd == nullptr) {
-            Log_Error("get_secondary_bd() failed");
+        BlockDevice *secondary_bd_raw = fwu_stage_bd(imageIndex);
+        if (secondary_bd_raw == nullptr) {
+            Log_Error("Stage BlockDevice of image %d not available", imageIndex);
             rc_ret = false;
             goto cleanup;
         }
 
+        /* Front secondary bd with write-back/read cache to save bus transactions */
+        otaCtx_inst->fwu_stage.secondary_bd = new WriteBackBlockDevice(secondary_bd_raw,
+                                                                       FWU_WRITE_BLOCK_DEFSIZE,
+                                                                       FWU_READ_BLOCK_DEFSIZE);
+
         /* Initialize secondary bd */
         int rc_bd = otaCtx_inst->fwu_stage.secondary_bd->init();
         if (rc_bd != 0) {
@@ -992,49 +1749,46 @@ bool MCUbUpdateHandlerImpl::OTACtx_Reinit(void)
         }
         otaCtx_inst->fwu_stage.secondary_bd_inited = true;
 
-        otaCtx_inst->fwu_stage.secondary_bd_progunit_size = otaCtx_inst->fwu_stage.secondary_bd->get_program_size();
-        otaCtx_inst->fwu_stage.secondary_bd_progunit = malloc(otaCtx_inst->fwu_stage.secondary_bd_progunit_size);
-
-        size_t read_size = otaCtx_inst->fwu_stage.secondary_bd->get_read_size();
+        /* Read unit of write-back cache is 1, so any read block size works. */
         otaCtx_inst->fwu_stage.secondary_bd_readblock_size = FWU_READ_BLOCK_DEFSIZE;
-        if (FWU_READ_BLOCK_DEFSIZE < read_size) {
-            otaCtx_inst->fwu_stage.secondary_bd_readblock_size = read_size;
-        }
         otaCtx_inst->fwu_stage.secondary_bd_readblock = malloc(otaCtx_inst->fwu_stage.secondary_bd_readblock_size);
 
         size_t second_bd_size = otaCtx_inst->fwu_stage.secondary_bd->size();
         Log_Info("Secondary BlockDevice size: %d (bytes)", second_bd_size);
 
-        /* Erase secondary bd */
-        rc_bd = otaCtx_inst->fwu_stage.secondary_bd->erase(0, second_bd_size);
-        if (rc_bd != 0) {
-            Log_Error("Secondary BlockDevice erase() failed: -%08x", -rc_bd);
-            rc_ret = false;
-            goto cleanup;
+        /* Erase secondary bd, unless resuming with its content */
+        if (eraseSecondary) {
+            rc_bd = otaCtx_inst->fwu_stage.secondary_bd->erase(0, second_bd_size);
+            if (rc_bd != 0) {
+                Log_Error("Secondary BlockDevice erase() failed: -%08x", -rc_bd);
+                rc_ret = false;
+                goto cleanup;
+            }
         }
     }
 
     /* Success */
-    otaCtx_opaque = otaCtx_inst;
+    otaCtx_opaque[imageIndex] = otaCtx_inst;
 
 cleanup:
 
     if (!rc_ret) {
-        /* Failure */
-        delete otaCtx_inst;
+        /* Failure: release partially prepared secondary bd too */
+        otaCtx_opaque[imageIndex] = otaCtx_inst;
+        OTACtx_Deinit(imageIndex);
         otaCtx_inst = nullptr;
     }
 
     return rc_ret;
 }
 
-void MCUbUpdateHandlerImpl::OTACtx_Deinit(void)
+void MCUbUpdateHandlerImpl::OTACtx_Deinit(int imageIndex)
 {
-    if (otaCtx_opaque == nullptr) {
+    if (otaCtx_opaque[imageIndex] == nullptr) {
         return;
     }
 
-    OTA_OperationContext_t *otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque);
+    OTA_OperationContext_t *otaCtx_inst = static_cast<OTA_OperationContext_t *>(otaCtx_opaque[imageIndex]);
 
     /* Deinit secondary bd */
     if (otaCtx_inst->fwu_stage.secondary_bd) {
@@ -1044,153 +1798,55 @@ void MCUbUpdateHandlerImpl::OTACtx_Deinit(void)
             otaCtx_inst->fwu_stage.secondary_bd_readblock_size = 0;
         }
 
-        if (otaCtx_inst->fwu_stage.secondary_bd_progunit) {
-            free(otaCtx_inst->fwu_stage.secondary_bd_progunit);
-            otaCtx_inst->fwu_stage.secondary_bd_progunit = nullptr;
-            otaCtx_inst->fwu_stage.secondary_bd_progunit_size = 0;
-        }
-
+        /* Flush pending data in write-back cache on deinit */
         if (otaCtx_inst->fwu_stage.secondary_bd_inited) {
             otaCtx_inst->fwu_stage.secondary_bd->deinit();
             otaCtx_inst->fwu_stage.secondary_bd_inited = false;
         }
+        delete otaCtx_inst->fwu_stage.secondary_bd;
         otaCtx_inst->fwu_stage.secondary_bd = nullptr;
     }
 
     delete otaCtx_inst;
     otaCtx_inst = nullptr;
-    otaCtx_opaque = nullptr;
+    otaCtx_opaque[imageIndex] = nullptr;
 }
     
 /*-----------------------------------------------------------*/
 
-static bool nvImgUpgSt_reset(bool includeReserved)
-{
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (includeReserved || !nvImgUpgSt_getAll(&imageUpgradeState)) {
-        memset(&imageUpgradeState, 0x00, sizeof(OTA_NonVolatileImageUpgradeState_t));
-    } else {
-        static_assert(offsetof(OTA_NonVolatileImageUpgradeState_t, reserved) < sizeof(OTA_NonVolatileImageUpgradeState_t),
-                      "Invalid reserved region offset in OTA_NonVolatileImageUpgradeState_t");
-        memset(&imageUpgradeState, 0x00, offsetof(OTA_NonVolatileImageUpgradeState_t, reserved));
-    }
-
-    return nvImgUpgSt_setAll(&imageUpgradeState);
-}
-
-static bool nvImgUpgSt_setStageVersion(struct image_version *stageVersion)
-{
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
-        return false;
-    }
-
-    memcpy(&(imageUpgradeState.stageVersion),
-           stageVersion,
-           sizeof(struct image_version));
-    imageUpgradeState.stageVersion_valid = true;
-
-    return nvImgUpgSt_setAll(&imageUpgradeState);
-}
-
-static bool nvImgUpgSt_setInstallRebooted(bool installRebooted)
-{
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
-        return false;
-    }
-
-    imageUpgradeState.installRebooted = installRebooted;
-    imageUpgradeState.installRebooted_valid = true;
-
-    return nvImgUpgSt_setAll(&imageUpgradeState);
-}
-
-static bool nvImgUpgSt_setStageInstalledCriteria(const char *installedCriteria)
-{
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
-        return false;
-    }
-
-    size_t len = strlen(installedCriteria);
-    if (len > INSTALLEDCRITERIA_MAXCHAR) {
-        return false;
-    }
-
-    memcpy(imageUpgradeState.stageInstalledCriteria,
-           installedCriteria,
-           len + 1);
-    imageUpgradeState.stageInstalledCriteria_valid = true;
-
-    return nvImgUpgSt_setAll(&imageUpgradeState);
-}
-
-/**
- * @brief Make stage installed criteria become persistent
- *
- * @note Stage installed criteria will be cleared on success.
- */
-static bool nvImgUpgSt_settleInstalledCriteria(void)
-{
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
-        return false;
-    }
-
-    if (!imageUpgradeState.stageInstalledCriteria_valid) {
-        return false;
-    }
-
-    size_t len = strlen(imageUpgradeState.stageInstalledCriteria);
-    if (len > INSTALLEDCRITERIA_MAXCHAR) {
-        return false;
-    }
-
-    /* Copy stage installed criteria to persistent one */
-    memcpy(imageUpgradeState.persistentInstalledCriteria,
-           imageUpgradeState.stageInstalledCriteria,
-           len + 1);
-    imageUpgradeState.persistentInstalledCriteria_valid = true;
-
-    /* Clear stage installed criteria */
-    imageUpgradeState.stageInstalledCriteria_valid = false;
-    memset(imageUpgradeState.stageInstalledCriteria, 
-           0x00,
-           INSTALLEDCRITERIA_MAXCHAR + 1);
-
-    return nvImgUpgSt_setAll(&imageUpgradeState);
-}
-
-static bool nvImgUpgSt_installed(bool *confirmed)
+bool imgUpgSt_installed(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState, bool *confirmed)
 {
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
+    if (!imageUpgradeState->installRebooted_valid ||
+        !imageUpgradeState->installRebooted) {
         return false;
     }
 
-    if (!imageUpgradeState.installRebooted_valid ||
-        !imageUpgradeState.installRebooted) {
+    if (!imageUpgradeState->stageVersion_valid) {
         return false;
     }
 
-    if (!imageUpgradeState.stageVersion_valid) {
+    int active_slot = fwu_active_slot();
+    struct image_header active_header;
+    if (!fwu_read_slot_header(active_slot, &active_header)) {
         return false;
     }
+    const struct image_version *active_version = &(active_header.ih_ver);
 
-    const struct image_header *active_header = (const struct image_header *) MCUBOOT_PRIMARY_SLOT_START_ADDR;
-    const struct image_version *active_version = &(active_header->ih_ver);
-
-    if (0 != memcmp(&(imageUpgradeState.stageVersion),
+    if (0 != memcmp(&(imageUpgradeState->stageVersion),
                     active_version,
                     sizeof(struct image_version))) {
         return false;
     }
 
+#if FWU_APPLY_IN_PLACE && !FWU_APPLY_IN_PLACE_REVERT
+    /* Without revert, the higher version is permanent once booted */
+    *confirmed = true;
+    return true;
+#else
     const struct flash_area *fap = nullptr;
     uint8_t image_ok = BOOT_FLAG_UNSET;
 
-    if ((flash_area_open(FLASH_AREA_IMAGE_PRIMARY(0), &fap)) != 0) {
+    if ((flash_area_open(fwu_slot_flash_area_id(active_slot), &fap)) != 0) {
         return false;
     }
 
@@ -1214,102 +1870,5 @@ cleanup:
         *confirmed = false;
         return true;
     }
-}
-
-static bool nvImgUpgSt_installRebooted(bool *installRebooted)
-{
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
-        return false;
-    }
-
-    if (!imageUpgradeState.installRebooted_valid) {
-        return false;
-    }
-
-    *installRebooted = imageUpgradeState.installRebooted;
-    return true;
-}
-
-static bool nvImgUpgSt_persistentInstalledCriteria(char *installedCriteria, size_t installedCriteria_maxlen)
-{
-    OTA_NonVolatileImageUpgradeState_t imageUpgradeState;
-    if (!nvImgUpgSt_getAll(&imageUpgradeState)) {
-        return false;
-    }
-
-    if (!imageUpgradeState.persistentInstalledCriteria_valid) {
-        return false;
-    }
-
-    size_t len = strlen(imageUpgradeState.persistentInstalledCriteria);
-    if ((len + 1) > installedCriteria_maxlen) {
-        return false;
-    }
-
-    memcpy(installedCriteria,
-           imageUpgradeState.persistentInstalledCriteria,
-           len + 1);
-
-    return true;
-}
-
-static bool nvImgUpgSt_setAll(const OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
-{
-    int kv_status = kv_set(KV_DEF_FQ_KEY(OTA_IMAGE_UPDATE_STATE_KEY),
-                           imageUpgradeState,
-                           sizeof(OTA_NonVolatileImageUpgradeState_t),
-                           0);
-    if (kv_status != MBED_SUCCESS) {
-        return false;
-    }
-
-    return true;
-}
-
-static bool nvImgUpgSt_getAll(OTA_NonVolatileImageUpgradeState_t *imageUpgradeState)
-{
-    size_t actual_size = 0;
-
-    int kv_status = kv_get(KV_DEF_FQ_KEY(OTA_IMAGE_UPDATE_STATE_KEY),
-                           imageUpgradeState,
-                           sizeof(OTA_NonVolatileImageUpgradeState_t),
-                           &actual_size);
-    if (kv_status != MBED_SUCCESS) {
-        return false;
-    }
-    if (actual_size != sizeof(OTA_NonVolatileImageUpgradeState_t)) {
-        return false;
-    }
-
-    return true;
-}
-
-/*-----------------------------------------------------------*/
-
-static int bd_read_program_unit(mbed::BlockDevice *bd,
-                                void *progunit,
-                                size_t progunit_size,
-                                void *readblock,
-                                size_t readblock_size,
-                                size_t offset)
-{
-    /* Support only read block size >= program unit size */
-    MBED_ASSERT(readblock_size >= progunit_size);
-
-    int rc = 0;
-    size_t readblock_aligndown = (offset / readblock_size) * readblock_size;
-    size_t progunit_aligndown = (offset / progunit_size) * progunit_size;
-    MBED_ASSERT(progunit_aligndown >= readblock_aligndown);
-
-    rc = bd->read(readblock, readblock_aligndown, readblock_size);
-    if (rc != 0) {
-        return rc;
-    }
-
-    memcpy(progunit,
-           ((const uint8_t *) readblock) + progunit_aligndown - readblock_aligndown,
-           progunit_size);
-
-    return rc;
+#endif
 }
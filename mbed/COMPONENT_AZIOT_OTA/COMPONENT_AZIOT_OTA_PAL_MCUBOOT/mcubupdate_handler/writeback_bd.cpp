@@ -0,0 +1,410 @@
+/*
+ * Copyright (c) 2022, Nuvoton Technology Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "writeback_bd.h"
+#include "trace_ring.h"
+
+#include "platform/mbed_assert.h"
+#include <stdlib.h>
+#include <string.h>
+
+using mbed::bd_addr_t;
+using mbed::bd_size_t;
+
+static inline bd_size_t align_down(bd_size_t val, bd_size_t size)
+{
+    return (val / size) * size;
+}
+
+static inline bd_size_t align_up(bd_size_t val, bd_size_t size)
+{
+    return ((val + size - 1) / size) * size;
+}
+
+WriteBackBlockDevice::WriteBackBlockDevice(mbed::BlockDevice *bd,
+                                           bd_size_t write_buffer_size,
+                                           bd_size_t read_buffer_size) :
+    _bd(bd),
+    _is_initialized(false),
+    _write_buf(nullptr),
+    _write_buf_size(0),
+    _write_buf_size_req(write_buffer_size),
+    _write_addr(0),
+    _write_fill(0),
+    _write_valid(false),
+    _write_dirty(false),
+    _read_buf(nullptr),
+    _read_buf_size(0),
+    _read_buf_size_req(read_buffer_size),
+    _read_addr(0),
+    _read_valid(false),
+    _program_size(0),
+    _bus_reads(0),
+    _bus_programs(0)
+{
+    MBED_ASSERT(_bd != nullptr);
+}
+
+WriteBackBlockDevice::~WriteBackBlockDevice()
+{
+    deinit();
+}
+
+int WriteBackBlockDevice::init()
+{
+    if (_is_initialized) {
+        return BD_ERROR_OK;
+    }
+
+    int rc = _bd->init();
+    if (rc != BD_ERROR_OK) {
+        return rc;
+    }
+
+    _program_size = _bd->get_program_size();
+
+    /* Write-back window must cover whole program units */
+    _write_buf_size = align_up(_write_buf_size_req ? _write_buf_size_req : _program_size, _program_size);
+    /* Read cache block must cover whole read units */
+    _read_buf_size = align_up(_read_buf_size_req ? _read_buf_size_req : _bd->get_read_size(), _bd->get_read_size());
+
+    _write_buf = static_cast<uint8_t *>(malloc(_write_buf_size));
+    _read_buf = static_cast<uint8_t *>(malloc(_read_buf_size));
+    if (_write_buf == nullptr || _read_buf == nullptr) {
+        free(_write_buf);
+        _write_buf = nullptr;
+        free(_read_buf);
+        _read_buf = nullptr;
+        _bd->deinit();
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    _write_valid = false;
+    _write_dirty = false;
+    _write_fill = 0;
+    _read_valid = false;
+    _bus_reads = 0;
+    _bus_programs = 0;
+    _is_initialized = true;
+
+    return BD_ERROR_OK;
+}
+
+int WriteBackBlockDevice::deinit()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_OK;
+    }
+
+    /* Don't lose pending data */
+    int rc = flush_write();
+
+    free(_write_buf);
+    _write_buf = nullptr;
+    free(_read_buf);
+    _read_buf = nullptr;
+    _write_valid = false;
+    _read_valid = false;
+    _is_initialized = false;
+
+    int rc_deinit = _bd->deinit();
+    return (rc != BD_ERROR_OK) ? rc : rc_deinit;
+}
+
+int WriteBackBlockDevice::sync()
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int rc = flush_write();
+    if (rc != BD_ERROR_OK) {
+        return rc;
+    }
+
+    return _bd->sync();
+}
+
+int WriteBackBlockDevice::read(void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    /* Pending data in range must reach device first */
+    if (_write_dirty &&
+        addr < (_write_addr + _write_fill) &&
+        _write_addr < (addr + size)) {
+        int rc = flush_write();
+        if (rc != BD_ERROR_OK) {
+            return rc;
+        }
+    }
+
+    return read_cached(static_cast<uint8_t *>(buffer), addr, size);
+}
+
+int WriteBackBlockDevice::program(const void *buffer, bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    const uint8_t *buf = static_cast<const uint8_t *>(buffer);
+    int rc = BD_ERROR_OK;
+
+    while (size) {
+        /* Start new window if the program doesn't continue current one */
+        if (!_write_valid ||
+            addr != (_write_addr + _write_fill) ||
+            _write_fill == _write_buf_size) {
+            rc = flush_write();
+            if (rc != BD_ERROR_OK) {
+                return rc;
+            }
+
+            _write_addr = align_down(addr, _program_size);
+            _write_fill = addr - _write_addr;
+            _write_valid = true;
+
+            /* Merge device content ahead of unaligned start */
+            if (_write_fill) {
+                rc = read_cached(_write_buf, _write_addr, _write_fill);
+                if (rc != BD_ERROR_OK) {
+                    _write_valid = false;
+                    return rc;
+                }
+            }
+        }
+
+        /* Large aligned data: program straight without copy */
+        if (_write_fill == 0 && size >= _write_buf_size) {
+            bd_size_t todo = align_down(size, _program_size);
+            invalidate_read(addr, todo);
+            _bus_programs ++;
+            TRACE_RING_BEGIN("secondary_bd_program");
+            rc = _bd->program(buf, addr, todo);
+            TRACE_RING_END("secondary_bd_program");
+            if (rc != BD_ERROR_OK) {
+                _write_valid = false;
+                return rc;
+            }
+            buf += todo;
+            addr += todo;
+            size -= todo;
+            _write_addr = addr;
+            continue;
+        }
+
+        bd_size_t todo = _write_buf_size - _write_fill;
+        if (todo > size) {
+            todo = size;
+        }
+        memcpy(_write_buf + _write_fill, buf, todo);
+        _write_fill += todo;
+        _write_dirty = true;
+        buf += todo;
+        addr += todo;
+        size -= todo;
+
+        /* Window full */
+        if (_write_fill == _write_buf_size) {
+            rc = flush_write();
+            if (rc != BD_ERROR_OK) {
+                return rc;
+            }
+        }
+    }
+
+    return rc;
+}
+
+int WriteBackBlockDevice::erase(bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int rc = flush_write();
+    if (rc != BD_ERROR_OK) {
+        return rc;
+    }
+
+    /* Window and cache content no longer match device */
+    _write_valid = false;
+    _read_valid = false;
+
+    return _bd->erase(addr, size);
+}
+
+int WriteBackBlockDevice::trim(bd_addr_t addr, bd_size_t size)
+{
+    if (!_is_initialized) {
+        return BD_ERROR_DEVICE_ERROR;
+    }
+
+    int rc = flush_write();
+    if (rc != BD_ERROR_OK) {
+        return rc;
+    }
+
+    _write_valid = false;
+    _read_valid = false;
+
+    return _bd->trim(addr, size);
+}
+
+bd_size_t WriteBackBlockDevice::get_read_size() const
+{
+    return 1;
+}
+
+bd_size_t WriteBackBlockDevice::get_program_size() const
+{
+    return 1;
+}
+
+bd_size_t WriteBackBlockDevice::get_erase_size() const
+{
+    return _bd->get_erase_size();
+}
+
+bd_size_t WriteBackBlockDevice::get_erase_size(bd_addr_t addr) const
+{
+    return _bd->get_erase_size(addr);
+}
+
+int WriteBackBlockDevice::get_erase_value() const
+{
+    return _bd->get_erase_value();
+}
+
+bd_size_t WriteBackBlockDevice::size() const
+{
+    return _bd->size();
+}
+
+const char *WriteBackBlockDevice::get_type() const
+{
+    return _bd->get_type();
+}
+
+int WriteBackBlockDevice::flush_write()
+{
+    if (!_write_dirty) {
+        return BD_ERROR_OK;
+    }
+
+    /* Pad last unaligned program unit with device content */
+    bd_size_t todo = align_up(_write_fill, _program_size);
+    if (todo > _write_fill) {
+        int rc = read_cached(_write_buf + _write_fill,
+                             _write_addr + _write_fill,
+                             todo - _write_fill);
+        if (rc != BD_ERROR_OK) {
+            return rc;
+        }
+    }
+
+    invalidate_read(_write_addr, todo);
+    _bus_programs ++;
+    TRACE_RING_BEGIN("secondary_bd_program");
+    int rc = _bd->program(_write_buf, _write_addr, todo);
+    TRACE_RING_END("secondary_bd_program");
+    if (rc != BD_ERROR_OK) {
+        _write_valid = false;
+        _write_dirty = false;
+        return rc;
+    }
+
+    /* Slide window past the programmed units, keeping only the last partial
+     * program unit so that a following sequential program can continue it
+     * without reading it back. Full units must not be programmed again. */
+    bd_addr_t tail_addr = align_down(_write_addr + _write_fill, _program_size);
+    bd_size_t tail_size = (_write_addr + _write_fill) - tail_addr;
+    if (tail_size) {
+        memmove(_write_buf, _write_buf + (tail_addr - _write_addr), tail_size);
+    }
+    _write_addr = tail_addr;
+    _write_fill = tail_size;
+    _write_dirty = false;
+    return BD_ERROR_OK;
+}
+
+int WriteBackBlockDevice::read_cached(uint8_t *buffer, bd_addr_t addr, bd_size_t size)
+{
+    int rc = BD_ERROR_OK;
+    bd_size_t bd_size = _bd->size();
+
+    while (size) {
+        /* Hit in read cache */
+        if (_read_valid &&
+            addr >= _read_addr &&
+            addr < (_read_addr + _read_buf_size)) {
+            bd_size_t todo = _read_addr + _read_buf_size - addr;
+            if (todo > size) {
+                todo = size;
+            }
+            memcpy(buffer, _read_buf + (addr - _read_addr), todo);
+            buffer += todo;
+            addr += todo;
+            size -= todo;
+            continue;
+        }
+
+        /* Large aligned data: read straight without copy */
+        if ((addr % _read_buf_size) == 0 && size >= _read_buf_size) {
+            bd_size_t todo = align_down(size, _read_buf_size);
+            _bus_reads ++;
+            rc = _bd->read(buffer, addr, todo);
+            if (rc != BD_ERROR_OK) {
+                return rc;
+            }
+            buffer += todo;
+            addr += todo;
+            size -= todo;
+            continue;
+        }
+
+        /* Fill read cache with the block covering addr */
+        bd_addr_t block_addr = align_down(addr, _read_buf_size);
+        bd_size_t block_size = _read_buf_size;
+        if ((block_addr + block_size) > bd_size) {
+            block_size = bd_size - block_addr;
+        }
+        _bus_reads ++;
+        rc = _bd->read(_read_buf, block_addr, block_size);
+        if (rc != BD_ERROR_OK) {
+            _read_valid = false;
+            return rc;
+        }
+        _read_addr = block_addr;
+        _read_valid = true;
+    }
+
+    return rc;
+}
+
+void WriteBackBlockDevice::invalidate_read(bd_addr_t addr, bd_size_t size)
+{
+    if (_read_valid &&
+        addr < (_read_addr + _read_buf_size) &&
+        _read_addr < (addr + size)) {
+        _read_valid = false;
+    }
+}
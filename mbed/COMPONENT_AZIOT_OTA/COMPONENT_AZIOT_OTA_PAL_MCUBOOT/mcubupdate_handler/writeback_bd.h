@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022, Nuvoton Technology Corporation
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef WRITEBACK_BD_H
+#define WRITEBACK_BD_H
+
+#include "blockdevice/BlockDevice.h"
+
+/** Write-back/read-cache adapter in front of the secondary slot BlockDevice
+ *
+ * OTA download delivers firmware in arbitrarily sized, sequential chunks.
+ * Programming each chunk straight through costs a read-modify-program of
+ * the unaligned program unit at both chunk ends, each of which is a slow bus
+ * transaction on SPIF/NUSD. This adapter instead:
+ *
+ * - Accumulates sequential programs in a RAM window and programs it as one
+ *   large aligned write when it fills up.
+ * - Keeps the last read block in RAM to serve small/unaligned reads.
+ * - Passes large aligned reads/programs through without copy.
+ *
+ * Read and program sizes are exposed as 1. Pending data is only guaranteed
+ * to reach the underlying BlockDevice after sync() or deinit(), so callers
+ * must sync() on completion or cancel.
+ */
+class WriteBackBlockDevice : public mbed::BlockDevice
+{
+public:
+    /** Constructor
+     *
+     * @param bd                Underlying BlockDevice
+     * @param write_buffer_size Size of write-back window, rounded up to program size
+     * @param read_buffer_size  Size of read cache block, rounded up to read size
+     */
+    WriteBackBlockDevice(mbed::BlockDevice *bd,
+                         mbed::bd_size_t write_buffer_size,
+                         mbed::bd_size_t read_buffer_size);
+
+    ~WriteBackBlockDevice() override;
+
+    int init() override;
+    int deinit() override;
+    int sync() override;
+
+    int read(void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size) override;
+    int program(const void *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size) override;
+    int erase(mbed::bd_addr_t addr, mbed::bd_size_t size) override;
+    int trim(mbed::bd_addr_t addr, mbed::bd_size_t size) override;
+
+    mbed::bd_size_t get_read_size() const override;
+    mbed::bd_size_t get_program_size() const override;
+    mbed::bd_size_t get_erase_size() const override;
+    mbed::bd_size_t get_erase_size(mbed::bd_addr_t addr) const override;
+    int get_erase_value() const override;
+    mbed::bd_size_t size() const override;
+    const char *get_type() const override;
+
+    /** Number of read() calls issued to the underlying BlockDevice */
+    uint32_t get_bus_read_count() const
+    {
+        return _bus_reads;
+    }
+
+    /** Number of program() calls issued to the underlying BlockDevice */
+    uint32_t get_bus_program_count() const
+    {
+        return _bus_programs;
+    }
+
+private:
+    /* Program the pending write-back window, padding its tail with device content */
+    int flush_write();
+
+    /* Read through read cache, bypassing write-back window */
+    int read_cached(uint8_t *buffer, mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    /* Drop read cache if it overlaps the given range */
+    void invalidate_read(mbed::bd_addr_t addr, mbed::bd_size_t size);
+
+    mbed::BlockDevice * _bd;
+    bool                _is_initialized;
+
+    /* Write-back window: [_write_addr, _write_addr + _write_fill) holds valid data */
+    uint8_t *           _write_buf;
+    mbed::bd_size_t     _write_buf_size;
+    mbed::bd_size_t     _write_buf_size_req;
+    mbed::bd_addr_t     _write_addr;
+    mbed::bd_size_t     _write_fill;
+    bool                _write_valid;
+    bool                _write_dirty;
+
+    /* Read cache: one block at _read_addr */
+    uint8_t *           _read_buf;
+    mbed::bd_size_t     _read_buf_size;
+    mbed::bd_size_t     _read_buf_size_req;
+    mbed::bd_addr_t     _read_addr;
+    bool                _read_valid;
+
+    mbed::bd_size_t     _program_size;
+
+    uint32_t            _bus_reads;
+    uint32_t            _bus_programs;
+};
+
+#endif  /* WRITEBACK_BD_H */
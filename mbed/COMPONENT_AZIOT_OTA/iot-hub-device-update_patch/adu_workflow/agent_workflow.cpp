@@ -46,9 +46,35 @@
 #include "rtos/Mutex.h"
 #endif
 
+// NUVOTON: Persist workflow state in KVStore instead of file system
+#include "mbed_workflow_persistence.h"
+// NUVOTON: Table-driven transitions on update action and step completion
+#include "mbed_workflow_transition.h"
+#include "aduc/adu_core_interface.h" // AzureDeviceUpdateCoreInterface_ReportStateAndResultAsync
+#include "aduc/reported_state_writer.h"
+
 // fwd decl
 void ADUC_Workflow_WorkCompletionCallback(const void* workCompletionToken, ADUC_Result result, bool isAsync);
 
+// NUVOTON: Serialize reported state into one buffer with fixed-schema templates and hand it to D2C messaging
+//          without copy, instead of building a parson tree and copying the serialized string.
+/**
+ * @brief Swap upstream default reporting callback for ADUC_ReportedState_ReportAsync().
+ *
+ * Called once, on agent startup before anything is reported. Reporting keeps going through
+ * ReportStateAndResultAsyncCallback, so a callback installed by the application or a test is left in place.
+ *
+ * @param[in,out] workflowData Workflow data.
+ */
+static void UseReportedStateWriter(ADUC_WorkflowData* workflowData)
+{
+    if (workflowData->ReportStateAndResultAsyncCallback == NULL
+        || workflowData->ReportStateAndResultAsyncCallback == AzureDeviceUpdateCoreInterface_ReportStateAndResultAsync)
+    {
+        workflowData->ReportStateAndResultAsyncCallback = ADUC_ReportedState_ReportAsync;
+    }
+}
+
 // This lock is used for critical sections where main and worker thread could read/write to ADUC_workflowData
 // It is used only at the top-level coarse granularity operations:
 //     * (main thread) ADUC_Workflow_HandlePropertyUpdate
@@ -80,6 +106,23 @@ static inline void s_workflow_unlock(void)
 }
 #endif
 
+// NUVOTON: Hot fields read once per update action or step completion, for mbed_workflow_transition tables
+/**
+ * @brief Read the fields of the workflow that transitions depend on.
+ * @remark Must be in a lock.
+ *
+ * @param handle The workflow handle.
+ * @param[out] fields The fields.
+ */
+static void ReadTransitionFields(ADUC_WorkflowHandle handle, ADUC_WorkflowTransitionFields* fields)
+{
+    fields->Action = workflow_get_action(handle);
+    fields->WorkflowStep = workflow_get_current_workflowstep(handle);
+    fields->CancellationType = workflow_get_cancellation_type(handle);
+    fields->OperationInProgress = workflow_get_operation_in_progress(handle);
+    fields->OperationCancelRequested = workflow_get_operation_cancel_requested(handle);
+}
+
 static const char* ADUC_Workflow_CancellationTypeToString(ADUC_WorkflowCancellationType cancellationType)
 {
     switch (cancellationType)
@@ -247,6 +290,8 @@ typedef struct tagADUC_WorkflowHandlerMapEntry
 
     const ADUC_Workflow_OperationCompleteFunc OperationCompleteFunc;
 
+    // NUVOTON: States and steps to transition to are in mbed_workflow_transition tables
+#if 0
     const ADUCITF_State NextStateOnSuccess; /**< State to transition to on successful operation */
 
     /**< The next workflow step input to transition workflow after transitioning to above NextStateOnSuccess when current
@@ -260,8 +305,21 @@ typedef struct tagADUC_WorkflowHandlerMapEntry
      *     workflow step is above WorkflowStep. Using ADUCITF_WorkflowStep_Undefined means it ends the workflow.
      */
     const ADUCITF_WorkflowStep AutoTransitionWorkflowStepOnFailure;
+#endif
 } ADUC_WorkflowHandlerMapEntry;
 
+// NUVOTON: Entries of workflowHandlerMap below, in order, for switch lookup instead of linear search
+enum
+{
+    WorkflowHandlerMapIndex_ProcessDeployment,
+    WorkflowHandlerMapIndex_Download,
+    WorkflowHandlerMapIndex_Backup,
+    WorkflowHandlerMapIndex_Install,
+    WorkflowHandlerMapIndex_Apply,
+    WorkflowHandlerMapIndex_Restore,
+    WorkflowHandlerMapIndex_Count
+};
+
 // clang-format off
 /**
  * @brief Workflow action table.
@@ -279,6 +337,9 @@ typedef struct tagADUC_WorkflowHandlerMapEntry
  *     of the workflow specified by NextWorkflowStepAfterNextState, but only if
  *     AutoTransitionApplicableUpdateAction is equal to the current update action of the workflow data.
  */
+// NUVOTON: constexpr for checking entry order at compile time. States and steps to transition to are in
+//          mbed_workflow_transition tables.
+#if 0
 const ADUC_WorkflowHandlerMapEntry workflowHandlerMap[] = {
     { ADUCITF_WorkflowStep_ProcessDeployment,
         /* calls operation */                               ADUC_Workflow_MethodCall_ProcessDeployment,
@@ -340,9 +401,51 @@ const ADUC_WorkflowHandlerMapEntry workflowHandlerMap[] = {
         /* on failure auto-transitions to workflow step */  ADUCITF_WorkflowStep_Undefined,
     },
 };
+#else
+constexpr ADUC_WorkflowHandlerMapEntry workflowHandlerMap[] = {
+    { ADUCITF_WorkflowStep_ProcessDeployment,
+        /* calls operation */                               ADUC_Workflow_MethodCall_ProcessDeployment,
+        /* and on completion calls */                       ADUC_Workflow_MethodCall_ProcessDeployment_Complete,
+    },
+
+    { ADUCITF_WorkflowStep_Download,
+        /* calls operation */                               ADUC_Workflow_MethodCall_Download,
+        /* and on completion calls */                       ADUC_Workflow_MethodCall_Download_Complete,
+    },
+
+    { ADUCITF_WorkflowStep_Backup,
+        /* calls operation */                               ADUC_Workflow_MethodCall_Backup,
+        /* and on completion calls */                       ADUC_Workflow_MethodCall_Backup_Complete,
+    },
+
+    { ADUCITF_WorkflowStep_Install,
+        /* calls operation */                               ADUC_Workflow_MethodCall_Install,
+        /* and on completion calls */                       ADUC_Workflow_MethodCall_Install_Complete,
+    },
+
+    { ADUCITF_WorkflowStep_Apply,
+        /* calls operation */                               ADUC_Workflow_MethodCall_Apply,
+        /* and on completion calls */                       ADUC_Workflow_MethodCall_Apply_Complete,
+    },
+
+    { ADUCITF_WorkflowStep_Restore,
+        /* calls operation */                               ADUC_Workflow_MethodCall_Restore,
+        /* and on completion calls */                       ADUC_Workflow_MethodCall_Restore_Complete,
+    },
+};
+#endif
 
 // clang-format on
 
+// NUVOTON: Check workflowHandlerMap against index enum above
+static_assert(ARRAY_SIZE(workflowHandlerMap) == WorkflowHandlerMapIndex_Count, "workflowHandlerMap size mismatch");
+static_assert(workflowHandlerMap[WorkflowHandlerMapIndex_ProcessDeployment].WorkflowStep == ADUCITF_WorkflowStep_ProcessDeployment, "workflowHandlerMap order mismatch");
+static_assert(workflowHandlerMap[WorkflowHandlerMapIndex_Download].WorkflowStep == ADUCITF_WorkflowStep_Download, "workflowHandlerMap order mismatch");
+static_assert(workflowHandlerMap[WorkflowHandlerMapIndex_Backup].WorkflowStep == ADUCITF_WorkflowStep_Backup, "workflowHandlerMap order mismatch");
+static_assert(workflowHandlerMap[WorkflowHandlerMapIndex_Install].WorkflowStep == ADUCITF_WorkflowStep_Install, "workflowHandlerMap order mismatch");
+static_assert(workflowHandlerMap[WorkflowHandlerMapIndex_Apply].WorkflowStep == ADUCITF_WorkflowStep_Apply, "workflowHandlerMap order mismatch");
+static_assert(workflowHandlerMap[WorkflowHandlerMapIndex_Restore].WorkflowStep == ADUCITF_WorkflowStep_Restore, "workflowHandlerMap order mismatch");
+
 /**
  * @brief Get the Workflow Handler Map Entry for a workflow step
  *
@@ -351,6 +454,8 @@ const ADUC_WorkflowHandlerMapEntry workflowHandlerMap[] = {
  */
 const ADUC_WorkflowHandlerMapEntry* GetWorkflowHandlerMapEntryForAction(ADUCITF_WorkflowStep workflowStep)
 {
+    // NUVOTON: Switch lookup, compiled to jump table, instead of linear search on every transition
+#if 0
     const ADUC_WorkflowHandlerMapEntry* entry;
     const unsigned int map_count = ARRAY_SIZE(workflowHandlerMap);
     unsigned index;
@@ -368,6 +473,27 @@ const ADUC_WorkflowHandlerMapEntry* GetWorkflowHandlerMapEntryForAction(ADUCITF_
     }
 
     return entry;
+#else
+    switch (workflowStep)
+    {
+    case ADUCITF_WorkflowStep_ProcessDeployment:
+        return &workflowHandlerMap[WorkflowHandlerMapIndex_ProcessDeployment];
+    case ADUCITF_WorkflowStep_Download:
+        return &workflowHandlerMap[WorkflowHandlerMapIndex_Download];
+    case ADUCITF_WorkflowStep_Backup:
+        return &workflowHandlerMap[WorkflowHandlerMapIndex_Backup];
+    case ADUCITF_WorkflowStep_Install:
+        return &workflowHandlerMap[WorkflowHandlerMapIndex_Install];
+    case ADUCITF_WorkflowStep_Apply:
+        return &workflowHandlerMap[WorkflowHandlerMapIndex_Apply];
+    case ADUCITF_WorkflowStep_Restore:
+        return &workflowHandlerMap[WorkflowHandlerMapIndex_Restore];
+    case ADUCITF_WorkflowStep_Undefined:
+        break;
+    }
+
+    return NULL;
+#endif
 }
 
 /**
@@ -398,6 +524,9 @@ void ADUC_Workflow_HandleStartupWorkflowData(ADUC_WorkflowData* currentWorkflowD
         return;
     }
 
+    // NUVOTON: Workflow data is set up by now. Install reported state writer before startup reports.
+    UseReportedStateWriter(currentWorkflowData);
+
     Log_Info("Perform startup tasks.");
 
     // NOTE: WorkflowHandle can be NULL when device first connected to the hub (no desired property).
@@ -644,11 +773,13 @@ done:
  */
 void ADUC_Workflow_HandleUpdateAction(ADUC_WorkflowData* workflowData)
 {
-    // NUVOTON: Fix for C++ strong typing
+    // NUVOTON: Fix for C++ strong typing. Hot fields read once, for decision from mbed_workflow_transition table.
 #if 0
     unsigned int desiredAction = workflow_get_action(workflowData->WorkflowHandle);
 #else
-    ADUCITF_UpdateAction desiredAction = workflow_get_action(workflowData->WorkflowHandle);
+    ADUC_WorkflowTransitionFields fields;
+    ReadTransitionFields(workflowData->WorkflowHandle, &fields);
+    ADUCITF_UpdateAction desiredAction = fields.Action;
 #endif
 
     // Special case: Cancel is handled here.
@@ -666,6 +797,8 @@ void ADUC_Workflow_HandleUpdateAction(ADUC_WorkflowData* workflowData)
     // * A rollout end time has passed & the device has been offline and did not receive the previous command.
     //
 
+    // NUVOTON: Decision from mbed_workflow_transition table instead of if/else chain
+#if 0
     ADUC_WorkflowCancellationType cancellationType = workflow_get_cancellation_type(workflowData->WorkflowHandle);
     Log_Debug(
         "cancellationType(%d) => %s", cancellationType, ADUC_Workflow_CancellationTypeToString(cancellationType));
@@ -709,6 +842,47 @@ void ADUC_Workflow_HandleUpdateAction(ADUC_WorkflowData* workflowData)
             // Continue processing workflow below.
         }
     }
+#else
+    Log_Debug(
+        "cancellationType(%d) => %s",
+        fields.CancellationType,
+        ADUC_Workflow_CancellationTypeToString(fields.CancellationType));
+
+    switch (ADUC_WorkflowTransition_OnUpdateAction(&fields))
+    {
+    case ADUC_WorkflowUpdateDecision_CancelOperation:
+        Log_Info(
+            "Canceling request for in-progress operation. desiredAction: %s, cancellationType: %s",
+            ADUCITF_UpdateActionToString(desiredAction),
+            ADUC_Workflow_CancellationTypeToString(fields.CancellationType));
+
+        // This sets a marker that cancellation has been requested.
+        workflow_set_operation_cancel_requested(workflowData->WorkflowHandle, true);
+
+        // Call upper-layer to notify of cancel
+        ADUC_Workflow_MethodCall_Cancel(workflowData);
+        goto done;
+
+    case ADUC_WorkflowUpdateDecision_ReturnToIdle:
+        // Cancel without an operation in progress means return to Idle state.
+        workflow_set_operation_cancel_requested(workflowData->WorkflowHandle, false);
+        workflow_set_cancellation_type(workflowData->WorkflowHandle, ADUC_WorkflowCancellationType_None);
+
+        Log_Info("Cancel received with no operation in progress - returning to Idle state");
+        goto done;
+
+    case ADUC_WorkflowUpdateDecision_ClearAndProcess:
+        workflow_set_operation_cancel_requested(workflowData->WorkflowHandle, false);
+        workflow_set_cancellation_type(workflowData->WorkflowHandle, ADUC_WorkflowCancellationType_None);
+
+        Log_Info("Replace/Retry when operation not in progress. Try to process workflow...");
+        // Continue processing workflow below.
+        break;
+
+    case ADUC_WorkflowUpdateDecision_Process:
+        break;
+    }
+#endif
 
     // Ignore duplicate deployment that can be caused by token expiry connection refresh after about 40 minutes.
     if (workflow_isequal_id(workflowData->WorkflowHandle, workflowData->LastCompletedWorkflowId)
@@ -766,6 +940,14 @@ void ADUC_Workflow_HandleUpdateAction(ADUC_WorkflowData* workflowData)
     if (nextStep == ADUCITF_WorkflowStep_ProcessDeployment)
     {
         Cleanup_Previous_Sandboxes(workflowData);
+
+        // NUVOTON: Deployment interrupted by unexpected reset is re-processed, then resumes after the last step
+        //          it completed (see ResumeWorkflowStep()). Content handler can skip payload already in storage.
+        //          See ADUC_WorkflowPersistence_GetDownloadOffset().
+        if (ADUC_WorkflowPersistence_IsSameDeployment(workflowData->WorkflowHandle))
+        {
+            Log_Info("Resuming persisted workflow '%s'", workflow_peek_id(workflowData->WorkflowHandle));
+        }
     }
 
     //
@@ -778,6 +960,46 @@ done:
     return;
 }
 
+// NUVOTON: Resume deployment interrupted by unexpected reset
+/**
+ * @brief Get the workflow step to go on with after deployment is processed, and restore state, for the same
+ * deployment recorded before startup.
+ * @remark Must be in a lock.
+ *
+ * Resumes after the last step completed with success. Deployment processing itself isn't skipped, as it sets up
+ * the content handler for the steps after it.
+ *
+ * @param workflowData The global context workflow data structure.
+ * @param nextWorkflowStep The workflow step to go on with, if there is nothing to resume.
+ * @return The workflow step to go on with.
+ */
+static ADUCITF_WorkflowStep ResumeWorkflowStep(ADUC_WorkflowData* workflowData, ADUCITF_WorkflowStep nextWorkflowStep)
+{
+    ADUCITF_WorkflowStep persistedStep = ADUCITF_WorkflowStep_Undefined;
+    ADUCITF_State persistedState = ADUCITF_State_Idle;
+    if (!ADUC_WorkflowPersistence_TakeStartupPhase(workflowData->WorkflowHandle, &persistedStep, &persistedState))
+    {
+        return nextWorkflowStep;
+    }
+
+    ADUC_WorkflowCompletion completed = ADUC_WorkflowTransition_GetNext(persistedStep, true);
+    if (completed.Kind != ADUC_WorkflowCompletion_NextStep || persistedStep == ADUCITF_WorkflowStep_ProcessDeployment
+        || persistedState != completed.NextState || AgentOrchestration_IsWorkflowComplete(completed.NextStep))
+    {
+        return nextWorkflowStep;
+    }
+
+    Log_Info(
+        "Persisted workflow completed step %s (state %s) before reset",
+        ADUCITF_WorkflowStepToString(persistedStep),
+        ADUCITF_StateToString(persistedState));
+
+    workflow_set_state(workflowData->WorkflowHandle, persistedState);
+    ADUC_WorkflowData_SetLastReportedState(persistedState, workflowData);
+
+    return completed.NextStep;
+}
+
 /**
  * @brief Looks up the current workflow step in the state transition table and invokes a step transition if the workflow is not complete.
  * @remark This is called by worker thread at the end of work completion processing.
@@ -796,13 +1018,25 @@ void ADUC_Workflow_AutoTransitionWorkflow(ADUC_WorkflowData* workflowData, bool
     //
     ADUCITF_WorkflowStep currentWorkflowStep = workflow_get_current_workflowstep(workflowData->WorkflowHandle);
 
+    // NUVOTON: Next step from mbed_workflow_transition table
+#if 0
     const ADUC_WorkflowHandlerMapEntry* postCompleteEntry = GetWorkflowHandlerMapEntryForAction(currentWorkflowStep);
     if (postCompleteEntry == NULL)
     {
         Log_Error("Invalid workflow step %u", currentWorkflowStep);
         return;
     }
+#else
+    ADUC_WorkflowCompletion completion = ADUC_WorkflowTransition_GetNext(currentWorkflowStep, onSuccess);
+    if (completion.Kind != ADUC_WorkflowCompletion_NextStep)
+    {
+        Log_Error("Invalid workflow step %u", currentWorkflowStep);
+        return;
+    }
+#endif
 
+    // NUVOTON: Pick next step once, instead of duplicate success/failure branches
+#if 0
     if (!onSuccess)
     {
         if (AgentOrchestration_IsWorkflowComplete(postCompleteEntry->AutoTransitionWorkflowStepOnFailure))
@@ -840,6 +1074,26 @@ void ADUC_Workflow_AutoTransitionWorkflow(ADUC_WorkflowData* workflowData, bool
             ADUC_Workflow_TransitionWorkflow(workflowData);
         }
     }
+#else
+    ADUCITF_WorkflowStep nextWorkflowStep = completion.NextStep;
+
+    if (onSuccess && currentWorkflowStep == ADUCITF_WorkflowStep_ProcessDeployment)
+    {
+        nextWorkflowStep = ResumeWorkflowStep(workflowData, nextWorkflowStep);
+    }
+
+    if (AgentOrchestration_IsWorkflowComplete(nextWorkflowStep))
+    {
+        Log_Info("Workflow is Complete.");
+        return;
+    }
+
+    workflow_set_current_workflowstep(workflowData->WorkflowHandle, nextWorkflowStep);
+
+    Log_Info("workflow is not completed. AutoTransition to step: %s", ADUCITF_WorkflowStepToString(nextWorkflowStep));
+
+    ADUC_Workflow_TransitionWorkflow(workflowData);
+#endif
 }
 
 /**
@@ -964,6 +1218,8 @@ void ADUC_Workflow_WorkCompletionCallback(const void* workCompletionToken, ADUC_
 
     entry->OperationCompleteFunc(methodCallData, result);
 
+    // NUVOTON: Next state and step, or completion of cancel, from mbed_workflow_transition table
+#if 0
     if (IsAducResultCodeSuccess(result.ResultCode))
     {
         // Operation succeeded -- go to next state.
@@ -1092,6 +1348,131 @@ void ADUC_Workflow_WorkCompletionCallback(const void* workCompletionToken, ADUC_
             ADUC_Workflow_AutoTransitionWorkflow(workflowData, false);
         }
     }
+#else
+    ADUC_WorkflowTransitionFields fields;
+    ReadTransitionFields(workflowData->WorkflowHandle, &fields);
+
+    ADUC_WorkflowCompletion completion;
+    completion = ADUC_WorkflowTransition_OnComplete(&fields, IsAducResultCodeSuccess(result.ResultCode));
+
+    if (completion.Kind != ADUC_WorkflowCompletion_NextStep)
+    {
+        Log_Warn(
+            "Handling cancel completion, cancellation type '%s'.",
+            ADUC_Workflow_CancellationTypeToString(fields.CancellationType));
+    }
+
+    switch (completion.Kind)
+    {
+    case ADUC_WorkflowCompletion_NextStep:
+        if (IsAducResultCodeSuccess(result.ResultCode))
+        {
+            // Operation succeeded -- go to next state.
+            Log_Info(
+                "WorkCompletionCallback: %s succeeded. Going to state %s",
+                ADUCITF_WorkflowStepToString(entry->WorkflowStep),
+                ADUCITF_StateToString(completion.NextState));
+
+            ADUC_Workflow_SetUpdateState(workflowData, completion.NextState);
+
+            // Transitioning to idle (or failed) state frees and nulls-out the WorkflowHandle as a side-effect of
+            // setting the update state.
+            if (ADUC_WorkflowData_GetLastReportedState(workflowData) != ADUCITF_State_Idle)
+            {
+                // Operation is now complete. Clear both inprogress and cancel requested.
+                workflow_clear_inprogress_and_cancelrequested(workflowData->WorkflowHandle);
+
+                //
+                // We are now ready to transition to the next step of the workflow.
+                //
+                ADUC_Workflow_AutoTransitionWorkflow(workflowData, true);
+            }
+        }
+        else
+        {
+            // Operation failed.
+            Log_Info(
+                "WorkCompletionCallback: %s failed. Going to state %s",
+                ADUCITF_WorkflowStepToString(entry->WorkflowStep),
+                ADUCITF_StateToString(completion.NextState));
+
+            // Reset so that a Retry/Replacement avoids cancel and instead properly starts processing.
+            workflow_set_operation_in_progress(workflowData->WorkflowHandle, false);
+
+            ADUC_Workflow_SetUpdateState(workflowData, completion.NextState);
+
+            ADUC_Workflow_AutoTransitionWorkflow(workflowData, false);
+        }
+        break;
+
+    case ADUC_WorkflowCompletion_Restart:
+        Log_Info(
+            "Starting process of deployment for '%s'", ADUC_Workflow_CancellationTypeToString(fields.CancellationType));
+
+        // Note: Must NOT call linux platform layer Idle method to reset cancellation request to false in the
+        // platform layer because that would destroy and NULL out the WorkflowHandle in the workflowData.
+
+        if (fields.CancellationType == ADUC_WorkflowCancellationType_Replacement)
+        {
+            // Cleanup the download sandbox for the current workflowId
+            // since it will not be transitioning to Idle state (where
+            // sandbox cleanup is normally done)
+
+            char* workflowId = ADUC_WorkflowData_GetWorkflowId(workflowData); // see workflow_free_string below
+            char* workFolder = ADUC_WorkflowData_GetWorkFolder(workflowData); // see workflow_free_string below
+
+            if (workflowId != NULL && workFolder != NULL)
+            {
+                Log_Info("Cleanup sandbox before replacement workflow");
+
+                const ADUC_UpdateActionCallbacks* updateActionCallbacks = &(workflowData->UpdateActionCallbacks);
+
+                updateActionCallbacks->SandboxDestroyCallback(
+                    updateActionCallbacks->PlatformLayerHandle, workflowId, workFolder);
+            }
+
+            workflow_free_string(workflowId);
+            workflow_free_string(workFolder);
+
+            // Reset workflow state to process deployment and transfer
+            // the deferred workflow to current.
+            workflow_update_for_replacement(workflowData->WorkflowHandle);
+        }
+        else
+        {
+            // it's a retry. Reset workflow state to reprocess deployment.
+            workflow_update_for_retry(workflowData->WorkflowHandle);
+        }
+
+        ADUC_WorkflowData_SetLastReportedState(ADUCITF_State_Idle, workflowData);
+
+        // ProcessDeployment's OperationFunc called by TransitionWorkflow is synchronous so it kicks off the
+        // download worker thread after reporting DeploymentInProgress ACK for the replacement/retry.
+        ADUC_Workflow_TransitionWorkflow(workflowData);
+        break;
+
+    case ADUC_WorkflowCompletion_Cancelled:
+    {
+        // Operation cancelled.
+        //
+        // We are now at the completion of the operation that was cancelled via a Cancel update action
+        // and will just return to Idle state.
+        //
+        // Ignore the result of the operation, which most likely is cancelled, e.g. ADUC_Result_Failure_Cancelled.
+        Log_Warn("Operation cancelled - returning to Idle state");
+
+        const ADUC_Result cancelledResult = { .ResultCode = ADUC_Result_Failure_Cancelled };
+        ADUC_Workflow_SetUpdateStateWithResult(workflowData, completion.NextState, cancelledResult);
+        break;
+    }
+
+    case ADUC_WorkflowCompletion_Invalid:
+        Log_Error(
+            "Invalid cancellation Type '%s' when cancel requested.",
+            ADUC_Workflow_CancellationTypeToString(fields.CancellationType));
+        break;
+    }
+#endif
 
 done:
     // lifetime of methodCallData now ends as the operation work has completed.
@@ -1141,6 +1522,25 @@ void ADUC_Workflow_DefaultDownloadProgressCallback(
         bytesTotal);
 }
 
+/**
+ * @brief Report state and result to the service through the workflow's reporting callback.
+ *
+ * @param[in] workflowData Workflow data.
+ * @param[in] updateState Update state to report.
+ * @param[in] result Result to report (optional, can be NULL).
+ * @param[in] installedUpdateId Installed update id to report (optional, can be NULL).
+ * @return true if the report was queued.
+ */
+static bool ReportStateAndResult(
+    ADUC_WorkflowData* workflowData,
+    ADUCITF_State updateState,
+    const ADUC_Result* result,
+    const char* installedUpdateId)
+{
+    return workflowData->ReportStateAndResultAsyncCallback(
+        (ADUC_WorkflowDataToken)workflowData, updateState, result, installedUpdateId);
+}
+
 /**
  * @brief Move state machine to a new stage.
  *
@@ -1203,8 +1603,8 @@ static void ADUC_Workflow_SetUpdateStateHelper(
             // Fall through to report Idle without InstalledUpdateId.
         }
 
-        if (!workflowData->ReportStateAndResultAsyncCallback(
-                (ADUC_WorkflowDataToken)workflowData, updateState, result, NULL /* installedUpdateId */))
+        if (!ReportStateAndResult(
+                workflowData, updateState, result, NULL /* installedUpdateId */))
         {
             updateState = ADUCITF_State_Failed;
             workflow_set_state(workflowData->WorkflowHandle, ADUCITF_State_Failed);
@@ -1216,8 +1616,8 @@ static void ADUC_Workflow_SetUpdateStateHelper(
     }
     else // Not Idle state
     {
-        if (!workflowData->ReportStateAndResultAsyncCallback(
-                (ADUC_WorkflowDataToken)workflowData, updateState, result, NULL /* installedUpdateId */))
+        if (!ReportStateAndResult(
+                workflowData, updateState, result, NULL /* installedUpdateId */))
         {
             updateState = ADUCITF_State_Failed;
             workflow_set_state(workflowData->WorkflowHandle, ADUCITF_State_Failed);
@@ -1229,6 +1629,16 @@ static void ADUC_Workflow_SetUpdateStateHelper(
     }
 
     ADUC_WorkflowData_SetLastReportedState(updateState, workflowData);
+
+    // NUVOTON: Persist workflow state at phase boundary to resume deployment across unexpected reset
+    if (updateState == ADUCITF_State_Idle)
+    {
+        ADUC_WorkflowPersistence_Clear();
+    }
+    else
+    {
+        ADUC_WorkflowPersistence_SavePhase(workflowData->WorkflowHandle, updateState);
+    }
 }
 
 // NUVOTON: Unnecessary for no downloadHandler implementation
@@ -1317,8 +1727,8 @@ void ADUC_Workflow_SetInstalledUpdateIdAndGoToIdle(ADUC_WorkflowData* workflowDa
 {
     ADUC_Result idleResult = { .ResultCode = ADUC_Result_Apply_Success, .ExtendedResultCode = 0 };
 
-    if (!workflowData->ReportStateAndResultAsyncCallback(
-            (ADUC_WorkflowDataToken)workflowData, ADUCITF_State_Idle, &idleResult, updateId))
+    if (!ReportStateAndResult(
+            workflowData, ADUCITF_State_Idle, &idleResult, updateId))
     {
         Log_Error("Failed to report last installed updateId. Going to idle state.");
     }
@@ -1330,6 +1740,9 @@ void ADUC_Workflow_SetInstalledUpdateIdAndGoToIdle(ADUC_WorkflowData* workflowDa
         Log_Error("Failed to set last completed workflow id. Going to idle state.");
     }
 
+    // NUVOTON: Deployment completed, nothing to resume
+    ADUC_WorkflowPersistence_Clear();
+
 // NUVOTON: Unnecessary for no downloadHandler implementation
 #if 0
     CallDownloadHandlerOnUpdateWorkflowCompleted(workflowData->WorkflowHandle);
@@ -0,0 +1,79 @@
+/**
+ * @file reported_state_writer.h
+ * @brief Fixed-schema writer of the deviceUpdate 'agent' reported property.
+ *
+ * Upstream GetReportingJsonValue() builds the reported property with a parson tree (one allocation
+ * per node) and ADUC_D2C_Message_SendAsync() then copies the serialized string again. The schema is
+ * fixed, so here the JSON is written from precomputed templates straight into one buffer, sized by a
+ * measuring pass, and handed to the D2C messaging utility without copy.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef ADUC_REPORTED_STATE_WRITER_H
+#define ADUC_REPORTED_STATE_WRITER_H
+
+#include "aduc/c_utils.h"
+#include "aduc/result.h"
+#include "aduc/types/adu_core.h" // ADUCITF_State
+#include "aduc/types/workflow.h" // ADUC_WorkflowData
+#include <stdbool.h>
+#include <stddef.h>
+
+EXTERN_C_BEGIN
+
+/**
+ * @brief Write the deviceUpdate reported property into @p buf.
+ *
+ * Members and values are the same as upstream GetReportingJsonValue(), in the same order. The text is not
+ * guaranteed byte-for-byte identical: string escaping follows RFC 8259 rather than parson (e.g. '/' is not
+ * escaped). Output looks like:
+ * {"deviceUpdate":{"__t":"c","agent":{"state":0,"workflow":{...},"installedUpdateId":"...","lastInstallResult":{...}}}}
+ *
+ * @param buf The output buffer. Can be NULL with @p size 0 to measure only.
+ * @param size The size of @p buf in bytes.
+ * @param workflowData The workflow data. Can be NULL.
+ * @param updateState The state to report.
+ * @param result The result to report. If NULL, result of the workflow is used.
+ * @param installedUpdateId The installed update id. Omitted if NULL.
+ * @return Length of the JSON string excluding the null terminator. The output is complete only if
+ *         less than @p size.
+ */
+size_t ADUC_ReportedState_Serialize(
+    char* buf,
+    size_t size,
+    const ADUC_WorkflowData* workflowData,
+    ADUCITF_State updateState,
+    const ADUC_Result* result,
+    const char* installedUpdateId);
+
+/**
+ * @brief Same as ADUC_ReportedState_Serialize() but into one exactly-sized malloc'd string.
+ *
+ * @return The JSON string, or NULL on failure. Caller must free() it.
+ */
+char* ADUC_ReportedState_SerializeToString(
+    const ADUC_WorkflowData* workflowData,
+    ADUCITF_State updateState,
+    const ADUC_Result* result,
+    const char* installedUpdateId);
+
+/**
+ * @brief Report state and result to the IoT Hub. Drop-in for upstream
+ * AzureDeviceUpdateCoreInterface_ReportStateAndResultAsync() as ADUC_WorkflowData::ReportStateAndResultAsyncCallback.
+ *
+ * @param workflowDataToken The workflow data token.
+ * @param updateState The state to report.
+ * @param result The result to report. Can be NULL.
+ * @param installedUpdateId The installed update id. Can be NULL.
+ * @return true if the message was queued for sending.
+ */
+bool ADUC_ReportedState_ReportAsync(
+    ADUC_WorkflowDataToken workflowDataToken,
+    ADUCITF_State updateState,
+    const ADUC_Result* result,
+    const char* installedUpdateId);
+
+EXTERN_C_END
+
+#endif // ADUC_REPORTED_STATE_WRITER_H
@@ -0,0 +1,305 @@
+/**
+ * @file reported_state_writer.c
+ * @brief Implements fixed-schema writer of the deviceUpdate 'agent' reported property.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#include "aduc/reported_state_writer.h"
+
+#include "aduc/adu_core_interface.h" // g_iotHubClientHandleForADUComponent
+#include "aduc/d2c_messaging.h"
+#include "aduc/logging.h"
+#include "aduc/workflow_data_utils.h"
+#include "aduc/workflow_utils.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Precomputed templates of the fixed schema. Member names and order follow upstream GetReportingJsonValue(). */
+#define TPL_ROOT_BEGIN "{\"deviceUpdate\":{\"__t\":\"c\",\"agent\":{\"state\":"
+#define TPL_WORKFLOW_ACTION ",\"workflow\":{\"action\":"
+#define TPL_WORKFLOW_ID ",\"id\":"
+#define TPL_WORKFLOW_RETRY_TIMESTAMP ",\"retryTimestamp\":"
+#define TPL_INSTALLED_UPDATE_ID ",\"installedUpdateId\":"
+#define TPL_LAST_INSTALL_RESULT ",\"lastInstallResult\":"
+#define TPL_RESULT_CODE "{\"resultCode\":"
+#define TPL_EXTENDED_RESULT_CODE ",\"extendedResultCode\":"
+#define TPL_RESULT_DETAILS ",\"resultDetails\":"
+#define TPL_STEP_RESULTS ",\"stepResults\":{"
+#define TPL_STEP_KEY_PREFIX "\"step_"
+#define TPL_ROOT_END "}}}"
+
+/**
+ * @brief Bounded output. Keeps counting past the end so that the first pass can measure.
+ */
+typedef struct tagADUC_ReportedStateWriter
+{
+    char* buf;
+    size_t size;
+    size_t len;
+} ADUC_ReportedStateWriter;
+
+static void WriteBytes(ADUC_ReportedStateWriter* w, const char* src, size_t n)
+{
+    if (w->len < w->size)
+    {
+        size_t room = w->size - w->len;
+        memcpy(w->buf + w->len, src, (n < room) ? n : room);
+    }
+    w->len += n;
+}
+
+#define WriteLiteral(w, lit) WriteBytes((w), (lit), sizeof(lit) - 1)
+
+static void WriteChar(ADUC_ReportedStateWriter* w, char c)
+{
+    WriteBytes(w, &c, 1);
+}
+
+static void WriteInt(ADUC_ReportedStateWriter* w, int32_t value)
+{
+    char tmp[12];
+    int n = snprintf(tmp, sizeof(tmp), "%" PRId32, value);
+    WriteBytes(w, tmp, (size_t)n);
+}
+
+/**
+ * @brief Write @p str as a quoted JSON string, escaping on the way.
+ */
+static void WriteEscapedString(ADUC_ReportedStateWriter* w, const char* str)
+{
+    static const char hex[] = "0123456789abcdef";
+    const char* run = str;
+    const char* p = str;
+
+    WriteChar(w, '"');
+    for (; *p != '\0'; p++)
+    {
+        unsigned char c = (unsigned char)*p;
+        const char* esc = NULL;
+        char uesc[6];
+
+        if (c == '"')
+        {
+            esc = "\\\"";
+        }
+        else if (c == '\\')
+        {
+            esc = "\\\\";
+        }
+        else if (c < 0x20)
+        {
+            switch (c)
+            {
+            case '\b':
+                esc = "\\b";
+                break;
+            case '\f':
+                esc = "\\f";
+                break;
+            case '\n':
+                esc = "\\n";
+                break;
+            case '\r':
+                esc = "\\r";
+                break;
+            case '\t':
+                esc = "\\t";
+                break;
+            default:
+                memcpy(uesc, "\\u00", 4);
+                uesc[4] = hex[c >> 4];
+                uesc[5] = hex[c & 0x0F];
+                break;
+            }
+        }
+        else
+        {
+            continue;
+        }
+
+        // Flush unescaped run before the escape sequence.
+        WriteBytes(w, run, (size_t)(p - run));
+        if (esc != NULL)
+        {
+            WriteBytes(w, esc, strlen(esc));
+        }
+        else
+        {
+            WriteBytes(w, uesc, sizeof(uesc));
+        }
+        run = p + 1;
+    }
+    WriteBytes(w, run, (size_t)(p - run));
+    WriteChar(w, '"');
+}
+
+/**
+ * @brief Write {"resultCode":..,"extendedResultCode":..[,"resultDetails":".."]
+ * The closing brace is left to the caller.
+ */
+static void WriteResult(ADUC_ReportedStateWriter* w, const ADUC_Result* result, const char* resultDetails)
+{
+    WriteLiteral(w, TPL_RESULT_CODE);
+    WriteInt(w, result->ResultCode);
+    WriteLiteral(w, TPL_EXTENDED_RESULT_CODE);
+    WriteInt(w, result->ExtendedResultCode);
+    if (resultDetails != NULL)
+    {
+        WriteLiteral(w, TPL_RESULT_DETAILS);
+        WriteEscapedString(w, resultDetails);
+    }
+}
+
+size_t ADUC_ReportedState_Serialize(
+    char* buf,
+    size_t size,
+    const ADUC_WorkflowData* workflowData,
+    ADUCITF_State updateState,
+    const ADUC_Result* result,
+    const char* installedUpdateId)
+{
+    ADUC_ReportedStateWriter w = { buf, size, 0 };
+    ADUC_WorkflowHandle handle = (workflowData != NULL) ? workflowData->WorkflowHandle : NULL;
+
+    WriteLiteral(&w, TPL_ROOT_BEGIN);
+    WriteInt(&w, (int32_t)updateState);
+
+    if (handle != NULL)
+    {
+        const char* id = workflow_peek_id(handle);
+        const char* retryTimestamp = workflow_peek_retryTimestamp(handle);
+
+        WriteLiteral(&w, TPL_WORKFLOW_ACTION);
+        WriteInt(&w, (int32_t)ADUC_WorkflowData_GetCurrentAction(workflowData));
+        WriteLiteral(&w, TPL_WORKFLOW_ID);
+        WriteEscapedString(&w, (id != NULL) ? id : "");
+        if (retryTimestamp != NULL && *retryTimestamp != '\0')
+        {
+            WriteLiteral(&w, TPL_WORKFLOW_RETRY_TIMESTAMP);
+            WriteEscapedString(&w, retryTimestamp);
+        }
+        WriteChar(&w, '}');
+    }
+
+    if (installedUpdateId != NULL)
+    {
+        WriteLiteral(&w, TPL_INSTALLED_UPDATE_ID);
+        WriteEscapedString(&w, installedUpdateId);
+    }
+
+    ADUC_Result rootResult = { .ResultCode = ADUC_Result_Failure, .ExtendedResultCode = 0 };
+    if (result != NULL)
+    {
+        rootResult = *result;
+    }
+    else if (handle != NULL)
+    {
+        rootResult = workflow_get_result(handle);
+    }
+
+    WriteLiteral(&w, TPL_LAST_INSTALL_RESULT);
+    WriteResult(&w, &rootResult, (handle != NULL) ? workflow_peek_result_details(handle) : NULL);
+
+    int childCount = (handle != NULL) ? workflow_get_children_count(handle) : 0;
+    if (childCount > 0)
+    {
+        WriteLiteral(&w, TPL_STEP_RESULTS);
+        for (int i = 0; i < childCount; i++)
+        {
+            ADUC_WorkflowHandle child = workflow_get_child(handle, i);
+            ADUC_Result childResult = workflow_get_result(child);
+
+            if (i > 0)
+            {
+                WriteChar(&w, ',');
+            }
+            WriteLiteral(&w, TPL_STEP_KEY_PREFIX);
+            WriteInt(&w, i);
+            WriteLiteral(&w, "\":");
+            WriteResult(&w, &childResult, workflow_peek_result_details(child));
+            WriteChar(&w, '}');
+        }
+        WriteChar(&w, '}');
+    }
+    WriteChar(&w, '}');
+
+    WriteLiteral(&w, TPL_ROOT_END);
+
+    // Null-terminate, truncated or not.
+    if (w.size > 0)
+    {
+        w.buf[(w.len < w.size) ? w.len : (w.size - 1)] = '\0';
+    }
+
+    return w.len;
+}
+
+char* ADUC_ReportedState_SerializeToString(
+    const ADUC_WorkflowData* workflowData,
+    ADUCITF_State updateState,
+    const ADUC_Result* result,
+    const char* installedUpdateId)
+{
+    // First pass measures, second pass writes.
+    size_t len = ADUC_ReportedState_Serialize(NULL, 0, workflowData, updateState, result, installedUpdateId);
+
+    char* jsonString = (char*)malloc(len + 1);
+    if (jsonString == NULL)
+    {
+        Log_Error("Out of memory for reported state (%u bytes)", (unsigned) (len + 1));
+        return NULL;
+    }
+
+    ADUC_ReportedState_Serialize(jsonString, len + 1, workflowData, updateState, result, installedUpdateId);
+    return jsonString;
+}
+
+/**
+ * @brief Callback when the D2C messaging utility finished with the reported state.
+ */
+static void OnReportedStateD2CMessageCompleted(void* message, ADUC_D2C_Message_Status status)
+{
+    UNREFERENCED_PARAMETER(message);
+    Log_Debug("Send message completed (status:%d)", status);
+}
+
+bool ADUC_ReportedState_ReportAsync(
+    ADUC_WorkflowDataToken workflowDataToken,
+    ADUCITF_State updateState,
+    const ADUC_Result* result,
+    const char* installedUpdateId)
+{
+    const ADUC_WorkflowData* workflowData = (const ADUC_WorkflowData*)workflowDataToken;
+
+    if (g_iotHubClientHandleForADUComponent == NULL)
+    {
+        Log_Error("ReportStateAsync called before registration! Can't report!");
+        return false;
+    }
+
+    char* jsonString = ADUC_ReportedState_SerializeToString(workflowData, updateState, result, installedUpdateId);
+    if (jsonString == NULL)
+    {
+        return false;
+    }
+
+    // Ownership of jsonString goes to the D2C messaging utility.
+    if (!ADUC_D2C_Message_SendAsync_TakeOwnership(
+            ADUC_D2C_Message_Type_Device_Update_Result,
+            &g_iotHubClientHandleForADUComponent,
+            jsonString,
+            NULL /* responseCallback */,
+            OnReportedStateD2CMessageCompleted,
+            NULL /* statusChangedCallback */,
+            NULL /* userData */))
+    {
+        Log_Error("Unable to send update result.");
+        return false;
+    }
+
+    return true;
+}
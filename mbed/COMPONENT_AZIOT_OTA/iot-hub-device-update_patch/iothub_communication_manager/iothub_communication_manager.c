@@ -49,6 +49,9 @@
 // NUVOTON: For including user configuration for model ID
 #include MBED_CONF_AZURE_CLIENT_OTA_ADUC_USER_CONFIG_FILE
 
+// NUVOTON: Profiling
+#include "trace_ring.h"
+
 /**
  * @brief A pointer to ADUC_ClientHandle data. This must be initialize by the component that creates the IoT Hub connection.
  */
@@ -228,6 +231,8 @@ void IoTHub_CommunicationManager_ConnectionStatus_Callback(
     switch (status)
     {
     case IOTHUB_CLIENT_CONNECTION_AUTHENTICATED:
+        // NUVOTON: Profiling. MQTT CONNACK accepted.
+        TRACE_RING_INSTANT("iothub_authenticated");
         g_last_authenticated_time = now_time;
         g_authentication_retries = 0;
         break;
@@ -252,6 +257,18 @@ void IoTHub_CommunicationManager_ConnectionStatus_Callback(
     g_last_connection_status_callback_time = now_time;
 }
 
+// NUVOTON: Profiling. Bracket device twin processing.
+static void IoTHub_CommunicationManager_DeviceTwin_Callback(
+    DEVICE_TWIN_UPDATE_STATE update_state, const unsigned char* payload, size_t size, void* user_context_callback)
+{
+    TRACE_RING_BEGIN("twin_receive");
+    if (g_device_twin_callback != NULL)
+    {
+        g_device_twin_callback(update_state, payload, size, user_context_callback);
+    }
+    TRACE_RING_END("twin_receive");
+}
+
 static IOTHUB_CLIENT_TRANSPORT_PROVIDER GetIotHubProtocolFromConfig()
 {
 #ifdef ADUC_GET_IOTHUB_PROTOCOL_FROM_CONFIG
@@ -434,7 +451,12 @@ static bool ADUC_DeviceClient_Create(
     // This will also automatically retrieve the full twin for the application.
     else if (
         (iothubResult =
+#if 0
              ClientHandle_SetClientTwinCallback(*outClientHandle, g_device_twin_callback, g_property_update_context))
+#else
+             ClientHandle_SetClientTwinCallback(
+                 *outClientHandle, IoTHub_CommunicationManager_DeviceTwin_Callback, g_property_update_context))
+#endif
         != IOTHUB_CLIENT_OK)
     {
         Log_Error("Unable to set device twin callback, error=%d", iothubResult);
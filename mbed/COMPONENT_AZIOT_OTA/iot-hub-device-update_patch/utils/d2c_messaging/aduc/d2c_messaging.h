@@ -214,6 +214,26 @@ bool ADUC_D2C_Message_SendAsync(
     ADUC_D2C_MESSAGE_STATUS_CHANGED_CALLBACK statusChangedCallback,
     void* userData);
 
+// NUVOTON: Avoid copying message built in a dedicated buffer
+/**
+ * @brief Same as ADUC_D2C_Message_SendAsync() but takes ownership of @p message instead of copying it.
+ *
+ * @param message The message content allocated by malloc(). Ownership passes to messaging utility on every path,
+ *                so it is freed by messaging utility once no longer processed. Caller must not access it after
+ *                this call. Passing NULL fails. Unlike ADUC_D2C_Message_SendAsync(), the queued
+ *                ADUC_D2C_Message::originalContent is @p message itself.
+ *
+ * @return Returns true if message successfully added to the pending-messages queue.
+ */
+bool ADUC_D2C_Message_SendAsync_TakeOwnership(
+    ADUC_D2C_Message_Type type,
+    void* cloudServiceHandle,
+    char* message,
+    ADUC_D2C_MESSAGE_HTTP_RESPONSE_CALLBACK responseCallback,
+    ADUC_D2C_MESSAGE_COMPLETED_CALLBACK completedCallback,
+    ADUC_D2C_MESSAGE_STATUS_CHANGED_CALLBACK statusChangedCallback,
+    void* userData);
+
 /**
  * @brief Sets the messaging transport. By default, the messaging utility will send messages to IoT Hub.
  *
@@ -571,40 +571,23 @@ void ADUC_D2C_Messaging_Uninit()
 #endif
 }
 
+// NUVOTON: Share queueing between ADUC_D2C_Message_SendAsync() and ADUC_D2C_Message_SendAsync_TakeOwnership()
 /**
- * @brief Submits the message to pending messages store. If the message for specified @p type already exist, it will be replaced by the new message.
+ * @brief Puts @p content to pending messages store, replacing the pending message of the same @p type.
  *
- * @param type The message type.
- * @param cloudServiceHandle An opaque pointer to the underlying cloud service handle.
- *                           By default, this is the handle to an Azure Iot C PnP device client.
- * @param message The required message content. For example, a JSON string containing 'reported' property of the IoT Hub Device Twin.
- * @param responseCallback A optional callback to be called when the device received a http response.
- * @param completedCallback An optional callback to be called when the messages processor stopped processing the message.
- * @param statusChangedCallback A optional callback to be called when the messages status has changed.
- * @param userData An additional user data.
- *
- * @return Returns true if message successfully added to the pending-messages queue.
+ * @param originalContent The message content as given by the caller. Stored as is in ADUC_D2C_Message::originalContent.
+ * @param content The malloc'd message content to send. Owned by messaging utility from now on.
  */
-bool ADUC_D2C_Message_SendAsync(
+static void QueueMessage(
     ADUC_D2C_Message_Type type,
     void* cloudServiceHandle,
-    const char* message,
+    const char* originalContent,
+    char* content,
     ADUC_D2C_MESSAGE_HTTP_RESPONSE_CALLBACK responseCallback,
     ADUC_D2C_MESSAGE_COMPLETED_CALLBACK completedCallback,
     ADUC_D2C_MESSAGE_STATUS_CHANGED_CALLBACK statusChangedCallback,
     void* userData)
 {
-    if (message == NULL)
-    {
-        Log_Error("message is NULL");
-        return false;
-    }
-
-    char* messageToSend = NULL;
-    if (mallocAndStrcpy_s(&messageToSend, message) != 0)
-    {
-        return false;
-    }
     // NUVOTON: Use Mbed OS mutex instead of pthread mutex
 #if 0
     pthread_mutex_lock(&s_pendingMessageStoreMutex);
@@ -622,11 +605,11 @@ bool ADUC_D2C_Message_SendAsync(
         }
     }
 
-    Log_Debug("Queueing message (t:%d, c:0x%x, m:%s)", type, message, message);
+    Log_Debug("Queueing message (t:%d, c:0x%x, m:%s)", type, originalContent, content);
     memset(&s_pendingMessageStore[type], 0, sizeof(s_pendingMessageStore[0]));
     s_pendingMessageStore[type].cloudServiceHandle = cloudServiceHandle;
-    s_pendingMessageStore[type].originalContent = message;
-    s_pendingMessageStore[type].content = messageToSend;
+    s_pendingMessageStore[type].originalContent = originalContent;
+    s_pendingMessageStore[type].content = content;
     s_pendingMessageStore[type].responseCallback = responseCallback;
     s_pendingMessageStore[type].completedCallback = completedCallback;
     s_pendingMessageStore[type].statusChangedCallback = statusChangedCallback;
@@ -639,6 +622,88 @@ bool ADUC_D2C_Message_SendAsync(
 #else
     s_pendingMessageStoreMutex.unlock();
 #endif
+}
+
+/**
+ * @brief Submits the message to pending messages store. If the message for specified @p type already exist, it will be replaced by the new message.
+ *
+ * @param type The message type.
+ * @param cloudServiceHandle An opaque pointer to the underlying cloud service handle.
+ *                           By default, this is the handle to an Azure Iot C PnP device client.
+ * @param message The required message content. For example, a JSON string containing 'reported' property of the IoT Hub Device Twin.
+ * @param responseCallback A optional callback to be called when the device received a http response.
+ * @param completedCallback An optional callback to be called when the messages processor stopped processing the message.
+ * @param statusChangedCallback A optional callback to be called when the messages status has changed.
+ * @param userData An additional user data.
+ *
+ * @return Returns true if message successfully added to the pending-messages queue.
+ */
+bool ADUC_D2C_Message_SendAsync(
+    ADUC_D2C_Message_Type type,
+    void* cloudServiceHandle,
+    const char* message,
+    ADUC_D2C_MESSAGE_HTTP_RESPONSE_CALLBACK responseCallback,
+    ADUC_D2C_MESSAGE_COMPLETED_CALLBACK completedCallback,
+    ADUC_D2C_MESSAGE_STATUS_CHANGED_CALLBACK statusChangedCallback,
+    void* userData)
+{
+    if (message == NULL)
+    {
+        Log_Error("message is NULL");
+        return false;
+    }
+
+    char* messageToSend = NULL;
+    if (mallocAndStrcpy_s(&messageToSend, message) != 0)
+    {
+        return false;
+    }
+
+    // NUVOTON: Share queueing with ADUC_D2C_Message_SendAsync_TakeOwnership()
+    QueueMessage(
+        type,
+        cloudServiceHandle,
+        message,
+        messageToSend,
+        responseCallback,
+        completedCallback,
+        statusChangedCallback,
+        userData);
+    return true;
+}
+
+/**
+ * @brief Same as ADUC_D2C_Message_SendAsync() but takes ownership of @p message instead of copying it.
+ *
+ * @param type The message type.
+ * @param cloudServiceHandle An opaque pointer to the underlying cloud service handle.
+ * @param message The message content allocated by malloc(). Ownership passes to messaging utility on every path,
+ *                so it is freed by messaging utility once no longer processed. Passing NULL fails.
+ * @param responseCallback A optional callback to be called when the device received a http response.
+ * @param completedCallback An optional callback to be called when the messages processor stopped processing the message.
+ * @param statusChangedCallback A optional callback to be called when the messages status has changed.
+ * @param userData An additional user data.
+ *
+ * @return Returns true if message successfully added to the pending-messages queue.
+ */
+bool ADUC_D2C_Message_SendAsync_TakeOwnership(
+    ADUC_D2C_Message_Type type,
+    void* cloudServiceHandle,
+    char* message,
+    ADUC_D2C_MESSAGE_HTTP_RESPONSE_CALLBACK responseCallback,
+    ADUC_D2C_MESSAGE_COMPLETED_CALLBACK completedCallback,
+    ADUC_D2C_MESSAGE_STATUS_CHANGED_CALLBACK statusChangedCallback,
+    void* userData)
+{
+    if (message == NULL)
+    {
+        Log_Error("message is NULL");
+        return false;
+    }
+
+    // No copy, so the queued message is its own original content.
+    QueueMessage(
+        type, cloudServiceHandle, message, message, responseCallback, completedCallback, statusChangedCallback, userData);
     return true;
 }
 
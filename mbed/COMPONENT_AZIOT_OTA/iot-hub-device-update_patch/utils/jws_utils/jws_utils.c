@@ -15,6 +15,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+// NUVOTON: Profiling
+#include "trace_ring.h"
 //
 // Internal Functions
 //
@@ -327,6 +329,9 @@ JWSResult VerifyJWSWithSJWK(const char* jws)
 {
     JWSResult result = JWSResult_Failed;
 
+    // NUVOTON: Profiling
+    TRACE_RING_BEGIN("jws_verify");
+
     char* header = NULL;
     char* jsonHeader = NULL;
     char* sjwk = NULL;
@@ -394,6 +399,9 @@ done:
     {
         FreeCryptoKeyHandle(key);
     }
+
+    // NUVOTON: Profiling
+    TRACE_RING_END("jws_verify");
     return result;
 }
 
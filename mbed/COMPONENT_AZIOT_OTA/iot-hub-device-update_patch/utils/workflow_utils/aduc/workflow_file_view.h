@@ -0,0 +1,62 @@
+/**
+ * @file workflow_file_view.h
+ * @brief Borrowed view of an update file, pointing into the workflow's parsed manifest.
+ *
+ * workflow_get_update_file() deep-copies every string and hash of the file into an
+ * ADUC_FileEntity, through a temporary hash array, and the caller must uninit it. Content
+ * handlers which only read the file description can use the view here instead: no allocation,
+ * no uninit, valid as long as the workflow is alive.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef WORKFLOW_FILE_VIEW_H
+#define WORKFLOW_FILE_VIEW_H
+
+#include "aduc/c_utils.h"
+#include "aduc/types/workflow.h" // ADUC_WorkflowHandle
+#include <parson.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+EXTERN_C_BEGIN
+
+/**
+ * @brief Update file description borrowed from workflow. Members must not be freed.
+ */
+typedef struct tagADUC_FileEntityView
+{
+    const char* FileId; /**< Id of the file in the update manifest */
+    const char* TargetFilename; /**< Filename, may be NULL */
+    const char* DownloadUri; /**< URL looked up in this workflow or its ancestors */
+    const char* Arguments; /**< Arguments, may be NULL */
+    const JSON_Object* Hashes; /**< Hash algorithm to base64 value map */
+    size_t HashCount; /**< Number of entries in Hashes */
+    size_t SizeInBytes; /**< File size, 0 if not specified */
+} ADUC_FileEntityView;
+
+/**
+ * @brief Fill @p view with update file at @p index, without allocation.
+ *
+ * @param handle The workflow handle.
+ * @param index Index of the update file.
+ * @param view Receives the view. Valid until the workflow is freed.
+ * @return true on success.
+ */
+bool workflow_peek_update_file(ADUC_WorkflowHandle handle, size_t index, ADUC_FileEntityView* view);
+
+/**
+ * @brief Get hash algorithm and base64 value at @p index of @p view.
+ *
+ * @param view The file view.
+ * @param index Index of the hash.
+ * @param hashType Receives the algorithm, e.g. "sha256". Borrowed.
+ * @param hashValue Receives the base64 value. Borrowed.
+ * @return true on success.
+ */
+bool workflow_file_view_get_hash(
+    const ADUC_FileEntityView* view, size_t index, const char** hashType, const char** hashValue);
+
+EXTERN_C_END
+
+#endif // WORKFLOW_FILE_VIEW_H
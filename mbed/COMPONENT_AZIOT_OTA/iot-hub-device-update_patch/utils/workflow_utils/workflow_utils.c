@@ -23,6 +23,12 @@
 #include "aduc/workflow_internal.h"
 #include "jws_utils.h"
 #include <aduc/c_utils.h>
+// NUVOTON: Atomic cancellation token
+#include "mbed_workflow_cancellation.h"
+// NUVOTON: Profiling
+#include "trace_ring.h"
+// NUVOTON: Borrowed file view
+#include "aduc/workflow_file_view.h"
 
 #include <azure_c_shared_utility/crt_abstractions.h> // for mallocAndStrcpy_s
 #include <azure_c_shared_utility/strings.h> // for STRING_*
@@ -82,6 +88,7 @@ extern ExtensionManager_Download_Options Default_ExtensionManager_Download_Optio
 
 // forward decls
 const JSON_Object* _workflow_get_fileurls_map(ADUC_WorkflowHandle handle);
+static const char* _workflow_find_file_url(ADUC_WorkflowHandle handle, const char* fileId);
 
 //
 // Private functions - this is an adapter for the underlying ADUC_Workflow object.
@@ -421,7 +428,6 @@ ADUC_RelatedFile* ADUC_RelatedFileArray_AllocAndInit(
     bool success = false;
 
     ADUC_RelatedFile* tempRelatedFileArray = NULL;
-    const JSON_Object* fileUrls = NULL;
 
     if (relatedFileObj == NULL || relatedFileCount == NULL)
     {
@@ -472,19 +478,8 @@ ADUC_RelatedFile* ADUC_RelatedFileArray_AllocAndInit(
         }
 
         // downloadUri
-        ADUC_WorkflowHandle h = handle;
-        do
+        if ((uri = _workflow_find_file_url(handle, fileId)) == NULL)
         {
-            if ((fileUrls = _workflow_get_fileurls_map(h)) != NULL)
-            {
-                uri = json_object_get_string(fileUrls, fileId);
-            }
-            h = workflow_get_parent(h);
-        } while (uri == NULL && h != NULL);
-
-        if (uri == NULL)
-        {
-            Log_Error("Cannot find URL for fileId '%s'", fileId);
             goto done;
         }
 
@@ -1586,6 +1581,37 @@ const JSON_Object* _workflow_get_fileurls_map(ADUC_WorkflowHandle handle)
     return o == NULL ? NULL : json_object_dotget_object(o, "fileUrls");
 }
 
+// NUVOTON: One parent-chain walk shared by file lookups
+/**
+ * @brief Find URL of @p fileId in 'fileUrls' map of this workflow, and its enclosing workflow(s).
+ *
+ * @param handle A workflow object handle.
+ * @param fileId The file id.
+ * @return const char* The URL, borrowed from the workflow, or NULL if not found.
+ */
+static const char* _workflow_find_file_url(ADUC_WorkflowHandle handle, const char* fileId)
+{
+    const JSON_Object* fileUrls = NULL;
+    const char* uri = NULL;
+    ADUC_WorkflowHandle h = handle;
+
+    do
+    {
+        if ((fileUrls = _workflow_get_fileurls_map(h)) != NULL)
+        {
+            uri = json_object_get_string(fileUrls, fileId);
+        }
+        h = workflow_get_parent(h);
+    } while (uri == NULL && h != NULL);
+
+    if (uri == NULL)
+    {
+        Log_Error("Cannot find URL for fileId '%s'", fileId);
+    }
+
+    return uri;
+}
+
 /**
  * @brief Return an update id of this workflow.
  * This id should be reported to the cloud once the update installed successfully.
@@ -1599,7 +1625,19 @@ const JSON_Object* _workflow_get_fileurls_map(ADUC_WorkflowHandle handle)
 ADUC_Result workflow_get_expected_update_id(ADUC_WorkflowHandle handle, ADUC_UpdateId** updateId)
 {
     ADUC_Result result = { ADUC_GeneralResult_Failure };
+    // NUVOTON: Child workflow leaves out Update Manifest text which is the same as its ancestor's. Go for it.
+#if 0
     if (!ADUC_Json_GetUpdateId(json_object_get_wrapping_value(_workflow_get_updateaction(handle)), updateId))
+#else
+    ADUC_WorkflowHandle h = handle;
+    while (workflow_get_parent(h) != NULL
+           && !json_object_has_value(_workflow_get_updateaction(h), ADUCITF_FIELDNAME_UPDATEMANIFEST))
+    {
+        h = workflow_get_parent(h);
+    }
+
+    if (!ADUC_Json_GetUpdateId(json_object_get_wrapping_value(_workflow_get_updateaction(h)), updateId))
+#endif
     {
         result.ExtendedResultCode = ADUC_ERC_UTILITIES_WORKFLOW_UTIL_INVALID_UPDATE_ID;
     }
@@ -1799,7 +1837,6 @@ bool workflow_get_update_file(ADUC_WorkflowHandle handle, size_t index, ADUC_Fil
     bool succeeded = false;
     const JSON_Object* files = NULL;
     const JSON_Object* file = NULL;
-    const JSON_Object* fileUrls = NULL;
     const char* uri = NULL;
     const char* fileId = NULL;
     const char* name = NULL;
@@ -1819,21 +1856,8 @@ bool workflow_get_update_file(ADUC_WorkflowHandle handle, size_t index, ADUC_Fil
         goto done;
     }
 
-    // Find fileurls map in this workflow, and its enclosing workflow(s).
-    ADUC_WorkflowHandle h = handle;
-
-    do
+    if ((uri = _workflow_find_file_url(handle, fileId)) == NULL)
     {
-        if ((fileUrls = _workflow_get_fileurls_map(h)) != NULL)
-        {
-            uri = json_object_get_string(fileUrls, fileId);
-        }
-        h = workflow_get_parent(h);
-    } while (uri == NULL && h != NULL);
-
-    if (uri == NULL)
-    {
-        Log_Error("Cannot find URL for fileId '%s'", fileId);
         goto done;
     }
 
@@ -1887,6 +1911,67 @@ done:
     return succeeded;
 }
 
+// NUVOTON: Borrowed file view without allocation, see aduc/workflow_file_view.h
+bool workflow_peek_update_file(ADUC_WorkflowHandle handle, size_t index, ADUC_FileEntityView* view)
+{
+    if (view == NULL)
+    {
+        return false;
+    }
+
+    const JSON_Object* files = NULL;
+    const JSON_Object* file = NULL;
+
+    memset(view, 0, sizeof(*view));
+
+    if ((files = _workflow_get_update_manifest_files_map(handle)) == NULL || index >= json_object_get_count(files))
+    {
+        return false;
+    }
+
+    if ((file = json_value_get_object(json_object_get_value_at(files, index))) == NULL)
+    {
+        return false;
+    }
+
+    view->FileId = json_object_get_name(files, index);
+    if ((view->DownloadUri = _workflow_find_file_url(handle, view->FileId)) == NULL)
+    {
+        return false;
+    }
+
+    view->Hashes = json_object_get_object(file, ADUCITF_FIELDNAME_HASHES);
+    view->HashCount = json_object_get_count(view->Hashes);
+    if (view->HashCount == 0)
+    {
+        Log_Error("Unable to parse hashes for file @ %zu", index);
+        return false;
+    }
+
+    view->TargetFilename = json_object_get_string(file, ADUCITF_FIELDNAME_FILENAME);
+    view->Arguments = json_object_get_string(file, ADUCITF_FIELDNAME_ARGUMENTS);
+    if (json_object_has_value(file, ADUCITF_FIELDNAME_SIZEINBYTES))
+    {
+        view->SizeInBytes = json_object_get_number(file, ADUCITF_FIELDNAME_SIZEINBYTES);
+    }
+
+    return true;
+}
+
+bool workflow_file_view_get_hash(
+    const ADUC_FileEntityView* view, size_t index, const char** hashType, const char** hashValue)
+{
+    if (view == NULL || index >= view->HashCount || hashType == NULL || hashValue == NULL)
+    {
+        return false;
+    }
+
+    *hashType = json_object_get_name(view->Hashes, index);
+    *hashValue = json_value_get_string(json_object_get_value_at(view->Hashes, index));
+
+    return *hashType != NULL && *hashValue != NULL;
+}
+
 bool workflow_get_update_file_by_name(ADUC_WorkflowHandle handle, const char* fileName, ADUC_FileEntity* entity)
 {
     if (entity == NULL)
@@ -1903,7 +1988,6 @@ bool workflow_get_update_file_by_name(ADUC_WorkflowHandle handle, const char* fi
     bool succeeded = false;
     const JSON_Object* files = NULL;
     const JSON_Object* file = NULL;
-    const JSON_Object* fileUrls = NULL;
     const char* uri = NULL;
     const char* fileId = NULL;
     const char* name = NULL;
@@ -1932,22 +2016,7 @@ bool workflow_get_update_file_by_name(ADUC_WorkflowHandle handle, const char* fi
         goto done;
     }
 
-    // Find fileurls map in this workflow, and its enclosing workflow(s).
-    ADUC_WorkflowHandle h = handle;
-
-    do
-    {
-        if ((fileUrls = _workflow_get_fileurls_map(h)) != NULL)
-        {
-            uri = json_object_get_string(fileUrls, fileId);
-        }
-        h = workflow_get_parent(h);
-    } while (uri == NULL && h != NULL);
-
-    if (uri == NULL)
-    {
-        Log_Error("Cannot find URL for fileId '%s'", fileId);
-    }
+    uri = _workflow_find_file_url(handle, fileId);
 
     name = json_object_get_string(file, ADUCITF_FIELDNAME_FILENAME);
     arguments = json_object_get_string(file, ADUCITF_FIELDNAME_ARGUMENTS);
@@ -2223,6 +2292,60 @@ static JSON_Array* workflow_get_instructions_steps_array(ADUC_WorkflowHandle han
     return json_object_dotget_array(o, WORKFLOW_PROPERTY_FIELD_INSTRUCTIONS_DOT_STEPS);
 }
 
+// NUVOTON: Copy members of a JSON object except the excluded ones, for building lightweight child workflow
+/**
+ * @brief Deep copy @p source except members named in @p excluded.
+ *
+ * @param source The source JSON object.
+ * @param excluded Names of members not to copy.
+ * @param excludedCount Number of names in @p excluded.
+ * @return JSON_Value* The new JSON object value, or NULL on failure. Caller must call json_value_free() on it.
+ */
+static JSON_Value* _workflow_copy_object_except(
+    const JSON_Object* source, const char* const* excluded, size_t excludedCount)
+{
+    JSON_Value* copyValue = json_value_init_object();
+    JSON_Object* copy = json_object(copyValue);
+    size_t count = json_object_get_count(source);
+
+    if (copyValue == NULL)
+    {
+        goto done;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const char* name = json_object_get_name(source, i);
+        bool isExcluded = false;
+
+        for (size_t e = 0; e < excludedCount; e++)
+        {
+            if (strcmp(name, excluded[e]) == 0)
+            {
+                isExcluded = true;
+                break;
+            }
+        }
+
+        if (isExcluded)
+        {
+            continue;
+        }
+
+        JSON_Value* member = json_value_deep_copy(json_object_get_value_at(source, i));
+        if (member == NULL || json_object_set_value(copy, name, member) == JSONFailure)
+        {
+            json_value_free(member);
+            json_value_free(copyValue);
+            copyValue = NULL;
+            goto done;
+        }
+    }
+
+done:
+    return copyValue;
+}
+
 /**
  * @brief Create a new workflow data handler using specified step data from base workflow.
  * Note: The 'workfolder' of the returned workflow data object will be the same as the base's.
@@ -2273,6 +2396,15 @@ ADUC_Result workflow_create_from_inline_step(ADUC_WorkflowHandle base, int stepI
 
     memset(wf, 0, sizeof(*wf));
 
+    JSON_Object* stepObject = json_object(stepValue);
+    JSON_Array* stepFiles = json_object_get_array(stepObject, ADUCITF_FIELDNAME_FILES);
+
+    // NUVOTON: Build child's Update Action and Update Manifest from only what the step needs, instead of deep
+    //          copying whole of them and then pruning. Update Manifest text and signature, which dominate Update
+    //          Action, are verified once on the root and left out (see workflow_get_expected_update_id). So are
+    //          base 'instructions' and files not referenced by the step. 'fileUrls' is looked up through the
+    //          parent chain on download.
+#if 0
     updateActionValue = json_value_deep_copy(json_object_get_wrapping_value(wfBase->UpdateActionObject));
     if (updateActionValue == NULL)
     {
@@ -2297,6 +2429,41 @@ ADUC_Result workflow_create_from_inline_step(ADUC_WorkflowHandle base, int stepI
     char* currentStepData = json_serialize_to_string_pretty(stepValue);
     Log_Debug("Processing current step:\n%s", currentStepData);
     json_free_serialized_string(currentStepData);
+#else
+    static const char* const updateActionExcluded[] = { ADUCITF_FIELDNAME_UPDATEMANIFEST,
+                                                        ADUCITF_FIELDNAME_UPDATEMANIFESTSIGNATURE,
+                                                        "fileUrls" };
+    static const char* const updateManifestExcluded[] = { ADUCITF_FIELDNAME_FILES, "instructions" };
+
+    updateActionValue = _workflow_copy_object_except(
+        wfBase->UpdateActionObject,
+        updateActionExcluded,
+        sizeof(updateActionExcluded) / sizeof(updateActionExcluded[0]));
+    if (updateActionValue == NULL)
+    {
+        Log_Error("Cannot copy Update Action json from base");
+        result.ExtendedResultCode = ADUC_ERC_UTILITIES_WORKFLOW_UTIL_COPY_UPDATE_ACTION_FROM_BASE_FAILURE;
+        goto done;
+    }
+
+    JSON_Object* updateActionObject = json_object(updateActionValue);
+
+    updateManifestValue = _workflow_copy_object_except(
+        wfBase->UpdateManifestObject,
+        updateManifestExcluded,
+        sizeof(updateManifestExcluded) / sizeof(updateManifestExcluded[0]));
+    if (updateManifestValue == NULL)
+    {
+        Log_Error("Cannot copy Update Manifest json from base");
+        result.ExtendedResultCode = ADUC_ERC_UTILITIES_WORKFLOW_UTIL_COPY_UPDATE_ACTION_FROM_BASE_FAILURE;
+        goto done;
+    }
+
+    JSON_Object* updateManifestObject = json_object(updateManifestValue);
+
+    // NUVOTON: No pretty serialization of the whole step just for a debug log
+    Log_Debug("Processing step #%d (%d file(s))", stepIndex, (int)json_array_get_count(stepFiles));
+#endif
 
     // Replace 'updateType' with step's handler type.
     const char* updateType = json_object_get_string(stepObject, STEP_PROPERTY_FIELD_HANDLER);
@@ -2329,6 +2496,9 @@ ADUC_Result workflow_create_from_inline_step(ADUC_WorkflowHandle base, int stepI
     }
 
     // Keep only file needed by this step entry. Remove the rest.
+    // NUVOTON: Look up each step file by id in base files instead of pruning base files against step files in
+    //          nested loop. This also leaves base step's 'files' array intact.
+#if 0
     JSON_Array* stepFiles = json_object_get_array(stepObject, ADUCITF_FIELDNAME_FILES);
     JSON_Object* baseFiles = json_object_get_object(updateManifestObject, ADUCITF_FIELDNAME_FILES);
     int fileCount = json_object_get_count(baseFiles);
@@ -2364,6 +2534,48 @@ ADUC_Result workflow_create_from_inline_step(ADUC_WorkflowHandle base, int stepI
 
     // Remove 'instructions' list...
     json_object_set_null(updateManifestObject, "instructions");
+#else
+    {
+        const JSON_Object* baseFiles = json_object_get_object(wfBase->UpdateManifestObject, ADUCITF_FIELDNAME_FILES);
+        JSON_Value* filesValue = json_value_init_object();
+
+        jsonStatus = json_object_set_value(updateManifestObject, ADUCITF_FIELDNAME_FILES, filesValue);
+        if (jsonStatus == JSONFailure)
+        {
+            json_value_free(filesValue);
+            Log_Error("Cannot create step files.");
+            result.ExtendedResultCode = ADUC_ERC_NOMEM;
+            goto done;
+        }
+
+        JSON_Object* files = json_object(filesValue);
+        size_t stepFilesCount = json_array_get_count(stepFiles);
+        for (size_t i = 0; i < stepFilesCount; i++)
+        {
+            // Note: step's files is an array of file ids.
+            const char* stepFileId = json_array_get_string(stepFiles, i);
+            if (stepFileId == NULL || json_object_has_value(files, stepFileId))
+            {
+                continue;
+            }
+
+            JSON_Value* baseFile = json_object_get_value(baseFiles, stepFileId);
+            if (baseFile == NULL)
+            {
+                continue;
+            }
+
+            JSON_Value* file = json_value_deep_copy(baseFile);
+            if (file == NULL || json_object_set_value(files, stepFileId, file) == JSONFailure)
+            {
+                json_value_free(file);
+                Log_Error("Cannot copy step file '%s'.", stepFileId);
+                result.ExtendedResultCode = ADUC_ERC_NOMEM;
+                goto done;
+            }
+        }
+    }
+#endif
 
     wf->UpdateActionObject = updateActionObject;
     wf->UpdateManifestObject = updateManifestObject;
@@ -2422,6 +2634,9 @@ bool workflow_transfer_data(ADUC_WorkflowHandle targetHandle, ADUC_WorkflowHandl
     wfTarget->PropertiesObject = wfSource->PropertiesObject;
     wfSource->PropertiesObject = NULL;
 
+    // NUVOTON: Cancel request goes with the properties replaced above
+    ADUC_WorkflowCancellation_Reset(targetHandle);
+
     return true;
 }
 
@@ -2436,6 +2651,10 @@ bool workflow_transfer_data(ADUC_WorkflowHandle targetHandle, ADUC_WorkflowHandl
 ADUC_Result workflow_init(const char* updateManifestJson, bool validateManifest, ADUC_WorkflowHandle* handle)
 {
     ADUC_Result result = { ADUC_GeneralResult_Failure };
+
+    // NUVOTON: Profiling
+    TRACE_RING_BEGIN("workflow_init");
+
     if (updateManifestJson == NULL || handle == NULL)
     {
         result.ExtendedResultCode = ADUC_ERC_UTILITIES_WORKFLOW_UTIL_ERROR_BAD_PARAM;
@@ -2465,6 +2684,9 @@ done:
         }
     }
 
+    // NUVOTON: Profiling
+    TRACE_RING_END("workflow_init");
+
     return result;
 }
 
@@ -2619,6 +2841,9 @@ void workflow_uninit(ADUC_WorkflowHandle handle)
 
     _workflow_free_update_file_inodes(wf);
 
+    // NUVOTON: Forget cancellation token of the workflow, keyed by handle about to be freed
+    ADUC_WorkflowCancellation_Reset(handle);
+
     // This should have been transferred, but free it if it's still around.
     if (wf != NULL && wf->DeferredReplacementWorkflow != NULL)
     {
@@ -3144,6 +3369,10 @@ bool workflow_request_cancel(ADUC_WorkflowHandle handle)
         return false;
     }
 
+    // NUVOTON: Raise atomic cancellation token of the workflow instead of writing the properties object,
+    //          which worker threads read concurrently. The token covers child workflows and aborts
+    //          in-flight transfers.
+#if 0
     bool success = workflow_set_boolean_property(handle, WORKFLOW_PROPERTY_FIELD_CANCEL_REQUESTED, true);
     int childCount = workflow_get_children_count(handle);
     for (int i = 0; i < childCount; i++)
@@ -3151,11 +3380,19 @@ bool workflow_request_cancel(ADUC_WorkflowHandle handle)
         success = success && workflow_request_cancel(workflow_get_child(handle, i));
     }
     return success;
+#else
+    return ADUC_WorkflowCancellation_Request(handle);
+#endif
 }
 
 bool workflow_is_cancel_requested(ADUC_WorkflowHandle handle)
 {
+    // NUVOTON: Lock-free atomic load instead of JSON lookup racing with workflow_request_cancel()
+#if 0
     return workflow_get_boolean_property(handle, WORKFLOW_PROPERTY_FIELD_CANCEL_REQUESTED);
+#else
+    return ADUC_WorkflowCancellation_IsRequested(handle);
+#endif
 }
 
 bool workflow_is_agent_restart_requested(ADUC_WorkflowHandle handle)
@@ -3544,29 +3781,12 @@ bool workflow_get_step_detached_manifest_file(ADUC_WorkflowHandle handle, size_t
     const char* fileId = json_object_get_string(step, STEP_PROPERTY_FIELD_DETACHED_MANIFEST_FILE_ID);
     const JSON_Object* files = _workflow_get_update_manifest_files_map(handle);
     const JSON_Object* file = json_object_get_object(files, fileId);
-    const JSON_Object* fileUrls = NULL;
     const char* uri = NULL;
     const char* name = NULL;
     size_t tempHashCount = 0;
     ADUC_Hash* tempHash = NULL;
 
-    // Find fileurls map in this workflow, and its enclosing workflow(s).
-    ADUC_WorkflowHandle h = handle;
-
-    do
-    {
-        if ((fileUrls = _workflow_get_fileurls_map(h)) == NULL)
-        {
-            Log_Warn("'fileUrls' property not found.");
-        }
-        else
-        {
-            uri = json_object_get_string(fileUrls, fileId);
-        }
-        h = workflow_get_parent(h);
-    } while (uri == NULL && h != NULL);
-
-    if (uri == NULL)
+    if ((uri = _workflow_find_file_url(handle, fileId)) == NULL)
     {
         goto done;
     }
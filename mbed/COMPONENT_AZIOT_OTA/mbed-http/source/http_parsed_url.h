@@ -19,24 +19,37 @@
 #define _MBED_HTTP_PARSED_URL_H_
 
 #include "http_parser.h"
+#include <string.h>
+#include <strings.h>
 
 class ParsedUrl {
 public:
-    ParsedUrl(const char* url) {
+    /**
+     * @param url URL to parse
+     * @param storage Optional caller-provided storage for the parsed fields, so that
+     *                nothing is allocated. Must outlive this object, and hold at least
+     *                storage_size(url) bytes, or heap is used instead.
+     * @param storage_size Size of storage
+     */
+    ParsedUrl(const char* url, char* storage = NULL, size_t storage_size = 0) {
         struct http_parser_url parsed_url;
-        http_parser_parse_url(url, strlen(url), false, &parsed_url);
+        size_t url_len = strlen(url);
+        memset(&parsed_url, 0, sizeof(parsed_url));
+        bool parsed = (http_parser_parse_url(url, url_len, false, &parsed_url) == 0);
 
-        for (size_t ix = 0; ix < UF_MAX; ix++) {
-            char* value;
-            if (parsed_url.field_set & (1 << ix)) {
-                value = (char*)calloc(parsed_url.field_data[ix].len + 1, 1);
-                memcpy(value, url + parsed_url.field_data[ix].off,
-                       parsed_url.field_data[ix].len);
-            }
-            else {
-                value = (char*)calloc(1, 1);
-            }
+        // All fields are packed in one buffer, each null-terminated
+        if (storage != NULL && storage_size >= ParsedUrl::storage_size(url_len)) {
+            _buffer = storage;
+            _we_allocated_buffer = false;
+        }
+        else {
+            _buffer = (char*)malloc(ParsedUrl::storage_size(url_len));
+            _we_allocated_buffer = true;
+        }
+        char* next = _buffer;
 
+        for (size_t ix = 0; ix < UF_MAX; ix++) {
+            char* value = next;
             switch ((http_parser_url_fields)ix) {
                 case UF_SCHEMA:   _schema   = value; break;
                 case UF_HOST:     _host     = value; break;
@@ -45,34 +58,57 @@ public:
                 case UF_USERINFO: _userinfo = value; break;
                 default:
                     // PORT is already parsed, FRAGMENT is not relevant for HTTP requests
-                    free(value);
-                    break;
+                    continue;
+            }
+
+            if ((parsed_url.field_set & (1 << ix)) && parsed_url.field_data[ix].len) {
+                memcpy(value, url + parsed_url.field_data[ix].off,
+                       parsed_url.field_data[ix].len);
+                next += parsed_url.field_data[ix].len;
+            }
+            else if ((http_parser_url_fields)ix == UF_PATH) {
+                *next++ = '/';
             }
+            *next++ = '\0';
         }
 
+        // Usable for a request only with scheme and host
+        _valid = parsed && _schema[0] != '\0' && _host[0] != '\0';
+
         _port = parsed_url.port;
         if (!_port) {
-            if (strcmp(_schema, "https") == 0 || strcmp(_schema, "wss") == 0) {
+            if (is_secure()) {
                 _port = 443;
             }
             else {
                 _port = 80;
             }
         }
-
-        if (strcmp(_path, "") == 0) {
-            free(_path);
-            _path = (char*)calloc(2, 1);
-            _path[0] = '/';
-        }
     }
 
     ~ParsedUrl() {
-        if (_schema) free(_schema);
-        if (_host) free(_host);
-        if (_path) free(_path);
-        if (_query) free(_query);
-        if (_userinfo) free(_userinfo);
+        if (_we_allocated_buffer) free(_buffer);
+    }
+
+    /**
+     * Storage size needed for a URL of url_len characters:
+     * fields never overlap, plus terminators and a default "/" path.
+     */
+    static size_t storage_size(size_t url_len) {
+        return url_len + UF_MAX + 1;
+    }
+
+    /**
+     * Whether the URL parsed, with scheme and host. Check once, before reusing
+     * this object across requests.
+     */
+    bool valid() const { return _valid; }
+
+    /**
+     * Whether the scheme is TLS-based (https or wss)
+     */
+    bool is_secure() const {
+        return strcasecmp(_schema, "https") == 0 || strcasecmp(_schema, "wss") == 0;
     }
 
     uint16_t port() const { return _port; }
@@ -83,7 +119,10 @@ public:
     char* userinfo() const { return _userinfo; }
 
 private:
+    bool _valid;
     uint16_t _port;
+    char* _buffer;
+    bool _we_allocated_buffer;
     char* _schema;
     char* _host;
     char* _path;
@@ -64,6 +64,36 @@ public:
         ((TCPSocket*)_socket)->open(network);
         _we_created_socket = true;
 
+#if (MBED_MAJOR_VERSION >= 6)
+        _network = network;
+#endif
+    }
+
+    /**
+     * HttpRequest Constructor
+     *
+     * @param[in] network The network interface
+     * @param[in] method HTTP method to use
+     * @param[in] parsed_url URL parsed beforehand, e.g. once for all retries of a download.
+     *                       Not owned, must outlive this request.
+     * @param[in] bodyCallback Callback on which to retrieve chunks of the response body.
+                               If not set, the complete body will be allocated on the HttpResponse object,
+                               which might use lots of memory.
+    */
+    HttpRequest(NetworkInterface* network, http_method method, ParsedUrl* parsed_url, Callback<void(const char *at, uint32_t length)> bodyCallback = 0)
+        : HttpRequestBase(NULL, bodyCallback)
+    {
+        _error = 0;
+        _response = NULL;
+
+        _parsed_url = parsed_url;
+        _we_own_parsed_url = false;
+        _request_builder = new HttpRequestBuilder(method, _parsed_url);
+
+        _socket = new TCPSocket();
+        ((TCPSocket*)_socket)->open(network);
+        _we_created_socket = true;
+
 #if (MBED_MAJOR_VERSION >= 6)
         _network = network;
 #endif
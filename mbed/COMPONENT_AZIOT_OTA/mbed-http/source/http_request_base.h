@@ -51,7 +51,8 @@ class HttpRequestBase {
 
 public:
     HttpRequestBase(Socket *socket, Callback<void(const char *at, uint32_t length)> bodyCallback)
-        : _socket(socket), _body_callback(bodyCallback), _request_buffer(NULL), _request_buffer_ix(0)
+        : _socket(socket), _body_callback(bodyCallback), _we_own_parsed_url(true), _request_buffer(NULL),
+          _request_buffer_ix(0), _recv_buffer(NULL), _recv_buffer_size(0)
     {}
 
     /**
@@ -64,7 +65,7 @@ public:
             delete _response;
         }
 
-        if (_parsed_url) {
+        if (_parsed_url && _we_own_parsed_url) {
             delete _parsed_url;
         }
 
@@ -232,6 +233,38 @@ public:
         return _request_buffer_ix;
     }
 
+    /**
+     * Set the receive buffer, so that none is allocated per request.
+     * The buffer must outlive the request. Can be shared by requests not in flight at the same time.
+     *
+     * @param buffer Pointer to the buffer, or NULL to allocate HTTP_RECEIVE_BUFFER_SIZE bytes per request
+     * @param buffer_size Size of the buffer
+     */
+    void set_receive_buffer(uint8_t *buffer, size_t buffer_size) {
+        _recv_buffer = buffer;
+        _recv_buffer_size = buffer_size;
+    }
+
+    /**
+     * Set timeout of blocking socket operations, including connect.
+     * Can be called from the body callback to adapt to the observed link.
+     *
+     * @param timeout_ms Timeout in milliseconds, or -1 for blocking forever
+     */
+    void set_timeout(int timeout_ms) {
+        if (_socket) {
+            _socket->set_timeout(timeout_ms);
+        }
+    }
+
+    /**
+     * Get the response being received, e.g. to check the status code from the body callback.
+     * NULL before send() starts receiving.
+     */
+    HttpResponse* get_response_in_progress() {
+        return _response;
+    }
+
     /**
      * Cancel the HTTP request/response transfer.
      */
@@ -241,9 +274,30 @@ public:
         }
     }
 
+    /**
+     * Abort the HTTP request/response transfer from another thread.
+     *
+     * Unlike cancel(), which is meant for the body callback, only the transport socket is closed.
+     * This wakes up a send/recv blocked in the transferring thread immediately, and leaves TLS
+     * state to be torn down by that thread.
+     */
+    void abort() {
+        Socket *transport = transport_socket();
+        if (transport) {
+            transport->close();
+        }
+    }
+
 protected:
     virtual nsapi_error_t connect_socket(char *host, uint16_t port) = 0;
 
+    /**
+     * Get the socket carrying the raw byte stream, or NULL if it cannot be closed safely from another thread.
+     */
+    virtual Socket *transport_socket() {
+        return _socket;
+    }
+
 private:
     nsapi_error_t connect_socket( ) {
         if (_response != NULL) {
@@ -251,6 +305,9 @@ private:
             return -2100; // @todo, make a lookup table with errors
         }
 
+        if (!_parsed_url->valid()) {
+            return NSAPI_ERROR_PARAMETER;
+        }
 
         if (_we_created_socket) {
             nsapi_error_t connection_result = connect_socket(_parsed_url->host(), _parsed_url->port());
@@ -299,19 +356,24 @@ private:
         // And a response parser
         HttpParser parser(_response, HTTP_RESPONSE, _body_callback);
 
-        // Set up a receive buffer (on the heap)
-        uint8_t* recv_buffer = (uint8_t*)malloc(HTTP_RECEIVE_BUFFER_SIZE);
+        // Set up a receive buffer (on the heap, unless provided by the user)
+        uint8_t* recv_buffer = _recv_buffer;
+        size_t recv_buffer_size = _recv_buffer_size;
+        if (recv_buffer == NULL) {
+            recv_buffer = (uint8_t*)malloc(HTTP_RECEIVE_BUFFER_SIZE);
+            recv_buffer_size = HTTP_RECEIVE_BUFFER_SIZE;
+        }
 
         // Socket::recv is called until we don't have any data anymore
         nsapi_size_or_error_t recv_ret;
-        while ((recv_ret = _socket->recv(recv_buffer, HTTP_RECEIVE_BUFFER_SIZE)) > 0) {
+        while ((recv_ret = _socket->recv(recv_buffer, recv_buffer_size)) > 0) {
 
             // Pass the chunk into the http_parser
             uint32_t nparsed = parser.execute((const char*)recv_buffer, recv_ret);
-            if (nparsed != recv_ret) {
+            if (nparsed != recv_ret || parser.failed()) {
                 // printf("Parsing failed... parsed %d bytes, received %d bytes\n", nparsed, recv_ret);
-                _error = -2101;
-                free(recv_buffer);
+                _error = _response->is_body_too_large() ? -2102 : -2101;
+                if (recv_buffer != _recv_buffer) free(recv_buffer);
                 return NULL;
             }
 
@@ -322,7 +384,7 @@ private:
         // error?
         if (recv_ret < 0) {
             _error = recv_ret;
-            free(recv_buffer);
+            if (recv_buffer != _recv_buffer) free(recv_buffer);
             return NULL;
         }
 
@@ -330,7 +392,7 @@ private:
         parser.finish();
 
         // Free the receive buffer
-        free(recv_buffer);
+        if (recv_buffer != _recv_buffer) free(recv_buffer);
 
         if (_we_created_socket) {
             // Close the socket
@@ -345,6 +407,7 @@ private:
     Callback<void(const char *at, uint32_t length)> _body_callback;
 
     ParsedUrl* _parsed_url;
+    bool _we_own_parsed_url;
 
     HttpRequestBuilder* _request_builder;
     HttpResponse* _response;
@@ -356,6 +419,9 @@ private:
     uint8_t *_request_buffer;
     size_t _request_buffer_size;
     size_t _request_buffer_ix;
+
+    uint8_t *_recv_buffer;
+    size_t _recv_buffer_size;
 };
 
 #endif // _HTTP_REQUEST_BASE_H_
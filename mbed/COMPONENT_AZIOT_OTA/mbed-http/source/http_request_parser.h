@@ -27,40 +27,25 @@ public:
     HttpParser(HttpResponse* a_response, http_parser_type parser_type, Callback<void(const char *at, uint32_t length)> a_body_callback = 0)
         : response(a_response), body_callback(a_body_callback)
     {
-        settings = new http_parser_settings();
-
-        settings->on_message_begin = &HttpParser::on_message_begin_callback;
-        settings->on_url = &HttpParser::on_url_callback;
-        settings->on_status = &HttpParser::on_status_callback;
-        settings->on_header_field = &HttpParser::on_header_field_callback;
-        settings->on_header_value = &HttpParser::on_header_value_callback;
-        settings->on_headers_complete = &HttpParser::on_headers_complete_callback;
-        settings->on_chunk_header = &HttpParser::on_chunk_header_callback;
-        settings->on_chunk_complete = &HttpParser::on_chunk_complete_callback;
-        settings->on_body = &HttpParser::on_body_callback;
-        settings->on_message_complete = &HttpParser::on_message_complete_callback;
-
-        // Construct the http_parser object
-        parser = new http_parser();
-        http_parser_init(parser, parser_type);
-        parser->data = (void*)this;
-    }
-
-    ~HttpParser() {
-        if (parser) {
-            delete parser;
-        }
-        if (settings) {
-            delete settings;
-        }
+        // Construct the http_parser object in place
+        http_parser_init(&parser, parser_type);
+        parser.data = (void*)this;
     }
 
     uint32_t execute(const char* buffer, uint32_t buffer_size) {
-        return http_parser_execute(parser, settings, buffer, buffer_size);
+        return http_parser_execute(&parser, parser_settings(), buffer, buffer_size);
     }
 
     void finish() {
-        http_parser_execute(parser, settings, NULL, 0);
+        http_parser_execute(&parser, parser_settings(), NULL, 0);
+    }
+
+    /**
+     * Whether parsing stopped on an error. A callback failing on the last bytes of a buffer
+     * does not show in what execute() returns.
+     */
+    bool failed() {
+        return HTTP_PARSER_ERRNO(&parser) != HPE_OK;
     }
 
 private:
@@ -96,6 +81,11 @@ private:
     int on_headers_complete(http_parser* parser) {
         response->set_headers_complete();
         response->set_method((http_method)parser->method);
+
+        // Body is to be buffered: fail fast if the declared length is too large
+        if (!body_callback && !response->check_expected_body_length()) {
+            return -1;
+        }
         return 0;
     }
 
@@ -107,8 +97,7 @@ private:
             return 0;
         }
 
-        response->set_body(at, length);
-        return 0;
+        return response->set_body(at, length) ? 0 : -1;
     }
 
     int on_message_complete(http_parser* parser) {
@@ -168,10 +157,26 @@ private:
         return ((HttpParser*)parser->data)->on_chunk_complete(parser);
     }
 
+    // Identical for every instance, so shared and constant-initialized
+    static const http_parser_settings* parser_settings() {
+        static const http_parser_settings settings = {
+            &HttpParser::on_message_begin_callback,     // on_message_begin
+            &HttpParser::on_url_callback,               // on_url
+            &HttpParser::on_status_callback,            // on_status
+            &HttpParser::on_header_field_callback,      // on_header_field
+            &HttpParser::on_header_value_callback,      // on_header_value
+            &HttpParser::on_headers_complete_callback,  // on_headers_complete
+            &HttpParser::on_body_callback,              // on_body
+            &HttpParser::on_message_complete_callback,  // on_message_complete
+            &HttpParser::on_chunk_header_callback,      // on_chunk_header
+            &HttpParser::on_chunk_complete_callback     // on_chunk_complete
+        };
+        return &settings;
+    }
+
     HttpResponse* response;
     Callback<void(const char *at, uint32_t length)> body_callback;
-    http_parser* parser;
-    http_parser_settings* settings;
+    http_parser parser;
 };
 
 #endif // _HTTP_RESPONSE_PARSER_H_
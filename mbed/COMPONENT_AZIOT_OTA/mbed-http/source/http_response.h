@@ -23,6 +23,21 @@
 
 using namespace std;
 
+/**
+ * Maximum size of a body buffered on the HttpResponse object (no body callback set).
+ * Larger bodies fail the request rather than exhausting the heap.
+ */
+#ifndef HTTP_RESPONSE_MAX_BODY_SIZE
+#define HTTP_RESPONSE_MAX_BODY_SIZE 64 * 1024
+#endif
+
+/**
+ * First allocation for a buffered body of unknown length. Grows geometrically from here.
+ */
+#ifndef HTTP_RESPONSE_INITIAL_BODY_SIZE
+#define HTTP_RESPONSE_INITIAL_BODY_SIZE 1024
+#endif
+
 class HttpResponse {
 public:
     HttpResponse() {
@@ -34,6 +49,8 @@ public:
         is_message_completed = false;
         body_length = 0;
         body_offset = 0;
+        body_capacity = 0;
+        is_body_overflowed = false;
         body = NULL;
     }
 
@@ -42,8 +59,11 @@ public:
             free(body);
         }
 
+        // parsing can stop between a header field and its value
         for (uint32_t ix = 0; ix < header_fields.size(); ix++) {
             delete header_fields[ix];
+        }
+        for (uint32_t ix = 0; ix < header_values.size(); ix++) {
             delete header_values[ix];
         }
     }
@@ -126,34 +146,71 @@ public:
         return header_values;
     }
 
-    void set_body(const char *at, uint32_t length) {
+    /**
+     * Check the declared Content-Length fits in the body buffer, before any body arrives.
+     * @return false if the body would be too large
+     */
+    bool check_expected_body_length() {
+        if (expected_content_length > (uint32_t)(HTTP_RESPONSE_MAX_BODY_SIZE)) {
+            is_body_overflowed = true;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * Append to the buffered body.
+     * @return false if the body would exceed HTTP_RESPONSE_MAX_BODY_SIZE or allocation failed
+     */
+    bool set_body(const char *at, uint32_t length) {
         // Connection: close, could not specify Content-Length, nor chunked... So do it like this:
         if (expected_content_length == 0 && length > 0) {
             is_chunked = true;
         }
 
-        // only malloc when this fn is called, so we don't alloc when body callback's are enabled
-        if (body == NULL && !is_chunked) {
-            body = (char*)malloc(expected_content_length);
+        if (length > (uint32_t)(HTTP_RESPONSE_MAX_BODY_SIZE) - body_offset) {
+            is_body_overflowed = true;
+            return false;
         }
 
-        if (is_chunked) {
-            if (body == NULL) {
-                body = (char*)malloc(length);
+        // only malloc when this fn is called, so we don't alloc when body callback's are enabled
+        if (body_offset + length > body_capacity) {
+            uint32_t capacity;
+            if (!is_chunked) {
+                // Known length: allocate once
+                capacity = expected_content_length;
             }
             else {
-                char* original_body = body;
-                body = (char*)realloc(body, body_offset + length);
-                if (body == NULL) {
-                    free(original_body);
-                    return;
-                }
+                // Unknown length: grow geometrically, so total copying stays linear
+                capacity = body_capacity ? body_capacity * 2 : HTTP_RESPONSE_INITIAL_BODY_SIZE;
+            }
+            if (capacity < body_offset + length) {
+                capacity = body_offset + length;
+            }
+            if (capacity > (uint32_t)(HTTP_RESPONSE_MAX_BODY_SIZE)) {
+                capacity = HTTP_RESPONSE_MAX_BODY_SIZE;
             }
+
+            char* new_body = (char*)realloc(body, capacity);
+            if (new_body == NULL) {
+                // original body is kept, and freed on destruction
+                return false;
+            }
+            body = new_body;
+            body_capacity = capacity;
         }
 
         memcpy(body + body_offset, at, length);
 
         body_offset += length;
+        return true;
+    }
+
+    /**
+     * Whether the buffered body was refused for exceeding HTTP_RESPONSE_MAX_BODY_SIZE.
+     */
+    bool is_body_too_large() {
+        return is_body_overflowed;
     }
 
     void* get_body() {
@@ -224,6 +281,8 @@ private:
     char * body;
     uint32_t body_length;
     uint32_t body_offset;
+    uint32_t body_capacity;
+    bool is_body_overflowed;
 };
 
 #endif
@@ -56,9 +56,60 @@ public:
         _request_builder = new HttpRequestBuilder(method, _parsed_url);
         _response = NULL;
 
+#if (MBED_MAJOR_VERSION < 6)
         _socket = new TLSSocket();
         ((TLSSocket*)_socket)->open(network);
         ((TLSSocket*)_socket)->set_root_ca_cert(ssl_ca_pem);
+#else
+        // Own the TCP transport, so that abort() can close it from another thread
+        _tcp_socket = new TCPSocket();
+        _tcp_socket->open(network);
+        _socket = new TLSSocketWrapper(_tcp_socket);
+        ((TLSSocketWrapper*)_socket)->set_root_ca_cert(ssl_ca_pem);
+#endif
+        _we_created_socket = true;
+
+#if (MBED_MAJOR_VERSION >= 6)
+        _network = network;
+#endif
+    }
+
+    /**
+     * HttpsRequest Constructor
+     * Initializes the TCP socket, sets up event handlers and flags.
+     *
+     * @param[in] network The network interface
+     * @param[in] ssl_ca_pem String containing the trusted CAs
+     * @param[in] method HTTP method to use
+     * @param[in] parsed_url URL parsed beforehand, e.g. once for all retries of a download.
+     *                       Not owned, must outlive this request.
+     * @param[in] body_callback Callback on which to retrieve chunks of the response body.
+                                If not set, the complete body will be allocated on the HttpResponse object,
+                                which might use lots of memory.
+     */
+    HttpsRequest(NetworkInterface* network,
+                 const char* ssl_ca_pem,
+                 http_method method,
+                 ParsedUrl* parsed_url,
+                 Callback<void(const char *at, uint32_t length)> body_callback = 0)
+        : HttpRequestBase(NULL, body_callback)
+    {
+        _parsed_url = parsed_url;
+        _we_own_parsed_url = false;
+        _request_builder = new HttpRequestBuilder(method, _parsed_url);
+        _response = NULL;
+
+#if (MBED_MAJOR_VERSION < 6)
+        _socket = new TLSSocket();
+        ((TLSSocket*)_socket)->open(network);
+        ((TLSSocket*)_socket)->set_root_ca_cert(ssl_ca_pem);
+#else
+        // Own the TCP transport, so that abort() can close it from another thread
+        _tcp_socket = new TCPSocket();
+        _tcp_socket->open(network);
+        _socket = new TLSSocketWrapper(_tcp_socket);
+        ((TLSSocketWrapper*)_socket)->set_root_ca_cert(ssl_ca_pem);
+#endif
         _we_created_socket = true;
 
 #if (MBED_MAJOR_VERSION >= 6)
@@ -92,10 +143,20 @@ public:
 
 #if (MBED_MAJOR_VERSION >= 6)
         _network = NULL;
+        _tcp_socket = NULL;
 #endif
     }
 
-    virtual ~HttpsRequest() {}
+    virtual ~HttpsRequest() {
+#if (MBED_MAJOR_VERSION >= 6)
+        // TLS wrapper closes its transport on destruction, so it must go first
+        if (_socket && _we_created_socket) {
+            delete _socket;
+            _socket = NULL;
+        }
+        delete _tcp_socket;
+#endif
+    }
 
 protected:
     virtual nsapi_error_t connect_socket(char *host, uint16_t port) {
@@ -112,12 +173,22 @@ protected:
             return rc;
         }
         sockaddr.set_port(port);
-        return ((TLSSocket*)_socket)->connect(sockaddr);
+        return ((TLSSocketWrapper*)_socket)->connect(sockaddr);
+#endif
+    }
+
+    virtual Socket *transport_socket() {
+#if (MBED_MAJOR_VERSION < 6)
+        // TLSSocket doesn't expose its TCP transport
+        return NULL;
+#else
+        return _tcp_socket;
 #endif
     }
 
 #if (MBED_MAJOR_VERSION >= 6)
     NetworkInterface* _network;
+    TCPSocket* _tcp_socket;
 #endif
 };
 
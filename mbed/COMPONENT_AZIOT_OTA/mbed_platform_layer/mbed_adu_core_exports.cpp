@@ -10,6 +10,8 @@
 #include "aduc/logging.h"
 //#include "aduc/process_utils.hpp"
 #include "mbed_adu_core_impl.hpp"
+#include "mbed_post_reboot.h"
+#include "mbed_workflow_persistence.h"
 #include <memory>
 //#include <signal.h> // raise()
 #include <string>
@@ -32,6 +34,12 @@ ADUC_Result ADUC_RegisterPlatformLayer(ADUC_UpdateActionCallbacks* data, unsigne
     UNREFERENCED_PARAMETER(argc);
     UNREFERENCED_PARAMETER(argv);
 
+    // Settle firmware upgrade state of last install before anything reports installed update.
+    ADUC_PostReboot_Settle();
+
+    // Pick up deployment interrupted by unexpected reset before the twin arrives.
+    ADUC_WorkflowPersistence_Load();
+
     {
         std::unique_ptr<ADUC::MbedPlatformLayer> pImpl{ ADUC::MbedPlatformLayer::Create() };
         ADUC_Result result{ pImpl->SetUpdateActionCallbacks(data) };
@@ -41,6 +49,14 @@ ADUC_Result ADUC_RegisterPlatformLayer(ADUC_UpdateActionCallbacks* data, unsigne
     }
 }
 
+/**
+ * @brief Default no-op, for OTA PAL without post-reboot state. See mbed_post_reboot.h.
+ */
+__attribute__((weak))
+void ADUC_PostReboot_Settle(void)
+{
+}
+
 /**
  * @brief Unregister this module.
  *
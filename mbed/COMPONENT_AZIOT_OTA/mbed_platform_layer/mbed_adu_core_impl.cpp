@@ -32,6 +32,20 @@ std::unique_ptr<MbedPlatformLayer> MbedPlatformLayer::Create()
     return std::unique_ptr<MbedPlatformLayer>{ new MbedPlatformLayer() };
 }
 
+MbedPlatformLayer::~MbedPlatformLayer()
+{
+    // Workers are owned by this instance. Stop them before their closures' token dangles.
+#if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
+    rtos::Thread **workers[] = { &downloadWorker, &backupWorker, &installWorker, &applyWorker, &restoreWorker };
+    for (rtos::Thread **worker : workers) {
+        if (*worker) {
+            (*worker)->~Thread();
+            *worker = nullptr;
+        }
+    }
+#endif
+}
+
 /**
  * @brief Set the ADUC_UpdateActionCallbacks object
  *
@@ -117,32 +131,6 @@ static ContentHandler* GetUpdateManifestHandler(const ADUC_WorkflowData* workflo
     return contentHandler;
 }
 
-/**
- * @brief Definitions of download/backup/install/apply/restore workers
- */
-#if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-rtos::Thread *MbedPlatformLayer::downloadWorker = nullptr;
-uint64_t MbedPlatformLayer::downloadWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
-
-rtos::Thread *MbedPlatformLayer::backupWorker = nullptr;
-uint64_t MbedPlatformLayer::backupWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
-
-rtos::Thread *MbedPlatformLayer::installWorker = nullptr;
-uint64_t MbedPlatformLayer::installWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
-
-rtos::Thread *MbedPlatformLayer::applyWorker = nullptr;
-uint64_t MbedPlatformLayer::applyWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
-
-rtos::Thread *MbedPlatformLayer::restoreWorker = nullptr;
-uint64_t MbedPlatformLayer::restoreWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
-#else
-std::unique_ptr<rtos::Thread> MbedPlatformLayer::downloadWorker;
-std::unique_ptr<rtos::Thread> MbedPlatformLayer::backupWorker;
-std::unique_ptr<rtos::Thread> MbedPlatformLayer::installWorker;
-std::unique_ptr<rtos::Thread> MbedPlatformLayer::applyWorker;
-std::unique_ptr<rtos::Thread> MbedPlatformLayer::restoreWorker;
-#endif
-
 /**
  * @brief Class implementation of Download method.
  * @return ADUC_Result
@@ -40,6 +40,8 @@
  *    To address above, we make thread control block memory (thread Id) for new
  *    worker thread of the same task type unchanged, so that libspace having bound
  *    to it can be reused without rebinding.
+ *    The memory is held per MbedPlatformLayer instance, so it is reused as long as
+ *    the platform layer stays registered.
  *
  * Arm C/C++ Compiler libspace:
  * https://developer.arm.com/documentation/dui0475/m/the-arm-c-and-c---libraries/multithreaded-support-in-arm-c-libraries/use-of-the---user-libspace-static-data-area-by-the-c-libraries
@@ -58,6 +60,11 @@ class MbedPlatformLayer
 public:
     static std::unique_ptr<MbedPlatformLayer> Create();
 
+    ~MbedPlatformLayer();
+
+    MbedPlatformLayer(const MbedPlatformLayer&) = delete;
+    MbedPlatformLayer& operator=(const MbedPlatformLayer&) = delete;
+
     ADUC_Result SetUpdateActionCallbacks(ADUC_UpdateActionCallbacks* data);
 
 private:
@@ -92,10 +99,10 @@ private:
                                  workCompletionData,
                                  info,
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-                                 downloadWorker,
-                                 downloadWorkerBlock);
+                                 static_cast<MbedPlatformLayer*>(token)->downloadWorker,
+                                 static_cast<MbedPlatformLayer*>(token)->downloadWorkerBlock);
 #else
-                                 downloadWorker);
+                                 static_cast<MbedPlatformLayer*>(token)->downloadWorker);
 #endif
     }
 
@@ -114,10 +121,10 @@ private:
                                  workCompletionData,
                                  info,
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-                                 backupWorker,
-                                 backupWorkerBlock);
+                                 static_cast<MbedPlatformLayer*>(token)->backupWorker,
+                                 static_cast<MbedPlatformLayer*>(token)->backupWorkerBlock);
 #else
-                                 backupWorker);
+                                 static_cast<MbedPlatformLayer*>(token)->backupWorker);
 #endif
     }
 
@@ -136,10 +143,10 @@ private:
                                  workCompletionData,
                                  info,
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-                                 installWorker,
-                                 installWorkerBlock);
+                                 static_cast<MbedPlatformLayer*>(token)->installWorker,
+                                 static_cast<MbedPlatformLayer*>(token)->installWorkerBlock);
 #else
-                                 installWorker);
+                                 static_cast<MbedPlatformLayer*>(token)->installWorker);
 #endif
     }
 
@@ -158,10 +165,10 @@ private:
                                  workCompletionData,
                                  info,
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-                                 applyWorker,
-                                 applyWorkerBlock);
+                                 static_cast<MbedPlatformLayer*>(token)->applyWorker,
+                                 static_cast<MbedPlatformLayer*>(token)->applyWorkerBlock);
 #else
-                                 applyWorker);
+                                 static_cast<MbedPlatformLayer*>(token)->applyWorker);
 #endif
     }
 
@@ -180,10 +187,10 @@ private:
                                  workCompletionData,
                                  info,
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-                                 restoreWorker,
-                                 restoreWorkerBlock);
+                                 static_cast<MbedPlatformLayer*>(token)->restoreWorker,
+                                 static_cast<MbedPlatformLayer*>(token)->restoreWorkerBlock);
 #else
-                                 restoreWorker);
+                                 static_cast<MbedPlatformLayer*>(token)->restoreWorker);
 #endif
     }
 
@@ -269,21 +276,23 @@ private:
         std::unique_ptr<rtos::Thread> &worker)
 #endif
     {
+        // Workers are per instance, so that more than one platform layer can coexist.
+        MbedPlatformLayer* self = static_cast<MbedPlatformLayer*>(token);
         const char *taskName;
         ADUC_Result InProgressResult;
-        if (&worker == &downloadWorker) {
+        if (&worker == &self->downloadWorker) {
             taskName = "Download worker";
             InProgressResult = ADUC_Result{ ADUC_Result_Download_InProgress };
-        } else if (&worker == &backupWorker) {
+        } else if (&worker == &self->backupWorker) {
             taskName = "Backup worker";
             InProgressResult = ADUC_Result{ ADUC_Result_Backup_InProgress };
-        } else if (&worker == &installWorker) {
+        } else if (&worker == &self->installWorker) {
             taskName = "Install worker";
             InProgressResult = ADUC_Result{ ADUC_Result_Install_InProgress };
-        } else if (&worker == &applyWorker) {
+        } else if (&worker == &self->applyWorker) {
             taskName = "Apply worker";
             InProgressResult = ADUC_Result{ ADUC_Result_Apply_InProgress };
-        } else if (&worker == &restoreWorker) {
+        } else if (&worker == &self->restoreWorker) {
             taskName = "Restore worker";
             InProgressResult = ADUC_Result{ ADUC_Result_Restore_InProgress };
         } else {
@@ -369,15 +378,15 @@ private:
 #endif
 
         osStatus os_rc = osOK;
-        if (&worker == &downloadWorker) {
+        if (&worker == &self->downloadWorker) {
             os_rc = worker->start(downloadTask);
-        } else if (&worker == &backupWorker) {
+        } else if (&worker == &self->backupWorker) {
             os_rc = worker->start(backupTask);
-        } else if (&worker == &installWorker) {
+        } else if (&worker == &self->installWorker) {
             os_rc = worker->start(installTask);
-        } else if (&worker == &applyWorker) {
+        } else if (&worker == &self->applyWorker) {
             os_rc = worker->start(applyTask);
-        } else if (&worker == &restoreWorker) {
+        } else if (&worker == &self->restoreWorker) {
             os_rc = worker->start(restoreTask);
         } else {
             Log_Error("%s() failed: Uncaught asynchronous task", __func__);
@@ -396,50 +405,50 @@ private:
      * @brief Download thread control block
      */
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-    static rtos::Thread *                   downloadWorker;
-    static uint64_t                         downloadWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
+    rtos::Thread *                          downloadWorker{ nullptr };
+    uint64_t                                downloadWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
 #else
-    static std::unique_ptr<rtos::Thread>    downloadWorker;
+    std::unique_ptr<rtos::Thread>           downloadWorker;
 #endif
 
     /**
      * @brief Backup thread control block
      */
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-    static rtos::Thread *                   backupWorker;
-    static uint64_t                         backupWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
+    rtos::Thread *                          backupWorker{ nullptr };
+    uint64_t                                backupWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
 #else
-    static std::unique_ptr<rtos::Thread>    backupWorker;
+    std::unique_ptr<rtos::Thread>           backupWorker;
 #endif
 
     /**
      * @brief Install thread control block
      */
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-    static rtos::Thread *                   installWorker;
-    static uint64_t                         installWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
+    rtos::Thread *                          installWorker{ nullptr };
+    uint64_t                                installWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
 #else
-    static std::unique_ptr<rtos::Thread>    installWorker;
+    std::unique_ptr<rtos::Thread>           installWorker;
 #endif
 
     /**
      * @brief Apply thread control block
      */
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-    static rtos::Thread *                   applyWorker;
-    static uint64_t                         applyWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
+    rtos::Thread *                          applyWorker{ nullptr };
+    uint64_t                                applyWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
 #else
-    static std::unique_ptr<rtos::Thread>    applyWorker;
+    std::unique_ptr<rtos::Thread>           applyWorker;
 #endif
 
     /**
      * @brief Restore thread control block
      */
 #if defined(NU_WORKAROUND_THREAD_LIBSPACE_UNBIND)
-    static rtos::Thread *                   restoreWorker;
-    static uint64_t                         restoreWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
+    rtos::Thread *                          restoreWorker{ nullptr };
+    uint64_t                                restoreWorkerBlock[(sizeof(rtos::Thread) + 7) / 8];
 #else
-    static std::unique_ptr<rtos::Thread>    restoreWorker;
+    std::unique_ptr<rtos::Thread>           restoreWorker;
 #endif
 
     //
@@ -0,0 +1,129 @@
+/**
+ * @file mbed_apply_window.cpp
+ * @brief Implements deferred apply window.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#include "mbed_apply_window.h"
+#include "mbed_workflow_cancellation.h"
+
+#include <algorithm>
+
+#include "aduc/logging.h"
+
+/* Mbed includes */
+#include "mbed.h"
+#include "rtos/EventFlags.h"
+
+/* Start of daily apply window, in seconds past 00:00 UTC */
+#if defined(MBED_CONF_AZURE_CLIENT_OTA_APPLY_WINDOW_START)
+#define ADUC_APPLY_WINDOW_START                 MBED_CONF_AZURE_CLIENT_OTA_APPLY_WINDOW_START
+#else
+#define ADUC_APPLY_WINDOW_START                 0
+#endif
+
+/* Length of daily apply window in seconds. 0 to apply right after download. */
+#if defined(MBED_CONF_AZURE_CLIENT_OTA_APPLY_WINDOW_LENGTH)
+#define ADUC_APPLY_WINDOW_LENGTH                MBED_CONF_AZURE_CLIENT_OTA_APPLY_WINDOW_LENGTH
+#else
+#define ADUC_APPLY_WINDOW_LENGTH                0
+#endif
+
+#define ADUC_APPLY_WINDOW_DAY                   (24 * 60 * 60)
+
+/* Re-evaluate window at least this often, in case RTC gets adjusted e.g. by SNTP while waiting */
+#define ADUC_APPLY_WINDOW_RECHECK_SECONDS       60
+
+/* Calendar time before this (2020-01-01) means RTC is not set yet */
+#define ADUC_APPLY_WINDOW_MIN_VALID_TIME        1577836800
+
+#define ADUC_APPLY_WINDOW_FLAG_TRIGGER          (1UL << 0)
+#define ADUC_APPLY_WINDOW_FLAG_CANCEL           (1UL << 1)
+
+static rtos::EventFlags s_apply_window_flags;
+
+/**
+ * @brief Wake the waiter on workflow cancel. Short and non-blocking as required.
+ */
+static void WakeOnCancel(void* context)
+{
+    UNREFERENCED_PARAMETER(context);
+    s_apply_window_flags.set(ADUC_APPLY_WINDOW_FLAG_CANCEL);
+}
+
+__attribute__((weak))
+unsigned ADUC_ApplyWindow_SecondsUntilOpen(time_t now)
+{
+    if (ADUC_APPLY_WINDOW_LENGTH == 0 || ADUC_APPLY_WINDOW_LENGTH >= ADUC_APPLY_WINDOW_DAY)
+    {
+        return 0;
+    }
+
+    if (now < ADUC_APPLY_WINDOW_MIN_VALID_TIME)
+    {
+        Log_Warn("RTC not set, apply window ignored");
+        return 0;
+    }
+
+    unsigned secondOfDay = (unsigned)(now % ADUC_APPLY_WINDOW_DAY);
+    unsigned sinceStart =
+        (secondOfDay + ADUC_APPLY_WINDOW_DAY - (ADUC_APPLY_WINDOW_START % ADUC_APPLY_WINDOW_DAY)) % ADUC_APPLY_WINDOW_DAY;
+    if (sinceStart < ADUC_APPLY_WINDOW_LENGTH)
+    {
+        return 0;
+    }
+
+    return ADUC_APPLY_WINDOW_DAY - sinceStart;
+}
+
+void ADUC_ApplyWindow_Trigger(void)
+{
+    Log_Info("Apply window triggered");
+    s_apply_window_flags.set(ADUC_APPLY_WINDOW_FLAG_TRIGGER);
+}
+
+bool ADUC_ApplyWindow_Wait(ADUC_WorkflowHandle handle)
+{
+    bool allowed = false;
+    bool subscribed = false;
+    unsigned waitSeconds = 0;
+
+    s_apply_window_flags.clear(ADUC_APPLY_WINDOW_FLAG_CANCEL);
+    subscribed = ADUC_WorkflowCancellation_Subscribe(handle, WakeOnCancel, NULL);
+    if (!subscribed)
+    {
+        Log_Warn("Cancel request will take effect on next window re-check only");
+    }
+
+    while (!ADUC_WorkflowCancellation_IsRequested(handle))
+    {
+        /* Consume trigger latched before or during the wait */
+        if (s_apply_window_flags.get() & ADUC_APPLY_WINDOW_FLAG_TRIGGER)
+        {
+            s_apply_window_flags.clear(ADUC_APPLY_WINDOW_FLAG_TRIGGER);
+            allowed = true;
+            break;
+        }
+
+        waitSeconds = ADUC_ApplyWindow_SecondsUntilOpen(time(NULL));
+        if (waitSeconds == 0)
+        {
+            allowed = true;
+            break;
+        }
+
+        Log_Info("Update staged, apply deferred for %u s", waitSeconds);
+        s_apply_window_flags.wait_any_for(
+            ADUC_APPLY_WINDOW_FLAG_TRIGGER | ADUC_APPLY_WINDOW_FLAG_CANCEL,
+            std::chrono::seconds(std::min(waitSeconds, (unsigned)ADUC_APPLY_WINDOW_RECHECK_SECONDS)),
+            false);
+    }
+
+    if (subscribed)
+    {
+        ADUC_WorkflowCancellation_Unsubscribe(WakeOnCancel, NULL);
+    }
+
+    return allowed;
+}
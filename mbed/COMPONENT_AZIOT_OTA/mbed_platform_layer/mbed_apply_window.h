@@ -0,0 +1,51 @@
+/**
+ * @file mbed_apply_window.h
+ * @brief Defers apply of a staged update until a daily window or an explicit trigger.
+ *
+ * Upstream runs Download, Install and Apply back-to-back, so the device reboots into the new
+ * image as soon as the bytes arrive. Here, the content handler downloads and verifies at the
+ * OTA download's link scheduler class, keeps the staged state across reset through workflow
+ * persistence, and then waits here before committing the apply, e.g. before marking MCUboot
+ * secondary image pending. The wait ends when the configured window opens, on trigger from
+ * the user application (e.g. on a direct method or desired property), or on workflow cancel.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef MBED_APPLY_WINDOW_H
+#define MBED_APPLY_WINDOW_H
+
+#include "aduc/c_utils.h"
+#include "aduc/types/workflow.h" // ADUC_WorkflowHandle
+#include <stdbool.h>
+#include <time.h>
+
+EXTERN_C_BEGIN
+
+/**
+ * @brief Seconds from @p now until apply is allowed. 0 if allowed now.
+ *
+ * Default implementation uses daily window of azure-client-ota.apply-window-start/length
+ * in UTC. User application can override it, e.g. to consult a maintenance schedule.
+ *
+ * @param now Current calendar time.
+ * @return Seconds to wait.
+ */
+unsigned ADUC_ApplyWindow_SecondsUntilOpen(time_t now);
+
+/**
+ * @brief Open the window now for the pending or next apply. Safe to call from any thread.
+ */
+void ADUC_ApplyWindow_Trigger(void);
+
+/**
+ * @brief Block until apply is allowed. Called from the apply worker.
+ *
+ * @param handle The workflow handle, for cancel.
+ * @return true if apply is allowed, false if the workflow is cancelled.
+ */
+bool ADUC_ApplyWindow_Wait(ADUC_WorkflowHandle handle);
+
+EXTERN_C_END
+
+#endif // MBED_APPLY_WINDOW_H
@@ -0,0 +1,563 @@
+/**
+ * @file mbed_ota_kvstore.cpp
+ * @brief Implements small-record store for OTA metadata.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#include "mbed_ota_kvstore.h"
+
+#include <cstdio>
+#include <cstring>
+
+#include "aduc/logging.h"
+
+/* Mbed includes */
+#include "mbed.h"
+#include "rtos/Mutex.h"
+#include "rtos/ThisThread.h"
+#include "kvstore_global_api/kvstore_global_api.h"
+#include "TDBStore.h"
+#if defined(MBED_CONF_AZURE_CLIENT_OTA_KVSTORE_FLASHIAP_ADDRESS) && defined(MBED_CONF_AZURE_CLIENT_OTA_KVSTORE_FLASHIAP_SIZE)
+#include "FlashIAP/FlashIAPBlockDevice.h"
+#endif
+
+#include "trace_ring.h"
+
+/* Stringize */
+#define STR_EXPAND(tok) #tok
+#define STR(tok) STR_EXPAND(tok)
+
+/* KVStore default path prefix of key */
+#define KV_DEF_PATH                             "/" STR(MBED_CONF_STORAGE_DEFAULT_KV) "/"
+
+/* Maximum characters of key, excluding tailing null character */
+#define ADUC_OTA_KV_KEY_MAXCHAR                 31
+
+/* Backend key of packed records */
+#define ADUC_OTA_KV_PACKED_KEY                  "ota_kv_records"
+
+/* Bump on incompatible change of packed layout */
+#define ADUC_OTA_KV_PACKED_VERSION              1
+
+/* Packed layout: version, record count, then per record: key length, key, size (little endian), data */
+#define ADUC_OTA_KV_PACKED_MAXSIZE \
+    (2 + ADUC_OTA_KV_RECORDS_MAX * (1 + ADUC_OTA_KV_KEY_MAXCHAR + 2 + ADUC_OTA_KV_RECORD_MAXSIZE))
+
+/* Record, stored or held in batch */
+typedef struct
+{
+    bool Valid;
+    char Key[ADUC_OTA_KV_KEY_MAXCHAR + 1];
+    size_t Size;
+    uint8_t Data[ADUC_OTA_KV_RECORD_MAXSIZE];
+} ADUC_OtaKVRecord;
+
+/* Recursive, guards backend, batch, and loaded records and packing buffer below */
+static rtos::Mutex s_otakv_mutex;
+static bool s_backend_inited = false;
+static mbed::KVStore* s_dedicated_store = NULL;
+static ADUC_OtaKVRecord s_stored[ADUC_OTA_KV_RECORDS_MAX];
+static bool s_batch_active = false;
+static osThreadId_t s_batch_owner = NULL;
+static ADUC_OtaKVRecord s_batch[ADUC_OTA_KV_BATCH_MAX];
+static uint8_t s_packed[ADUC_OTA_KV_PACKED_MAXSIZE];
+
+__attribute__((weak))
+mbed::BlockDevice* get_ota_kvstore_bd(void)
+{
+#if defined(MBED_CONF_AZURE_CLIENT_OTA_KVSTORE_FLASHIAP_ADDRESS) && defined(MBED_CONF_AZURE_CLIENT_OTA_KVSTORE_FLASHIAP_SIZE)
+    static FlashIAPBlockDevice fbd(MBED_CONF_AZURE_CLIENT_OTA_KVSTORE_FLASHIAP_ADDRESS,
+                                   MBED_CONF_AZURE_CLIENT_OTA_KVSTORE_FLASHIAP_SIZE);
+    return &fbd;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * @brief Make fully-qualified key path of default KVStore.
+ */
+static bool Backend_DefaultPath(const char* key, char* path, size_t path_size)
+{
+    int len = snprintf(path, path_size, KV_DEF_PATH "%s", key);
+    return len > 0 && (size_t)len < path_size;
+}
+
+static int Backend_Set_Locked(const char* key, const void* buffer, size_t size)
+{
+    int kv_status;
+
+    TRACE_RING_BEGIN("kv_set");
+    if (s_dedicated_store != NULL)
+    {
+        kv_status = s_dedicated_store->set(key, buffer, size, 0);
+    }
+    else
+    {
+        char path[sizeof(KV_DEF_PATH) + ADUC_OTA_KV_KEY_MAXCHAR];
+        kv_status = Backend_DefaultPath(key, path, sizeof(path)) ? kv_set(path, buffer, size, 0)
+                                                                 : MBED_ERROR_INVALID_ARGUMENT;
+    }
+    TRACE_RING_END("kv_set");
+
+    return kv_status;
+}
+
+static int Backend_Get_Locked(const char* key, void* buffer, size_t buffer_size, size_t* actual_size)
+{
+    if (s_dedicated_store != NULL)
+    {
+        return s_dedicated_store->get(key, buffer, buffer_size, actual_size);
+    }
+
+    char path[sizeof(KV_DEF_PATH) + ADUC_OTA_KV_KEY_MAXCHAR];
+    return Backend_DefaultPath(key, path, sizeof(path)) ? kv_get(path, buffer, buffer_size, actual_size)
+                                                        : MBED_ERROR_INVALID_ARGUMENT;
+}
+
+static int Backend_Remove_Locked(const char* key)
+{
+    if (s_dedicated_store != NULL)
+    {
+        return s_dedicated_store->remove(key);
+    }
+
+    char path[sizeof(KV_DEF_PATH) + ADUC_OTA_KV_KEY_MAXCHAR];
+    return Backend_DefaultPath(key, path, sizeof(path)) ? kv_remove(path) : MBED_ERROR_INVALID_ARGUMENT;
+}
+
+/**
+ * @brief Parse packed records into s_stored. Must be in lock.
+ */
+static bool Unpack_Locked(const uint8_t* packed, size_t size)
+{
+    if (size < 2 || packed[0] != ADUC_OTA_KV_PACKED_VERSION || packed[1] > ADUC_OTA_KV_RECORDS_MAX)
+    {
+        return false;
+    }
+
+    size_t pos = 2;
+    for (int i = 0; i < packed[1]; i++)
+    {
+        ADUC_OtaKVRecord* record = &s_stored[i];
+
+        if (pos + 1 > size || packed[pos] > ADUC_OTA_KV_KEY_MAXCHAR || pos + 1 + packed[pos] + 2 > size)
+        {
+            return false;
+        }
+        size_t key_len = packed[pos++];
+        memcpy(record->Key, packed + pos, key_len);
+        record->Key[key_len] = '\0';
+        pos += key_len;
+
+        record->Size = (size_t)packed[pos] | ((size_t)packed[pos + 1] << 8);
+        pos += 2;
+        if (record->Size > ADUC_OTA_KV_RECORD_MAXSIZE || pos + record->Size > size)
+        {
+            return false;
+        }
+        memcpy(record->Data, packed + pos, record->Size);
+        pos += record->Size;
+        record->Valid = true;
+    }
+
+    return pos == size;
+}
+
+/**
+ * @brief Pack s_stored into s_packed. Must be in lock.
+ */
+static size_t Pack_Locked(void)
+{
+    size_t pos = 2;
+    uint8_t count = 0;
+    for (const ADUC_OtaKVRecord& record : s_stored)
+    {
+        if (!record.Valid)
+        {
+            continue;
+        }
+
+        size_t key_len = strlen(record.Key);
+        s_packed[pos++] = (uint8_t)key_len;
+        memcpy(s_packed + pos, record.Key, key_len);
+        pos += key_len;
+        s_packed[pos++] = (uint8_t)(record.Size & 0xFF);
+        s_packed[pos++] = (uint8_t)(record.Size >> 8);
+        memcpy(s_packed + pos, record.Data, record.Size);
+        pos += record.Size;
+        count++;
+    }
+    s_packed[0] = ADUC_OTA_KV_PACKED_VERSION;
+    s_packed[1] = count;
+
+    return pos;
+}
+
+/**
+ * @brief Set up dedicated store on first use. Must be in lock.
+ */
+static void Backend_Init_Locked(void)
+{
+    if (s_backend_inited)
+    {
+        return;
+    }
+    s_backend_inited = true;
+
+    mbed::BlockDevice* bd = get_ota_kvstore_bd();
+    if (bd == NULL)
+    {
+        return;
+    }
+
+    s_dedicated_store = new mbed::TDBStore(bd);
+    int kv_status = s_dedicated_store->init();
+    if (kv_status != MBED_SUCCESS)
+    {
+        Log_Error("Dedicated OTA KVStore init failed: %d. Use default KVStore.", kv_status);
+        delete s_dedicated_store;
+        s_dedicated_store = NULL;
+    }
+}
+
+/**
+ * @brief Read packed records into s_stored, in one backend read. Must be in lock.
+ *
+ * Not cached, so that backend stays the only state across reset.
+ *
+ * @return MBED_SUCCESS, also with no records stored yet, or KVStore error code.
+ */
+static int Load_Locked(void)
+{
+    Backend_Init_Locked();
+
+    memset(s_stored, 0x00, sizeof(s_stored));
+
+    size_t actual_size = 0;
+    int kv_status = Backend_Get_Locked(ADUC_OTA_KV_PACKED_KEY, s_packed, sizeof(s_packed), &actual_size);
+    if (kv_status == MBED_ERROR_ITEM_NOT_FOUND)
+    {
+        return MBED_SUCCESS;
+    }
+    if (kv_status != MBED_SUCCESS)
+    {
+        Log_Error("OTA KV records read failed: %d", kv_status);
+        return kv_status;
+    }
+    if (!Unpack_Locked(s_packed, actual_size))
+    {
+        Log_Error("OTA KV records corrupted. Drop them.");
+        memset(s_stored, 0x00, sizeof(s_stored));
+    }
+
+    return MBED_SUCCESS;
+}
+
+/**
+ * @brief Write s_stored to backend, all records in one backend write. Must be in lock.
+ */
+static int Store_Locked(void)
+{
+    return Backend_Set_Locked(ADUC_OTA_KV_PACKED_KEY, s_packed, Pack_Locked());
+}
+
+static ADUC_OtaKVRecord* FindRecord_Locked(ADUC_OtaKVRecord* records, size_t count, const char* key)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (records[i].Valid && strcmp(records[i].Key, key) == 0)
+        {
+            return &records[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Take free record for @p key. Must be in lock.
+ */
+static ADUC_OtaKVRecord* AllocRecord_Locked(ADUC_OtaKVRecord* records, size_t count, const char* key)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!records[i].Valid)
+        {
+            strcpy(records[i].Key, key);
+            records[i].Valid = true;
+            return &records[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Update loaded s_stored with @p key. Must be in lock.
+ *
+ * @param changed Set to true if content of @p key changes.
+ * @param is_new Set to true if @p key is new to packed records.
+ */
+static int Update_Locked(const char* key, const void* buffer, size_t size, bool* changed, bool* is_new)
+{
+    ADUC_OtaKVRecord* record = FindRecord_Locked(s_stored, ADUC_OTA_KV_RECORDS_MAX, key);
+    if (record != NULL && record->Size == size && memcmp(record->Data, buffer, size) == 0)
+    {
+        return MBED_SUCCESS;
+    }
+
+    if (record == NULL)
+    {
+        record = AllocRecord_Locked(s_stored, ADUC_OTA_KV_RECORDS_MAX, key);
+        if (record == NULL)
+        {
+            Log_Error("OTA KV records full. Can't write '%s'.", key);
+            return MBED_ERROR_MEDIA_FULL;
+        }
+        *is_new = true;
+    }
+
+    memcpy(record->Data, buffer, size);
+    record->Size = size;
+    *changed = true;
+    return MBED_SUCCESS;
+}
+
+/**
+ * @brief Write @p key to backend unless content is the same. Must be in lock.
+ */
+static int WriteThrough_Locked(const char* key, const void* buffer, size_t size)
+{
+    bool changed = false;
+    bool is_new = false;
+
+    int kv_status = Load_Locked();
+    if (kv_status == MBED_SUCCESS)
+    {
+        kv_status = Update_Locked(key, buffer, size, &changed, &is_new);
+    }
+    if (kv_status == MBED_SUCCESS && changed)
+    {
+        kv_status = Store_Locked();
+    }
+    if (kv_status == MBED_SUCCESS && is_new)
+    {
+        // Drop record of the same key written on its own by earlier versions
+        Backend_Remove_Locked(key);
+    }
+
+    return kv_status;
+}
+
+/**
+ * @brief Take batch record for @p key, if calling thread owns the batch. Must be in lock.
+ */
+static ADUC_OtaKVRecord* AllocBatchRecord_Locked(const char* key)
+{
+    if (!s_batch_active || s_batch_owner != rtos::ThisThread::get_id())
+    {
+        return NULL;
+    }
+
+    ADUC_OtaKVRecord* record = AllocRecord_Locked(s_batch, ADUC_OTA_KV_BATCH_MAX, key);
+    if (record == NULL)
+    {
+        Log_Warn("OTA KV batch full. Write '%s' through.", key);
+    }
+    return record;
+}
+
+int ADUC_OtaKV_Set(const char* key, const void* buffer, size_t size)
+{
+    if (key == NULL || (buffer == NULL && size != 0) || size > ADUC_OTA_KV_RECORD_MAXSIZE
+        || strlen(key) > ADUC_OTA_KV_KEY_MAXCHAR)
+    {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    s_otakv_mutex.lock();
+
+    int kv_status = MBED_SUCCESS;
+    ADUC_OtaKVRecord* record = FindRecord_Locked(s_batch, ADUC_OTA_KV_BATCH_MAX, key);
+    if (record == NULL)
+    {
+        record = AllocBatchRecord_Locked(key);
+    }
+
+    if (record != NULL)
+    {
+        memcpy(record->Data, buffer, size);
+        record->Size = size;
+    }
+    else
+    {
+        kv_status = WriteThrough_Locked(key, buffer, size);
+    }
+
+    s_otakv_mutex.unlock();
+    return kv_status;
+}
+
+int ADUC_OtaKV_Get(const char* key, void* buffer, size_t buffer_size, size_t* actual_size)
+{
+    if (key == NULL || (buffer == NULL && buffer_size != 0))
+    {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    s_otakv_mutex.lock();
+
+    const ADUC_OtaKVRecord* record = FindRecord_Locked(s_batch, ADUC_OTA_KV_BATCH_MAX, key);
+    int kv_status = MBED_SUCCESS;
+    if (record == NULL)
+    {
+        kv_status = Load_Locked();
+        record = FindRecord_Locked(s_stored, ADUC_OTA_KV_RECORDS_MAX, key);
+    }
+
+    if (record != NULL)
+    {
+        size_t copy_size = record->Size < buffer_size ? record->Size : buffer_size;
+        memcpy(buffer, record->Data, copy_size);
+        if (actual_size != NULL)
+        {
+            *actual_size = copy_size;
+        }
+    }
+    else if (kv_status == MBED_SUCCESS)
+    {
+        // Record written on its own by earlier versions, until next set of it
+        kv_status = Backend_Get_Locked(key, buffer, buffer_size, actual_size);
+    }
+
+    s_otakv_mutex.unlock();
+    return kv_status;
+}
+
+int ADUC_OtaKV_Remove(const char* key)
+{
+    if (key == NULL)
+    {
+        return MBED_ERROR_INVALID_ARGUMENT;
+    }
+
+    s_otakv_mutex.lock();
+
+    bool found = false;
+    ADUC_OtaKVRecord* record = FindRecord_Locked(s_batch, ADUC_OTA_KV_BATCH_MAX, key);
+    if (record != NULL)
+    {
+        record->Valid = false;
+        found = true;
+    }
+
+    int kv_status = Load_Locked();
+    if (kv_status == MBED_SUCCESS)
+    {
+        record = FindRecord_Locked(s_stored, ADUC_OTA_KV_RECORDS_MAX, key);
+        if (record != NULL)
+        {
+            record->Valid = false;
+            kv_status = Store_Locked();
+            found = true;
+        }
+    }
+
+    if (kv_status == MBED_SUCCESS)
+    {
+        int legacy_status = Backend_Remove_Locked(key);
+        if (!found)
+        {
+            kv_status = legacy_status;
+        }
+    }
+
+    s_otakv_mutex.unlock();
+    return kv_status;
+}
+
+int ADUC_OtaKV_BeginBatch(void)
+{
+    s_otakv_mutex.lock();
+
+    int kv_status = MBED_SUCCESS;
+    if (s_batch_active)
+    {
+        Log_Error("OTA KV batch already active%s", s_batch_owner == rtos::ThisThread::get_id() ? "" : " in another thread");
+        kv_status = MBED_ERROR_ALREADY_IN_USE;
+    }
+    else
+    {
+        s_batch_active = true;
+        s_batch_owner = rtos::ThisThread::get_id();
+    }
+
+    s_otakv_mutex.unlock();
+    return kv_status;
+}
+
+int ADUC_OtaKV_Commit(void)
+{
+    s_otakv_mutex.lock();
+
+    if (s_batch_active && s_batch_owner != rtos::ThisThread::get_id())
+    {
+        Log_Error("OTA KV batch owned by another thread");
+        s_otakv_mutex.unlock();
+        return MBED_ERROR_ALREADY_IN_USE;
+    }
+
+    bool held = false;
+    for (const ADUC_OtaKVRecord& entry : s_batch)
+    {
+        held = held || entry.Valid;
+    }
+
+    int kv_status = MBED_SUCCESS;
+    bool changed = false;
+    bool is_new[ADUC_OTA_KV_BATCH_MAX] = {};
+    if (held)
+    {
+        kv_status = Load_Locked();
+    }
+    for (size_t i = 0; kv_status == MBED_SUCCESS && held && i < ADUC_OTA_KV_BATCH_MAX; i++)
+    {
+        const ADUC_OtaKVRecord& entry = s_batch[i];
+        if (entry.Valid)
+        {
+            kv_status = Update_Locked(entry.Key, entry.Data, entry.Size, &changed, &is_new[i]);
+        }
+    }
+
+    // All held records in one backend write, so that they persist together or not at all
+    if (kv_status == MBED_SUCCESS && changed)
+    {
+        kv_status = Store_Locked();
+    }
+    if (kv_status == MBED_SUCCESS)
+    {
+        for (size_t i = 0; i < ADUC_OTA_KV_BATCH_MAX; i++)
+        {
+            if (is_new[i])
+            {
+                Backend_Remove_Locked(s_batch[i].Key);
+            }
+        }
+    }
+    else
+    {
+        Log_Error("OTA KV commit failed: %d", kv_status);
+    }
+
+    for (ADUC_OtaKVRecord& entry : s_batch)
+    {
+        entry.Valid = false;
+    }
+    s_batch_active = false;
+    s_batch_owner = NULL;
+
+    s_otakv_mutex.unlock();
+    return kv_status;
+}
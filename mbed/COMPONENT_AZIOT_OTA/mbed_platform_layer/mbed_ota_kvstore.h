@@ -0,0 +1,96 @@
+/**
+ * @file mbed_ota_kvstore.h
+ * @brief Small-record store for OTA metadata, with write suppression and batched commit.
+ *
+ * OTA metadata (workflow persistence record, firmware upgrade state) is a few small records
+ * rewritten at phase boundaries. They are packed into one backend record, so that updates to
+ * several of them persist together or not at all. The backend record goes to a dedicated
+ * TDBStore when a partition is provided through get_ota_kvstore_bd(), so that garbage collection
+ * only moves a few hundred bytes of OTA records and doesn't fire on application data in the
+ * middle of OTA. Otherwise, it stays in the default KVStore.
+ *
+ * Writes of unchanged content are suppressed. A batch holds writes in RAM until
+ * ADUC_OtaKV_Commit(), which writes them all in one backend write.
+ *
+ * Records written on their own by earlier versions are still read, and dropped on next set.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef MBED_OTA_KVSTORE_H
+#define MBED_OTA_KVSTORE_H
+
+#include "aduc/c_utils.h"
+#include <stddef.h>
+
+#ifdef __cplusplus
+namespace mbed {
+class BlockDevice;
+}
+
+/**
+ * @brief Block device partition dedicated to OTA metadata.
+ *
+ * Default implementation returns a FlashIAPBlockDevice over azure-client-ota.kvstore-flashiap-address
+ * and azure-client-ota.kvstore-flashiap-size if both are configured, or NULL, meaning the default
+ * KVStore is used. User application can override it, e.g. with a SlicingBlockDevice of two erase
+ * units outside the KVStore area.
+ * Changing it drops OTA metadata kept in the previous store.
+ */
+mbed::BlockDevice* get_ota_kvstore_bd(void);
+#endif
+
+EXTERN_C_BEGIN
+
+/* Maximum record size, records stored, and records held by one batch */
+#define ADUC_OTA_KV_RECORD_MAXSIZE              256
+#define ADUC_OTA_KV_RECORDS_MAX                 4
+#define ADUC_OTA_KV_BATCH_MAX                   2
+
+/**
+ * @brief Set @p key to @p buffer. No write if content is unchanged. Held in RAM if in batch.
+ *
+ * @param key Plain key name, without KVStore path.
+ * @return MBED_SUCCESS, MBED_ERROR_MEDIA_FULL if ADUC_OTA_KV_RECORDS_MAX records are stored,
+ * or KVStore error code.
+ */
+int ADUC_OtaKV_Set(const char* key, const void* buffer, size_t size);
+
+/**
+ * @brief Get @p key, including content held in batch.
+ *
+ * @param key Plain key name, without KVStore path.
+ * @return MBED_SUCCESS or KVStore error code.
+ */
+int ADUC_OtaKV_Get(const char* key, void* buffer, size_t buffer_size, size_t* actual_size);
+
+/**
+ * @brief Remove @p key, including content held in batch.
+ *
+ * @param key Plain key name, without KVStore path.
+ * @return MBED_SUCCESS, MBED_ERROR_ITEM_NOT_FOUND or KVStore error code.
+ */
+int ADUC_OtaKV_Remove(const char* key);
+
+/**
+ * @brief Start holding writes of the calling thread in RAM. Not nestable.
+ *
+ * One batch at a time, owned by the calling thread until ADUC_OtaKV_Commit(). Writes of other
+ * threads to keys held in batch update the held content, so the latest content wins on commit.
+ *
+ * @return MBED_SUCCESS, or MBED_ERROR_ALREADY_IN_USE if a batch is active, of any thread.
+ */
+int ADUC_OtaKV_BeginBatch(void);
+
+/**
+ * @brief Write held content in one backend write and end batch. Nothing held is written on
+ * failure. MBED_SUCCESS with nothing written if no batch is active.
+ *
+ * @return MBED_SUCCESS, MBED_ERROR_ALREADY_IN_USE if the batch is owned by another thread,
+ * MBED_ERROR_MEDIA_FULL if ADUC_OTA_KV_RECORDS_MAX records are stored, or KVStore error code.
+ */
+int ADUC_OtaKV_Commit(void);
+
+EXTERN_C_END
+
+#endif // MBED_OTA_KVSTORE_H
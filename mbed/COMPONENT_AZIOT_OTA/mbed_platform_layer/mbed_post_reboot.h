@@ -0,0 +1,36 @@
+/**
+ * @file mbed_post_reboot.h
+ * @brief Settles firmware upgrade state on first start after install reboot.
+ *
+ * Upstream agent runs as a fresh process after reboot and has the update handler settle its
+ * state on demand. Here, the OTA PAL implements this hook. MCUboot OTA PAL runs it from Mbed OS
+ * pre-main hook mbed_main(), after global constructors, instead of from a global constructor of its
+ * own, which relied on KVStore being usable during static initialization.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef MBED_POST_REBOOT_H
+#define MBED_POST_REBOOT_H
+
+#include "aduc/c_utils.h"
+
+EXTERN_C_BEGIN
+
+/**
+ * @brief Settle firmware upgrade state after reboot. Safe to call more than once; only the first
+ * call does the work.
+ *
+ * This is the only place MCUboot upgrade gets confirmed. MCUboot OTA PAL calls it before main(),
+ * unless azure-client-ota-mcuboot.confirm-before-main is disabled, e.g. for the application to
+ * define mbed_main() itself. The agent calls it again in ADUC_RegisterPlatformLayer(), before
+ * anything reports installed update, which is a no-op if it ran before. With confirm-before-main
+ * disabled, the upgraded image stays unconfirmed until then, and a reset reverts it.
+ *
+ * Default implementation does nothing; OTA PAL overrides it.
+ */
+void ADUC_PostReboot_Settle(void);
+
+EXTERN_C_END
+
+#endif // MBED_POST_REBOOT_H
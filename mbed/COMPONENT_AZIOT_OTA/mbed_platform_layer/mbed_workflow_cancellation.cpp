@@ -0,0 +1,232 @@
+/**
+ * @file mbed_workflow_cancellation.cpp
+ * @brief Implements cancellation token of ADU workflows.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#include "mbed_workflow_cancellation.h"
+
+#include <atomic>
+#include <cstring>
+
+#include "aduc/logging.h"
+#include "aduc/workflow_utils.h"
+
+/* Mbed includes */
+#include "mbed.h"
+#include "rtos/Mutex.h"
+
+/* Cancelled workflows tracked at the same time: root and child workflows of the current
+ * workflow and of a deferred replacement, i.e. 2 * (1 + images per deployment) */
+#define ADUC_CANCELLATION_TOKEN_MAX             MBED_CONF_AZURE_CLIENT_OTA_WORKFLOW_CANCELLATION_TOKENS
+
+/* Concurrent subscribers: one in-flight transfer per image, plus apply window wait */
+#define ADUC_CANCELLATION_SUBSCRIBER_MAX        MBED_CONF_AZURE_CLIENT_OTA_WORKFLOW_CANCELLATION_SUBSCRIBERS
+
+#if defined(MCUBOOT_IMAGE_NUMBER)
+MBED_STATIC_ASSERT(ADUC_CANCELLATION_TOKEN_MAX >= 2 * (1 + MCUBOOT_IMAGE_NUMBER),
+                   "azure-client-ota.workflow-cancellation-tokens too small for MCUBOOT_IMAGE_NUMBER");
+MBED_STATIC_ASSERT(ADUC_CANCELLATION_SUBSCRIBER_MAX >= MCUBOOT_IMAGE_NUMBER + 1,
+                   "azure-client-ota.workflow-cancellation-subscribers too small for MCUBOOT_IMAGE_NUMBER");
+#endif
+
+/* Cancel request of one workflow and its descendants, keyed by workflow handle */
+typedef struct
+{
+    std::atomic<ADUC_WorkflowHandle> Handle;
+    std::atomic<bool> Cancelled;
+} ADUC_CancellationToken;
+
+typedef struct
+{
+    ADUC_WorkflowHandle Handle;
+    ADUC_WorkflowCancellationCallback Callback;
+    void* Context;
+} ADUC_CancellationSubscriber;
+
+/* Recursive, so that a subscriber can unsubscribe itself */
+static rtos::Mutex s_cancellation_mutex;
+static ADUC_CancellationToken s_tokens[ADUC_CANCELLATION_TOKEN_MAX];
+static ADUC_CancellationSubscriber s_subscribers[ADUC_CANCELLATION_SUBSCRIBER_MAX];
+
+/**
+ * @brief Find token of @p handle. Must be in lock.
+ */
+static ADUC_CancellationToken* FindToken_Locked(ADUC_WorkflowHandle handle)
+{
+    for (ADUC_CancellationToken& token : s_tokens)
+    {
+        if (token.Handle.load() == handle)
+        {
+            return &token;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Check whether @p ancestor is @p handle or one of its ancestors.
+ */
+static bool IsSelfOrAncestor(ADUC_WorkflowHandle ancestor, ADUC_WorkflowHandle handle)
+{
+    for (; handle != NULL; handle = workflow_get_parent(handle))
+    {
+        if (handle == ancestor)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Invoke subscribers of @p handle and its descendants. Must be in lock.
+ */
+static void Notify_Locked(ADUC_WorkflowHandle handle)
+{
+    for (ADUC_CancellationSubscriber& subscriber : s_subscribers)
+    {
+        if (subscriber.Callback != NULL && IsSelfOrAncestor(handle, subscriber.Handle))
+        {
+            subscriber.Callback(subscriber.Context);
+        }
+    }
+}
+
+bool ADUC_WorkflowCancellation_Request(ADUC_WorkflowHandle handle)
+{
+    if (handle == NULL)
+    {
+        return false;
+    }
+
+    s_cancellation_mutex.lock();
+
+    bool requested = true;
+    ADUC_CancellationToken* token = FindToken_Locked(handle);
+    if (token == NULL)
+    {
+        token = FindToken_Locked(NULL);
+    }
+    if (token == NULL)
+    {
+        // Table sized too small for the deployment: a cancel request must not get lost silently.
+        Log_Error("No free cancellation token (max %d)", ADUC_CANCELLATION_TOKEN_MAX);
+        MBED_ERROR(
+            MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, MBED_ERROR_CODE_OUT_OF_RESOURCES),
+            "Raise azure-client-ota.workflow-cancellation-tokens");
+        requested = false;
+    }
+    else if (!token->Cancelled.load())
+    {
+        token->Handle.store(handle);
+        token->Cancelled.store(true);
+        Notify_Locked(handle);
+    }
+
+    s_cancellation_mutex.unlock();
+    return requested;
+}
+
+bool ADUC_WorkflowCancellation_IsRequested(ADUC_WorkflowHandle handle)
+{
+    // Cancel of a workflow applies to its descendants, so check ancestors too.
+    for (; handle != NULL; handle = workflow_get_parent(handle))
+    {
+        for (ADUC_CancellationToken& token : s_tokens)
+        {
+            if (token.Handle.load() == handle && token.Cancelled.load())
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void ADUC_WorkflowCancellation_Reset(ADUC_WorkflowHandle handle)
+{
+    if (handle == NULL)
+    {
+        return;
+    }
+
+    s_cancellation_mutex.lock();
+
+    ADUC_CancellationToken* token = FindToken_Locked(handle);
+    if (token != NULL)
+    {
+        token->Cancelled.store(false);
+        token->Handle.store(NULL);
+    }
+
+    for (ADUC_CancellationSubscriber& subscriber : s_subscribers)
+    {
+        if (subscriber.Handle == handle)
+        {
+            memset(&subscriber, 0x00, sizeof(subscriber));
+        }
+    }
+
+    s_cancellation_mutex.unlock();
+}
+
+bool ADUC_WorkflowCancellation_Subscribe(
+    ADUC_WorkflowHandle handle, ADUC_WorkflowCancellationCallback callback, void* context)
+{
+    if (handle == NULL || callback == NULL)
+    {
+        return false;
+    }
+
+    s_cancellation_mutex.lock();
+
+    bool subscribed = false;
+    for (ADUC_CancellationSubscriber& subscriber : s_subscribers)
+    {
+        if (subscriber.Callback == NULL)
+        {
+            subscriber.Handle = handle;
+            subscriber.Callback = callback;
+            subscriber.Context = context;
+            subscribed = true;
+            break;
+        }
+    }
+
+    if (!subscribed)
+    {
+        // Table sized too small for the deployment: cancel would no longer abort a transfer.
+        Log_Error("No free cancellation subscriber slot (max %d)", ADUC_CANCELLATION_SUBSCRIBER_MAX);
+        MBED_ERROR(
+            MBED_MAKE_ERROR(MBED_MODULE_APPLICATION, MBED_ERROR_CODE_OUT_OF_RESOURCES),
+            "Raise azure-client-ota.workflow-cancellation-subscribers");
+    }
+    else if (ADUC_WorkflowCancellation_IsRequested(handle))
+    {
+        // Cancel already requested. Don't miss it.
+        callback(context);
+    }
+
+    s_cancellation_mutex.unlock();
+    return subscribed;
+}
+
+void ADUC_WorkflowCancellation_Unsubscribe(ADUC_WorkflowCancellationCallback callback, void* context)
+{
+    s_cancellation_mutex.lock();
+
+    for (ADUC_CancellationSubscriber& subscriber : s_subscribers)
+    {
+        if (subscriber.Callback == callback && subscriber.Context == context)
+        {
+            memset(&subscriber, 0x00, sizeof(subscriber));
+        }
+    }
+
+    s_cancellation_mutex.unlock();
+}
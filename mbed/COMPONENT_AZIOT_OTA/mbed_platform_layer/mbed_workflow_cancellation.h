@@ -0,0 +1,81 @@
+/**
+ * @file mbed_workflow_cancellation.h
+ * @brief Cancellation token of ADU workflows, safe to poll from worker threads.
+ *
+ * Upstream keeps the cancel request as a '_cancelRequested' property in the workflow's parson
+ * properties object. Polling it from the download worker means a string-keyed JSON lookup per
+ * HTTP body chunk, racing with the main thread writing the same object on cancel. Besides, a
+ * transfer blocked in recv() only notices the cancel after the next chunk or socket timeout.
+ *
+ * Here, the cancel request is an atomic flag per cancelled workflow handle. Like upstream, cancel
+ * of a workflow applies to it and its descendants (child workflows), not to its parent or siblings.
+ * Subscriber callbacks are invoked on cancel to abort in-flight transfers.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef MBED_WORKFLOW_CANCELLATION_H
+#define MBED_WORKFLOW_CANCELLATION_H
+
+#include "aduc/c_utils.h"
+#include "aduc/types/workflow.h" // ADUC_WorkflowHandle
+#include <stdbool.h>
+
+EXTERN_C_BEGIN
+
+/**
+ * @brief Callback invoked once on cancel request.
+ *
+ * Invoked in the requesting thread with the cancellation lock held, so it must be short and
+ * non-blocking, e.g. closing a socket. Once ADUC_WorkflowCancellation_Unsubscribe() returns,
+ * the callback is guaranteed not running.
+ */
+typedef void (*ADUC_WorkflowCancellationCallback)(void* context);
+
+/**
+ * @brief Request cancel of @p handle and its descendants, and invoke their subscribers.
+ *
+ * @param handle The workflow handle.
+ * @return true on success, false if there is no free cancellation token.
+ */
+bool ADUC_WorkflowCancellation_Request(ADUC_WorkflowHandle handle);
+
+/**
+ * @brief Check cancel request without lock.
+ *
+ * @param handle The workflow handle.
+ * @return true if cancel has been requested for @p handle or one of its ancestors.
+ */
+bool ADUC_WorkflowCancellation_IsRequested(ADUC_WorkflowHandle handle);
+
+/**
+ * @brief Forget cancel request and subscribers of @p handle, e.g. on workflow free.
+ *
+ * @param handle The workflow handle.
+ */
+void ADUC_WorkflowCancellation_Reset(ADUC_WorkflowHandle handle);
+
+/**
+ * @brief Subscribe to cancel request of @p handle or one of its ancestors.
+ *
+ * If cancel has already been requested, @p callback is invoked immediately.
+ *
+ * @param handle The workflow handle.
+ * @param callback The callback.
+ * @param context The context passed to @p callback.
+ * @return true on success, false if there is no free subscriber slot.
+ */
+bool ADUC_WorkflowCancellation_Subscribe(
+    ADUC_WorkflowHandle handle, ADUC_WorkflowCancellationCallback callback, void* context);
+
+/**
+ * @brief Unsubscribe what ADUC_WorkflowCancellation_Subscribe() subscribed.
+ *
+ * @param callback The callback.
+ * @param context The context.
+ */
+void ADUC_WorkflowCancellation_Unsubscribe(ADUC_WorkflowCancellationCallback callback, void* context);
+
+EXTERN_C_END
+
+#endif // MBED_WORKFLOW_CANCELLATION_H
@@ -0,0 +1,393 @@
+/**
+ * @file mbed_workflow_persistence.cpp
+ * @brief Implements persisting essential ADU workflow state in KVStore.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#include "mbed_workflow_persistence.h"
+
+#include <cinttypes>
+#include <cstring>
+
+#include "aduc/logging.h"
+#include "aduc/workflow_utils.h"
+
+/* Mbed includes */
+#include "mbed.h"
+#include "rtos/Mutex.h"
+
+#include "mbed_ota_kvstore.h"
+
+/* OTA KVStore key to in-storage record */
+#define ADUC_WORKFLOW_STATE_KEY                 "aduc_workflow_state"
+
+/* Bump on incompatible change of ADUC_PersistedWorkflowState layout */
+#define ADUC_WORKFLOW_STATE_MAGIC               0x57465333UL    // "WFS3"
+
+/* In-storage layout: magic + record */
+typedef struct
+{
+    uint32_t Magic;
+    ADUC_PersistedWorkflowState State;
+} ADUC_PersistedWorkflowRecord;
+
+static_assert(sizeof(ADUC_PersistedWorkflowRecord) <= ADUC_OTA_KV_RECORD_MAXSIZE,
+              "ADUC_PersistedWorkflowRecord exceeds OTA KVStore record size");
+
+/* RAM copy of in-storage record to avoid KVStore read on every query */
+static rtos::Mutex s_persistence_mutex;
+static bool s_record_loaded = false;
+static bool s_record_valid = false;
+static ADUC_PersistedWorkflowRecord s_record;
+
+/* Phase boundary recorded before startup, for ADUC_WorkflowPersistence_TakeStartupPhase() */
+static bool s_startup_phase_valid = false;
+static ADUC_PersistedWorkflowState s_startup_phase;
+
+/**
+ * @brief Fill workflow id and retry token of root workflow of @p handle.
+ *
+ * @return false if the handle doesn't have id or strings don't fit in.
+ */
+static bool FillDeploymentIdentity(ADUC_WorkflowHandle handle, ADUC_PersistedWorkflowState* state)
+{
+    ADUC_WorkflowHandle root = workflow_get_root(handle);
+    const char* workflowId = workflow_peek_id(root);
+    const char* retryToken = workflow_peek_retryTimestamp(root);
+
+    if (workflowId == NULL || *workflowId == '\0')
+    {
+        return false;
+    }
+
+    size_t len = strlen(workflowId);
+    if (len > ADUC_PERSISTED_WORKFLOW_ID_MAXCHAR)
+    {
+        Log_Warn("Workflow id too long to persist: %s", workflowId);
+        return false;
+    }
+    memset(state->WorkflowId, 0x00, sizeof(state->WorkflowId));
+    memcpy(state->WorkflowId, workflowId, len);
+
+    memset(state->RetryToken, 0x00, sizeof(state->RetryToken));
+    if (retryToken != NULL)
+    {
+        len = strlen(retryToken);
+        if (len > ADUC_PERSISTED_RETRY_TOKEN_MAXCHAR)
+        {
+            Log_Warn("Retry token too long to persist: %s", retryToken);
+            return false;
+        }
+        memcpy(state->RetryToken, retryToken, len);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check record loaded and for the same deployment. Must be in lock.
+ */
+static bool IsSameDeployment_Locked(const ADUC_PersistedWorkflowState* identity)
+{
+    return s_record_valid && strcmp(s_record.State.WorkflowId, identity->WorkflowId) == 0
+        && strcmp(s_record.State.RetryToken, identity->RetryToken) == 0;
+}
+
+/**
+ * @brief Write @p record to KVStore, and to RAM copy only if that succeeds. Must be in lock.
+ *
+ * On failure, RAM copy keeps what is in storage, so that queries don't report progress which
+ * would be lost on reset.
+ */
+static bool Store_Locked(const ADUC_PersistedWorkflowRecord* record)
+{
+    int kv_status = ADUC_OtaKV_Set(ADUC_WORKFLOW_STATE_KEY, record, sizeof(*record));
+    if (kv_status != MBED_SUCCESS)
+    {
+        Log_Error("ADUC_OtaKV_Set(workflow state) failed: %d", kv_status);
+        return false;
+    }
+
+    s_record = *record;
+    s_record_valid = true;
+    return true;
+}
+
+/**
+ * @brief Check @p updateState is one a workflow step ends in. See ADUC_WorkflowPersistence_SavePhase().
+ */
+static bool IsPhaseBoundary(ADUCITF_State updateState)
+{
+    switch (updateState)
+    {
+    case ADUCITF_State_DeploymentInProgress:
+    case ADUCITF_State_DownloadSucceeded:
+    case ADUCITF_State_BackupSucceeded:
+    case ADUCITF_State_InstallSucceeded:
+    case ADUCITF_State_Failed:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Read KVStore into RAM copy if not yet. Must be in lock.
+ */
+static bool Load_Locked(void)
+{
+    if (s_record_loaded)
+    {
+        return s_record_valid;
+    }
+
+    size_t actual_size = 0;
+    int kv_status = ADUC_OtaKV_Get(ADUC_WORKFLOW_STATE_KEY, &s_record, sizeof(s_record), &actual_size);
+
+    s_record_loaded = true;
+    s_record_valid = (kv_status == MBED_SUCCESS) && (actual_size == sizeof(s_record))
+        && (s_record.Magic == ADUC_WORKFLOW_STATE_MAGIC)
+        && (memchr(s_record.State.WorkflowId, '\0', sizeof(s_record.State.WorkflowId)) != NULL)
+        && (memchr(s_record.State.RetryToken, '\0', sizeof(s_record.State.RetryToken)) != NULL);
+    if (!s_record_valid)
+    {
+        memset(&s_record, 0x00, sizeof(s_record));
+    }
+
+    s_startup_phase_valid = s_record_valid;
+    s_startup_phase = s_record.State;
+
+    return s_record_valid;
+}
+
+bool ADUC_WorkflowPersistence_Load(void)
+{
+    s_persistence_mutex.lock();
+
+    bool loaded = Load_Locked();
+    if (loaded)
+    {
+        Log_Info(
+            "Persisted workflow '%s' (retry '%s'): step %d, state %d, download offset %" PRIu32,
+            s_record.State.WorkflowId,
+            s_record.State.RetryToken,
+            s_record.State.WorkflowStep,
+            s_record.State.State,
+            s_record.State.DownloadOffset);
+    }
+
+    s_persistence_mutex.unlock();
+    return loaded;
+}
+
+bool ADUC_WorkflowPersistence_SavePhase(ADUC_WorkflowHandle handle, ADUCITF_State updateState)
+{
+    if (!IsPhaseBoundary(updateState))
+    {
+        return true;
+    }
+
+    ADUC_PersistedWorkflowRecord record;
+    memset(&record, 0x00, sizeof(record));
+    if (handle == NULL || !FillDeploymentIdentity(handle, &record.State))
+    {
+        return false;
+    }
+    record.Magic = ADUC_WORKFLOW_STATE_MAGIC;
+    record.State.WorkflowStep = (uint8_t)workflow_get_current_workflowstep(workflow_get_root(handle));
+    record.State.State = (uint8_t)updateState;
+
+    s_persistence_mutex.lock();
+
+    Load_Locked();
+
+    // Download progress belongs to the same deployment only.
+    bool stored = true;
+    if (IsSameDeployment_Locked(&record.State))
+    {
+        record.State.DownloadOffset = s_record.State.DownloadOffset;
+        memcpy(record.State.PrefixDigest, s_record.State.PrefixDigest, sizeof(record.State.PrefixDigest));
+        if (memcmp(&record, &s_record, sizeof(record)) == 0)
+        {
+            // Unchanged. Save KVStore write.
+            goto done;
+        }
+    }
+
+    stored = Store_Locked(&record);
+
+done:
+    // Failed deployment is redone from start
+    if (updateState == ADUCITF_State_Failed)
+    {
+        s_startup_phase_valid = false;
+    }
+
+    s_persistence_mutex.unlock();
+    return stored;
+}
+
+bool ADUC_WorkflowPersistence_TakeStartupPhase(
+    ADUC_WorkflowHandle handle, ADUCITF_WorkflowStep* workflowStep, ADUCITF_State* updateState)
+{
+    ADUC_PersistedWorkflowState identity;
+    if (handle == NULL || workflowStep == NULL || updateState == NULL || !FillDeploymentIdentity(handle, &identity))
+    {
+        return false;
+    }
+
+    s_persistence_mutex.lock();
+
+    Load_Locked();
+
+    bool matched = s_startup_phase_valid && strcmp(s_startup_phase.WorkflowId, identity.WorkflowId) == 0
+        && strcmp(s_startup_phase.RetryToken, identity.RetryToken) == 0;
+    if (matched)
+    {
+        *workflowStep = (ADUCITF_WorkflowStep)s_startup_phase.WorkflowStep;
+        *updateState = (ADUCITF_State)s_startup_phase.State;
+        s_startup_phase_valid = false;
+    }
+
+    s_persistence_mutex.unlock();
+    return matched;
+}
+
+/**
+ * @brief Update download progress in RAM copy and KVStore. Must be in lock with record of the same deployment.
+ */
+static bool StoreDownloadOffset_Locked(uint32_t downloadOffset, const uint8_t* prefixDigest)
+{
+    ADUC_PersistedWorkflowRecord record = s_record;
+    record.State.DownloadOffset = downloadOffset;
+    memset(record.State.PrefixDigest, 0x00, sizeof(record.State.PrefixDigest));
+    if (prefixDigest != NULL)
+    {
+        memcpy(record.State.PrefixDigest, prefixDigest, sizeof(record.State.PrefixDigest));
+    }
+
+    if (memcmp(&record, &s_record, sizeof(record)) == 0)
+    {
+        // Unchanged. Save KVStore write.
+        return true;
+    }
+
+    return Store_Locked(&record);
+}
+
+bool ADUC_WorkflowPersistence_SaveDownloadOffset(
+    ADUC_WorkflowHandle handle, uint32_t downloadOffset, const uint8_t* prefixDigest)
+{
+    ADUC_PersistedWorkflowState identity;
+    if (handle == NULL || !FillDeploymentIdentity(handle, &identity))
+    {
+        return false;
+    }
+
+    s_persistence_mutex.lock();
+
+    bool stored = false;
+    if (Load_Locked() && IsSameDeployment_Locked(&identity))
+    {
+        stored = StoreDownloadOffset_Locked(downloadOffset, prefixDigest);
+    }
+
+    s_persistence_mutex.unlock();
+    return stored;
+}
+
+bool ADUC_WorkflowPersistence_SaveDownloadCheckpoint(
+    ADUC_WorkflowHandle handle,
+    uint32_t imageOffset,
+    uint32_t imageSize,
+    uint32_t partialOffset,
+    const uint8_t* prefixDigest)
+{
+    ADUC_PersistedWorkflowState identity;
+    if (handle == NULL || prefixDigest == NULL || partialOffset == 0 || partialOffset >= imageSize
+        || !FillDeploymentIdentity(handle, &identity))
+    {
+        return false;
+    }
+
+    s_persistence_mutex.lock();
+
+    // Persisted progress must be within this image: images before it have settled, and it hasn't settled itself.
+    bool stored = false;
+    if (Load_Locked() && IsSameDeployment_Locked(&identity) && s_record.State.DownloadOffset >= imageOffset
+        && s_record.State.DownloadOffset < imageOffset + imageSize)
+    {
+        stored = StoreDownloadOffset_Locked(imageOffset + partialOffset, prefixDigest);
+    }
+
+    s_persistence_mutex.unlock();
+    return stored;
+}
+
+bool ADUC_WorkflowPersistence_GetDownloadOffset(
+    ADUC_WorkflowHandle handle, uint32_t* downloadOffset, uint8_t* prefixDigest)
+{
+    ADUC_PersistedWorkflowState identity;
+    if (handle == NULL || downloadOffset == NULL || !FillDeploymentIdentity(handle, &identity))
+    {
+        return false;
+    }
+
+    s_persistence_mutex.lock();
+
+    bool matched = Load_Locked() && IsSameDeployment_Locked(&identity);
+    if (matched)
+    {
+        *downloadOffset = s_record.State.DownloadOffset;
+        if (prefixDigest != NULL)
+        {
+            memcpy(prefixDigest, s_record.State.PrefixDigest, ADUC_PERSISTED_PREFIX_DIGEST_SIZE);
+        }
+    }
+
+    s_persistence_mutex.unlock();
+    return matched;
+}
+
+bool ADUC_WorkflowPersistence_IsSameDeployment(ADUC_WorkflowHandle handle)
+{
+    ADUC_PersistedWorkflowState identity;
+    if (handle == NULL || !FillDeploymentIdentity(handle, &identity))
+    {
+        return false;
+    }
+
+    s_persistence_mutex.lock();
+
+    bool matched = Load_Locked() && IsSameDeployment_Locked(&identity);
+
+    s_persistence_mutex.unlock();
+    return matched;
+}
+
+bool ADUC_WorkflowPersistence_Clear(void)
+{
+    s_persistence_mutex.lock();
+
+    bool cleared = true;
+    Load_Locked();
+    if (s_record_valid)
+    {
+        int kv_status = ADUC_OtaKV_Remove(ADUC_WORKFLOW_STATE_KEY);
+        if (kv_status != MBED_SUCCESS && kv_status != MBED_ERROR_ITEM_NOT_FOUND)
+        {
+            Log_Error("ADUC_OtaKV_Remove(workflow state) failed: %d", kv_status);
+            cleared = false;
+        }
+        else
+        {
+            memset(&s_record, 0x00, sizeof(s_record));
+            s_record_valid = false;
+            s_startup_phase_valid = false;
+        }
+    }
+
+    s_persistence_mutex.unlock();
+    return cleared;
+}
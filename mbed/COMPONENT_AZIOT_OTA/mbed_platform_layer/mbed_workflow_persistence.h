@@ -0,0 +1,145 @@
+/**
+ * @file mbed_workflow_persistence.h
+ * @brief Persists essential ADU workflow state in KVStore to resume deployment across unexpected reset.
+ *
+ * Upstream agent keeps workflow state in files (workflow_read_state_from_file, sandbox work folder), which
+ * is unavailable on Mbed OS. Here, a compact binary record of the current deployment is written to KVStore
+ * at phase boundaries, so that after reset (watchdog, brownout, ...) the agent can recognize the same
+ * deployment on twin arrival and skip work already done.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef MBED_WORKFLOW_PERSISTENCE_H
+#define MBED_WORKFLOW_PERSISTENCE_H
+
+#include "aduc/c_utils.h"
+#include "aduc/types/adu_core.h" // ADUCITF_State, ADUCITF_WorkflowStep
+#include "aduc/types/workflow.h" // ADUC_WorkflowHandle
+#include <stdbool.h>
+#include <stdint.h>
+
+EXTERN_C_BEGIN
+
+/* Maximum characters of workflow id/retry token, excluding tailing null character */
+#define ADUC_PERSISTED_WORKFLOW_ID_MAXCHAR          63
+#define ADUC_PERSISTED_RETRY_TOKEN_MAXCHAR          47
+
+/* Size of digest of partly downloaded image, SHA-256 */
+#define ADUC_PERSISTED_PREFIX_DIGEST_SIZE           32
+
+/**
+ * @brief In-storage record of the current deployment.
+ */
+typedef struct tagADUC_PersistedWorkflowState
+{
+    char WorkflowId[ADUC_PERSISTED_WORKFLOW_ID_MAXCHAR + 1];    /**< Root workflow id */
+    char RetryToken[ADUC_PERSISTED_RETRY_TOKEN_MAXCHAR + 1];    /**< Root workflow retryTimestamp, empty if none */
+    uint8_t WorkflowStep;                                       /**< ADUCITF_WorkflowStep at last phase boundary */
+    uint8_t State;                                              /**< ADUCITF_State reported at last phase boundary */
+    uint8_t Reserved[2];                                        /**< Zero, for no implicit padding */
+    uint32_t DownloadOffset;                                    /**< Bytes of payload known to be in storage */
+    uint8_t PrefixDigest[ADUC_PERSISTED_PREFIX_DIGEST_SIZE];    /**< SHA-256 of the part in storage of the image
+                                                                     DownloadOffset falls in, zero on image boundary */
+} ADUC_PersistedWorkflowState;
+
+/**
+ * @brief Load persisted record from KVStore into RAM. Safe to call more than once.
+ *
+ * Called at agent startup before the twin arrives. Step and state are restored from the record
+ * through ADUC_WorkflowPersistence_TakeStartupPhase() once the twin identifies the same deployment.
+ *
+ * @return true if there is a persisted deployment record.
+ */
+bool ADUC_WorkflowPersistence_Load(void);
+
+/**
+ * @brief Record a phase boundary of the workflow in KVStore.
+ *
+ * Phase boundaries are the states a workflow step ends in: DeploymentInProgress, DownloadSucceeded,
+ * BackupSucceeded, InstallSucceeded and Failed. Other states are in the middle of a step, which is
+ * redone from start after reset anyway, and aren't written.
+ *
+ * Download offset is kept only if the record belongs to the same deployment (workflow id and retry token).
+ *
+ * @param handle The workflow handle. Root workflow is used.
+ * @param updateState The state just reported.
+ * @return true if recorded, or nothing to record.
+ */
+bool ADUC_WorkflowPersistence_SavePhase(ADUC_WorkflowHandle handle, ADUCITF_State updateState);
+
+/**
+ * @brief Take the last phase boundary recorded before startup, if it belongs to the deployment of @p handle.
+ *
+ * For resuming an interrupted deployment after the last step it completed. Given out once, and
+ * withdrawn when the deployment fails or the record is cleared in the meantime.
+ *
+ * @param handle The workflow handle. Root workflow is used.
+ * @param[out] workflowStep Workflow step which ended at the boundary.
+ * @param[out] updateState State it ended in.
+ * @return true if there is such a phase boundary.
+ */
+bool ADUC_WorkflowPersistence_TakeStartupPhase(
+    ADUC_WorkflowHandle handle, ADUCITF_WorkflowStep* workflowStep, ADUCITF_State* updateState);
+
+/**
+ * @brief Record download progress of the deployment in KVStore.
+ *
+ * @param handle The workflow handle. Root workflow is used.
+ * @param downloadOffset Bytes of payload which have settled in storage.
+ * @param prefixDigest SHA-256 of the settled part of the image @p downloadOffset falls in,
+ *                     or NULL if @p downloadOffset is on an image boundary.
+ * @return true on success.
+ */
+bool ADUC_WorkflowPersistence_SaveDownloadOffset(
+    ADUC_WorkflowHandle handle, uint32_t downloadOffset, const uint8_t* prefixDigest);
+
+/**
+ * @brief Record download progress within one image, if all images before it have settled.
+ *
+ * Images may download concurrently, while persisted progress counts payload in image order. The
+ * checkpoint is taken only if persisted progress has reached the image, and not gone past it.
+ *
+ * @param handle The workflow handle. Root workflow is used.
+ * @param imageOffset Bytes of payload of images before this one.
+ * @param imageSize Bytes of payload of this image.
+ * @param partialOffset Bytes of this image which have settled in storage.
+ * @param prefixDigest SHA-256 of these bytes.
+ * @return true if recorded.
+ */
+bool ADUC_WorkflowPersistence_SaveDownloadCheckpoint(
+    ADUC_WorkflowHandle handle,
+    uint32_t imageOffset,
+    uint32_t imageSize,
+    uint32_t partialOffset,
+    const uint8_t* prefixDigest);
+
+/**
+ * @brief Get persisted download progress if it belongs to the deployment of @p handle.
+ *
+ * @param handle The workflow handle. Root workflow is used.
+ * @param[out] downloadOffset Bytes of payload which have settled in storage.
+ * @param[out] prefixDigest Optional, ADUC_PERSISTED_PREFIX_DIGEST_SIZE bytes. See ADUC_PersistedWorkflowState.
+ * @return true if the record matches the deployment.
+ */
+bool ADUC_WorkflowPersistence_GetDownloadOffset(
+    ADUC_WorkflowHandle handle, uint32_t* downloadOffset, uint8_t* prefixDigest);
+
+/**
+ * @brief Check whether the persisted record belongs to the deployment of @p handle.
+ *
+ * @param handle The workflow handle. Root workflow is used.
+ * @return true if workflow id and retry token both match.
+ */
+bool ADUC_WorkflowPersistence_IsSameDeployment(ADUC_WorkflowHandle handle);
+
+/**
+ * @brief Remove persisted record, e.g. on workflow completion.
+ *
+ * @return true on success.
+ */
+bool ADUC_WorkflowPersistence_Clear(void);
+
+EXTERN_C_END
+
+#endif // MBED_WORKFLOW_PERSISTENCE_H
@@ -0,0 +1,195 @@
+/**
+ * @file mbed_workflow_transition.cpp
+ * @brief Implements table-driven ADU workflow state machine.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#include "mbed_workflow_transition.h"
+
+/* Row of step transition table, by workflow step */
+typedef enum
+{
+    WorkflowStepIndex_ProcessDeployment,
+    WorkflowStepIndex_Download,
+    WorkflowStepIndex_Backup,
+    WorkflowStepIndex_Install,
+    WorkflowStepIndex_Apply,
+    WorkflowStepIndex_Restore,
+    WorkflowStepIndex_Count,
+    WorkflowStepIndex_Invalid = WorkflowStepIndex_Count
+} WorkflowStepIndex;
+
+typedef struct
+{
+    ADUCITF_WorkflowStep WorkflowStep;
+    ADUCITF_State NextStateOnSuccess;
+    ADUCITF_WorkflowStep NextStepOnSuccess; /**< Undefined ends the workflow */
+    ADUCITF_State NextStateOnFailure;
+    ADUCITF_WorkflowStep NextStepOnFailure; /**< Undefined ends the workflow */
+} WorkflowStepTransition;
+
+// clang-format off
+/* Step transitions of upstream workflowHandlerMap */
+static constexpr WorkflowStepTransition s_stepTransitions[WorkflowStepIndex_Count] = {
+    /* step                                   on success: state                    step                                on failure: state       step */
+    { ADUCITF_WorkflowStep_ProcessDeployment, ADUCITF_State_DeploymentInProgress,  ADUCITF_WorkflowStep_Download,     ADUCITF_State_Failed,   ADUCITF_WorkflowStep_Undefined },
+    { ADUCITF_WorkflowStep_Download,          ADUCITF_State_DownloadSucceeded,     ADUCITF_WorkflowStep_Backup,       ADUCITF_State_Failed,   ADUCITF_WorkflowStep_Undefined },
+    // Backup failure ends the workflow. Content handler returns ADUC_Result_Backup_Success to go on regardless.
+    { ADUCITF_WorkflowStep_Backup,            ADUCITF_State_BackupSucceeded,       ADUCITF_WorkflowStep_Install,      ADUCITF_State_Failed,   ADUCITF_WorkflowStep_Undefined },
+    { ADUCITF_WorkflowStep_Install,           ADUCITF_State_InstallSucceeded,      ADUCITF_WorkflowStep_Apply,        ADUCITF_State_Failed,   ADUCITF_WorkflowStep_Restore },
+    // There's no "ApplySucceeded" state. On success, return to Idle.
+    { ADUCITF_WorkflowStep_Apply,             ADUCITF_State_Idle,                  ADUCITF_WorkflowStep_Undefined,    ADUCITF_State_Failed,   ADUCITF_WorkflowStep_Restore },
+    { ADUCITF_WorkflowStep_Restore,           ADUCITF_State_Idle,                  ADUCITF_WorkflowStep_Undefined,    ADUCITF_State_Failed,   ADUCITF_WorkflowStep_Undefined },
+};
+// clang-format on
+
+static_assert(s_stepTransitions[WorkflowStepIndex_ProcessDeployment].WorkflowStep == ADUCITF_WorkflowStep_ProcessDeployment, "s_stepTransitions order mismatch");
+static_assert(s_stepTransitions[WorkflowStepIndex_Download].WorkflowStep == ADUCITF_WorkflowStep_Download, "s_stepTransitions order mismatch");
+static_assert(s_stepTransitions[WorkflowStepIndex_Backup].WorkflowStep == ADUCITF_WorkflowStep_Backup, "s_stepTransitions order mismatch");
+static_assert(s_stepTransitions[WorkflowStepIndex_Install].WorkflowStep == ADUCITF_WorkflowStep_Install, "s_stepTransitions order mismatch");
+static_assert(s_stepTransitions[WorkflowStepIndex_Apply].WorkflowStep == ADUCITF_WorkflowStep_Apply, "s_stepTransitions order mismatch");
+static_assert(s_stepTransitions[WorkflowStepIndex_Restore].WorkflowStep == ADUCITF_WorkflowStep_Restore, "s_stepTransitions order mismatch");
+
+/* Update action, as far as update decisions go */
+typedef enum
+{
+    ActionClass_Cancel,
+    ActionClass_ProcessDeployment,
+    ActionClass_Other,
+    ActionClass_Count
+} ActionClass;
+
+/* Cancellation type, as far as update decisions go */
+typedef enum
+{
+    CancelClass_None,           /**< None, or ComponentChanged: only meaningful on step completion */
+    CancelClass_Normal,
+    CancelClass_ReplaceOrRetry,
+    CancelClass_Count
+} CancelClass;
+
+// clang-format off
+/* Update decisions of upstream ADUC_Workflow_HandleUpdateAction, by [action][cancellation][operation in progress] */
+static constexpr ADUC_WorkflowUpdateDecision s_updateDecisions[ActionClass_Count][CancelClass_Count][2] = {
+    /* Cancel */
+    {
+        /* None */              { ADUC_WorkflowUpdateDecision_ReturnToIdle,    ADUC_WorkflowUpdateDecision_CancelOperation },
+        /* Normal */            { ADUC_WorkflowUpdateDecision_ReturnToIdle,    ADUC_WorkflowUpdateDecision_CancelOperation },
+        /* Replace or retry */  { ADUC_WorkflowUpdateDecision_ReturnToIdle,    ADUC_WorkflowUpdateDecision_CancelOperation },
+    },
+    /* ProcessDeployment */
+    {
+        /* None */              { ADUC_WorkflowUpdateDecision_Process,         ADUC_WorkflowUpdateDecision_Process },
+        /* Normal */            { ADUC_WorkflowUpdateDecision_ReturnToIdle,    ADUC_WorkflowUpdateDecision_CancelOperation },
+        /* Replace or retry */  { ADUC_WorkflowUpdateDecision_ClearAndProcess, ADUC_WorkflowUpdateDecision_CancelOperation },
+    },
+    /* Other */
+    {
+        /* None */              { ADUC_WorkflowUpdateDecision_Process,         ADUC_WorkflowUpdateDecision_Process },
+        /* Normal */            { ADUC_WorkflowUpdateDecision_ReturnToIdle,    ADUC_WorkflowUpdateDecision_CancelOperation },
+        /* Replace or retry */  { ADUC_WorkflowUpdateDecision_Process,         ADUC_WorkflowUpdateDecision_Process },
+    },
+};
+// clang-format on
+
+static WorkflowStepIndex GetWorkflowStepIndex(ADUCITF_WorkflowStep workflowStep)
+{
+    switch (workflowStep)
+    {
+    case ADUCITF_WorkflowStep_ProcessDeployment:
+        return WorkflowStepIndex_ProcessDeployment;
+    case ADUCITF_WorkflowStep_Download:
+        return WorkflowStepIndex_Download;
+    case ADUCITF_WorkflowStep_Backup:
+        return WorkflowStepIndex_Backup;
+    case ADUCITF_WorkflowStep_Install:
+        return WorkflowStepIndex_Install;
+    case ADUCITF_WorkflowStep_Apply:
+        return WorkflowStepIndex_Apply;
+    case ADUCITF_WorkflowStep_Restore:
+        return WorkflowStepIndex_Restore;
+    default:
+        return WorkflowStepIndex_Invalid;
+    }
+}
+
+static ActionClass GetActionClass(ADUCITF_UpdateAction action)
+{
+    switch (action)
+    {
+    case ADUCITF_UpdateAction_Cancel:
+        return ActionClass_Cancel;
+    case ADUCITF_UpdateAction_ProcessDeployment:
+        return ActionClass_ProcessDeployment;
+    default:
+        return ActionClass_Other;
+    }
+}
+
+static CancelClass GetCancelClass(ADUC_WorkflowCancellationType cancellationType)
+{
+    switch (cancellationType)
+    {
+    case ADUC_WorkflowCancellationType_Normal:
+        return CancelClass_Normal;
+    case ADUC_WorkflowCancellationType_Replacement:
+    case ADUC_WorkflowCancellationType_Retry:
+        return CancelClass_ReplaceOrRetry;
+    default:
+        return CancelClass_None;
+    }
+}
+
+ADUC_WorkflowUpdateDecision ADUC_WorkflowTransition_OnUpdateAction(const ADUC_WorkflowTransitionFields* fields)
+{
+    return s_updateDecisions[GetActionClass(fields->Action)][GetCancelClass(fields->CancellationType)]
+                            [fields->OperationInProgress ? 1 : 0];
+}
+
+ADUC_WorkflowCompletion ADUC_WorkflowTransition_GetNext(ADUCITF_WorkflowStep workflowStep, bool succeeded)
+{
+    ADUC_WorkflowCompletion completion = { ADUC_WorkflowCompletion_Invalid, ADUCITF_State_None, ADUCITF_WorkflowStep_Undefined };
+
+    WorkflowStepIndex index = GetWorkflowStepIndex(workflowStep);
+    if (index == WorkflowStepIndex_Invalid)
+    {
+        return completion;
+    }
+
+    const WorkflowStepTransition* transition = &s_stepTransitions[index];
+    completion.Kind = ADUC_WorkflowCompletion_NextStep;
+    completion.NextState = succeeded ? transition->NextStateOnSuccess : transition->NextStateOnFailure;
+    completion.NextStep = succeeded ? transition->NextStepOnSuccess : transition->NextStepOnFailure;
+    return completion;
+}
+
+ADUC_WorkflowCompletion ADUC_WorkflowTransition_OnComplete(const ADUC_WorkflowTransitionFields* fields, bool succeeded)
+{
+    ADUC_WorkflowCompletion completion = ADUC_WorkflowTransition_GetNext(fields->WorkflowStep, succeeded);
+
+    // Operation cancelled, both are failure results. Success goes on regardless.
+    if (completion.Kind != ADUC_WorkflowCompletion_NextStep || succeeded || !fields->OperationCancelRequested)
+    {
+        return completion;
+    }
+
+    completion.NextState = ADUCITF_State_None;
+    completion.NextStep = ADUCITF_WorkflowStep_Undefined;
+    switch (fields->CancellationType)
+    {
+    case ADUC_WorkflowCancellationType_Replacement:
+    case ADUC_WorkflowCancellationType_Retry:
+    case ADUC_WorkflowCancellationType_ComponentChanged:
+        completion.Kind = ADUC_WorkflowCompletion_Restart;
+        break;
+    case ADUC_WorkflowCancellationType_Normal:
+        completion.Kind = ADUC_WorkflowCompletion_Cancelled;
+        completion.NextState = ADUCITF_State_Idle;
+        break;
+    default:
+        completion.Kind = ADUC_WorkflowCompletion_Invalid;
+        break;
+    }
+    return completion;
+}
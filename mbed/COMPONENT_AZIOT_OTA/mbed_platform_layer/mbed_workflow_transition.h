@@ -0,0 +1,94 @@
+/**
+ * @file mbed_workflow_transition.h
+ * @brief Table-driven ADU workflow state machine: what an update action or the completion of a workflow
+ * step leads to.
+ *
+ * Upstream agent decides these in if/else chains across agent_workflow.cpp, reading workflow properties
+ * anew at each test. Here, the hot fields are read once per update action or step completion into
+ * ADUC_WorkflowTransitionFields, and decisions are looked up in constant tables. agent_workflow.cpp
+ * carries them out: method calls, reporting, locking.
+ *
+ * @copyright Copyright (c) Microsoft Corporation.
+ * Licensed under the MIT License.
+ */
+#ifndef MBED_WORKFLOW_TRANSITION_H
+#define MBED_WORKFLOW_TRANSITION_H
+
+#include "aduc/c_utils.h"
+#include "aduc/types/adu_core.h" // ADUCITF_State, ADUCITF_UpdateAction, ADUCITF_WorkflowStep
+#include "aduc/types/workflow.h" // ADUC_WorkflowCancellationType
+#include <stdbool.h>
+
+EXTERN_C_BEGIN
+
+/**
+ * @brief Hot fields of the workflow a decision depends on, in plain members.
+ */
+typedef struct tagADUC_WorkflowTransitionFields
+{
+    ADUCITF_UpdateAction Action;                    /**< Desired update action */
+    ADUCITF_WorkflowStep WorkflowStep;              /**< Current workflow step */
+    ADUC_WorkflowCancellationType CancellationType; /**< Current cancellation type */
+    bool OperationInProgress;                       /**< Operation of the current step in progress */
+    bool OperationCancelRequested;                  /**< Cancel requested of that operation */
+} ADUC_WorkflowTransitionFields;
+
+/**
+ * @brief What to do on an update action.
+ */
+typedef enum tagADUC_WorkflowUpdateDecision
+{
+    ADUC_WorkflowUpdateDecision_Process,         /**< Process the workflow */
+    ADUC_WorkflowUpdateDecision_CancelOperation, /**< Request cancel of the operation in progress. Its completion goes on. */
+    ADUC_WorkflowUpdateDecision_ReturnToIdle,    /**< Cancel with no operation in progress: clear cancellation, stay idle */
+    ADUC_WorkflowUpdateDecision_ClearAndProcess, /**< Replacement/retry with no operation in progress: clear cancellation,
+                                                      then process the workflow */
+} ADUC_WorkflowUpdateDecision;
+
+/**
+ * @brief What completion of a workflow step leads to.
+ */
+typedef enum tagADUC_WorkflowCompletionKind
+{
+    ADUC_WorkflowCompletion_Invalid,   /**< Workflow step, or cancellation type of cancelled operation, not valid */
+    ADUC_WorkflowCompletion_NextStep,  /**< Go to NextState, then auto-transition to NextStep unless workflow is complete */
+    ADUC_WorkflowCompletion_Restart,   /**< Cancelled for replacement, retry or component change: process deployment again */
+    ADUC_WorkflowCompletion_Cancelled, /**< Cancelled by Cancel action: go to Idle with cancelled result */
+} ADUC_WorkflowCompletionKind;
+
+typedef struct tagADUC_WorkflowCompletion
+{
+    ADUC_WorkflowCompletionKind Kind;
+    ADUCITF_State NextState;       /**< For ADUC_WorkflowCompletion_NextStep */
+    ADUCITF_WorkflowStep NextStep; /**< For ADUC_WorkflowCompletion_NextStep. Undefined when workflow is complete. */
+} ADUC_WorkflowCompletion;
+
+/**
+ * @brief Decide what to do on the update action in @p fields.
+ *
+ * @param fields Hot fields of the workflow, with the update action just received.
+ * @return The decision.
+ */
+ADUC_WorkflowUpdateDecision ADUC_WorkflowTransition_OnUpdateAction(const ADUC_WorkflowTransitionFields* fields);
+
+/**
+ * @brief Get the state and workflow step after @p workflowStep ends.
+ *
+ * @param workflowStep The workflow step which ended.
+ * @param succeeded Whether it succeeded.
+ * @return ADUC_WorkflowCompletion_NextStep, or ADUC_WorkflowCompletion_Invalid for unknown @p workflowStep.
+ */
+ADUC_WorkflowCompletion ADUC_WorkflowTransition_GetNext(ADUCITF_WorkflowStep workflowStep, bool succeeded);
+
+/**
+ * @brief Decide what completion of the operation of the current workflow step leads to.
+ *
+ * @param fields Hot fields of the workflow, read after the operation completed.
+ * @param succeeded Whether the operation succeeded.
+ * @return The completion.
+ */
+ADUC_WorkflowCompletion ADUC_WorkflowTransition_OnComplete(const ADUC_WorkflowTransitionFields* fields, bool succeeded);
+
+EXTERN_C_END
+
+#endif // MBED_WORKFLOW_TRANSITION_H
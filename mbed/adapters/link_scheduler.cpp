@@ -0,0 +1,127 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "mbed.h"
+#include "rtos/Kernel.h"
+#include "rtos/Mutex.h"
+#include "rtos/ThisThread.h"
+
+#include <stdint.h>
+#include "link_scheduler.h"
+
+using namespace std::chrono;
+
+/* Link capacity shared by all classes, in bytes/s. 0 for unlimited. */
+#define LINK_RATE       MBED_CONF_AZURE_CLIENT_LINK_SCHEDULER_LINK_RATE
+/* Cap of bulk class, in bytes/s. 0 for no cap. */
+#define BULK_RATE       MBED_CONF_AZURE_CLIENT_LINK_SCHEDULER_BULK_RATE
+/* Bucket depth, in bytes */
+#define BURST           MBED_CONF_AZURE_CLIENT_LINK_SCHEDULER_BURST
+/* Link tokens bulk class must leave for control class, in bytes. Bounded by bucket depth. */
+#define CONTROL_RESERVE ((MBED_CONF_AZURE_CLIENT_LINK_SCHEDULER_CONTROL_RESERVE < BURST) ? \
+                         MBED_CONF_AZURE_CLIENT_LINK_SCHEDULER_CONTROL_RESERVE : BURST)
+
+/* Upper bound of one sleep so that bulk class reacts to link changes, e.g. socket abort */
+#define MAX_WAIT_MS     100
+
+static rtos::Mutex link_mutex;
+/* Token balances, in bytes. Negative balance is debt to pay back before bulk class can go on. */
+static int64_t link_tokens = BURST;
+static int64_t bulk_tokens = BURST;
+static uint64_t last_refill_ms = 0;
+static bool refill_started = false;
+
+static uint64_t now_ms(void)
+{
+    return duration_cast<milliseconds>(rtos::Kernel::Clock::now().time_since_epoch()).count();
+}
+
+static int64_t refill_one(int64_t tokens, uint64_t rate, uint64_t elapsed_ms)
+{
+    tokens += (int64_t) (rate * elapsed_ms / 1000);
+    return (tokens > BURST) ? BURST : tokens;
+}
+
+/* Must be in lock */
+static void refill(void)
+{
+    uint64_t now = now_ms();
+
+    if (!refill_started) {
+        refill_started = true;
+        last_refill_ms = now;
+        return;
+    }
+
+    uint64_t elapsed_ms = now - last_refill_ms;
+    if (elapsed_ms == 0) {
+        return;
+    }
+    last_refill_ms = now;
+
+    if (LINK_RATE) {
+        link_tokens = refill_one(link_tokens, LINK_RATE, elapsed_ms);
+    }
+    if (BULK_RATE) {
+        bulk_tokens = refill_one(bulk_tokens, BULK_RATE, elapsed_ms);
+    }
+}
+
+/* Milliseconds until bulk class can go on. Must be in lock. */
+static uint64_t bulk_wait_ms(void)
+{
+    uint64_t wait_ms = 0;
+
+    /* Preprocessor guards, not 'if': division by rate of 0 mustn't even be compiled */
+#if LINK_RATE
+    if (link_tokens < CONTROL_RESERVE) {
+        uint64_t ms = (uint64_t) (CONTROL_RESERVE - link_tokens) * 1000 / LINK_RATE + 1;
+        wait_ms = (ms > wait_ms) ? ms : wait_ms;
+    }
+#endif
+#if BULK_RATE
+    if (bulk_tokens < 0) {
+        uint64_t ms = (uint64_t) (-bulk_tokens) * 1000 / BULK_RATE + 1;
+        wait_ms = (ms > wait_ms) ? ms : wait_ms;
+    }
+#endif
+
+    return wait_ms;
+}
+
+int link_scheduler_is_enabled(void)
+{
+    return (LINK_RATE || BULK_RATE) ? 1 : 0;
+}
+
+void link_scheduler_consume(LINK_SCHEDULER_CLASS cls, size_t bytes)
+{
+    if (!link_scheduler_is_enabled() || bytes == 0) {
+        return;
+    }
+
+    link_mutex.lock();
+
+    refill();
+    if (LINK_RATE) {
+        link_tokens -= bytes;
+    }
+    if (cls != LINK_SCHEDULER_CLASS_BULK) {
+        link_mutex.unlock();
+        return;
+    }
+    if (BULK_RATE) {
+        bulk_tokens -= bytes;
+    }
+
+    /* Pay back debt. Don't hold the lock while sleeping: control class must go on. */
+    uint64_t wait_ms;
+    while ((wait_ms = bulk_wait_ms()) != 0) {
+        link_mutex.unlock();
+        rtos::ThisThread::sleep_for(milliseconds((wait_ms > MAX_WAIT_MS) ? MAX_WAIT_MS : wait_ms));
+        link_mutex.lock();
+        refill();
+    }
+
+    link_mutex.unlock();
+}
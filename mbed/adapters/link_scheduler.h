@@ -0,0 +1,50 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef LINK_SCHEDULER_H
+#define LINK_SCHEDULER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Token-bucket scheduler sharing one narrowband link between traffic classes
+ *
+ * Control traffic (MQTT: telemetry, twin, C2D) is never delayed, but consumes
+ * link tokens. Bulk traffic (OTA download) waits until link tokens recover above
+ * a reserve kept for control traffic, and optionally until its own bucket allows.
+ *
+ * Modes by configuration (azure-client.link-scheduler-*):
+ * - link-rate = 0, bulk-rate = 0:  Disabled
+ * - bulk-rate > 0:                 Bulk capped to bulk-rate
+ * - link-rate > 0:                 Bulk fills capacity left idle by control traffic
+ * Both can be combined.
+ *
+ * Throttling is applied on the receiving side: bulk data not drained from the
+ * socket closes the TCP receive window, which in turn slows the sender.
+ */
+
+typedef enum LINK_SCHEDULER_CLASS_TAG
+{
+    LINK_SCHEDULER_CLASS_CONTROL = 0,
+    LINK_SCHEDULER_CLASS_BULK,
+    LINK_SCHEDULER_CLASS_MAX
+} LINK_SCHEDULER_CLASS;
+
+/* Account bytes transferred on the link for the class
+ *
+ * For LINK_SCHEDULER_CLASS_CONTROL, returns immediately.
+ * For LINK_SCHEDULER_CLASS_BULK, blocks the calling thread until its budget recovers.
+ */
+void link_scheduler_consume(LINK_SCHEDULER_CLASS cls, size_t bytes);
+
+/* Whether any limit is configured */
+int link_scheduler_is_enabled(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LINK_SCHEDULER_H */
@@ -14,6 +14,8 @@
 
 #include "mbed.h"
 #include "netsocket/nsapi_types.h"
+#include "trace_ring.h"
+#include "tls_record_tap.h"
 
 #define MBED_XIO_RECEIVE_BUFFER_SIZE    128
 
@@ -46,8 +48,41 @@ typedef struct SOCKET_IO_INSTANCE_TAG
     int port;
     IO_STATE io_state;
     SINGLYLINKEDLIST_HANDLE pending_io_list;
+#if MBED_CONF_AZURE_CLIENT_TRACE_RING_SIZE
+    TLS_RECORD_TAP tls_record_tap;
+#endif
 } SOCKET_IO_INSTANCE;
 
+/* Trace TLS handshake and MQTT CONNECT/CONNACK, which tlsio_mbedtls and umqtt
+ * run over this socket, from TLS record framing of the bytes on the wire */
+static void trace_tls_records(SOCKET_IO_INSTANCE* socket_io_instance, TLS_RECORD_TAP_DIRECTION direction, const unsigned char* bytes, size_t size)
+{
+#if MBED_CONF_AZURE_CLIENT_TRACE_RING_SIZE
+    unsigned events = tls_record_tap_feed(&socket_io_instance->tls_record_tap, direction, bytes, size);
+    if (events & TLS_RECORD_TAP_HANDSHAKE_BEGIN)
+    {
+        TRACE_RING_BEGIN("tls_handshake");
+    }
+    if (events & TLS_RECORD_TAP_HANDSHAKE_END)
+    {
+        TRACE_RING_END("tls_handshake");
+    }
+    if (events & TLS_RECORD_TAP_FIRST_DATA_SENT)
+    {
+        TRACE_RING_BEGIN("mqtt_connack");
+    }
+    if (events & TLS_RECORD_TAP_FIRST_DATA_RECEIVED)
+    {
+        TRACE_RING_END("mqtt_connack");
+    }
+#else
+    (void)socket_io_instance;
+    (void)direction;
+    (void)bytes;
+    (void)size;
+#endif
+}
+
 /*this function will clone an option given by name and value*/
 static void* socketio_CloneOption(const char* name, const void* value)
 {
@@ -164,6 +199,7 @@ static int retrieve_data(SOCKET_IO_INSTANCE* socket_io_instance)
         if (received > 0)
         {
             total_received += received;
+            trace_tls_records(socket_io_instance, TLS_RECORD_TAP_RECEIVED, recv_bytes, received);
             if (socket_io_instance->on_bytes_received != NULL)
             {
                 /* explictly ignoring here the result of the callback */
@@ -206,6 +242,10 @@ static int send_queued_data(SOCKET_IO_INSTANCE* socket_io_instance)
         }
 
         int send_result = tcpsocketconnection_send(socket_io_instance->tcp_socket_connection, (const char*)pending_socket_io->bytes, pending_socket_io->size);
+        if (send_result > 0)
+        {
+            trace_tls_records(socket_io_instance, TLS_RECORD_TAP_SENT, pending_socket_io->bytes, send_result);
+        }
         if (send_result != (int)pending_socket_io->size)
         {
             if (send_result == 0)
@@ -393,6 +433,9 @@ int socketio_open(CONCRETE_IO_HANDLE socket_io, ON_IO_OPEN_COMPLETE on_io_open_c
                 socket_io_instance->on_io_error_context = on_io_error_context;
 
                 socket_io_instance->io_state = IO_STATE_OPEN;
+#if MBED_CONF_AZURE_CLIENT_TRACE_RING_SIZE
+                tls_record_tap_reset(&socket_io_instance->tls_record_tap);
+#endif
 
                 result = 0;
             }
@@ -7,24 +7,32 @@
 #include <stddef.h>
 #include "TCPSocket.h"
 #include "azure_c_shared_utility/tcpsocketconnection_c.h"
+#include "link_scheduler.h"
+#include "trace_ring.h"
 
 // The NetworkInterface instance of network device
 extern NetworkInterface *_defaultSystemNetwork;
 
-static volatile bool tcpsocketconnection_isConnected = false;
+// Connection state is kept per handle, so that connections don't see each other's state
+typedef struct TCPSOCKETCONNECTION_INSTANCE_TAG
+{
+	TCPSocket socket;
+	volatile bool isConnected;
+} TCPSOCKETCONNECTION_INSTANCE;
 
 TCPSOCKETCONNECTION_HANDLE tcpsocketconnection_create(void)
 {
-	TCPSocket* tcpSocket = new TCPSocket();
-	tcpSocket->open(_defaultSystemNetwork);
-    return tcpSocket;
+	TCPSOCKETCONNECTION_INSTANCE* tcpSocketConnection = new TCPSOCKETCONNECTION_INSTANCE();
+	tcpSocketConnection->isConnected = false;
+	tcpSocketConnection->socket.open(_defaultSystemNetwork);
+    return tcpSocketConnection;
 }
 
 void tcpsocketconnection_set_blocking(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionHandle, bool blocking, unsigned int timeout)
 {
 	if (tcpSocketConnectionHandle != NULL)
 	{
-		TCPSocket* tsc = (TCPSocket*)tcpSocketConnectionHandle;
+		TCPSocket* tsc = &((TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle)->socket;
 		tsc->set_blocking(blocking);
 		tsc->set_timeout(timeout);
 	}
@@ -34,27 +42,33 @@ void tcpsocketconnection_destroy(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionH
 {
 	if (tcpSocketConnectionHandle != NULL)
 	{
-		delete (TCPSocket*)tcpSocketConnectionHandle;
+		delete (TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle;
 	}
 }
 
 int tcpsocketconnection_connect(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionHandle, const char* host, const int port)
 {
 	int ret = 0;
-	if (tcpSocketConnectionHandle != NULL && !tcpsocketconnection_isConnected)
+	TCPSOCKETCONNECTION_INSTANCE* tcpSocketConnection = (TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle;
+	if (tcpSocketConnection != NULL && !tcpSocketConnection->isConnected)
 	{
-		TCPSocket* tsc = (TCPSocket*)tcpSocketConnectionHandle;
+		TCPSocket* tsc = &tcpSocketConnection->socket;
 		SocketAddress addr;
 
+		TRACE_RING_BEGIN("dns");
 		ret = _defaultSystemNetwork->gethostbyname(host, &addr);
+		TRACE_RING_END("dns");
 		if (ret != 0) {
 			return ret;
 		}
 		addr.set_port(port);
 
-		if ( (ret = tsc->connect(addr)) == 0)
+		TRACE_RING_BEGIN("tcp_connect");
+		ret = tsc->connect(addr);
+		TRACE_RING_END("tcp_connect");
+		if (ret == 0)
 		{
-			tcpsocketconnection_isConnected = true;
+			tcpSocketConnection->isConnected = true;
 		}
 	}
 	return ret;
@@ -62,16 +76,17 @@ int tcpsocketconnection_connect(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionHa
 
 bool tcpsocketconnection_is_connected(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionHandle)
 {
-	return tcpsocketconnection_isConnected;
+	TCPSOCKETCONNECTION_INSTANCE* tcpSocketConnection = (TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle;
+	return tcpSocketConnection != NULL && tcpSocketConnection->isConnected;
 }
 
 void tcpsocketconnection_close(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionHandle)
 {
-	if (tcpSocketConnectionHandle != NULL && tcpsocketconnection_isConnected)
+	TCPSOCKETCONNECTION_INSTANCE* tcpSocketConnection = (TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle;
+	if (tcpSocketConnection != NULL && tcpSocketConnection->isConnected)
 	{
-		TCPSocket* tsc = (TCPSocket*)tcpSocketConnectionHandle;
-		tsc->close();
-		tcpsocketconnection_isConnected = false;
+		tcpSocketConnection->socket.close();
+		tcpSocketConnection->isConnected = false;
 	}
 }
 
@@ -79,8 +94,13 @@ int tcpsocketconnection_send(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionHandl
 {
 	if (tcpSocketConnectionHandle != NULL)
 	{
-		TCPSocket* tsc = (TCPSocket*)tcpSocketConnectionHandle;
-		return tsc->send((char*)data, length);
+		TCPSocket* tsc = &((TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle)->socket;
+		int ret = tsc->send((char*)data, length);
+		if (ret > 0)
+		{
+			link_scheduler_consume(LINK_SCHEDULER_CLASS_CONTROL, ret);
+		}
+		return ret;
 	}
 	
 	return -1;
@@ -90,8 +110,13 @@ int tcpsocketconnection_send_all(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionH
 {
 	if (tcpSocketConnectionHandle != NULL)
 	{
-		TCPSocket* tsc = (TCPSocket*)tcpSocketConnectionHandle;
-		return tsc->send((char*)data, length);
+		TCPSocket* tsc = &((TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle)->socket;
+		int ret = tsc->send((char*)data, length);
+		if (ret > 0)
+		{
+			link_scheduler_consume(LINK_SCHEDULER_CLASS_CONTROL, ret);
+		}
+		return ret;
 	}
 	return -1;
 }
@@ -100,8 +125,13 @@ int tcpsocketconnection_receive(TCPSOCKETCONNECTION_HANDLE tcpSocketConnectionHa
 {
 	if (tcpSocketConnectionHandle != NULL)
 	{
-		TCPSocket* tsc = (TCPSocket*)tcpSocketConnectionHandle;
-		return tsc->recv(data, length);
+		TCPSocket* tsc = &((TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle)->socket;
+		int ret = tsc->recv(data, length);
+		if (ret > 0)
+		{
+			link_scheduler_consume(LINK_SCHEDULER_CLASS_CONTROL, ret);
+		}
+		return ret;
 	}
 	return -1;
 }
@@ -110,8 +140,13 @@ int tcpsocketconnection_receive_all(TCPSOCKETCONNECTION_HANDLE tcpSocketConnecti
 {
 	if (tcpSocketConnectionHandle != NULL)
 	{
-		TCPSocket* tsc = (TCPSocket*)tcpSocketConnectionHandle;
-		return tsc->recv(data, length);
+		TCPSocket* tsc = &((TCPSOCKETCONNECTION_INSTANCE*)tcpSocketConnectionHandle)->socket;
+		int ret = tsc->recv(data, length);
+		if (ret > 0)
+		{
+			link_scheduler_consume(LINK_SCHEDULER_CLASS_CONTROL, ret);
+		}
+		return ret;
 	}
 	return -1;
 }
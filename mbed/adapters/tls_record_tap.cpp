@@ -0,0 +1,97 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include <string.h>
+#include "tls_record_tap.h"
+
+/* Record content types (RFC 5246 6.2.1) */
+#define TLS_CHANGE_CIPHER_SPEC  20
+#define TLS_ALERT               21
+#define TLS_HANDSHAKE           22
+#define TLS_APPLICATION_DATA    23
+
+/* Largest TLSCiphertext.length (RFC 5246 6.2.3) */
+#define TLS_RECORD_MAX_LENGTH   (16384 + 2048)
+
+void tls_record_tap_reset(TLS_RECORD_TAP* tap)
+{
+    memset(tap, 0, sizeof(*tap));
+}
+
+/* Events on header of record complete */
+static unsigned record_begin(TLS_RECORD_TAP_DIRECTION direction, TLS_RECORD_TAP_STREAM* stream)
+{
+    switch (stream->header[0]) {
+        case TLS_HANDSHAKE:
+            return (direction == TLS_RECORD_TAP_SENT) ? TLS_RECORD_TAP_HANDSHAKE_BEGIN : 0;
+
+        case TLS_APPLICATION_DATA:
+            return (direction == TLS_RECORD_TAP_SENT) ? TLS_RECORD_TAP_FIRST_DATA_SENT : 0;
+
+        case TLS_CHANGE_CIPHER_SPEC:
+            stream->change_cipher_spec = 1;
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+/* Events on last byte of record: only then can it be decrypted */
+static unsigned record_end(TLS_RECORD_TAP_DIRECTION direction, const TLS_RECORD_TAP_STREAM* stream)
+{
+    if (direction != TLS_RECORD_TAP_RECEIVED) {
+        return 0;
+    }
+
+    switch (stream->header[0]) {
+        case TLS_HANDSHAKE:
+            return stream->change_cipher_spec ? TLS_RECORD_TAP_HANDSHAKE_END : 0;
+
+        case TLS_APPLICATION_DATA:
+            return TLS_RECORD_TAP_FIRST_DATA_RECEIVED;
+
+        default:
+            return 0;
+    }
+}
+
+unsigned tls_record_tap_feed(TLS_RECORD_TAP* tap, TLS_RECORD_TAP_DIRECTION direction, const unsigned char* bytes, size_t size)
+{
+    TLS_RECORD_TAP_STREAM* stream = &tap->streams[direction];
+    unsigned events = 0;
+
+    while (size > 0 && !tap->stopped) {
+        if (stream->header_size < sizeof(stream->header)) {
+            stream->header[stream->header_size ++] = *bytes ++;
+            size --;
+            if (stream->header_size < sizeof(stream->header)) {
+                continue;
+            }
+
+            uint16_t length = (uint16_t) ((stream->header[3] << 8) | stream->header[4]);
+            if (stream->header[0] < TLS_CHANGE_CIPHER_SPEC || stream->header[0] > TLS_APPLICATION_DATA ||
+                stream->header[1] != 3 || length > TLS_RECORD_MAX_LENGTH) {
+                tap->stopped = 1;
+                break;
+            }
+            stream->body_left = length;
+            events |= record_begin(direction, stream);
+        } else {
+            size_t body = (size < stream->body_left) ? size : stream->body_left;
+            stream->body_left -= (uint16_t) body;
+            bytes += body;
+            size -= body;
+        }
+
+        if (stream->body_left == 0) {
+            events |= record_end(direction, stream);
+            stream->header_size = 0;
+        }
+    }
+
+    /* Each once per connection */
+    events &= ~tap->events;
+    tap->events |= events;
+    return events;
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef TLS_RECORD_TAP_H
+#define TLS_RECORD_TAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Milestones of a TLS connection, from record framing seen at the socket
+ *
+ * tlsio_mbedtls runs the TLS handshake and umqtt the MQTT CONNECT/CONNACK exchange
+ * inside the submodules. Both go through our socketio as TLS records, whose 5-byte
+ * headers are in clear: content type, version, length. Following them across
+ * arbitrary splits of the byte stream gives, once per connection:
+ *
+ * - HANDSHAKE_BEGIN:       first handshake record sent (ClientHello)
+ * - HANDSHAKE_END:         last byte of first handshake record received after server
+ *                          ChangeCipherSpec (server Finished, TLS 1.2)
+ * - FIRST_DATA_SENT:       first application data record sent (MQTT CONNECT)
+ * - FIRST_DATA_RECEIVED:   last byte of first application data record received
+ *                          (MQTT CONNACK)
+ *
+ * Stream not framed as TLS records stops the tap: no more events until reset.
+ */
+
+#define TLS_RECORD_TAP_HANDSHAKE_BEGIN      0x01
+#define TLS_RECORD_TAP_HANDSHAKE_END        0x02
+#define TLS_RECORD_TAP_FIRST_DATA_SENT      0x04
+#define TLS_RECORD_TAP_FIRST_DATA_RECEIVED  0x08
+
+typedef enum TLS_RECORD_TAP_DIRECTION_TAG
+{
+    TLS_RECORD_TAP_SENT = 0,
+    TLS_RECORD_TAP_RECEIVED,
+    TLS_RECORD_TAP_DIRECTION_MAX
+} TLS_RECORD_TAP_DIRECTION;
+
+typedef struct TLS_RECORD_TAP_STREAM_TAG
+{
+    uint8_t header[5];          // Header of current record, header_size bytes of it so far
+    uint8_t header_size;
+    uint16_t body_left;         // Bytes of current record body still to come
+    uint8_t change_cipher_spec; // ChangeCipherSpec record seen
+} TLS_RECORD_TAP_STREAM;
+
+typedef struct TLS_RECORD_TAP_TAG
+{
+    TLS_RECORD_TAP_STREAM streams[TLS_RECORD_TAP_DIRECTION_MAX];
+    uint8_t events;             // TLS_RECORD_TAP_* given out so far
+    uint8_t stopped;            // Not TLS records
+} TLS_RECORD_TAP;
+
+/* Start over, for new connection */
+void tls_record_tap_reset(TLS_RECORD_TAP* tap);
+
+/* Follow bytes sent/received, in stream order. Returns TLS_RECORD_TAP_* reached in them. */
+unsigned tls_record_tap_feed(TLS_RECORD_TAP* tap, TLS_RECORD_TAP_DIRECTION direction, const unsigned char* bytes, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TLS_RECORD_TAP_H */
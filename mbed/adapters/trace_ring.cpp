@@ -0,0 +1,69 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#include "mbed.h"
+#include "platform/mbed_atomic.h"
+#include "hal/us_ticker_api.h"
+#include "cmsis_os2.h"
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "trace_ring.h"
+
+#define TRACE_RING_SIZE     MBED_CONF_AZURE_CLIENT_TRACE_RING_SIZE
+
+#if TRACE_RING_SIZE
+
+typedef struct {
+    uint32_t    timestamp_us;   // Low 32 bits of us ticker. Wrap is undone on conversion.
+    uint32_t    thread;         // RTOS thread ID, 0 in ISR
+    const char *name;
+    char        phase;          // 'B'egin, 'E'nd, 'i'nstant
+} trace_ring_event_t;
+
+static trace_ring_event_t trace_ring[TRACE_RING_SIZE];
+/* Events ever recorded. Slot of next event is this modulo ring size. */
+static uint32_t trace_ring_next = 0;
+
+void trace_ring_record(const char *name, char phase)
+{
+    uint32_t index = core_util_atomic_incr_u32(&trace_ring_next, 1) - 1;
+    trace_ring_event_t *event = &trace_ring[index % TRACE_RING_SIZE];
+
+    event->timestamp_us = (uint32_t) ticker_read_us(get_us_ticker_data());
+    event->thread = core_util_is_isr_active() ? 0 : (uint32_t) (uintptr_t) osThreadGetId();
+    event->name = name;
+    event->phase = phase;
+}
+
+void trace_ring_dump(void)
+{
+    uint32_t next = core_util_atomic_load_u32(&trace_ring_next);
+    uint32_t count = (next < TRACE_RING_SIZE) ? next : TRACE_RING_SIZE;
+
+    /* Events recorded during dump may show up torn. Dump at rest for exact result. */
+    printf("trace_ring: begin %" PRIu32 "/%" PRIu32 " events\r\n", count, next);
+    for (uint32_t index = next - count; index != next; index ++) {
+        const trace_ring_event_t *event = &trace_ring[index % TRACE_RING_SIZE];
+        printf("trace_ring: %" PRIu32 " %c %08" PRIx32 " %s\r\n",
+               event->timestamp_us,
+               event->phase,
+               event->thread,
+               event->name ? event->name : "?");
+    }
+    printf("trace_ring: end\r\n");
+}
+
+#else
+
+void trace_ring_record(const char *, char)
+{
+}
+
+void trace_ring_dump(void)
+{
+    printf("trace_ring: disabled (azure-client.trace-ring-size = 0)\r\n");
+}
+
+#endif /* TRACE_RING_SIZE */
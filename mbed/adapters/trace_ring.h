@@ -0,0 +1,44 @@
+// Copyright (c) 2022 Nuvoton Technology Corporation
+// Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+#ifndef TRACE_RING_H
+#define TRACE_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Event trace into RAM ring buffer, for seeing where time goes on connect and OTA
+ *
+ * Trace points record timestamp (us), thread and name of begin/end/instant events.
+ * Recording is lock-free and ISR-safe: slot claimed by atomic increment, oldest
+ * events overwritten when full.
+ *
+ * Enabled by azure-client.trace-ring-size > 0 (events). Otherwise, trace points
+ * compile to nothing.
+ *
+ * trace_ring_dump() prints the ring to console. tools/trace_ring_to_chrome.py
+ * converts it to Chrome trace_event JSON (chrome://tracing, Perfetto).
+ */
+
+/* Record one event. 'name' must be static, e.g. string literal: only pointer is kept. */
+void trace_ring_record(const char *name, char phase);
+
+/* Print recorded events to console, oldest first */
+void trace_ring_dump(void);
+
+#if MBED_CONF_AZURE_CLIENT_TRACE_RING_SIZE
+#define TRACE_RING_BEGIN(name)      trace_ring_record((name), 'B')
+#define TRACE_RING_END(name)        trace_ring_record((name), 'E')
+#define TRACE_RING_INSTANT(name)    trace_ring_record((name), 'i')
+#else
+#define TRACE_RING_BEGIN(name)      ((void) 0)
+#define TRACE_RING_END(name)        ((void) 0)
+#define TRACE_RING_INSTANT(name)    ((void) 0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TRACE_RING_H */
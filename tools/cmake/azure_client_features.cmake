@@ -0,0 +1,144 @@
+# Copyright (c) 2022 Nuvoton Technology Corporation
+# SPDX-License-Identifier: Apache-2.0
+
+# Feature toggles (azure-client.feature-* in mbed_lib.json5) to trim flash footprint, and the
+# binutils size tool for the size report. Shared by the Mbed CE build and the host build.
+
+# Set OUT_VAR to whether FEATURE is enabled in MBED_CONFIG_DEFINITIONS of the caller.
+# A feature is left out only when explicitly configured false.
+function(azure_client_feature_enabled FEATURE OUT_VAR)
+    string(TOUPPER "${FEATURE}" _feature)
+    string(REPLACE "-" "_" _feature "${_feature}")
+    if("MBED_CONF_AZURE_CLIENT_FEATURE_${_feature}=0" IN_LIST MBED_CONFIG_DEFINITIONS)
+        set(${OUT_VAR} FALSE PARENT_SCOPE)
+    else()
+        set(${OUT_VAR} TRUE PARENT_SCOPE)
+    endif()
+endfunction()
+
+# Set OUT_VAR to the sources that depend on feature toggles, under ROOT_DIR (the repository root)
+function(azure_client_feature_sources OUT_VAR ROOT_DIR)
+    foreach(_feature websockets http-proxy dps convenience-layer module-client test-mocks fast-codecs)
+        string(TOUPPER "${_feature}" _var)
+        string(REPLACE "-" "_" _var "${_var}")
+        azure_client_feature_enabled(${_feature} _${_var})
+    endforeach()
+
+    # URL encoder and UTF-8 checker: copied/c-utility with exact-length two-pass encoder and
+    # word-at-a-time ASCII skip, or unmodified c-utility
+    if(_FAST_CODECS)
+        set(_codecs_dir ${ROOT_DIR}/copied/c-utility)
+    else()
+        set(_codecs_dir ${ROOT_DIR}/dependencies/c-utility/src)
+    endif()
+
+    set(_cutil_dir ${ROOT_DIR}/dependencies/c-utility/src)
+    set(_iothub_dir ${ROOT_DIR}/azure-iot-sdk-c/iothub_client/src)
+    set(_prov_dir ${ROOT_DIR}/azure-iot-sdk-c/provisioning_client)
+    set(_umock_dir ${ROOT_DIR}/dependencies/umock-c/src)
+
+    set(_sources
+        ${_codecs_dir}/urlencode.c
+    )
+
+    if(_WEBSOCKETS)
+        list(APPEND _sources
+            ${_cutil_dir}/ws_url.c
+            ${_cutil_dir}/wsio.c
+            ${_cutil_dir}/uws_frame_encoder.c
+            ${_cutil_dir}/uws_client.c
+            ${_codecs_dir}/utf8_checker.c
+        )
+    endif()
+
+    if(_HTTP_PROXY)
+        list(APPEND _sources
+            ${_cutil_dir}/http_proxy_io.c
+        )
+    endif()
+
+    if(_DPS)
+        list(APPEND _sources
+            ${_prov_dir}/adapters/hsm_client_data.c
+            ${_prov_dir}/src/prov_transport_mqtt_client.c
+            ${_prov_dir}/src/prov_security_factory.c
+            ${_prov_dir}/src/prov_auth_client.c
+            ${_prov_dir}/src/iothub_security_factory.c
+            ${_prov_dir}/src/iothub_auth_client.c
+            ${_prov_dir}/src/prov_transport_mqtt_common.c
+            ${_prov_dir}/src/prov_device_client.c
+            ${_prov_dir}/src/prov_device_ll_client.c
+        )
+
+        # MQTT over WebSockets transport of DPS goes through wsio and http_proxy_io
+        if(_WEBSOCKETS AND _HTTP_PROXY)
+            list(APPEND _sources
+                ${_prov_dir}/src/prov_transport_mqtt_ws_client.c
+            )
+        endif()
+    endif()
+
+    if(_CONVENIENCE_LAYER)
+        list(APPEND _sources
+            ${_iothub_dir}/iothub_client.c
+            ${_iothub_dir}/iothub_client_core.c
+            ${_iothub_dir}/iothub_device_client.c
+            ${_iothub_dir}/iothubtransport.c
+        )
+    endif()
+
+    if(_MODULE_CLIENT)
+        list(APPEND _sources
+            ${_iothub_dir}/iothub_module_client_ll.c
+            ${_iothub_dir}/iothub_client_edge.c
+        )
+        if(_CONVENIENCE_LAYER)
+            list(APPEND _sources
+                ${_iothub_dir}/iothub_module_client.c
+            )
+        endif()
+    endif()
+
+    if(_TEST_MOCKS)
+        list(APPEND _sources
+            ${_umock_dir}/umocktypename.c
+            ${_umock_dir}/umockstring.c
+            ${_umock_dir}/umock_log.c
+            ${_umock_dir}/umock_c_negative_tests.c
+            ${_umock_dir}/umock_c.c
+            ${_umock_dir}/umockcallrecorder.c
+            ${_umock_dir}/umockcall.c
+            ${_umock_dir}/umocktypes_c.c
+            ${_umock_dir}/umocktypes.c
+            ${_umock_dir}/umocktypes_bool.c
+            ${_umock_dir}/umockcallpairs.c
+            ${_umock_dir}/umockautoignoreargs.c
+            ${_umock_dir}/umockalloc.c
+            ${_umock_dir}/umocktypes_wcharptr.c
+            ${_umock_dir}/umocktypes_stdint.c
+            ${_umock_dir}/umocktypes_charptr.c
+        )
+    endif()
+
+    set(${OUT_VAR} ${_sources} PARENT_SCOPE)
+endfunction()
+
+# Find binutils size into OUT_VAR (a cache variable, so it can be given on the command line):
+# CMAKE_SIZE when the toolchain sets it, else <prefix>size next to the C compiler, e.g.
+# arm-none-eabi-size for arm-none-eabi-gcc, else size or llvm-size on PATH.
+function(azure_client_find_size_tool OUT_VAR)
+    if(CMAKE_SIZE)
+        set(${OUT_VAR} ${CMAKE_SIZE} CACHE FILEPATH "binutils size for the size report")
+        return()
+    endif()
+
+    get_filename_component(_compiler_dir "${CMAKE_C_COMPILER}" DIRECTORY)
+    get_filename_component(_compiler_name "${CMAKE_C_COMPILER}" NAME)
+    if(_compiler_name MATCHES "^(.+-)(gcc|cc|clang)(-[0-9.]+)?(\\.exe)?$")
+        find_program(${OUT_VAR} NAMES ${CMAKE_MATCH_1}size HINTS "${_compiler_dir}" NO_DEFAULT_PATH)
+        find_program(${OUT_VAR} NAMES ${CMAKE_MATCH_1}size)
+    endif()
+
+    # Fallback: host tools read the object files of most targets
+    find_program(${OUT_VAR} NAMES size llvm-size HINTS "${_compiler_dir}")
+endfunction()
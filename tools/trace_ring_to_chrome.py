@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 Nuvoton Technology Corporation
+# Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+"""Convert trace_ring_dump() console output to Chrome trace_event JSON.
+
+Usage: trace_ring_to_chrome.py console.log > trace.json
+Then open trace.json in chrome://tracing or https://ui.perfetto.dev.
+"""
+
+import json
+import re
+import sys
+
+EVENT_RE = re.compile(r"trace_ring: (\d+) ([BEi]) ([0-9a-fA-F]{8}) (.*?)\r?$")
+
+
+def convert(lines):
+    events = []
+    threads = {}
+    last_us = None
+    wrap_us = 0
+
+    for line in lines:
+        if "trace_ring: begin" in line:
+            # New dump: keep the last one only
+            events = []
+            threads = {}
+            last_us = None
+            wrap_us = 0
+            continue
+
+        match = EVENT_RE.search(line)
+        if not match:
+            continue
+
+        timestamp_us = int(match.group(1))
+        # Undo wrap of 32-bit us timestamp. Events are dumped oldest first.
+        if last_us is not None and timestamp_us + wrap_us < last_us:
+            wrap_us += 1 << 32
+        timestamp_us += wrap_us
+        last_us = timestamp_us
+
+        thread = match.group(3).lower()
+        tid = threads.setdefault(thread, len(threads) + 1)
+
+        event = {
+            "name": match.group(4),
+            "ph": match.group(2),
+            "ts": timestamp_us,
+            "pid": 1,
+            "tid": tid,
+        }
+        if event["ph"] == "i":
+            event["s"] = "t"
+        events.append(event)
+
+    for thread, tid in threads.items():
+        name = "ISR" if int(thread, 16) == 0 else "thread " + thread
+        events.append({"name": "thread_name", "ph": "M", "pid": 1, "tid": tid, "args": {"name": name}})
+
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) > 2:
+        sys.exit(__doc__)
+
+    if len(sys.argv) == 2:
+        with open(sys.argv[1], encoding="utf-8", errors="replace") as log:
+            trace = convert(log)
+    else:
+        trace = convert(sys.stdin)
+
+    json.dump(trace, sys.stdout, indent=1)
+
+
+if __name__ == "__main__":
+    main()